@@ -5,9 +5,13 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <unordered_map>
+
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
+#include "flashlight/lib/text/decoder/BatchLexiconDecoder.h"
+#include "flashlight/lib/text/decoder/FlatTrie.h"
 #include "flashlight/lib/text/decoder/LexiconDecoder.h"
 #include "flashlight/lib/text/decoder/LexiconFreeDecoder.h"
 
@@ -128,6 +132,18 @@ std::vector<DecodeResult> LexiconFreeDecoder_decode(
   return decoder.decode(reinterpret_cast<const float*>(emissions), T, N);
 }
 
+std::vector<std::vector<DecodeResult>> BatchLexiconDecoder_decode(
+    BatchLexiconDecoder& decoder,
+    const std::vector<uintptr_t>& emissions,
+    const std::vector<int>& T,
+    int N) {
+  std::vector<const float*> emissionPtrs;
+  for (auto emission : emissions) {
+    emissionPtrs.push_back(reinterpret_cast<const float*>(emission));
+  }
+  return decoder.decode(emissionPtrs, T, N);
+}
+
 } // namespace
 
 PYBIND11_MODULE(flashlight_lib_text_decoder, m) {
@@ -151,6 +167,42 @@ PYBIND11_MODULE(flashlight_lib_text_decoder, m) {
       .def("search", &Trie::search, "indices"_a)
       .def("smear", &Trie::smear, "smear_mode"_a);
 
+  py::class_<FlatTrieNode>(m, "FlatTrieNode")
+      .def_readonly("max_score", &FlatTrieNode::maxScore)
+      .def_readonly("num_children", &FlatTrieNode::nChildren)
+      .def_readonly("num_labels", &FlatTrieNode::nLabels);
+
+  // Nodes point into the trie storage: keep the trie alive while in use
+  py::class_<FlatTrie, FlatTriePtr>(m, "FlatTrie")
+      .def(py::init<const Trie&>(), "trie"_a)
+      .def(py::init<const std::string&>(), "path"_a)
+      .def("save", &FlatTrie::save, "path"_a)
+      .def(
+          "get_root",
+          &FlatTrie::getRoot,
+          py::return_value_policy::reference_internal)
+      .def(
+          "search",
+          &FlatTrie::search,
+          "indices"_a,
+          py::return_value_policy::reference_internal)
+      .def(
+          "labels",
+          [](const FlatTrie& trie, const FlatTrieNode* node) {
+            return std::vector<int>(
+                trie.labels(node), trie.labels(node) + node->nLabels);
+          },
+          "node"_a)
+      .def(
+          "scores",
+          [](const FlatTrie& trie, const FlatTrieNode* node) {
+            return std::vector<float>(
+                trie.scores(node), trie.scores(node) + node->nLabels);
+          },
+          "node"_a)
+      .def("num_nodes", &FlatTrie::numNodes)
+      .def("is_mapped", &FlatTrie::isMapped);
+
   py::class_<LM, LMPtr, PyLM>(m, "LM")
       .def(py::init<>())
       .def("start", &LM::start, "start_with_nothing"_a)
@@ -159,7 +211,16 @@ PYBIND11_MODULE(flashlight_lib_text_decoder, m) {
 
   py::class_<LMState, LMStatePtr>(m, "LMState")
       .def(py::init<>())
-      .def_readwrite("children", &LMState::children)
+      .def_property_readonly(
+          "children",
+          [](const LMState& state) {
+            std::unordered_map<int, LMStatePtr> children;
+            state.children.forEach(
+                [&children](int usrIdx, const LMStatePtr& child) {
+                  children.emplace(usrIdx, child);
+                });
+            return children;
+          })
       .def("compare", &LMState::compare, "state"_a)
       .def("child", &LMState::child<LMState>, "usr_index"_a);
 
@@ -250,6 +311,15 @@ PYBIND11_MODULE(flashlight_lib_text_decoder, m) {
            const int,
            const std::vector<float>&,
            const bool>())
+      .def(py::init<
+           LexiconDecoderOptions,
+           const FlatTriePtr,
+           const LMPtr,
+           const int,
+           const int,
+           const int,
+           const std::vector<float>&,
+           const bool>())
       .def("decode_begin", &LexiconDecoder::decodeBegin)
       .def(
           "decode_step",
@@ -260,12 +330,33 @@ PYBIND11_MODULE(flashlight_lib_text_decoder, m) {
       .def("decode_end", &LexiconDecoder::decodeEnd)
       .def("decode", &LexiconDecoder_decode, "emissions"_a, "T"_a, "N"_a)
       .def("prune", &LexiconDecoder::prune, "look_back"_a = 0)
+      .def(
+          "commit",
+          &LexiconDecoder::commit,
+          "max_uncommitted_frames"_a = -1)
       .def(
           "get_best_hypothesis",
           &LexiconDecoder::getBestHypothesis,
           "look_back"_a = 0)
       .def("get_all_final_hypothesis", &LexiconDecoder::getAllFinalHypothesis);
 
+  py::class_<BatchLexiconDecoder>(m, "BatchLexiconDecoder")
+      .def(py::init<
+           LexiconDecoderOptions,
+           const FlatTriePtr,
+           const LMPtr,
+           const int,
+           const int,
+           const int,
+           const std::vector<float>&,
+           const bool>())
+      .def(
+          "decode",
+          &BatchLexiconDecoder_decode,
+          "emissions"_a,
+          "T"_a,
+          "N"_a);
+
   py::class_<LexiconFreeDecoder>(m, "LexiconFreeDecoder")
       .def(py::init<
            LexiconFreeDecoderOptions,
@@ -8,8 +8,11 @@ LICENSE file in the root directory of this source tree.
 
 from .flashlight_lib_text_decoder import (
     LM,
+    BatchLexiconDecoder,
     CriterionType,
     DecodeResult,
+    FlatTrie,
+    FlatTrieNode,
     LexiconDecoderOptions,
     LexiconFreeDecoderOptions,
     KenLM,
@@ -61,3 +61,32 @@ function(build_test)
     )
   gtest_add_tests(TARGET ${target})
 endfunction(build_test)
+
+# Benchmarks have their own main() and are built along with the tests, but
+# are not registered with ctest
+function(build_benchmark)
+  set(options)
+  set(oneValueArgs SRC)
+  set(multiValueArgs LIBS PREPROC)
+  cmake_parse_arguments(build_benchmark "${options}" "${oneValueArgs}"
+    "${multiValueArgs}" ${ARGN})
+
+  get_filename_component(src_name ${build_benchmark_SRC} NAME_WE)
+  set(target "${src_name}")
+  add_executable(${target} ${build_benchmark_SRC})
+  target_link_libraries(
+    ${target}
+    PUBLIC
+    ${build_benchmark_LIBS}
+    )
+  target_include_directories(
+    ${target}
+    PUBLIC
+    ${PROJECT_SOURCE_DIR}
+    )
+  target_compile_definitions(
+    ${target}
+    PUBLIC
+    ${build_benchmark_PREPROC}
+    )
+endfunction(build_benchmark)
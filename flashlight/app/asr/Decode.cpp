@@ -5,6 +5,7 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <cmath>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
@@ -33,12 +34,15 @@
 #include "flashlight/ext/common/Serializer.h"
 #include "flashlight/ext/plugin/ModulePlugin.h"
 #include "flashlight/lib/common/ProducerConsumerQueue.h"
+#include "flashlight/lib/text/decoder/BatchSeq2SeqDecoder.h"
+#include "flashlight/lib/text/decoder/FlatTrie.h"
 #include "flashlight/lib/text/decoder/LexiconDecoder.h"
 #include "flashlight/lib/text/decoder/LexiconFreeDecoder.h"
 #include "flashlight/lib/text/decoder/LexiconFreeSeq2SeqDecoder.h"
 #include "flashlight/lib/text/decoder/LexiconSeq2SeqDecoder.h"
 #include "flashlight/lib/text/decoder/lm/ConvLM.h"
 #include "flashlight/lib/text/decoder/lm/KenLM.h"
+#include "flashlight/lib/text/decoder/lm/MemoizedLM.h"
 #include "flashlight/lib/text/decoder/lm/ZeroLM.h"
 
 using fl::ext::afToVector;
@@ -132,6 +136,7 @@ int main(int argc, char** argv) {
   // Only Copy any values from deprecated flags to new flags when deprecated
   // flags are present and corresponding new flags aren't
   handleDeprecatedFlags();
+  fl::OptimMode::get().setBf16CpuCompute(FLAGS_fl_cpu_bf16);
 
   LOG(INFO) << "Gflags after parsing \n" << serializeGflags("; ");
 
@@ -181,6 +186,49 @@ int main(int argc, char** argv) {
   std::vector<int> sliceNumSamples(FLAGS_nthread_decoder, 0);
   std::vector<double> sliceTime(FLAGS_nthread_decoder, 0);
 
+  if (FLAGS_decoder_batchsize <= 0) {
+    LOG(FATAL) << "FLAGS_decoder_batchsize (" << FLAGS_decoder_batchsize
+               << ") need to be positive ";
+  }
+  if (FLAGS_decoder_batchsize > 1 && !isSeq2seqCrit) {
+    LOG(FATAL) << "[Decoder] Batch decoding is only supported for "
+               << "'seq2seq'/'transformer' criterion";
+  }
+
+  // (lmweight, wordscore) grid decoded in a single pass
+  std::vector<std::pair<double, double>> sweepGrid;
+  if (FLAGS_sweep) {
+    if (FLAGS_isbeamdump) {
+      LOG(FATAL) << "[Decoder] Beam dump is not supported with sweep";
+    }
+    if (FLAGS_decoder_batchsize > 1) {
+      LOG(FATAL) << "[Decoder] Batch decoding is not supported with sweep";
+    }
+    if (FLAGS_lmweight_step <= 0 || FLAGS_wordscore_step <= 0) {
+      LOG(FATAL) << "[Decoder] Sweep steps need to be positive";
+    }
+    // Tolerance for the rounding of the boundaries
+    int nLmWeights = std::floor(
+        (FLAGS_lmweight_high - FLAGS_lmweight_low) / FLAGS_lmweight_step +
+        1 + 1e-6);
+    int nWordScores = std::floor(
+        (FLAGS_wordscore_high - FLAGS_wordscore_low) / FLAGS_wordscore_step +
+        1 + 1e-6);
+    for (int i = 0; i < nLmWeights; i++) {
+      for (int j = 0; j < nWordScores; j++) {
+        sweepGrid.emplace_back(
+            FLAGS_lmweight_low + i * FLAGS_lmweight_step,
+            FLAGS_wordscore_low + j * FLAGS_wordscore_step);
+      }
+    }
+    LOG(INFO) << "[Decoder] Sweep over " << sweepGrid.size()
+              << " (lmweight, wordscore) values";
+  }
+  std::vector<std::vector<double>> sweepWrdDst(
+      sweepGrid.size(), std::vector<double>(FLAGS_nthread_decoder, 0));
+  std::vector<std::vector<double>> sweepTknDst(
+      sweepGrid.size(), std::vector<double>(FLAGS_nthread_decoder, 0));
+
   // Prepare criterion
   CriterionType criterionType = CriterionType::ASG;
   if (FLAGS_criterion == kCtcCriterion) {
@@ -262,13 +310,22 @@ int main(int argc, char** argv) {
       }
       convLmModel->eval();
 
-      auto getConvLmScoreFunc = buildGetConvLmScoreFunction(convLmModel);
-      lm = std::make_shared<fl::lib::text::ConvLM>(
-          getConvLmScoreFunc,
-          FLAGS_lm_vocab,
-          usrDict,
-          FLAGS_lm_memory,
-          FLAGS_beamsize);
+      if (FLAGS_lm_incremental) {
+        lm = std::make_shared<fl::lib::text::ConvLM>(
+            buildGetConvLmIncrementalScoreFunction(convLmModel),
+            FLAGS_lm_vocab,
+            usrDict,
+            FLAGS_lm_memory,
+            FLAGS_beamsize);
+      } else {
+        auto getConvLmScoreFunc = buildGetConvLmScoreFunction(convLmModel);
+        lm = std::make_shared<fl::lib::text::ConvLM>(
+            getConvLmScoreFunc,
+            FLAGS_lm_vocab,
+            usrDict,
+            FLAGS_lm_memory,
+            FLAGS_beamsize);
+      }
     } else {
       LOG(FATAL) << "[LM constructing] Invalid LM Type: " << FLAGS_lmtype;
     }
@@ -282,17 +339,54 @@ int main(int argc, char** argv) {
   if (FLAGS_wordseparator != "") {
     silIdx = tokenDict.getIndex(FLAGS_wordseparator);
   }
-  std::shared_ptr<fl::lib::text::Trie> trie = buildTrie(
-      FLAGS_decodertype,
-      FLAGS_uselexicon,
-      lm,
-      FLAGS_smearing,
-      tokenDict,
-      lexicon,
-      wordDict,
-      silIdx,
-      FLAGS_replabel);
-  LOG(INFO) << "[Decoder] Trie smeared.\n";
+  // Decoders share one flattened trie, memory mapped when it is cached and
+  // was built from the same inputs
+  std::shared_ptr<fl::lib::text::FlatTrie> trie;
+  uint64_t trieInputs = 0;
+  if (!FLAGS_flattrie.empty()) {
+    trieInputs = trieFingerprint(
+        FLAGS_decodertype,
+        FLAGS_uselexicon,
+        lm,
+        FLAGS_smearing,
+        tokenDict,
+        lexicon,
+        wordDict,
+        silIdx,
+        FLAGS_replabel);
+    if (fl::lib::fileExists(FLAGS_flattrie)) {
+      auto mappedTrie =
+          std::make_shared<fl::lib::text::FlatTrie>(FLAGS_flattrie);
+      if (mappedTrie->fingerprint() == trieInputs) {
+        trie = mappedTrie;
+        LOG(INFO) << "[Decoder] Trie mapped from " << FLAGS_flattrie << "\n";
+      } else {
+        LOG(WARNING) << "[Decoder] Trie in " << FLAGS_flattrie
+                     << " was built from another lexicon, token/word "
+                     << "dictionary, smearing or LM: rebuilding it";
+      }
+    }
+  }
+  if (!trie) {
+    auto fullTrie = buildTrie(
+        FLAGS_decodertype,
+        FLAGS_uselexicon,
+        lm,
+        FLAGS_smearing,
+        tokenDict,
+        lexicon,
+        wordDict,
+        silIdx,
+        FLAGS_replabel);
+    if (fullTrie) {
+      trie = std::make_shared<fl::lib::text::FlatTrie>(*fullTrie, trieInputs);
+      if (!FLAGS_flattrie.empty()) {
+        trie->save(FLAGS_flattrie);
+        LOG(INFO) << "[Decoder] Trie saved to " << FLAGS_flattrie;
+      }
+    }
+    LOG(INFO) << "[Decoder] Trie smeared.\n";
+  }
 
   /* ===================== Create Dataset ===================== */
   fl::lib::audio::FeatureParams featParams(
@@ -474,7 +568,10 @@ int main(int argc, char** argv) {
                      &sliceNumWords,
                      &sliceNumTokens,
                      &sliceNumSamples,
-                     &sliceTime](int tid) {
+                     &sliceTime,
+                     &sweepGrid,
+                     &sweepWrdDst,
+                     &sweepTknDst](int tid) {
     /* 1. Prepare GPU-dependent resources */
     // Note: These 2 GPU-dependent models should be placed on different
     // cards
@@ -500,13 +597,22 @@ int main(int argc, char** argv) {
         Serializer::load(FLAGS_lm, convlmVersion, convLmModel);
         convLmModel->eval();
 
-        auto getConvLmScoreFunc = buildGetConvLmScoreFunction(convLmModel);
-        localLm = std::make_shared<fl::lib::text::ConvLM>(
-            getConvLmScoreFunc,
-            FLAGS_lm_vocab,
-            usrDict,
-            FLAGS_lm_memory,
-            FLAGS_beamsize);
+        if (FLAGS_lm_incremental) {
+          localLm = std::make_shared<fl::lib::text::ConvLM>(
+              buildGetConvLmIncrementalScoreFunction(convLmModel),
+              FLAGS_lm_vocab,
+              usrDict,
+              FLAGS_lm_memory,
+              FLAGS_beamsize);
+        } else {
+          auto getConvLmScoreFunc = buildGetConvLmScoreFunction(convLmModel);
+          localLm = std::make_shared<fl::lib::text::ConvLM>(
+              getConvLmScoreFunc,
+              FLAGS_lm_vocab,
+              usrDict,
+              FLAGS_lm_memory,
+              FLAGS_beamsize);
+        }
       }
 
       if (criterionType == CriterionType::S2S) {
@@ -518,127 +624,195 @@ int main(int argc, char** argv) {
     }
 
     /* 2. Build Decoder */
-    std::unique_ptr<fl::lib::text::Decoder> decoder;
     if (FLAGS_decodertype != "wrd" && FLAGS_decodertype != "tkn") {
       LOG(FATAL) << "Unsupported decoder type: " << FLAGS_decodertype;
     }
 
-    if (criterionType == CriterionType::S2S) {
-      auto amUpdateFunc = FLAGS_criterion == kSeq2SeqRNNCriterion
-          ? buildSeq2SeqRnnAmUpdateFunction(
+    auto buildDecoder = [&](double lmWeight,
+                            double wordScore,
+                            const fl::lib::text::LMPtr& decoderLm) {
+      std::unique_ptr<fl::lib::text::Decoder> decoder;
+      if (criterionType == CriterionType::S2S) {
+        auto amUpdateFunc = FLAGS_criterion == kSeq2SeqRNNCriterion
+            ? buildSeq2SeqRnnAmUpdateFunction(
+                  localCriterion,
+                  FLAGS_decoderattnround,
+                  FLAGS_beamsize,
+                  FLAGS_attentionthreshold,
+                  FLAGS_smoothingtemperature)
+            : buildSeq2SeqTransformerAmUpdateFunction(
+                  localCriterion,
+                  FLAGS_beamsize,
+                  FLAGS_attentionthreshold,
+                  FLAGS_smoothingtemperature);
+        int eosIdx = tokenDict.getIndex(fl::app::asr::kEosToken);
+
+        if (FLAGS_decodertype == "wrd" || FLAGS_uselexicon) {
+          decoder.reset(new fl::lib::text::LexiconSeq2SeqDecoder(
+              {
+                  .beamSize = FLAGS_beamsize,
+                  .beamSizeToken = FLAGS_beamsizetoken,
+                  .beamThreshold = FLAGS_beamthreshold,
+                  .lmWeight = lmWeight,
+                  .wordScore = wordScore,
+                  .eosScore = FLAGS_eosscore,
+                  .logAdd = FLAGS_logadd,
+              },
+              trie,
+              decoderLm,
+              eosIdx,
+              amUpdateFunc,
+              FLAGS_maxdecoderoutputlen,
+              FLAGS_decodertype == "tkn"));
+          LOG(INFO) << "[Decoder] LexiconSeq2Seq decoder with "
+                    << FLAGS_decodertype << "-LM loaded in thread: " << tid;
+        } else {
+          decoder.reset(new fl::lib::text::LexiconFreeSeq2SeqDecoder(
+              {
+                  .beamSize = FLAGS_beamsize,
+                  .beamSizeToken = FLAGS_beamsizetoken,
+                  .beamThreshold = FLAGS_beamthreshold,
+                  .lmWeight = lmWeight,
+                  .eosScore = FLAGS_eosscore,
+                  .logAdd = FLAGS_logadd,
+              },
+              decoderLm,
+              eosIdx,
+              amUpdateFunc,
+              FLAGS_maxdecoderoutputlen));
+          LOG(INFO)
+              << "[Decoder] LexiconFreeSeq2Seq decoder with token-LM loaded in thread: "
+              << tid;
+        }
+      } else {
+        if (FLAGS_decodertype == "wrd" || FLAGS_uselexicon) {
+          decoder.reset(new fl::lib::text::LexiconDecoder(
+              {.beamSize = FLAGS_beamsize,
+               .beamSizeToken = FLAGS_beamsizetoken,
+               .beamThreshold = FLAGS_beamthreshold,
+               .lmWeight = lmWeight,
+               .wordScore = wordScore,
+               .unkScore = FLAGS_unkscore,
+               .silScore = FLAGS_silscore,
+               .logAdd = FLAGS_logadd,
+               .criterionType = criterionType},
+              trie,
+              decoderLm,
+              silIdx,
+              blankIdx,
+              unkWordIdx,
+              transition,
+              FLAGS_decodertype == "tkn"));
+          LOG(INFO) << "[Decoder] Lexicon decoder with " << FLAGS_decodertype
+                    << "-LM loaded in thread: " << tid;
+        } else {
+          decoder.reset(new fl::lib::text::LexiconFreeDecoder(
+              {.beamSize = FLAGS_beamsize,
+               .beamSizeToken = FLAGS_beamsizetoken,
+               .beamThreshold = FLAGS_beamthreshold,
+               .lmWeight = lmWeight,
+               .silScore = FLAGS_silscore,
+               .logAdd = FLAGS_logadd,
+               .criterionType = criterionType},
+              decoderLm,
+              silIdx,
+              blankIdx,
+              transition));
+          LOG(INFO)
+              << "[Decoder] Lexicon-free decoder with token-LM loaded in thread: "
+              << tid;
+        }
+      }
+      return decoder;
+    };
+
+    std::unique_ptr<fl::lib::text::Decoder> decoder;
+    // Seq2Seq batch decoding: one decoder per utterance of the batch, whose
+    // hypothesis go through the AM together
+    std::unique_ptr<fl::lib::text::BatchSeq2SeqDecoder> batchDecoder;
+    // Sweep: every grid point decodes each emission in turn and the LM is
+    // queried once per history and utterance
+    std::shared_ptr<fl::lib::text::MemoizedLM> sweepLm;
+    std::vector<std::unique_ptr<fl::lib::text::Decoder>> sweepDecoders;
+    std::vector<fl::EditDistanceMeter> sweepWrdMeters(sweepGrid.size());
+    std::vector<fl::EditDistanceMeter> sweepTknMeters(sweepGrid.size());
+    if (sweepGrid.empty() && FLAGS_decoder_batchsize > 1) {
+      std::vector<fl::lib::text::Seq2SeqDecoderPtr> batchDecoders;
+      for (int i = 0; i < FLAGS_decoder_batchsize; i++) {
+        std::shared_ptr<fl::lib::text::Decoder> utteranceDecoder =
+            buildDecoder(FLAGS_lmweight, FLAGS_wordscore, localLm);
+        batchDecoders.push_back(
+            std::dynamic_pointer_cast<fl::lib::text::Seq2SeqDecoder>(
+                utteranceDecoder));
+      }
+      int maxBatchSize = FLAGS_beamsize * FLAGS_decoder_batchsize;
+      auto batchAmUpdateFunc = FLAGS_criterion == kSeq2SeqRNNCriterion
+          ? buildSeq2SeqRnnBatchAmUpdateFunction(
                 localCriterion,
                 FLAGS_decoderattnround,
-                FLAGS_beamsize,
+                maxBatchSize,
                 FLAGS_attentionthreshold,
                 FLAGS_smoothingtemperature)
-          : buildSeq2SeqTransformerAmUpdateFunction(
+          : buildSeq2SeqTransformerBatchAmUpdateFunction(
                 localCriterion,
-                FLAGS_beamsize,
+                maxBatchSize,
                 FLAGS_attentionthreshold,
                 FLAGS_smoothingtemperature);
-      int eosIdx = tokenDict.getIndex(fl::app::asr::kEosToken);
-
-      if (FLAGS_decodertype == "wrd" || FLAGS_uselexicon) {
-        decoder.reset(new fl::lib::text::LexiconSeq2SeqDecoder(
-            {
-                .beamSize = FLAGS_beamsize,
-                .beamSizeToken = FLAGS_beamsizetoken,
-                .beamThreshold = FLAGS_beamthreshold,
-                .lmWeight = FLAGS_lmweight,
-                .wordScore = FLAGS_wordscore,
-                .eosScore = FLAGS_eosscore,
-                .logAdd = FLAGS_logadd,
-            },
-            trie,
-            localLm,
-            eosIdx,
-            amUpdateFunc,
-            FLAGS_maxdecoderoutputlen,
-            FLAGS_decodertype == "tkn"));
-        LOG(INFO) << "[Decoder] LexiconSeq2Seq decoder with "
-                  << FLAGS_decodertype << "-LM loaded in thread: " << tid;
-      } else {
-        decoder.reset(new fl::lib::text::LexiconFreeSeq2SeqDecoder(
-            {
-                .beamSize = FLAGS_beamsize,
-                .beamSizeToken = FLAGS_beamsizetoken,
-                .beamThreshold = FLAGS_beamthreshold,
-                .lmWeight = FLAGS_lmweight,
-                .eosScore = FLAGS_eosscore,
-                .logAdd = FLAGS_logadd,
-            },
-            localLm,
-            eosIdx,
-            amUpdateFunc,
-            FLAGS_maxdecoderoutputlen));
-        LOG(INFO)
-            << "[Decoder] LexiconFreeSeq2Seq decoder with token-LM loaded in thread: "
-            << tid;
-      }
+      batchDecoder = std::make_unique<fl::lib::text::BatchSeq2SeqDecoder>(
+          std::move(batchDecoders), batchAmUpdateFunc);
+      LOG(INFO) << "[Decoder] Decoding batches of " << FLAGS_decoder_batchsize
+                << " utterances in thread: " << tid;
+    } else if (sweepGrid.empty()) {
+      decoder = buildDecoder(FLAGS_lmweight, FLAGS_wordscore, localLm);
     } else {
-      if (FLAGS_decodertype == "wrd" || FLAGS_uselexicon) {
-        decoder.reset(new fl::lib::text::LexiconDecoder(
-            {.beamSize = FLAGS_beamsize,
-             .beamSizeToken = FLAGS_beamsizetoken,
-             .beamThreshold = FLAGS_beamthreshold,
-             .lmWeight = FLAGS_lmweight,
-             .wordScore = FLAGS_wordscore,
-             .unkScore = FLAGS_unkscore,
-             .silScore = FLAGS_silscore,
-             .logAdd = FLAGS_logadd,
-             .criterionType = criterionType},
-            trie,
-            localLm,
-            silIdx,
-            blankIdx,
-            unkWordIdx,
-            transition,
-            FLAGS_decodertype == "tkn"));
-        LOG(INFO) << "[Decoder] Lexicon decoder with " << FLAGS_decodertype
-                  << "-LM loaded in thread: " << tid;
-      } else {
-        decoder.reset(new fl::lib::text::LexiconFreeDecoder(
-            {.beamSize = FLAGS_beamsize,
-             .beamSizeToken = FLAGS_beamsizetoken,
-             .beamThreshold = FLAGS_beamthreshold,
-             .lmWeight = FLAGS_lmweight,
-             .silScore = FLAGS_silscore,
-             .logAdd = FLAGS_logadd,
-             .criterionType = criterionType},
-            localLm,
-            silIdx,
-            blankIdx,
-            transition));
-        LOG(INFO)
-            << "[Decoder] Lexicon-free decoder with token-LM loaded in thread: "
-            << tid;
+      sweepLm = std::make_shared<fl::lib::text::MemoizedLM>(localLm);
+      for (const auto& point : sweepGrid) {
+        sweepDecoders.push_back(
+            buildDecoder(point.first, point.second, sweepLm));
       }
     }
+
     /* 3. Get data and run decoder */
     TestMeters meters;
-    EmissionTargetPair emissionTargetPair;
-    while (emissionQueue.get(emissionTargetPair)) {
-      const auto& emissionUnit = emissionTargetPair.first;
-      const auto& targetUnit = emissionTargetPair.second;
-
-      const auto& nFrames = emissionUnit.nFrames;
-      const auto& nTokens = emissionUnit.nTokens;
-      const auto& emission = emissionUnit.emission;
-      const auto& sampleId = emissionUnit.sampleId;
-      const auto& wordTarget = targetUnit.wordTargetStr;
-      const auto& tokenTarget = targetUnit.tokenTarget;
-      // DecodeResult
-      meters.timer.reset();
-      meters.timer.resume();
-      const auto& results = decoder->decode(emission.data(), nFrames, nTokens);
-      meters.timer.stop();
-
-      int nTopHyps = FLAGS_isbeamdump ? results.size() : 1;
-      for (int i = 0; i < nTopHyps; i++) {
-        // Cleanup predictions
-        auto rawWordPrediction = results[i].words;
-        auto rawTokenPrediction = results[i].tokens;
-
+    int batchSize = batchDecoder ? FLAGS_decoder_batchsize : 1;
+    std::vector<EmissionTargetPair> batch;
+    auto getBatch = [&]() {
+      batch.clear();
+      EmissionTargetPair emissionTargetPair;
+      while (batch.size() < batchSize &&
+             emissionQueue.get(emissionTargetPair)) {
+        batch.push_back(std::move(emissionTargetPair));
+      }
+      return !batch.empty();
+    };
+    while (getBatch()) {
+      std::vector<std::vector<fl::lib::text::DecodeResult>> batchResults;
+      double batchTime = 0;
+      if (batchDecoder) {
+        std::vector<const float*> emissions;
+        std::vector<int> nFrames;
+        for (const auto& emissionTargetPair : batch) {
+          emissions.push_back(emissionTargetPair.first.emission.data());
+          nFrames.push_back(emissionTargetPair.first.nFrames);
+        }
+        meters.timer.reset();
+        meters.timer.resume();
+        batchResults = batchDecoder->decode(
+            emissions, nFrames, batch.front().first.nTokens);
+        meters.timer.stop();
+        // Share the decoding time evenly between the utterances of the batch
+        batchTime = meters.timer.value() / batch.size();
+      }
+      for (int b = 0; b < batch.size(); b++) {
+        const auto& emissionUnit = batch[b].first;
+        const auto& targetUnit = batch[b].second;
+
+        const auto& nFrames = emissionUnit.nFrames;
+        const auto& nTokens = emissionUnit.nTokens;
+        const auto& emission = emissionUnit.emission;
+        const auto& sampleId = emissionUnit.sampleId;
+        const auto& wordTarget = targetUnit.wordTargetStr;
+        const auto& tokenTarget = targetUnit.tokenTarget;
         auto letterTarget = tknTarget2Ltr(
             tokenTarget,
             tokenDict,
@@ -648,92 +822,140 @@ int main(int argc, char** argv) {
             FLAGS_replabel,
             FLAGS_usewordpiece,
             FLAGS_wordseparator);
-        auto letterPrediction = tknPrediction2Ltr(
-            rawTokenPrediction,
-            tokenDict,
-            FLAGS_criterion,
-            FLAGS_surround,
-            isSeq2seqCrit,
-            FLAGS_replabel,
-            FLAGS_usewordpiece,
-            FLAGS_wordseparator);
-        std::vector<std::string> wordPrediction;
-        if (FLAGS_uselexicon) {
-          rawWordPrediction =
-              validateIdx(rawWordPrediction, wordDict.getIndex(kUnkToken));
-          wordPrediction = wrdIdx2Wrd(rawWordPrediction, wordDict);
-        } else {
-          wordPrediction = tkn2Wrd(letterPrediction, FLAGS_wordseparator);
-        }
-        auto wordTargetStr = join(" ", wordTarget);
-        auto wordPredictionStr = join(" ", wordPrediction);
-
-        // Normal decoding and computing WER
-        if (!FLAGS_isbeamdump) {
-          meters.wrdDstSlice.add(wordPrediction, wordTarget);
-          meters.tknDstSlice.add(letterPrediction, letterTarget);
-
-          if (!FLAGS_sclite.empty()) {
-            std::string suffix = " (" + sampleId + ")\n";
-            writeHyp(wordPredictionStr + suffix);
-            writeRef(wordTargetStr + suffix);
-          }
 
-          if (FLAGS_show) {
-            meters.wrdDst.reset();
-            meters.tknDst.reset();
-            meters.wrdDst.add(wordPrediction, wordTarget);
-            meters.tknDst.add(letterPrediction, letterTarget);
-
-            std::stringstream buffer;
-            buffer << "|T|: " << wordTargetStr << std::endl;
-            buffer << "|P|: " << wordPredictionStr << std::endl;
-            if (FLAGS_showletters) {
-              buffer << "|t|: " << join(" ", letterTarget) << std::endl;
-              buffer << "|p|: " << join(" ", letterPrediction) << std::endl;
-            }
-            buffer << "[sample: " << sampleId
-                   << ", WER: " << meters.wrdDst.errorRate()[0]
-                   << "\%, TER: " << meters.tknDst.errorRate()[0]
-                   << "\%, slice WER: " << meters.wrdDstSlice.errorRate()[0]
-                   << "\%, slice TER: " << meters.tknDstSlice.errorRate()[0]
-                   << "\%, decoded samples (thread " << tid
-                   << "): " << sliceNumSamples[tid] + 1 << "]" << std::endl;
-
-            std::cout << buffer.str();
-            if (!FLAGS_sclite.empty()) {
-              writeLog(buffer.str());
-            }
+        // Cleanup predictions
+        auto getPrediction = [&](const fl::lib::text::DecodeResult& result,
+                                 std::vector<std::string>& wordPrediction,
+                                 std::vector<std::string>& letterPrediction) {
+          letterPrediction = tknPrediction2Ltr(
+              result.tokens,
+              tokenDict,
+              FLAGS_criterion,
+              FLAGS_surround,
+              isSeq2seqCrit,
+              FLAGS_replabel,
+              FLAGS_usewordpiece,
+              FLAGS_wordseparator);
+          if (FLAGS_uselexicon) {
+            auto rawWordPrediction =
+                validateIdx(result.words, wordDict.getIndex(kUnkToken));
+            wordPrediction = wrdIdx2Wrd(rawWordPrediction, wordDict);
+          } else {
+            wordPrediction = tkn2Wrd(letterPrediction, FLAGS_wordseparator);
           }
-
-          // Update conters
+        };
+
+        if (!sweepDecoders.empty()) {
+          meters.timer.reset();
+          meters.timer.resume();
+          sweepLm->clear();
+          std::vector<std::string> wordPrediction, letterPrediction;
+          for (int i = 0; i < sweepDecoders.size(); i++) {
+            const auto& results =
+                sweepDecoders[i]->decode(emission.data(), nFrames, nTokens);
+            getPrediction(results.front(), wordPrediction, letterPrediction);
+            sweepWrdMeters[i].add(wordPrediction, wordTarget);
+            sweepTknMeters[i].add(letterPrediction, letterTarget);
+          }
+          meters.timer.stop();
           sliceNumWords[tid] += wordTarget.size();
           sliceNumTokens[tid] += letterTarget.size();
           sliceTime[tid] += meters.timer.value();
           sliceNumSamples[tid] += 1;
+          continue;
+        }
+
+        // DecodeResult
+        std::vector<fl::lib::text::DecodeResult> results;
+        double decodeTime = batchTime;
+        if (batchDecoder) {
+          results = std::move(batchResults[b]);
+        } else {
+          meters.timer.reset();
+          meters.timer.resume();
+          results = decoder->decode(emission.data(), nFrames, nTokens);
+          meters.timer.stop();
+          decodeTime = meters.timer.value();
         }
-        // Beam Dump
-        else {
-          meters.wrdDst.reset();
-          meters.wrdDst.add(wordPrediction, wordTarget);
-          auto wer = meters.wrdDst.errorRate()[0];
-
-          if (FLAGS_sclite.empty()) {
-            LOG(FATAL) << "FLAGS_sclite is empty, nowhere to dump the beam.";
+
+        int nTopHyps = FLAGS_isbeamdump ? results.size() : 1;
+        for (int i = 0; i < nTopHyps; i++) {
+          std::vector<std::string> wordPrediction, letterPrediction;
+          getPrediction(results[i], wordPrediction, letterPrediction);
+          auto wordTargetStr = join(" ", wordTarget);
+          auto wordPredictionStr = join(" ", wordPrediction);
+
+          // Normal decoding and computing WER
+          if (!FLAGS_isbeamdump) {
+            meters.wrdDstSlice.add(wordPrediction, wordTarget);
+            meters.tknDstSlice.add(letterPrediction, letterTarget);
+
+            if (!FLAGS_sclite.empty()) {
+              std::string suffix = " (" + sampleId + ")\n";
+              writeHyp(wordPredictionStr + suffix);
+              writeRef(wordTargetStr + suffix);
+            }
+
+            if (FLAGS_show) {
+              meters.wrdDst.reset();
+              meters.tknDst.reset();
+              meters.wrdDst.add(wordPrediction, wordTarget);
+              meters.tknDst.add(letterPrediction, letterTarget);
+
+              std::stringstream buffer;
+              buffer << "|T|: " << wordTargetStr << std::endl;
+              buffer << "|P|: " << wordPredictionStr << std::endl;
+              if (FLAGS_showletters) {
+                buffer << "|t|: " << join(" ", letterTarget) << std::endl;
+                buffer << "|p|: " << join(" ", letterPrediction) << std::endl;
+              }
+              buffer << "[sample: " << sampleId
+                     << ", WER: " << meters.wrdDst.errorRate()[0]
+                     << "\%, TER: " << meters.tknDst.errorRate()[0]
+                     << "\%, slice WER: " << meters.wrdDstSlice.errorRate()[0]
+                     << "\%, slice TER: " << meters.tknDstSlice.errorRate()[0]
+                     << "\%, decoded samples (thread " << tid
+                     << "): " << sliceNumSamples[tid] + 1 << "]" << std::endl;
+
+              std::cout << buffer.str();
+              if (!FLAGS_sclite.empty()) {
+                writeLog(buffer.str());
+              }
+            }
+
+            // Update conters
+            sliceNumWords[tid] += wordTarget.size();
+            sliceNumTokens[tid] += letterTarget.size();
+            sliceTime[tid] += decodeTime;
+            sliceNumSamples[tid] += 1;
           }
+          // Beam Dump
+          else {
+            meters.wrdDst.reset();
+            meters.wrdDst.add(wordPrediction, wordTarget);
+            auto wer = meters.wrdDst.errorRate()[0];
+
+            if (FLAGS_sclite.empty()) {
+              LOG(FATAL) << "FLAGS_sclite is empty, nowhere to dump the beam.";
+            }
 
-          auto score = results[i].score;
-          auto amScore = results[i].amScore;
-          auto lmScore = results[i].lmScore;
-          auto outString = sampleId + " | " + std::to_string(score) + " | " +
-              std::to_string(amScore) + " | " + std::to_string(lmScore) +
-              " | " + std::to_string(wer) + " | " + wordPredictionStr + "\n";
-          writeHyp(outString);
+            auto score = results[i].score;
+            auto amScore = results[i].amScore;
+            auto lmScore = results[i].lmScore;
+            auto outString = sampleId + " | " + std::to_string(score) + " | " +
+                std::to_string(amScore) + " | " + std::to_string(lmScore) +
+                " | " + std::to_string(wer) + " | " + wordPredictionStr + "\n";
+            writeHyp(outString);
+          }
         }
       }
     }
     sliceWrdDst[tid] = meters.wrdDstSlice.value()[0];
     sliceTknDst[tid] = meters.tknDstSlice.value()[0];
+    for (int i = 0; i < sweepGrid.size(); i++) {
+      sweepWrdDst[i][tid] = sweepWrdMeters[i].value()[0];
+      sweepTknDst[i][tid] = sweepTknMeters[i].value()[0];
+    }
   };
 
   /* ===================== Spread threades ===================== */
@@ -828,6 +1050,34 @@ int main(int argc, char** argv) {
   } else {
     totalTkn = totalTokens > 0 ? totalTkn / totalTokens * 100. : 0.0;
   }
+  // In sweep mode, the decoding of each sample is only scored per grid point:
+  // report the best one
+  std::stringstream sweepBuffer;
+  if (!sweepGrid.empty()) {
+    int bestIdx = 0;
+    std::vector<double> sweepWer(sweepGrid.size()), sweepTer(sweepGrid.size());
+    for (int i = 0; i < sweepGrid.size(); i++) {
+      for (int j = 0; j < FLAGS_nthread_decoder; j++) {
+        sweepWer[i] += sweepWrdDst[i][j];
+        sweepTer[i] += sweepTknDst[i][j];
+      }
+      sweepWer[i] = totalWords > 0 ? sweepWer[i] / totalWords * 100. : 0.0;
+      sweepTer[i] = totalTokens > 0 ? sweepTer[i] / totalTokens * 100. : 0.0;
+      sweepBuffer << "[Sweep lmweight=" << sweepGrid[i].first
+                  << " wordscore=" << sweepGrid[i].second
+                  << "] WER: " << sweepWer[i] << "\%, TER: " << sweepTer[i]
+                  << "\%" << std::endl;
+      if (sweepWer[i] < sweepWer[bestIdx]) {
+        bestIdx = i;
+      }
+    }
+    sweepBuffer << "[Sweep best lmweight=" << sweepGrid[bestIdx].first
+                << " wordscore=" << sweepGrid[bestIdx].second
+                << "] WER: " << sweepWer[bestIdx] << "\%, TER: "
+                << sweepTer[bestIdx] << "\%" << std::endl;
+    totalWer = sweepWer[bestIdx];
+    totalTkn = sweepTer[bestIdx];
+  }
   std::stringstream buffer;
   buffer << "------\n";
   buffer << "[Decode " << FLAGS_test << " (" << totalSamples << " samples) in "
@@ -835,6 +1085,7 @@ int main(int argc, char** argv) {
          << totalTime / totalSamples
          << "s/sample) -- WER: " << std::setprecision(6) << totalWer
          << "\%, TER: " << totalTkn << "\%]" << std::endl;
+  buffer << sweepBuffer.str();
   LOG(INFO) << buffer.str();
   if (!FLAGS_sclite.empty()) {
     writeLog(buffer.str());
@@ -107,6 +107,7 @@ int main(int argc, char** argv) {
   // Only Copy any values from deprecated flags to new flags when deprecated
   // flags are present and corresponding new flags aren't
   handleDeprecatedFlags();
+  fl::OptimMode::get().setBf16CpuCompute(FLAGS_fl_cpu_bf16);
 
   LOG(INFO) << "Gflags after parsing \n" << serializeGflags("; ");
 
@@ -218,6 +218,7 @@ int main(int argc, char** argv) {
       ? fl::OptimLevel::DEFAULT
       : fl::OptimMode::toOptimLevel(FLAGS_fl_optim_mode);
   fl::OptimMode::get().setOptimLevel(flOptimLevel);
+  fl::OptimMode::get().setBf16CpuCompute(FLAGS_fl_cpu_bf16);
   std::shared_ptr<fl::ext::DynamicScaler> dynamicScaler;
   if (FLAGS_fl_amp_use_mixed_precision) {
     // Only set the optim mode to O1 if it was left empty
@@ -332,6 +333,33 @@ int main(int argc, char** argv) {
   int wordpadVal = kTargetPadValue;
   auto padVal = std::make_tuple(0, targetpadVal, wordpadVal);
 
+  std::shared_ptr<FeatureCache> featureCache;
+  if (!FLAGS_feature_cache_dir.empty()) {
+    auto featuresKey = FeatureCache::featuresKey(
+        featParams, featType, {FLAGS_localnrmlleftctx, FLAGS_localnrmlrightctx});
+    if (isMaster) {
+      fl::lib::dirCreateRecursive(FLAGS_feature_cache_dir);
+    }
+    if (worldSize > 1) {
+      fl::barrier();
+    }
+    // One cache per process: each worker only writes its own segments
+    featureCache = std::make_shared<FeatureCache>(
+        pathsConcat(
+            FLAGS_feature_cache_dir,
+            format(
+                "features-%016llx-rank%d",
+                static_cast<unsigned long long>(featuresKey),
+                worldRank)),
+        featuresKey);
+    FL_LOG_MASTER(INFO) << "Feature cache in " << FLAGS_feature_cache_dir
+                        << " holds " << featureCache->size() << " samples";
+    if (!sfxConf.empty()) {
+      FL_LOG_MASTER(WARNING) << "Sound effects are applied: training features "
+                             << "are not cached";
+    }
+  }
+
   std::vector<std::string> trainSplits = fl::lib::split(",", FLAGS_train, true);
   auto trainds = createDataset(
       trainSplits,
@@ -345,7 +373,8 @@ int main(int argc, char** argv) {
       worldSize,
       false, // allowEmpty
       FLAGS_batching_strategy,
-      FLAGS_batching_max_duration);
+      FLAGS_batching_max_duration,
+      sfxConf.empty() ? featureCache : nullptr);
 
   std::map<std::string, std::shared_ptr<fl::Dataset>> validds;
   int64_t validBatchSize =
@@ -363,8 +392,10 @@ int main(int argc, char** argv) {
         padVal,
         worldRank,
         worldSize,
-        true // allowEmpty
-    );
+        true, // allowEmpty
+        kBatchStrategyNone,
+        0,
+        featureCache);
   }
 
   /* =========== Create Network & Optimizers / Reload Snapshot ============ */
@@ -21,7 +21,6 @@ DEFINE_string(config, "", "Path to a sound effect json config file");
 
 using namespace ::fl::app::asr::sfx;
 using ::fl::app::asr::loadSound;
-using ::fl::app::asr::loadSoundInfo;
 using ::fl::app::asr::saveSound;
 
 int main(int argc, char** argv) {
@@ -47,8 +46,8 @@ int main(int argc, char** argv) {
     LOG(FATAL) << "flag --input must point to input file";
   }
 
-  auto sound = loadSound<float>(FLAGS_input);
-  auto info = loadSoundInfo(FLAGS_input);
+  std::vector<float> sound;
+  auto info = loadSound<float>(FLAGS_input, sound);
 
   std::shared_ptr<SoundEffect> sfx =
       createSoundEffect(readSoundEffectConfigFile(FLAGS_config));
@@ -275,6 +275,12 @@ DEFINE_int64(
     sfx_start_update,
     std::numeric_limits<int>::max(),
     "[train] Start sount effect augmentation starting at this update iteration.");
+DEFINE_string(
+    feature_cache_dir,
+    "",
+    "[train] Directory where the input features are cached after being computed "
+    "once, and read from on the next epochs and restarts. Training data is not "
+    "cached when sound effects are applied.");
 
 // RUN OPTIONS
 DEFINE_string(datadir, "", "Prefix to the 'train'/'valid'/'test' files paths");
@@ -349,6 +355,12 @@ DEFINE_uint64(
     fl_amp_max_scale_factor,
     32000,
     "[train] Maximum value for the loss scale factor in mixed precision training");
+DEFINE_bool(
+    fl_cpu_bf16,
+    false,
+    "Compute convolutions, RNNs and matrix products in bf16 on the CPU "
+    "backend (if the CPU supports AVX-512). Parameters, optimizer state and "
+    "activations stay f32, so no loss scaling is needed.");
 
 // ARCHITECTURE OPTIONS
 DEFINE_string(
@@ -402,6 +414,12 @@ DEFINE_string(
     "none",
     "[decode] How to perform trie smearing to have proxy "
     "on scores in the middle of a word: 'none', 'max' or 'logadd'");
+DEFINE_string(
+    flattrie,
+    "",
+    "[decode] Path of the flattened lexicon trie: memory mapped if the file exists "
+    "and was built from the same lexicon, token/word dictionaries, 'smearing' "
+    "and, for 'wrd' decoding, LM; otherwise (re)written once the trie is built");
 DEFINE_string(
     lmtype,
     "kenlm",
@@ -472,10 +490,20 @@ DEFINE_int32(
     nthread_decoder,
     1,
     "[decode] Number of threads for beam-search decoding");
+DEFINE_int32(
+    decoder_batchsize,
+    1,
+    "[decode] 'seq2seq'/'transformer' criterion: number of utterances decoded "
+    "together by each thread, the hypothesis of all of them being forwarded "
+    "through the AM decoder at once");
 DEFINE_int32(
     lm_memory,
     5000,
     "[decode] Total memory size for batch forming for 'convlm' LM forward pass");
+DEFINE_bool(
+    lm_incremental,
+    false,
+    "[decode] Score 'convlm' LM incrementally: each hypothesis caches the receptive field of every causal convolution, so a new token is forwarded as a single frame");
 
 DEFINE_int32(
     emission_queue_size,
@@ -501,6 +529,24 @@ DEFINE_double(
     4.0,
     "language model weight (high boundary, search)");
 DEFINE_double(lmweight_step, 0.2, "language model weight (step, search)");
+DEFINE_double(
+    wordscore_low,
+    0.0,
+    "[decode] word insertion score (low boundary, sweep)");
+DEFINE_double(
+    wordscore_high,
+    0.0,
+    "[decode] word insertion score (high boundary, sweep)");
+DEFINE_double(
+    wordscore_step,
+    1.0,
+    "[decode] word insertion score (step, sweep)");
+DEFINE_bool(
+    sweep,
+    false,
+    "[decode] Decode each utterance for every (lmweight, wordscore) of the grid "
+    "defined by 'lmweight_low/high/step' and 'wordscore_low/high/step' in a single "
+    "pass, reusing the emissions and the LM scores, and report WER per grid point");
 
 // ASG OPTIONS
 DEFINE_int64(
@@ -144,6 +144,7 @@ DECLARE_int64(saug_tmaskn);
 
 DECLARE_string(sfx_config);
 DECLARE_int64(sfx_start_update);
+DECLARE_string(feature_cache_dir);
 
 /* ========== RUN OPTIONS ========== */
 
@@ -167,6 +168,7 @@ DECLARE_bool(fl_amp_use_mixed_precision);
 DECLARE_double(fl_amp_scale_factor);
 DECLARE_uint64(fl_amp_scale_factor_update_interval);
 DECLARE_uint64(fl_amp_max_scale_factor);
+DECLARE_bool(fl_cpu_bf16);
 
 /* ========== ARCHITECTURE OPTIONS ========== */
 
@@ -188,6 +190,7 @@ DECLARE_bool(uselexicon);
 DECLARE_bool(isbeamdump);
 
 DECLARE_string(smearing);
+DECLARE_string(flattrie);
 DECLARE_string(lmtype);
 DECLARE_string(lexicon);
 DECLARE_string(lm_vocab);
@@ -210,13 +213,19 @@ DECLARE_int32(beamsize);
 DECLARE_int32(beamsizetoken);
 DECLARE_int32(nthread_decoder_am_forward);
 DECLARE_int32(nthread_decoder);
+DECLARE_int32(decoder_batchsize);
 DECLARE_int32(lm_memory);
+DECLARE_bool(lm_incremental);
 
 DECLARE_int32(emission_queue_size);
 
 DECLARE_double(lmweight_low);
 DECLARE_double(lmweight_high);
 DECLARE_double(lmweight_step);
+DECLARE_double(wordscore_low);
+DECLARE_double(wordscore_high);
+DECLARE_double(wordscore_step);
+DECLARE_bool(sweep);
 
 // Seq2Seq
 DECLARE_double(smoothingtemperature);
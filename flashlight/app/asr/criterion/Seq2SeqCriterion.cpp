@@ -517,7 +517,24 @@ Seq2SeqCriterion::decodeBatchStep(
     const std::vector<Seq2SeqState*>& inStates,
     const int attentionThreshold,
     const float smoothingTemperature) const {
-  // NB: xEncoded has to be with batchsize 1
+  return decodeBatchStep(
+      {xEncoded},
+      {static_cast<int>(ys.size())},
+      ys,
+      inStates,
+      attentionThreshold,
+      smoothingTemperature);
+}
+
+std::pair<std::vector<std::vector<float>>, std::vector<Seq2SeqStatePtr>>
+Seq2SeqCriterion::decodeBatchStep(
+    const std::vector<fl::Variable>& xEncoded,
+    const std::vector<int>& nHyps,
+    std::vector<fl::Variable>& ys,
+    const std::vector<Seq2SeqState*>& inStates,
+    const int attentionThreshold,
+    const float smoothingTemperature) const {
+  // NB: each xEncoded has to be with batchsize 1
   int batchSize = ys.size();
   std::vector<Variable> statesVector(batchSize);
 
@@ -566,25 +583,43 @@ Seq2SeqCriterion::decodeBatchStep(
           "Batched decoding does not support models with window");
     }
 
-    Variable summaries, alphaBatched;
-    // NB:
-    // - Third Variable is set to empty since no attention use it.
-    // - Only ContentAttention is supported
-    std::tie(alphaBatched, summaries) =
-        attention(n)->forward(yBatched, xEncoded, Variable(), Variable());
-    alphaBatched = reorder(alphaBatched, 1, 0); // B x T -> T x B
-    yBatched = yBatched + summaries; // H x B
-
-    af::array bestpath, maxvalues;
-    af::max(maxvalues, bestpath, alphaBatched.array(), 0);
-    std::vector<int> maxIdx = afToVector<int>(bestpath);
+    // Each utterance attends to its own encoded input
+    std::vector<Variable> summaries;
+    for (int j = 0, start = 0; j < xEncoded.size(); start += nHyps[j], j++) {
+      if (nHyps[j] == 0) {
+        continue;
+      }
+      Variable summary, alphaBatched;
+      // NB:
+      // - Third Variable is set to empty since no attention use it.
+      // - Only ContentAttention is supported
+      std::tie(alphaBatched, summary) = attention(n)->forward(
+          xEncoded.size() == 1 ? yBatched
+                               : yBatched.cols(start, start + nHyps[j] - 1),
+          xEncoded[j],
+          Variable(),
+          Variable());
+      alphaBatched = reorder(alphaBatched, 1, 0); // B x T -> T x B
+      summaries.push_back(summary);
+
+      af::array bestpath, maxvalues;
+      af::max(maxvalues, bestpath, alphaBatched.array(), 0);
+      std::vector<int> maxIdx = afToVector<int>(bestpath);
+      for (int i = 0; i < nHyps[j]; i++) {
+        auto& outState = outstates[start + i];
+        const Seq2SeqState* inState = inStates[start + i];
+        outState->peakAttnPos = maxIdx[i];
+        // TODO: std::abs maybe unnecessary
+        outState->isValid =
+            std::abs(outState->peakAttnPos - inState->peakAttnPos) <=
+            attentionThreshold;
+        outState->alpha = alphaBatched.col(i);
+      }
+    }
+    yBatched = yBatched +
+        (summaries.size() == 1 ? summaries[0]
+                               : concatenate(summaries, 1)); // H x B
     for (int i = 0; i < batchSize; i++) {
-      outstates[i]->peakAttnPos = maxIdx[i];
-      // TODO: std::abs maybe unnecessary
-      outstates[i]->isValid =
-          std::abs(outstates[i]->peakAttnPos - inStates[i]->peakAttnPos) <=
-          attentionThreshold;
-      outstates[i]->alpha = alphaBatched.col(i);
       outstates[i]->summary = yBatched.col(i);
     }
   }
@@ -686,6 +721,101 @@ AMUpdateFunc buildSeq2SeqRnnAmUpdateFunction(
 
   return amUpdateFunc;
 }
+
+BatchAMUpdateFunc buildSeq2SeqRnnBatchAmUpdateFunction(
+    std::shared_ptr<SequenceCriterion>& criterion,
+    int attRound,
+    int maxBatchSize,
+    float attThr,
+    float smoothingTemp) {
+  // the initial state of each hypothesis is sized for `attRound` rounds
+  auto buf = std::make_shared<Seq2SeqDecoderBuffer>(
+      attRound, maxBatchSize, attThr, smoothingTemp);
+  int step = std::max(1, maxBatchSize);
+
+  const Seq2SeqCriterion* s2sCriterion =
+      static_cast<Seq2SeqCriterion*>(criterion.get());
+  auto amUpdateFunc = [buf, s2sCriterion, step](
+                          const std::vector<const float*>& emissions,
+                          const int N,
+                          const std::vector<int>& T,
+                          const std::vector<int>& rawY,
+                          const std::vector<AMStatePtr>& rawPrevStates,
+                          const std::vector<int>& nHyps,
+                          int& t) {
+    if (t == 0) {
+      buf->inputs.resize(emissions.size());
+      for (int b = 0; b < emissions.size(); b++) {
+        buf->inputs[b] = fl::Variable(af::array(N, T[b], emissions[b]), false);
+      }
+    }
+    int batchSize = rawY.size();
+    std::vector<std::vector<float>> amScoresAll;
+    std::vector<AMStatePtr> out;
+
+    // Utterance of each hypothesis
+    std::vector<int> utterances;
+    for (int b = 0; b < nHyps.size(); b++) {
+      utterances.insert(utterances.end(), nHyps[b], b);
+    }
+
+    // Run forward in batches of at most `maxBatchSize` hypothesis, each
+    // attending to the input of its utterance
+    std::vector<fl::Variable> inputs;
+    std::vector<int> inputHyps;
+    for (int start = 0; start < batchSize; start += step) {
+      int end = std::min(start + step, batchSize);
+      buf->prevStates.resize(0);
+      buf->ys.resize(0);
+      inputs.clear();
+      inputHyps.clear();
+
+      // Cast to seq2seq states
+      for (int i = start; i < end; i++) {
+        Seq2SeqState* prevState =
+            static_cast<Seq2SeqState*>(rawPrevStates[i].get());
+        fl::Variable y;
+        if (t > 0) {
+          y = fl::constant(rawY[i], 1, s32, false);
+        } else {
+          prevState = &buf->dummyState;
+        }
+        buf->ys.push_back(y);
+        buf->prevStates.push_back(prevState);
+        if (i == start || utterances[i] != utterances[i - 1]) {
+          inputs.push_back(buf->inputs[utterances[i]]);
+          inputHyps.push_back(0);
+        }
+        ++inputHyps.back();
+      }
+
+      std::vector<std::vector<float>> amScores;
+      std::vector<Seq2SeqStatePtr> outStates;
+      std::tie(amScores, outStates) = s2sCriterion->decodeBatchStep(
+          inputs,
+          inputHyps,
+          buf->ys,
+          buf->prevStates,
+          buf->attentionThreshold,
+          buf->smoothingTemperature);
+
+      // Cast back to void*
+      for (auto& os : outStates) {
+        if (os->isValid) {
+          out.push_back(os);
+        } else {
+          out.push_back(nullptr);
+        }
+      }
+      for (auto& s : amScores) {
+        amScoresAll.push_back(std::move(s));
+      }
+    }
+    return std::make_pair(amScoresAll, out);
+  };
+
+  return amUpdateFunc;
+}
 } // namespace asr
 } // namespace app
 } // namespace fl
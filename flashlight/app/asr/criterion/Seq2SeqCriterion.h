@@ -136,6 +136,21 @@ class Seq2SeqCriterion : public SequenceCriterion {
       const int attentionThreshold = std::numeric_limits<int>::infinity(),
       const float smoothingTemperature = 1.0) const;
 
+  /**
+   * Decoder step for the hypothesis of several utterances, all at the same
+   * step: the first `nHyps[0]` hypothesis attend to `xEncoded[0]`, the next
+   * `nHyps[1]` ones to `xEncoded[1]`, and so on. The RNNs and the output
+   * projection run on all the hypothesis at once.
+   */
+  std::pair<std::vector<std::vector<float>>, std::vector<Seq2SeqStatePtr>>
+  decodeBatchStep(
+      const std::vector<fl::Variable>& xEncoded,
+      const std::vector<int>& nHyps,
+      std::vector<fl::Variable>& ys,
+      const std::vector<Seq2SeqState*>& inStates,
+      const int attentionThreshold = std::numeric_limits<int>::infinity(),
+      const float smoothingTemperature = 1.0) const;
+
   std::pair<fl::Variable, Seq2SeqState> decodeStep(
       const fl::Variable& xEncoded,
       const fl::Variable& y,
@@ -202,6 +217,8 @@ class Seq2SeqCriterion : public SequenceCriterion {
 /* Decoder helpers */
 struct Seq2SeqDecoderBuffer {
   fl::Variable input;
+  // Encoded inputs of each utterance, for batched decoding
+  std::vector<fl::Variable> inputs;
   Seq2SeqState dummyState;
   std::vector<fl::Variable> ys;
   std::vector<Seq2SeqState*> prevStates;
@@ -227,6 +244,18 @@ AMUpdateFunc buildSeq2SeqRnnAmUpdateFunction(
     int beamSize,
     float attThr,
     float smoothingTemp);
+
+/**
+ * Same as buildSeq2SeqRnnAmUpdateFunction() for the hypothesis of several
+ * utterances, forwarded together in batches of at most `maxBatchSize`
+ * hypothesis.
+ */
+BatchAMUpdateFunc buildSeq2SeqRnnBatchAmUpdateFunction(
+    std::shared_ptr<SequenceCriterion>& criterion,
+    int attRound,
+    int maxBatchSize,
+    float attThr,
+    float smoothingTemp);
 } // namespace asr
 } // namespace app
 } // namespace fl
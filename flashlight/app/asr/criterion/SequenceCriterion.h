@@ -52,6 +52,19 @@ typedef std::function<
         const std::vector<AMStatePtr>&,
         int&)>
     AMUpdateFunc;
+
+// AM update for the hypothesis of several utterances, grouped by utterance
+// (see fl::lib::text::BatchAMUpdateFunc)
+typedef std::function<
+    std::pair<std::vector<std::vector<float>>, std::vector<AMStatePtr>>(
+        const std::vector<const float*>&,
+        const int,
+        const std::vector<int>&,
+        const std::vector<int>&,
+        const std::vector<AMStatePtr>&,
+        const std::vector<int>&,
+        int&)>
+    BatchAMUpdateFunc;
 } // namespace asr
 } // namespace app
 } // namespace fl
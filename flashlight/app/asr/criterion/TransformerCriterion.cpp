@@ -8,6 +8,7 @@
 #include "flashlight/app/asr/criterion/TransformerCriterion.h"
 
 #include <algorithm>
+#include <map>
 #include <queue>
 
 #include "flashlight/app/asr/common/Defines.h"
@@ -210,20 +211,13 @@ std::pair<Variable, TS2SState> TransformerCriterion::decodeStep(
 
   TS2SState outState;
   outState.step = inState.step + 1;
-  af::array padMask; // no mask because we are doing step by step decoding here,
-                     // no look in the future
+  outState.layerStates.resize(nLayer_);
+  // only the new step is projected, the previous ones are in the state
   for (int i = 0; i < nLayer_; i++) {
-    if (inState.step == 0) {
-      outState.hidden.push_back(hy);
-      hy = layer(i)
-               ->forward(std::vector<Variable>({hy, fl::noGrad(padMask)}))
-               .front();
-    } else {
-      outState.hidden.push_back(concatenate({inState.hidden[i], hy}, 1));
-      hy = layer(i)
-               ->forward({inState.hidden[i], hy, fl::noGrad(padMask)})
-               .front();
-    }
+    std::tie(hy, outState.layerStates[i]) = layer(i)->forwardIncremental(
+        hy,
+        inState.step == 0 ? fl::TransformerState()
+                          : inState.layerStates[i]);
   }
 
   Variable windowWeight, alpha, summary;
@@ -254,9 +248,26 @@ TransformerCriterion::decodeBatchStep(
     const fl::Variable& xEncoded,
     std::vector<fl::Variable>& ys,
     const std::vector<TS2SState*>& inStates,
+    const int attentionThreshold,
+    const float smoothingTemperature) const {
+  return decodeBatchStep(
+      {xEncoded},
+      {static_cast<int>(ys.size())},
+      ys,
+      inStates,
+      attentionThreshold,
+      smoothingTemperature);
+}
+
+std::pair<std::vector<std::vector<float>>, std::vector<TS2SStatePtr>>
+TransformerCriterion::decodeBatchStep(
+    const std::vector<fl::Variable>& xEncoded,
+    const std::vector<int>& nHyps,
+    std::vector<fl::Variable>& ys,
+    const std::vector<TS2SState*>& inStates,
     const int /* attentionThreshold */,
     const float smoothingTemperature) const {
-  // assume xEncoded has batch 1
+  // assume each xEncoded has batch 1
   int B = ys.size();
 
   for (int i = 0; i < B; i++) {
@@ -275,33 +286,50 @@ TransformerCriterion::decodeBatchStep(
     outstates[i]->step = inStates[i]->step + 1;
   }
 
-  Variable outStateBatched;
+  // All the hypothesis are at the same step: their keys and values are
+  // batched, and only the new step is projected
   for (int i = 0; i < nLayer_; i++) {
-    if (inStates[0]->step == 0) {
-      for (int j = 0; j < B; j++) {
-        outstates[j]->hidden.push_back(yBatched.slice(j));
-      }
-      yBatched = layer(i)->forward(std::vector<Variable>({yBatched})).front();
-    } else {
-      std::vector<Variable> statesVector(B);
+    fl::TransformerState layerState;
+    if (inStates[0]->step > 0) {
+      std::vector<Variable> keys(B), values(B);
       for (int j = 0; j < B; j++) {
-        statesVector[j] = inStates[j]->hidden[i];
+        keys[j] = inStates[j]->layerStates[i].keys;
+        values[j] = inStates[j]->layerStates[i].values;
       }
-      Variable inStateHiddenBatched = concatenate(statesVector, 2);
-      auto tmp = std::vector<Variable>({inStateHiddenBatched, yBatched});
-      auto tmp2 = concatenate(tmp, 1);
-      for (int j = 0; j < B; j++) {
-        outstates[j]->hidden.push_back(tmp2.slice(j));
-      }
-      yBatched = layer(i)->forward(tmp).front();
+      layerState.keys = concatenate(keys, 2);
+      layerState.values = concatenate(values, 2);
+    }
+    std::tie(yBatched, layerState) =
+        layer(i)->forwardIncremental(yBatched, layerState);
+    // No gradient through the decoding: don't keep the graph of past steps
+    for (int j = 0; j < B; j++) {
+      outstates[j]->layerStates.push_back(
+          {fl::noGrad(layerState.keys.slice(j).array()),
+           fl::noGrad(layerState.values.slice(j).array())});
     }
   }
 
   Variable alpha, summary;
   yBatched = moddims(yBatched, {yBatched.dims(0), -1});
-  std::tie(alpha, summary) =
-      attention()->forward(yBatched, xEncoded, Variable(), Variable());
-  alpha = reorder(alpha, 1, 0);
+  if (xEncoded.size() == 1) {
+    std::tie(alpha, summary) =
+        attention()->forward(yBatched, xEncoded[0], Variable(), Variable());
+  } else {
+    // Each utterance attends to its own encoded input
+    std::vector<Variable> summaries;
+    for (int i = 0, start = 0; i < xEncoded.size(); start += nHyps[i], i++) {
+      if (nHyps[i] == 0) {
+        continue;
+      }
+      std::tie(alpha, summary) = attention()->forward(
+          yBatched.cols(start, start + nHyps[i] - 1),
+          xEncoded[i],
+          Variable(),
+          Variable());
+      summaries.push_back(summary);
+    }
+    summary = concatenate(summaries, 1);
+  }
   yBatched = yBatched + summary;
 
   auto outBatched = linearOut()->forward(yBatched);
@@ -346,7 +374,7 @@ AMUpdateFunc buildSeq2SeqTransformerAmUpdateFunction(
       lastIndexOfStatePtr[ptr] = index;
     }
 
-    int start = 0, step = std::min(10, 1000 / (t + 1));
+    int start = 0, step = std::max(1, std::min(10, 1000 / (t + 1)));
     while (start < B) {
       buf->prevStates.resize(0);
       buf->ys.resize(0);
@@ -387,7 +415,7 @@ AMUpdateFunc buildSeq2SeqTransformerAmUpdateFunction(
         if (prevState &&
             (lastIndexOfStatePtr.find(prevState) == lastIndexOfStatePtr.end() ||
              lastIndexOfStatePtr.find(prevState)->second == i)) {
-          prevState->hidden.clear();
+          prevState->layerStates.clear();
         }
       }
       start += step;
@@ -398,6 +426,110 @@ AMUpdateFunc buildSeq2SeqTransformerAmUpdateFunction(
   return amUpdateFunc;
 }
 
+BatchAMUpdateFunc buildSeq2SeqTransformerBatchAmUpdateFunction(
+    std::shared_ptr<SequenceCriterion>& criterion,
+    int maxBatchSize,
+    float attThr,
+    float smoothingTemp) {
+  auto buf =
+      std::make_shared<TS2SDecoderBuffer>(maxBatchSize, attThr, smoothingTemp);
+
+  const TransformerCriterion* criterionCast =
+      static_cast<TransformerCriterion*>(criterion.get());
+
+  auto amUpdateFunc = [buf, criterionCast, maxBatchSize](
+                          const std::vector<const float*>& emissions,
+                          const int N,
+                          const std::vector<int>& T,
+                          const std::vector<int>& rawY,
+                          const std::vector<AMStatePtr>& rawPrevStates,
+                          const std::vector<int>& nHyps,
+                          int& t) {
+    if (t == 0) {
+      buf->inputs.resize(emissions.size());
+      for (int b = 0; b < emissions.size(); b++) {
+        buf->inputs[b] = fl::Variable(af::array(N, T[b], emissions[b]), false);
+      }
+    }
+    int B = rawY.size();
+    std::vector<AMStatePtr> out;
+    std::vector<std::vector<float>> amScoresAll;
+
+    // Utterance of each hypothesis
+    std::vector<int> utterances;
+    for (int b = 0; b < nHyps.size(); b++) {
+      utterances.insert(utterances.end(), nHyps[b], b);
+    }
+
+    // Store the latest index of the hidden state when we can clear it
+    std::map<TS2SState*, int> lastIndexOfStatePtr;
+    for (int index = 0; index < rawPrevStates.size(); index++) {
+      TS2SState* ptr = static_cast<TS2SState*>(rawPrevStates[index].get());
+      lastIndexOfStatePtr[ptr] = index;
+    }
+
+    // The keys and values grow with the number of steps
+    int start = 0;
+    int step =
+        std::max(1, std::min(maxBatchSize, 100 * maxBatchSize / (t + 1)));
+    std::vector<fl::Variable> inputs;
+    std::vector<int> inputHyps;
+    while (start < B) {
+      buf->prevStates.resize(0);
+      buf->ys.resize(0);
+      inputs.clear();
+      inputHyps.clear();
+
+      int end = std::min(start + step, B);
+      for (int i = start; i < end; i++) {
+        TS2SState* prevState = static_cast<TS2SState*>(rawPrevStates[i].get());
+        fl::Variable y;
+        if (t > 0) {
+          y = fl::constant(rawY[i], 1, s32, false);
+        } else {
+          prevState = &buf->dummyState;
+        }
+        buf->ys.push_back(y);
+        buf->prevStates.push_back(prevState);
+        if (i == start || utterances[i] != utterances[i - 1]) {
+          inputs.push_back(buf->inputs[utterances[i]]);
+          inputHyps.push_back(0);
+        }
+        ++inputHyps.back();
+      }
+      std::vector<std::vector<float>> amScores;
+      std::vector<TS2SStatePtr> outStates;
+      std::tie(amScores, outStates) = criterionCast->decodeBatchStep(
+          inputs,
+          inputHyps,
+          buf->ys,
+          buf->prevStates,
+          buf->attentionThreshold,
+          buf->smoothingTemperature);
+      for (auto& os : outStates) {
+        out.push_back(os);
+      }
+      for (auto& s : amScores) {
+        amScoresAll.push_back(s);
+      }
+      // clean the previous state which is not needed anymore
+      // to prevent from OOM
+      for (int i = start; i < end; i++) {
+        TS2SState* prevState = static_cast<TS2SState*>(rawPrevStates[i].get());
+        if (prevState &&
+            (lastIndexOfStatePtr.find(prevState) == lastIndexOfStatePtr.end() ||
+             lastIndexOfStatePtr.find(prevState)->second == i)) {
+          prevState->layerStates.clear();
+        }
+      }
+      start = end;
+    }
+    return std::make_pair(amScoresAll, out);
+  };
+
+  return amUpdateFunc;
+}
+
 std::string TransformerCriterion::prettyString() const {
   return "TransformerCriterion";
 }
@@ -23,7 +23,8 @@ namespace asr {
 
 struct TS2SState {
   fl::Variable alpha;
-  std::vector<fl::Variable> hidden;
+  // Keys and values of the previous steps, for each decoder layer
+  std::vector<fl::TransformerState> layerStates;
   fl::Variable summary;
   int step;
 
@@ -81,6 +82,21 @@ class TransformerCriterion : public SequenceCriterion {
       const int attentionThreshold,
       const float smoothingTemperature) const;
 
+  /**
+   * Decoder step for the hypothesis of several utterances, all at the same
+   * step: the first `nHyps[0]` hypothesis attend to `xEncoded[0]`, the next
+   * `nHyps[1]` ones to `xEncoded[1]`, and so on. The decoder layers and the
+   * output projection run on all the hypothesis at once.
+   */
+  std::pair<std::vector<std::vector<float>>, std::vector<TS2SStatePtr>>
+  decodeBatchStep(
+      const std::vector<fl::Variable>& xEncoded,
+      const std::vector<int>& nHyps,
+      std::vector<fl::Variable>& ys,
+      const std::vector<TS2SState*>& inStates,
+      const int attentionThreshold,
+      const float smoothingTemperature) const;
+
   void clearWindow() {
     trainWithWindow_ = false;
     window_ = nullptr;
@@ -136,6 +152,8 @@ class TransformerCriterion : public SequenceCriterion {
 
 struct TS2SDecoderBuffer {
   fl::Variable input;
+  // Encoded inputs of each utterance, for batched decoding
+  std::vector<fl::Variable> inputs;
   TS2SState dummyState;
   std::vector<fl::Variable> ys;
   std::vector<TS2SState*> prevStates;
@@ -154,6 +172,17 @@ AMUpdateFunc buildSeq2SeqTransformerAmUpdateFunction(
     int beamSize,
     float attThr,
     float smoothingTemp);
+
+/**
+ * Same as buildSeq2SeqTransformerAmUpdateFunction() for the hypothesis of
+ * several utterances, forwarded by batches of at most `maxBatchSize`
+ * hypothesis (fewer for long outputs, to bound memory).
+ */
+BatchAMUpdateFunc buildSeq2SeqTransformerBatchAmUpdateFunction(
+    std::shared_ptr<SequenceCriterion>& criterion,
+    int maxBatchSize,
+    float attThr,
+    float smoothingTemp);
 } // namespace asr
 } // namespace app
 } // namespace fl
@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "flashlight/app/asr/data/FeatureCache.h"
+
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+
+#include "flashlight/fl/dataset/MemoryMappedBlobDataset.h"
+#include "flashlight/lib/common/System.h"
+
+namespace fl {
+namespace app {
+namespace asr {
+
+namespace {
+
+// Arrays of a cached sample
+constexpr int kFeaturesField = 0;
+constexpr int kPathField = 1;
+constexpr int kKeyField = 2;
+constexpr int kNumFields = 3;
+
+// Bump when the features computed for given settings change
+constexpr uint64_t kFeaturesVersion = 1;
+
+constexpr uint64_t kFnvOffset = 0xcbf29ce484222325ULL;
+constexpr uint64_t kFnvPrime = 0x100000001b3ULL;
+
+// FNV-1a hash of `size` bytes, continuing from `hash`
+uint64_t fnv1a(const void* data, size_t size, uint64_t hash = kFnvOffset) {
+  const auto* bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ bytes[i]) * kFnvPrime;
+  }
+  return hash;
+}
+
+template <typename T>
+uint64_t fnv1a(const T& value, uint64_t hash) {
+  return fnv1a(&value, sizeof(value), hash);
+}
+
+bool isValidSample(
+    const std::vector<BlobDatasetEntry>& entries,
+    int64_t fileSize) {
+  if (entries.size() != kNumFields ||
+      entries[kFeaturesField].type != af::dtype::f32 ||
+      entries[kPathField].type != af::dtype::u8 ||
+      entries[kKeyField].type != af::dtype::u64 ||
+      entries[kKeyField].dims.elements() != 1) {
+    return false;
+  }
+  for (const auto& e : entries) {
+    for (int i = 0; i < 4; ++i) {
+      if (e.dims[i] < 0) {
+        return false;
+      }
+    }
+    int64_t bytes = af::getSizeOf(e.type) * e.dims.elements();
+    if (e.offset < 0 || e.offset + bytes > fileSize) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+FeatureCache::FeatureCache(
+    const std::string& prefix,
+    uint64_t featuresKey,
+    int64_t segmentSize /* = 4096 */)
+    : prefix_(prefix), featuresKey_(featuresKey), segmentSize_(segmentSize) {
+  if (segmentSize_ <= 0) {
+    throw std::invalid_argument("[FeatureCache] segmentSize must be positive");
+  }
+  for (int64_t segment = 0; lib::fileExists(segmentPath(segment));
+       ++segment) {
+    if (!loadSegment(segment)) {
+      // Not sealed: drop its features, keeping an empty segment so that the
+      // next ones are still found
+      FileBlobDataset(segmentPath(segment), true, true).writeIndex();
+      if (!loadSegment(segment)) {
+        throw std::runtime_error(
+            "[FeatureCache] could not reset " + segmentPath(segment));
+      }
+    }
+  }
+}
+
+FeatureCache::~FeatureCache() {
+  try {
+    seal();
+  } catch (const std::exception&) {
+    // The segment being written is dropped when the cache is opened again
+  }
+}
+
+uint64_t FeatureCache::featuresKey(
+    const lib::audio::FeatureParams& params,
+    const FeatureType& featureType,
+    const std::pair<int, int>& localNormCtx) {
+  uint64_t hash = fnv1a(kFeaturesVersion, kFnvOffset);
+  hash = fnv1a(static_cast<int>(featureType), hash);
+  hash = fnv1a(localNormCtx.first, hash);
+  hash = fnv1a(localNormCtx.second, hash);
+  // Field by field, the struct has padding
+  hash = fnv1a(params.samplingFreq, hash);
+  hash = fnv1a(params.frameSizeMs, hash);
+  hash = fnv1a(params.frameStrideMs, hash);
+  hash = fnv1a(params.numFilterbankChans, hash);
+  hash = fnv1a(params.lowFreqFilterbank, hash);
+  hash = fnv1a(params.highFreqFilterbank, hash);
+  hash = fnv1a(params.numCepstralCoeffs, hash);
+  hash = fnv1a(params.lifterParam, hash);
+  hash = fnv1a(params.deltaWindow, hash);
+  hash = fnv1a(params.accWindow, hash);
+  hash = fnv1a(static_cast<int>(params.windowType), hash);
+  hash = fnv1a(params.preemCoef, hash);
+  hash = fnv1a(params.melFloor, hash);
+  hash = fnv1a(params.ditherVal, hash);
+  hash = fnv1a(params.usePower, hash);
+  hash = fnv1a(params.useEnergy, hash);
+  hash = fnv1a(params.rawEnergy, hash);
+  hash = fnv1a(params.zeroMeanFrame, hash);
+  return hash;
+}
+
+af::array FeatureCache::get(const std::string& path) const {
+  std::shared_lock<std::shared_timed_mutex> lock(mutex_);
+  auto it = index_.find(sampleKey(path));
+  if (it == index_.end()) {
+    return af::array();
+  }
+  std::unique_lock<std::mutex> writeLock(writeMutex_, std::defer_lock);
+  if (segments_[it->second.first] == writer_) {
+    // Read the segment being written between two writes
+    lock.unlock();
+    writeLock.lock();
+    lock.lock();
+  }
+  return read(path);
+}
+
+af::array FeatureCache::read(const std::string& path) const {
+  auto it = index_.find(sampleKey(path));
+  if (it == index_.end()) {
+    return af::array();
+  }
+  const auto& segment = segments_[it->second.first];
+  int64_t idx = it->second.second;
+  auto cachedPath = segment->rawGet(idx, kPathField);
+  if (std::string(cachedPath.begin(), cachedPath.end()) != path) {
+    return af::array(); // hash collision
+  }
+  auto dims = segment->getEntries(idx)[kFeaturesField].dims;
+  auto features = segment->rawGet(idx, kFeaturesField);
+  return af::array(dims, reinterpret_cast<const float*>(features.data()));
+}
+
+void FeatureCache::add(const std::string& path, const af::array& features) {
+  if (features.type() != af::dtype::f32) {
+    throw std::invalid_argument("[FeatureCache] features must be f32");
+  }
+  if (features.isempty() || path.empty()) {
+    return;
+  }
+  const uint64_t key = sampleKey(path);
+  unsigned long long featuresKey = featuresKey_;
+  std::vector<af::array> sample(kNumFields);
+  sample[kFeaturesField] = features;
+  sample[kPathField] = af::array(
+      path.size(), reinterpret_cast<const unsigned char*>(path.data()));
+  sample[kKeyField] = af::array(1, &featuresKey);
+
+  // segments_, writer_ and index_ only change under writeMutex_, which is
+  // enough to read them here
+  std::lock_guard<std::mutex> writeLock(writeMutex_);
+  if (index_.find(key) != index_.end()) {
+    return; // added by another thread meanwhile
+  }
+  if (!writer_) {
+    auto writer = std::make_shared<FileBlobDataset>(
+        segmentPath(segments_.size()), true, true);
+    std::unique_lock<std::shared_timed_mutex> lock(mutex_);
+    writer_ = writer;
+    segments_.push_back(writer_);
+  }
+  writer_->add(sample);
+  // Flush the stream of this thread so that the other threads can read it
+  writer_->flush();
+  {
+    std::unique_lock<std::shared_timed_mutex> lock(mutex_);
+    index_[key] = {segments_.size() - 1, writer_->size() - 1};
+  }
+  if (writer_->size() >= segmentSize_) {
+    seal();
+  }
+}
+
+void FeatureCache::flush() {
+  std::lock_guard<std::mutex> writeLock(writeMutex_);
+  seal();
+}
+
+int64_t FeatureCache::size() const {
+  std::shared_lock<std::shared_timed_mutex> lock(mutex_);
+  return index_.size();
+}
+
+std::string FeatureCache::segmentPath(int64_t segment) const {
+  return prefix_ + "." + std::to_string(segment) + ".blob";
+}
+
+uint64_t FeatureCache::sampleKey(const std::string& path) const {
+  return fnv1a(path.data(), path.size(), fnv1a(featuresKey_, kFnvOffset));
+}
+
+bool FeatureCache::loadSegment(int64_t segment) {
+  const auto path = segmentPath(segment);
+  std::shared_ptr<MemoryMappedBlobDataset> blob;
+  std::vector<std::pair<uint64_t, int64_t>> keys;
+  try {
+    blob = std::make_shared<MemoryMappedBlobDataset>(path, MmapAdvice::RANDOM);
+    int64_t fileSize =
+        std::ifstream(path, std::ios::binary | std::ios::ate).tellg();
+    for (int64_t i = 0; i < blob->size(); ++i) {
+      if (!isValidSample(blob->getEntries(i), fileSize)) {
+        return false;
+      }
+      uint64_t featuresKey;
+      auto cachedKey = blob->rawGet(i, kKeyField);
+      std::memcpy(&featuresKey, cachedKey.data(), sizeof(featuresKey));
+      if (featuresKey != featuresKey_) {
+        continue;
+      }
+      auto cachedPath = blob->rawGet(i, kPathField);
+      keys.emplace_back(
+          sampleKey(std::string(cachedPath.begin(), cachedPath.end())), i);
+    }
+  } catch (const std::exception&) {
+    return false;
+  }
+  for (const auto& key : keys) {
+    index_[key.first] = {segment, key.second};
+  }
+  segments_.push_back(std::move(blob));
+  return true;
+}
+
+void FeatureCache::seal() {
+  if (!writer_) {
+    return;
+  }
+  writer_->writeIndex();
+  std::unique_lock<std::shared_timed_mutex> lock(mutex_);
+  // Closing the segment flushes the streams of all the threads
+  writer_.reset();
+  segments_.pop_back();
+  if (!loadSegment(segments_.size())) {
+    throw std::runtime_error(
+        "[FeatureCache] could not seal " + segmentPath(segments_.size()));
+  }
+}
+
+} // namespace asr
+} // namespace app
+} // namespace fl
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "flashlight/app/asr/data/FeatureTransforms.h"
+#include "flashlight/fl/dataset/FileBlobDataset.h"
+
+namespace fl {
+namespace app {
+namespace asr {
+
+/**
+ * FeatureCache stores the input features computed by `inputFeatures()` in
+ * blobs, so that they are computed once and then served from disk on the
+ * next epochs and after a restart.
+ *
+ * Samples are keyed by a hash of their audio path and of the featurization
+ * settings (see `featuresKey()`): a cache built with other settings simply
+ * misses. Features are random when sound effects (or dithering) are enabled,
+ * and should not be cached then.
+ *
+ * The cache is a sequence of segments `<prefix>.<n>.blob`. New features are
+ * appended to a FileBlobDataset segment which is sealed (its index written)
+ * once it holds `segmentSize` samples, or on `flush()` and destruction;
+ * sealed segments are memory mapped (see MemoryMappedBlobDataset). A process
+ * killed before sealing its last segment only loses the features of that
+ * segment: invalid segments are emptied when the cache is opened again.
+ *
+ * The cache is thread-safe. Features are written to disk without blocking
+ * the readers of sealed segments, only their index entry is published under
+ * the exclusive lock. Segments must not be shared by several processes: give
+ * each worker its own prefix.
+ */
+class FeatureCache {
+ public:
+  /**
+   * @param[in] prefix The path prefix of the segment files.
+   * @param[in] featuresKey The key of the featurization settings.
+   * @param[in] segmentSize The number of samples after which a segment is
+   * sealed.
+   */
+  FeatureCache(
+      const std::string& prefix,
+      uint64_t featuresKey,
+      int64_t segmentSize = 4096);
+
+  FeatureCache(const FeatureCache&) = delete;
+  FeatureCache& operator=(const FeatureCache&) = delete;
+
+  ~FeatureCache();
+
+  /* Hash of the settings given to `inputFeatures()` */
+  static uint64_t featuresKey(
+      const lib::audio::FeatureParams& params,
+      const FeatureType& featureType,
+      const std::pair<int, int>& localNormCtx);
+
+  /* Features cached for the audio `path`, an empty array if there are none */
+  af::array get(const std::string& path) const;
+
+  /* Cache the features of the audio `path` */
+  void add(const std::string& path, const af::array& features);
+
+  /* Seal the segment being written, so that it is kept on restart */
+  void flush();
+
+  /* Number of cached samples */
+  int64_t size() const;
+
+ private:
+  std::string prefix_;
+  uint64_t featuresKey_;
+  int64_t segmentSize_;
+  // Sealed segments, and the one being written (if any) at the back
+  std::vector<std::shared_ptr<BlobDataset>> segments_;
+  std::shared_ptr<FileBlobDataset> writer_;
+  // Sample key -> (segment, index in the segment)
+  std::unordered_map<uint64_t, std::pair<int64_t, int64_t>> index_;
+  // Guards segments_, writer_ and index_
+  mutable std::shared_timed_mutex mutex_;
+  // Serializes the writes to writer_ and its reads, which FileBlobDataset
+  // does not allow concurrently. Taken before mutex_.
+  mutable std::mutex writeMutex_;
+
+  std::string segmentPath(int64_t segment) const;
+
+  uint64_t sampleKey(const std::string& path) const;
+
+  /* Same as get(), with mutex_ held */
+  af::array read(const std::string& path) const;
+
+  /* Map a sealed segment and index its samples, return false if invalid */
+  bool loadSegment(int64_t segment);
+
+  /* Seal the segment being written, with writeMutex_ held */
+  void seal();
+};
+
+} // namespace asr
+} // namespace app
+} // namespace fl
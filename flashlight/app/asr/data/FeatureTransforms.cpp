@@ -72,8 +72,11 @@ fl::Dataset::DataTransformFunction inputFeatures(
           "'inputFeatures': Invalid input dims . Expected 2d array - Channels x T");
     }
     auto channels = dims[0];
-    std::vector<float> input(dims.elements());
-    std::copy_n(static_cast<const float*>(data), input.size(), input.data());
+    // Reuse the capacity of the previous input of this thread
+    thread_local std::vector<float> input;
+    input.assign(
+        static_cast<const float*>(data),
+        static_cast<const float*>(data) + dims.elements());
     if (channels > 1) {
       input = transpose2d(input, dims[1], channels);
     }
@@ -7,21 +7,9 @@
 
 #include "flashlight/app/asr/data/ListFileDataset.h"
 
+#include "flashlight/app/asr/data/FeatureCache.h"
 #include "flashlight/app/asr/data/Sound.h"
 
-#include "flashlight/lib/common/String.h"
-
-using namespace fl::lib;
-
-namespace {
-constexpr const size_t kIdIdx = 0;
-constexpr const size_t kInIdx = 1;
-constexpr const size_t kSzIdx = 2;
-constexpr const size_t kTgtIdx = 3;
-constexpr const size_t kNumCols = 4;
-
-} // namespace
-
 namespace fl {
 namespace app {
 namespace asr {
@@ -34,32 +22,9 @@ ListFileDataset::ListFileDataset(
       tgtFeatFunc_(tgtFeatFunc),
       wrdFeatFunc_(wrdFeatFunc),
       numRows_(0) {
-  std::ifstream inFile(filename);
-  if (!inFile) {
-    throw std::invalid_argument("Unable to open file -" + filename);
-  }
-  std::string line;
-  while (std::getline(inFile, line)) {
-    if (line.empty()) {
-      continue;
-    }
-    auto splits = splitOnWhitespace(line, true);
-    if (splits.size() < 3) {
-      throw std::runtime_error(
-          "File " + filename +
-          " has invalid columns in line (expected 3 columns at least): " +
-          line);
-    }
-
-    ids_.emplace_back(std::move(splits[kIdIdx]));
-    inputs_.emplace_back(std::move(splits[kInIdx]));
-    inputSizes_.emplace_back(std::stof(splits[kSzIdx]));
-    targets_.emplace_back(fl::lib::join(
-        " ", std::vector<std::string>(splits.begin() + kTgtIdx, splits.end())));
-    ++numRows_;
-  }
-  inFile.close();
-  targetSizesCache_.resize(inputSizes_.size(), -1);
+  index_ = std::make_shared<ListFileIndex>(filename);
+  numRows_ = index_->size();
+  targetSizesCache_.resize(numRows_, -1);
 }
 
 int64_t ListFileDataset::size() const {
@@ -69,18 +34,31 @@ int64_t ListFileDataset::size() const {
 std::vector<af::array> ListFileDataset::get(const int64_t idx) const {
   checkIndexBounds(idx);
 
-  auto audio = loadAudio(inputs_[idx]); // channels x time
+  auto handle = index_->input(idx);
+  auto transcript = index_->target(idx);
   af::array input;
-  if (inFeatFunc_) {
-    input = inFeatFunc_(
-        static_cast<void*>(audio.first.data()), audio.second, af::dtype::f32);
-  } else {
-    input = af::array(audio.second, audio.first.data());
+  if (featureCache_ && inFeatFunc_) {
+    input = featureCache_->get(handle);
+  }
+  if (input.isempty()) {
+    // Samples are decoded in a per-thread buffer, the features (or the array)
+    // being copies of them
+    thread_local std::vector<float> audio;
+    auto dims = loadAudioInto(handle, audio); // channels x time
+    if (inFeatFunc_) {
+      input =
+          inFeatFunc_(static_cast<void*>(audio.data()), dims, af::dtype::f32);
+      if (featureCache_) {
+        featureCache_->add(handle, input);
+      }
+    } else {
+      input = af::array(dims, audio.data());
+    }
   }
 
   af::array target;
   if (tgtFeatFunc_) {
-    std::vector<char> curTarget(targets_[idx].begin(), targets_[idx].end());
+    std::vector<char> curTarget(transcript.begin(), transcript.end());
     target = tgtFeatFunc_(
         static_cast<void*>(curTarget.data()),
         {static_cast<dim_t>(curTarget.size())},
@@ -90,16 +68,17 @@ std::vector<af::array> ListFileDataset::get(const int64_t idx) const {
 
   af::array words;
   if (wrdFeatFunc_) {
-    std::vector<char> curTarget(targets_[idx].begin(), targets_[idx].end());
+    std::vector<char> curTarget(transcript.begin(), transcript.end());
     words = wrdFeatFunc_(
         static_cast<void*>(curTarget.data()),
         {static_cast<dim_t>(curTarget.size())},
         af::dtype::b8);
   }
 
-  af::array sampleIdx = af::array(ids_[idx].length(), ids_[idx].data());
-  af::array samplePath = af::array(inputs_[idx].length(), inputs_[idx].data());
-  af::array sampleDuration = af::array(1, inputSizes_.data() + idx);
+  auto id = index_->id(idx);
+  af::array sampleIdx = af::array(id.length(), id.data());
+  af::array samplePath = af::array(handle.length(), handle.data());
+  af::array sampleDuration = af::array(1, index_->inputSize(idx));
   af::array sampleTargetSize = af::constant(float(target.elements()), 1);
 
   return {input, target, words, sampleIdx, samplePath, sampleDuration, sampleTargetSize};
@@ -107,13 +86,26 @@ std::vector<af::array> ListFileDataset::get(const int64_t idx) const {
 
 std::pair<std::vector<float>, af::dim4> ListFileDataset::loadAudio(
     const std::string& handle) const {
-  auto info = loadSoundInfo(handle.c_str());
-  return {loadSound<float>(handle.c_str()), {info.channels, info.frames}};
+  std::vector<float> audio;
+  auto info = loadSound<float>(handle, audio);
+  return {std::move(audio), {info.channels, info.frames}};
+}
+
+af::dim4 ListFileDataset::loadAudioInto(
+    const std::string& handle,
+    std::vector<float>& buffer) const {
+  auto audio = loadAudio(handle);
+  buffer = std::move(audio.first);
+  return audio.second;
+}
+
+void ListFileDataset::setFeatureCache(std::shared_ptr<FeatureCache> cache) {
+  featureCache_ = std::move(cache);
 }
 
 float ListFileDataset::getInputSize(const int64_t idx) const {
   checkIndexBounds(idx);
-  return inputSizes_[idx];
+  return *index_->inputSize(idx);
 }
 
 int64_t ListFileDataset::getTargetSize(const int64_t idx) const {
@@ -124,7 +116,8 @@ int64_t ListFileDataset::getTargetSize(const int64_t idx) const {
   if (!tgtFeatFunc_) {
     return 0;
   }
-  std::vector<char> curTarget(targets_[idx].begin(), targets_[idx].end());
+  auto transcript = index_->target(idx);
+  std::vector<char> curTarget(transcript.begin(), transcript.end());
   auto tgtSize = tgtFeatFunc_(
                      static_cast<void*>(curTarget.data()),
                      {static_cast<dim_t>(curTarget.size())},
@@ -134,6 +127,11 @@ int64_t ListFileDataset::getTargetSize(const int64_t idx) const {
   return tgtSize;
 }
 
+int64_t ListFileDataset::getSortedIndex(const int64_t i) const {
+  checkIndexBounds(i);
+  return index_->sortedRow(i);
+}
+
 } // namespace asr
 } // namespace app
 } // namespace fl
@@ -7,9 +7,11 @@
 
 #pragma once
 
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
+#include "flashlight/app/asr/data/ListFileIndex.h"
 #include "flashlight/fl/flashlight.h"
 
 #include "flashlight/lib/text/dictionary/Dictionary.h"
@@ -18,6 +20,8 @@ namespace fl {
 namespace app {
 namespace asr {
 
+class FeatureCache;
+
 /**
  *
  * ListFileDataset class encapsulates the loading of dataset files used in
@@ -42,6 +46,9 @@ namespace asr {
  * Calling `dataset.get(idx)` returns an af::array vector of size 4 - `input`,
  * `target`, `word_transcription`, `sample_id` in the same order.
  *
+ * The input file can also be a binary index of a list file (see
+ * ListFileIndex), which is memory mapped rather than parsed.
+ *
  */
 class ListFileDataset : public fl::Dataset {
  public:
@@ -59,17 +66,36 @@ class ListFileDataset : public fl::Dataset {
 
   int64_t getTargetSize(const int64_t idx) const;
 
+  /* The `i`-th sample in the order of decreasing input sizes (stable) */
+  int64_t getSortedIndex(const int64_t i) const;
+
+  /* Load the audio `handle`, return it with its (channels x time) dims */
   virtual std::pair<std::vector<float>, af::dim4> loadAudio(
       const std::string& handle) const;
 
+  /**
+   * Load the audio `handle` in `buffer`, return its (channels x time) dims.
+   * This is what `get()` calls; by default it moves the result of
+   * `loadAudio()` into `buffer`, so subclasses overriding `loadAudio()` keep
+   * working. Override it to decode into the (reused) buffer directly.
+   */
+  virtual af::dim4 loadAudioInto(
+      const std::string& handle,
+      std::vector<float>& buffer) const;
+
+  /**
+   * Serve the input features from `cache`, where they are added once
+   * computed. The cache must have been created for the settings of the input
+   * transform, see `FeatureCache::featuresKey()`.
+   */
+  void setFeatureCache(std::shared_ptr<FeatureCache> cache);
+
  protected:
   DataTransformFunction inFeatFunc_, tgtFeatFunc_, wrdFeatFunc_;
   int64_t numRows_;
-  std::vector<std::string> ids_;
-  std::vector<std::string> inputs_;
-  std::vector<std::string> targets_;
-  std::vector<float> inputSizes_;
+  std::shared_ptr<const ListFileIndex> index_;
   mutable std::vector<int64_t> targetSizesCache_;
+  std::shared_ptr<FeatureCache> featureCache_;
 };
 
 } // namespace asr
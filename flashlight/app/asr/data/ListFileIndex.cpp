@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "flashlight/app/asr/data/ListFileIndex.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+#include "flashlight/lib/common/String.h"
+
+namespace fl {
+namespace app {
+namespace asr {
+
+namespace {
+
+constexpr char kListFileIndexMagic[8] = {'F', 'L', 'L', 'S', 'T', 'I', '0', '1'};
+
+constexpr size_t kIdCol = 0;
+constexpr size_t kInCol = 1;
+constexpr size_t kSzCol = 2;
+constexpr size_t kTgtCol = 3;
+
+// File layout: header, offsets, input sizes, sorted rows, string arena
+struct ListFileIndexHeader {
+  char magic[8];
+  uint64_t numRows;
+  uint64_t arenaSize;
+};
+
+size_t serializedSize(uint64_t numRows, uint64_t arenaSize) {
+  return sizeof(ListFileIndexHeader) + (3 * numRows + 1) * sizeof(uint64_t) +
+      numRows * (sizeof(float) + sizeof(uint32_t)) + arenaSize;
+}
+
+// Columns of a row of a list file, empty for empty lines
+std::vector<std::string> splitRow(
+    const std::string& line,
+    const std::string& filename) {
+  if (line.empty()) {
+    return {};
+  }
+  auto splits = fl::lib::splitOnWhitespace(line, true);
+  if (splits.size() < 3) {
+    throw std::runtime_error(
+        "File " + filename +
+        " has invalid columns in line (expected 3 columns at least): " + line);
+  }
+  return splits;
+}
+
+// Length of the transcription: the columns from kTgtCol joined with spaces
+size_t targetLength(const std::vector<std::string>& splits) {
+  size_t length = 0;
+  for (size_t i = kTgtCol; i < splits.size(); i++) {
+    length += splits[i].size() + (i > kTgtCol ? 1 : 0);
+  }
+  return length;
+}
+
+} // namespace
+
+ListFileIndex::ListFileIndex(const std::string& path) {
+  if (!isIndexFile(path)) {
+    parse(path);
+    return;
+  }
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("[ListFileIndex] could not open file " + path);
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    throw std::runtime_error("[ListFileIndex] could not stat file " + path);
+  }
+  mappedSize_ = st.st_size;
+  void* ptr = mmap(nullptr, mappedSize_, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping stays valid after the descriptor is closed
+  close(fd);
+  if (ptr == MAP_FAILED) {
+    throw std::runtime_error("[ListFileIndex] could not mmap file " + path);
+  }
+  mapped_ = ptr;
+  try {
+    setView(static_cast<const char*>(mapped_), mappedSize_, path);
+  } catch (...) {
+    munmap(mapped_, mappedSize_);
+    throw;
+  }
+}
+
+ListFileIndex::~ListFileIndex() {
+  if (mapped_) {
+    munmap(mapped_, mappedSize_);
+  }
+}
+
+bool ListFileIndex::isIndexFile(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  char magic[sizeof(kListFileIndexMagic)];
+  return file.read(magic, sizeof(magic)) &&
+      std::memcmp(magic, kListFileIndexMagic, sizeof(magic)) == 0;
+}
+
+void ListFileIndex::parse(const std::string& filename) {
+  std::ifstream inFile(filename);
+  if (!inFile) {
+    throw std::invalid_argument("Unable to open file -" + filename);
+  }
+
+  // First pass: sizes of the arrays
+  uint64_t numRows = 0, arenaSize = 0;
+  std::string line;
+  while (std::getline(inFile, line)) {
+    auto splits = splitRow(line, filename);
+    if (splits.empty()) {
+      continue;
+    }
+    ++numRows;
+    arenaSize +=
+        splits[kIdCol].size() + splits[kInCol].size() + targetLength(splits);
+  }
+  if (numRows > std::numeric_limits<uint32_t>::max()) {
+    throw std::runtime_error("File " + filename + " has too many rows");
+  }
+
+  size_t size = serializedSize(numRows, arenaSize);
+  buffer_.resize((size + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+  char* data = reinterpret_cast<char*>(buffer_.data());
+  ListFileIndexHeader header;
+  std::memcpy(header.magic, kListFileIndexMagic, sizeof(kListFileIndexMagic));
+  header.numRows = numRows;
+  header.arenaSize = arenaSize;
+  std::memcpy(data, &header, sizeof(header));
+
+  auto* offsets = reinterpret_cast<uint64_t*>(data + sizeof(header));
+  auto* inputSizes = reinterpret_cast<float*>(offsets + 3 * numRows + 1);
+  auto* sortedRows = reinterpret_cast<uint32_t*>(inputSizes + numRows);
+  auto* arena = reinterpret_cast<char*>(sortedRows + numRows);
+
+  // Second pass: fill them
+  inFile.clear();
+  inFile.seekg(0);
+  uint64_t row = 0, field = 0, offset = 0;
+  auto append = [&](const std::string& str) {
+    std::copy(str.begin(), str.end(), arena + offset);
+    offset += str.size();
+    offsets[++field] = offset;
+  };
+  offsets[0] = 0;
+  while (std::getline(inFile, line) && row < numRows) {
+    auto splits = splitRow(line, filename);
+    if (splits.empty()) {
+      continue;
+    }
+    append(splits[kIdCol]);
+    append(splits[kInCol]);
+    append(fl::lib::join(
+        " ", std::vector<std::string>(splits.begin() + kTgtCol, splits.end())));
+    inputSizes[row++] = std::stof(splits[kSzCol]);
+  }
+  if (row != numRows || offset != arenaSize) {
+    throw std::runtime_error("File " + filename + " changed while reading it");
+  }
+
+  std::iota(sortedRows, sortedRows + numRows, 0);
+  std::stable_sort(
+      sortedRows, sortedRows + numRows, [inputSizes](uint32_t l, uint32_t r) {
+        return inputSizes[l] > inputSizes[r];
+      });
+  setView(data, size, filename);
+}
+
+void ListFileIndex::setView(
+    const char* data,
+    size_t size,
+    const std::string& source) {
+  ListFileIndexHeader header;
+  if (size < sizeof(header)) {
+    throw std::runtime_error("[ListFileIndex] invalid index in " + source);
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(
+          header.magic, kListFileIndexMagic, sizeof(kListFileIndexMagic)) !=
+          0 ||
+      header.numRows > std::numeric_limits<uint32_t>::max() ||
+      size != serializedSize(header.numRows, header.arenaSize)) {
+    throw std::runtime_error("[ListFileIndex] invalid index in " + source);
+  }
+  numRows_ = header.numRows;
+  arenaSize_ = header.arenaSize;
+  offsets_ = reinterpret_cast<const uint64_t*>(data + sizeof(header));
+  inputSizes_ = reinterpret_cast<const float*>(offsets_ + 3 * numRows_ + 1);
+  sortedRows_ = reinterpret_cast<const uint32_t*>(inputSizes_ + numRows_);
+  arena_ = reinterpret_cast<const char*>(sortedRows_ + numRows_);
+  if (offsets_[3 * numRows_] != arenaSize_) {
+    throw std::runtime_error("[ListFileIndex] invalid index in " + source);
+  }
+}
+
+void ListFileIndex::save(const std::string& path) const {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    throw std::runtime_error("[ListFileIndex] could not open file " + path);
+  }
+  const char* data =
+      reinterpret_cast<const char*>(offsets_) - sizeof(ListFileIndexHeader);
+  file.write(data, serializedSize(numRows_, arenaSize_));
+  if (!file.good()) {
+    throw std::runtime_error("[ListFileIndex] could not write file " + path);
+  }
+}
+
+} // namespace asr
+} // namespace app
+} // namespace fl
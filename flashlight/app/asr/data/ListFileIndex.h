@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace fl {
+namespace app {
+namespace asr {
+
+/**
+ * ListFileIndex holds the rows of a list file (see ListFileDataset) in a
+ * compact, read-only layout: the sample ids, input handles and
+ * transcriptions are packed in a single string arena indexed by offsets,
+ * next to the input sizes and the order of the rows by decreasing input
+ * size.
+ *
+ * The index can be saved to a binary file and memory mapped back: loading it
+ * takes constant time and its pages are shared by all the processes (and
+ * datasets) reading the same file. Index files are built from list files
+ * with the `fl_asr_build_list_index` tool.
+ *
+ * Example:
+ *  ListFileIndex("train.lst").save("train.lst.idx");
+ *  ListFileIndex index("train.lst.idx"); // memory mapped
+ */
+class ListFileIndex {
+ public:
+  /* Memory map an index file, or parse a list file if `path` is not one */
+  explicit ListFileIndex(const std::string& path);
+
+  ListFileIndex(const ListFileIndex&) = delete;
+  ListFileIndex& operator=(const ListFileIndex&) = delete;
+
+  ~ListFileIndex();
+
+  /* Write the index in a file which can be memory mapped */
+  void save(const std::string& path) const;
+
+  /* Whether `path` is an index file written with `save()` */
+  static bool isIndexFile(const std::string& path);
+
+  int64_t size() const {
+    return numRows_;
+  }
+
+  std::string id(int64_t idx) const {
+    return field(idx, kIdField);
+  }
+
+  std::string input(int64_t idx) const {
+    return field(idx, kInputField);
+  }
+
+  std::string target(int64_t idx) const {
+    return field(idx, kTargetField);
+  }
+
+  /* Pointer to the input size of the row `idx` */
+  const float* inputSize(int64_t idx) const {
+    return inputSizes_ + idx;
+  }
+
+  /* The `i`-th row in the order of decreasing input sizes (stable) */
+  int64_t sortedRow(int64_t i) const {
+    return sortedRows_[i];
+  }
+
+  /* Whether the index is memory mapped from a file */
+  bool isMapped() const {
+    return mapped_ != nullptr;
+  }
+
+ private:
+  static constexpr int kIdField = 0;
+  static constexpr int kInputField = 1;
+  static constexpr int kTargetField = 2;
+  static constexpr int kNumFields = 3;
+
+  // Owned storage when parsed from a list file
+  std::vector<uint64_t> buffer_;
+  // Mapped storage when loaded from an index file
+  void* mapped_{nullptr};
+  size_t mappedSize_{0};
+
+  int64_t numRows_{0};
+  uint64_t arenaSize_{0};
+  const float* inputSizes_{nullptr};
+  const uint32_t* sortedRows_{nullptr};
+  // Field `f` of row `i` is [offsets_[3i + f], offsets_[3i + f + 1])
+  const uint64_t* offsets_{nullptr};
+  const char* arena_{nullptr};
+
+  std::string field(int64_t idx, int f) const {
+    const uint64_t* offset = offsets_ + idx * kNumFields + f;
+    return std::string(arena_ + offset[0], arena_ + offset[1]);
+  }
+
+  /* Parse a list file into `buffer_` */
+  void parse(const std::string& filename);
+
+  /* Set the array pointers from a buffer holding a serialized index */
+  void setView(const char* data, size_t size, const std::string& source);
+};
+
+} // namespace asr
+} // namespace app
+} // namespace fl
@@ -233,6 +233,22 @@ std::vector<T> loadSound(const std::string& filename) {
 
 template <typename T>
 std::vector<T> loadSound(std::istream& f) {
+  std::vector<T> in;
+  loadSound<T>(f, in);
+  return in;
+}
+
+template <typename T>
+SoundInfo loadSound(const std::string& filename, std::vector<T>& buffer) {
+  std::ifstream f(filename);
+  if (!f.is_open()) {
+    throw std::runtime_error("could not open file " + filename);
+  }
+  return loadSound<T>(f, buffer);
+}
+
+template <typename T>
+SoundInfo loadSound(std::istream& f, std::vector<T>& buffer) {
   SF_VIRTUAL_IO vsf = {sf_vio_ro_get_filelen,
                        sf_vio_ro_seek,
                        sf_vio_ro_read,
@@ -248,27 +264,34 @@ std::vector<T> loadSound(std::istream& f) {
         "loadSound: unknown format or could not open stream");
   }
 
-  std::vector<T> in(info.frames * info.channels);
+  buffer.resize(info.frames * info.channels);
   sf_count_t nframe;
   if (std::is_same<T, float>::value) {
-    nframe =
-        sf_readf_float(file, reinterpret_cast<float*>(in.data()), info.frames);
+    nframe = sf_readf_float(
+        file, reinterpret_cast<float*>(buffer.data()), info.frames);
   } else if (std::is_same<T, double>::value) {
     nframe = sf_readf_double(
-        file, reinterpret_cast<double*>(in.data()), info.frames);
+        file, reinterpret_cast<double*>(buffer.data()), info.frames);
   } else if (std::is_same<T, int>::value) {
-    nframe = sf_readf_int(file, reinterpret_cast<int*>(in.data()), info.frames);
-  } else if (std::is_same<T, short>::value) {
     nframe =
-        sf_readf_short(file, reinterpret_cast<short*>(in.data()), info.frames);
+        sf_readf_int(file, reinterpret_cast<int*>(buffer.data()), info.frames);
+  } else if (std::is_same<T, short>::value) {
+    nframe = sf_readf_short(
+        file, reinterpret_cast<short*>(buffer.data()), info.frames);
   } else {
+    sf_close(file);
     throw std::logic_error("loadSound: called with unsupported T");
   }
   sf_close(file);
   if (nframe != info.frames) {
     throw std::runtime_error("loadSound: read error");
   }
-  return in;
+
+  SoundInfo usrinfo;
+  usrinfo.frames = info.frames;
+  usrinfo.samplerate = info.samplerate;
+  usrinfo.channels = info.channels;
+  return usrinfo;
 }
 
 template <typename T>
@@ -373,6 +396,16 @@ template std::vector<double> loadSound<double>(std::istream&);
 template std::vector<int> loadSound<int>(std::istream&);
 template std::vector<short> loadSound<short>(std::istream&);
 
+template SoundInfo loadSound(const std::string&, std::vector<float>&);
+template SoundInfo loadSound(const std::string&, std::vector<double>&);
+template SoundInfo loadSound(const std::string&, std::vector<int>&);
+template SoundInfo loadSound(const std::string&, std::vector<short>&);
+
+template SoundInfo loadSound<float>(std::istream&, std::vector<float>&);
+template SoundInfo loadSound<double>(std::istream&, std::vector<double>&);
+template SoundInfo loadSound<int>(std::istream&, std::vector<int>&);
+template SoundInfo loadSound<short>(std::istream&, std::vector<short>&);
+
 template void saveSound(
     const std::string&,
     const std::vector<float>&,
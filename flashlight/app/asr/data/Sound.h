@@ -83,6 +83,17 @@ std::vector<T> loadSound(std::istream& f);
 template <typename T>
 std::vector<T> loadSound(const std::string& filename);
 
+/**
+ * Load the header and the samples of a sound with a single open and parse:
+ * the (interleaved) samples are written in `buffer`, which is resized and
+ * keeps its capacity, so that a buffer reused across calls is allocated only
+ * once.
+ */
+template <typename T>
+SoundInfo loadSound(std::istream& f, std::vector<T>& buffer);
+template <typename T>
+SoundInfo loadSound(const std::string& filename, std::vector<T>& buffer);
+
 template <typename T>
 void saveSound(
     std::ostream& f,
@@ -7,7 +7,10 @@
 
 #include "flashlight/app/asr/decoder/ConvLmModule.h"
 
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
 #include "flashlight/ext/common/DistributedUtils.h"
 
@@ -15,6 +18,138 @@ namespace fl {
 namespace app {
 namespace asr {
 
+namespace {
+
+// Streaming state of a hypothesis: the input frames history of every causal
+// convolution, flattened and concatenated in network traversal order.
+struct ConvLmFrameState : fl::lib::text::ConvLMStreamingState {
+  af::array history;
+};
+
+// Shapes (for a single hypothesis) of the convolution histories, known after
+// the first forward
+struct ConvLmFrameLayout {
+  std::vector<af::dim4> shapes;
+  std::vector<dim_t> offsets;
+  dim_t size = 0;
+};
+
+// Forwards one frame per hypothesis through the network, taking the previous
+// input frames of each causal convolution from `histories` (empty at the
+// start of the sequences) and collecting the updated ones.
+class FrameForward {
+ public:
+  explicit FrameForward(std::vector<af::array> histories)
+      : histories_(std::move(histories)) {}
+
+  Variable forward(const std::shared_ptr<Module>& module, const Variable& in) {
+    if (auto seq = std::dynamic_pointer_cast<Sequential>(module)) {
+      auto output = in;
+      for (const auto& child : seq->modules()) {
+        output = forward(child, output);
+      }
+      return output;
+    }
+    if (auto res = std::dynamic_pointer_cast<Residual>(module)) {
+      return forwardResidual(res, in);
+    }
+    if (auto wn = std::dynamic_pointer_cast<WeightNorm>(module)) {
+      // weights are normalized once when switching to eval mode
+      return forward(wn->module(), in);
+    }
+    if (auto conv = std::dynamic_pointer_cast<AsymmetricConv1D>(module)) {
+      return forwardConv(conv, in);
+    }
+    bool mixesTime = std::dynamic_pointer_cast<Container>(module) ||
+        std::dynamic_pointer_cast<Padding>(module) ||
+        std::dynamic_pointer_cast<Pool2D>(module) ||
+        std::dynamic_pointer_cast<RNN>(module);
+    if (std::dynamic_pointer_cast<Conv2D>(module)) {
+      mixesTime = module->param(0).dims(0) != 1;
+    }
+    if (mixesTime) {
+      throw std::invalid_argument(
+          "[ConvLM] Module can't be forwarded frame by frame: " +
+          module->prettyString());
+    }
+    return module->forward({in}).front();
+  }
+
+  std::vector<af::array>& newHistories() {
+    return newHistories_;
+  }
+
+ private:
+  std::vector<af::array> histories_;
+  std::vector<af::array> newHistories_;
+
+  Variable forwardConv(
+      const std::shared_ptr<AsymmetricConv1D>& conv,
+      const Variable& in) {
+    int historySize = conv->historySize();
+    if (historySize == 0) {
+      return conv->forward(in);
+    }
+    int idx = newHistories_.size();
+    af::array history = idx < histories_.size()
+        ? histories_[idx]
+        : af::constant(
+              0,
+              af::dim4(historySize, in.dims(1), in.dims(2), in.dims(3)),
+              in.type());
+    auto window = af::join(0, history, in.array());
+    newHistories_.push_back(window.rows(1, historySize));
+    return conv->forwardFrame(Variable(window, false));
+  }
+
+  // Mirrors Residual::forward
+  Variable forwardResidual(
+      const std::shared_ptr<Residual>& res,
+      const Variable& in) {
+    auto modules = res->modules();
+    auto projections = res->getProjectionsIndices();
+    auto shortcuts = res->getShortcuts();
+    auto scales = res->getScales();
+    auto applyScale = [&scales](const Variable& input, int layerIndex) {
+      auto scale = scales.find(layerIndex);
+      return scale == scales.end() ? input : input * scale->second;
+    };
+    auto addShortcuts = [&](Variable& output,
+                            const std::vector<Variable>& outputs,
+                            int layerIndex) {
+      auto layerShortcuts = shortcuts.find(layerIndex);
+      if (layerShortcuts == shortcuts.end()) {
+        return;
+      }
+      for (const auto& shortcut : layerShortcuts->second) {
+        Variable connectionOut = outputs[shortcut.first];
+        if (shortcut.second != -1) {
+          connectionOut = forward(modules[shortcut.second], connectionOut);
+        }
+        output = output + connectionOut.as(output.type());
+      }
+    };
+
+    int nLayers = modules.size() - projections.size();
+    std::vector<Variable> outputs(nLayers + 1);
+    outputs[0] = in;
+    Variable output = in;
+    for (int moduleIndex = 0, layerIndex = 0; layerIndex < nLayers;
+         layerIndex++, moduleIndex++) {
+      while (projections.find(moduleIndex) != projections.end()) {
+        moduleIndex++;
+      }
+      addShortcuts(output, outputs, layerIndex);
+      output = forward(modules[moduleIndex], applyScale(output, layerIndex));
+      outputs[layerIndex + 1] = output;
+    }
+    addShortcuts(output, outputs, nLayers);
+    return applyScale(output, nLayers);
+  }
+};
+
+} // namespace
+
 GetConvLmScoreFunc buildGetConvLmScoreFunction(
     std::shared_ptr<Module> network) {
   auto getConvLmScoreFunc = [network](
@@ -64,6 +199,99 @@ GetConvLmScoreFunc buildGetConvLmScoreFunction(
 
   return getConvLmScoreFunc;
 }
+
+fl::lib::text::GetConvLmIncrementalScoreFunc
+buildGetConvLmIncrementalScoreFunction(std::shared_ptr<Module> network) {
+  auto layout = std::make_shared<ConvLmFrameLayout>();
+  auto getConvLmScoreFunc =
+      [network, layout](
+          const std::vector<fl::lib::text::ConvLMStreamingStatePtr>& inStates,
+          const std::vector<int>& lastTokens,
+          std::vector<fl::lib::text::ConvLMStreamingStatePtr>& outStates) {
+        int batchSize = lastTokens.size();
+        if (batchSize == 0 || inStates.size() != batchSize) {
+          throw std::invalid_argument(
+              "[ConvLM] Incorrect number of states (" +
+              std::to_string(inStates.size()) + ") or tokens (" +
+              std::to_string(batchSize) + ").");
+        }
+
+        // Batch the histories: missing states are the start of the sequence,
+        // i.e. zero frames as with the padding of the full forward
+        std::vector<af::array> histories;
+        bool hasHistory = false;
+        for (const auto& state : inStates) {
+          hasHistory = hasHistory || state;
+        }
+        if (hasHistory && layout->size > 0) {
+          af::array batched = af::constant(0, layout->size, batchSize);
+          for (int b = 0; b < batchSize; b++) {
+            if (inStates[b]) {
+              batched(af::span, b) =
+                  static_cast<ConvLmFrameState*>(inStates[b].get())->history;
+            }
+          }
+          for (int i = 0; i < layout->shapes.size(); i++) {
+            auto dims = layout->shapes[i];
+            dims[3] = batchSize;
+            histories.push_back(af::moddims(
+                batched.rows(
+                    layout->offsets[i],
+                    layout->offsets[i] + layout->shapes[i].elements() - 1),
+                dims));
+          }
+        }
+
+        af::array inputData(1, batchSize, lastTokens.data());
+        FrameForward frameForward(std::move(histories));
+        fl::Variable output =
+            frameForward.forward(network, fl::input(inputData));
+        if (af::count<int>(af::isNaN(output.array())) != 0) {
+          throw std::runtime_error("[ConvLM] Encountered NaNs in propagation");
+        }
+        int32_t C = output.dims(0);
+        if (output.elements() != C * batchSize) {
+          throw std::logic_error(
+              "[ConvLM]: incorrect predictions: expected one frame for " +
+              std::to_string(batchSize) + " hypotheses");
+        }
+
+        // Unbatch the new histories
+        auto& newHistories = frameForward.newHistories();
+        if (layout->shapes.empty()) {
+          for (const auto& history : newHistories) {
+            auto dims = history.dims();
+            dims[3] = 1;
+            layout->shapes.push_back(dims);
+            layout->offsets.push_back(layout->size);
+            layout->size += dims.elements();
+          }
+        }
+        if (newHistories.size() != layout->shapes.size()) {
+          throw std::logic_error("[ConvLM]: inconsistent streaming state");
+        }
+        af::array batched;
+        for (const auto& history : newHistories) {
+          auto flat =
+              af::moddims(history, history.elements() / batchSize, batchSize);
+          batched = batched.isempty() ? flat : af::join(0, batched, flat);
+        }
+        outStates.resize(batchSize);
+        for (int b = 0; b < batchSize; b++) {
+          auto state = std::make_shared<ConvLmFrameState>();
+          if (!batched.isempty()) {
+            state->history = batched(af::span, b);
+          }
+          outStates[b] = std::move(state);
+        }
+
+        // vector of B X C predictions
+        auto preds = af::moddims(output.array(), C, batchSize);
+        return ext::afToVector<float>(preds);
+      };
+
+  return getConvLmScoreFunc;
+}
 } // namespace asr
 } // namespace app
 } // namespace fl
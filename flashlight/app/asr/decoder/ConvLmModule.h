@@ -9,6 +9,7 @@
 
 #include "flashlight/fl/contrib/contrib.h"
 #include "flashlight/fl/flashlight.h"
+#include "flashlight/lib/text/decoder/lm/ConvLM.h"
 
 namespace fl {
 namespace app {
@@ -18,6 +19,16 @@ using GetConvLmScoreFunc = std::function<std::vector<
     float>(const std::vector<int>&, const std::vector<int>&, int, int)>;
 
 GetConvLmScoreFunc buildGetConvLmScoreFunction(std::shared_ptr<Module> network);
+
+/**
+ * Builds the scoring function of a streaming ConvLM: each hypothesis keeps the
+ * receptive field of every causal convolution, so a new token is forwarded as
+ * a single frame through every layer. The network (in eval mode) can be built
+ * from `Sequential`, `Residual`, `WeightNorm`, causal `AsymmetricConv1D`
+ * (time along the first dimension) and any module which is pointwise in time.
+ */
+fl::lib::text::GetConvLmIncrementalScoreFunc
+buildGetConvLmIncrementalScoreFunction(std::shared_ptr<Module> network);
 } // namespace asr
 } // namespace app
 } // namespace fl
@@ -6,12 +6,49 @@
  */
 
 #include "flashlight/app/asr/decoder/DecodeUtils.h"
+
+#include <algorithm>
+#include <type_traits>
+
 using fl::lib::text::SmearingMode;
 
 namespace fl {
 namespace app {
 namespace asr {
 
+namespace {
+
+// 64-bit FNV-1a
+class Fingerprint {
+ public:
+  void add(const void* data, size_t size) {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+      hash_ = (hash_ ^ bytes[i]) * 1099511628211ULL;
+    }
+  }
+
+  void add(const std::string& str) {
+    add(static_cast<uint64_t>(str.size()));
+    add(str.data(), str.size());
+  }
+
+  template <typename T>
+  void add(const T& value) {
+    static_assert(std::is_arithmetic<T>::value, "Fingerprint of a number");
+    add(&value, sizeof(value));
+  }
+
+  uint64_t value() const {
+    return hash_;
+  }
+
+ private:
+  uint64_t hash_{14695981039346656037ULL};
+};
+
+} // namespace
+
 std::shared_ptr<fl::lib::text::Trie> buildTrie(
     const std::string& decoderType,
     bool useLexicon,
@@ -57,6 +94,60 @@ std::shared_ptr<fl::lib::text::Trie> buildTrie(
   return trie;
 }
 
+uint64_t trieFingerprint(
+    const std::string& decoderType,
+    bool useLexicon,
+    std::shared_ptr<fl::lib::text::LM> lm,
+    const std::string& smearing,
+    const fl::lib::text::Dictionary& tokenDict,
+    const fl::lib::text::LexiconMap& lexicon,
+    const fl::lib::text::Dictionary& wordDict,
+    const int wordSeparatorIdx,
+    const int repLabel) {
+  Fingerprint fingerprint;
+  fingerprint.add(decoderType);
+  fingerprint.add(useLexicon);
+  fingerprint.add(smearing);
+  fingerprint.add(wordSeparatorIdx);
+  fingerprint.add(repLabel);
+  fingerprint.add(static_cast<uint64_t>(tokenDict.indexSize()));
+  for (int i = 0; i < tokenDict.indexSize(); i++) {
+    fingerprint.add(tokenDict.getEntry(i));
+  }
+
+  // The lexicon is unordered: go through its words in a fixed order
+  std::vector<const fl::lib::text::LexiconMap::value_type*> entries;
+  entries.reserve(lexicon.size());
+  for (const auto& it : lexicon) {
+    entries.push_back(&it);
+  }
+  std::sort(entries.begin(), entries.end(), [](const auto* a, const auto* b) {
+    return a->first < b->first;
+  });
+  auto startState = lm->start(false);
+  for (const auto* entry : entries) {
+    const std::string& word = entry->first;
+    int usrIdx = wordDict.getIndex(word);
+    fingerprint.add(word);
+    fingerprint.add(usrIdx);
+    if (decoderType == "wrd") {
+      fl::lib::text::LMStatePtr dummyState;
+      float score;
+      std::tie(dummyState, score) = lm->score(startState, usrIdx);
+      fingerprint.add(score);
+    }
+    const auto& spellings = entry->second;
+    fingerprint.add(static_cast<uint64_t>(spellings.size()));
+    for (const auto& tokens : spellings) {
+      fingerprint.add(static_cast<uint64_t>(tokens.size()));
+      for (const auto& token : tokens) {
+        fingerprint.add(token);
+      }
+    }
+  }
+  return fingerprint.value();
+}
+
 } // namespace asr
 } // namespace app
 } // namespace fl
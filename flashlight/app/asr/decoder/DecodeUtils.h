@@ -37,6 +37,22 @@ std::shared_ptr<fl::lib::text::Trie> buildTrie(
     const int wordSeparatorIdx,
     const int repLabel);
 
+/*
+ * Fingerprint of the inputs of buildTrie(), which takes the same arguments:
+ * the lexicon, the token and word dictionaries, the smearing mode and, for
+ * 'wrd' decoding, the LM scores of the words.
+ */
+uint64_t trieFingerprint(
+    const std::string& decoderType,
+    bool useLexicon,
+    std::shared_ptr<fl::lib::text::LM> lm,
+    const std::string& smearing,
+    const fl::lib::text::Dictionary& tokenDict,
+    const fl::lib::text::LexiconMap& lexicon,
+    const fl::lib::text::Dictionary& wordDict,
+    const int wordSeparatorIdx,
+    const int repLabel);
+
 } // namespace asr
 } // namespace app
 } // namespace fl
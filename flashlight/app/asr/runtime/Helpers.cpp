@@ -7,6 +7,7 @@
 
 #include "flashlight/app/asr/runtime/Helpers.h"
 
+#include <algorithm>
 #include <numeric>
 #include <random>
 #include <utility>
@@ -112,8 +113,10 @@ std::shared_ptr<fl::Dataset> createDataset(
     int worldSize /* = 1 */,
     const bool allowEmpty /* = false */,
     const std::string& batchingStrategy /* kBatchStrategyNone */,
-    int maxDurationPerBatch /* = 0 */) {
+    int maxDurationPerBatch /* = 0 */,
+    const std::shared_ptr<FeatureCache>& featureCache /* = nullptr */) {
   std::vector<std::shared_ptr<const fl::Dataset>> allListDs;
+  std::vector<std::shared_ptr<ListFileDataset>> listDs;
   std::vector<float> sizes;
   for (auto& path : paths) {
     std::shared_ptr<ListFileDataset> curListDs;
@@ -136,8 +139,12 @@ std::shared_ptr<fl::Dataset> createDataset(
           targetTransform,
           wordTransform);
     }
+    if (featureCache) {
+      curListDs->setFeatureCache(featureCache);
+    }
 
     allListDs.emplace_back(curListDs);
+    listDs.emplace_back(curListDs);
     sizes.reserve(sizes.size() + curListDs->size());
     for (int64_t i = 0; i < curListDs->size(); ++i) {
       sizes.push_back(curListDs->getInputSize(i));
@@ -159,8 +166,23 @@ std::shared_ptr<fl::Dataset> createDataset(
       std::swap(sizes[i - 1], sizes[index]);
     }
   } else {
-    std::stable_sort(sortedIds.begin(), sortedIds.end(), cmp);
-    std::stable_sort(sizes.begin(), sizes.end(), std::greater<float>());
+    // Each list is sorted already: merge them
+    sortedIds.clear();
+    int64_t offset = 0;
+    for (const auto& ds : listDs) {
+      auto mid = sortedIds.size();
+      for (int64_t i = 0; i < ds->size(); ++i) {
+        sortedIds.push_back(offset + ds->getSortedIndex(i));
+      }
+      std::inplace_merge(
+          sortedIds.begin(), sortedIds.begin() + mid, sortedIds.end(), cmp);
+      offset += ds->size();
+    }
+    std::vector<float> sortedSizes(sizes.size());
+    for (int64_t i = 0; i < sortedIds.size(); ++i) {
+      sortedSizes[i] = sizes[sortedIds[i]];
+    }
+    sizes = std::move(sortedSizes);
   }
 
   auto concatListDs = std::make_shared<fl::ConcatDataset>(allListDs);
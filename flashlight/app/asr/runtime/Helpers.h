@@ -23,6 +23,7 @@
 #include "flashlight/app/asr/common/Defines.h"
 #include "flashlight/app/asr/common/Flags.h"
 #include "flashlight/app/asr/criterion/criterion.h"
+#include "flashlight/app/asr/data/FeatureCache.h"
 #include "flashlight/app/asr/data/ListFileDataset.h"
 
 #include "flashlight/lib/common/String.h"
@@ -67,6 +68,7 @@ std::vector<std::string> readSampleIds(const af::array& arr);
  * "dynamic"
  * @param maxDurationPerBatch - is used for batchingStrategy="dynamic", max
  * total duration in a batch
+ * @param featureCache - a cache of the features computed by inputTransform
  */
 std::shared_ptr<fl::Dataset> createDataset(
     const std::vector<std::string>& paths,
@@ -81,7 +83,8 @@ std::shared_ptr<fl::Dataset> createDataset(
     int worldSize = 1,
     const bool allowEmpty = false,
     const std::string& batchingStrategy = kBatchStrategyNone,
-    int maxDurationPerBatch = 0);
+    int maxDurationPerBatch = 0,
+    const std::shared_ptr<FeatureCache>& featureCache = nullptr);
 
 std::shared_ptr<fl::Dataset> loadPrefetchDataset(
     std::shared_ptr<fl::Dataset> dataset,
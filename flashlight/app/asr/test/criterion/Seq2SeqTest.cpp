@@ -420,6 +420,121 @@ TEST(Seq2SeqTest, BatchedDecoderStep) {
   }
 }
 
+namespace {
+
+// Runs two steps for two utterances of different lengths, with two
+// hypothesis per utterance at the second step, with the single-utterance AM
+// update and with the batch one, and checks that both give the same scores
+void checkBatchAmUpdateFunction(
+    const AMUpdateFunc& amUpdateFunc,
+    const BatchAMUpdateFunc& batchAmUpdateFunc,
+    int H) {
+  std::vector<int> T = {10, 7};
+  std::vector<std::vector<float>> emissions;
+  std::vector<const float*> emissionPtrs;
+  for (int t : T) {
+    emissions.push_back(afToVector<float>(af::randn(H, t, f32)));
+    emissionPtrs.push_back(emissions.back().data());
+  }
+
+  std::vector<std::vector<float>> singleScores;
+  for (int b = 0; b < T.size(); b++) {
+    int step = 0;
+    auto first =
+        amUpdateFunc(emissionPtrs[b], H, T[b], {-1}, {nullptr}, step);
+    singleScores.push_back(first.first[0]);
+    step = 1;
+    auto second = amUpdateFunc(
+        emissionPtrs[b],
+        H,
+        T[b],
+        {1, 2},
+        {first.second[0], first.second[0]},
+        step);
+    singleScores.push_back(second.first[0]);
+    singleScores.push_back(second.first[1]);
+  }
+
+  int step = 0;
+  auto first = batchAmUpdateFunc(
+      emissionPtrs, H, T, {-1, -1}, {nullptr, nullptr}, {1, 1}, step);
+  step = 1;
+  auto second = batchAmUpdateFunc(
+      emissionPtrs,
+      H,
+      T,
+      {1, 2, 1, 2},
+      {first.second[0], first.second[0], first.second[1], first.second[1]},
+      {2, 2},
+      step);
+  std::vector<std::vector<float>> batchScores = {first.first[0],
+                                                 second.first[0],
+                                                 second.first[1],
+                                                 first.first[1],
+                                                 second.first[2],
+                                                 second.first[3]};
+
+  ASSERT_EQ(batchScores.size(), singleScores.size());
+  for (int i = 0; i < singleScores.size(); i++) {
+    ASSERT_EQ(batchScores[i].size(), singleScores[i].size());
+    for (int j = 0; j < singleScores[i].size(); j++) {
+      ASSERT_NEAR(singleScores[i][j], batchScores[i][j], 1e-5);
+    }
+  }
+}
+
+} // namespace
+
+TEST(Seq2SeqTest, BatchAmUpdateFunction) {
+  int N = 5, H = 8, maxoutputlen = 100, nRnnLayer = 2, nAttnRound = 2;
+  std::shared_ptr<SequenceCriterion> seq2seq =
+      std::make_shared<Seq2SeqCriterion>(
+          N,
+          H,
+          N - 2,
+          N - 1,
+          maxoutputlen,
+          std::vector<std::shared_ptr<AttentionBase>>(
+              nAttnRound, std::make_shared<ContentAttention>()),
+          nullptr,
+          false,
+          100,
+          0.0,
+          false,
+          kRandSampling,
+          1.0,
+          nRnnLayer,
+          nAttnRound,
+          0.0);
+  seq2seq->eval();
+  // A batch of 3 hypothesis splits the second step within an utterance
+  checkBatchAmUpdateFunction(
+      buildSeq2SeqRnnAmUpdateFunction(seq2seq, nAttnRound, 2, 1000, 1.0),
+      buildSeq2SeqRnnBatchAmUpdateFunction(seq2seq, nAttnRound, 3, 1000, 1.0),
+      H);
+
+  std::shared_ptr<SequenceCriterion> transformer =
+      std::make_shared<TransformerCriterion>(
+          N,
+          H,
+          N - 2,
+          N - 1,
+          maxoutputlen,
+          2, // nLayer
+          std::make_shared<ContentAttention>(),
+          nullptr,
+          false,
+          0.0,
+          100,
+          0.0,
+          0.0);
+  transformer->eval();
+  checkBatchAmUpdateFunction(
+      buildSeq2SeqTransformerAmUpdateFunction(transformer, 2, 1000, 1.0),
+      buildSeq2SeqTransformerBatchAmUpdateFunction(transformer, 3, 1000, 1.0),
+      H);
+}
+
 TEST(Seq2SeqTest, Seq2SeqSampling) {
   int N = 5, H = 8, B = 1, T = 10, U = 5, maxoutputlen = 100;
   auto input = noGrad(af::randn(H, T, B, f32));
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arrayfire.h>
+#include <gtest/gtest.h>
+
+#include "flashlight/app/asr/data/FeatureCache.h"
+#include "flashlight/fl/common/Init.h"
+#include "flashlight/lib/common/System.h"
+
+using namespace fl::app::asr;
+
+namespace {
+
+fl::lib::audio::FeatureParams featureParams() {
+  fl::lib::audio::FeatureParams params;
+  params.numFilterbankChans = 40;
+  return params;
+}
+
+void removeSegments(const std::string& prefix) {
+  for (int i = 0; i < 8; ++i) {
+    std::remove((prefix + "." + std::to_string(i) + ".blob").c_str());
+  }
+}
+
+bool sameArray(const af::array& a, const af::array& b) {
+  return a.dims() == b.dims() && af::allTrue<bool>(a == b);
+}
+
+} // namespace
+
+TEST(FeatureCacheTest, FeaturesKey) {
+  auto params = featureParams();
+  auto key = FeatureCache::featuresKey(params, FeatureType::MFSC, {0, 0});
+  ASSERT_EQ(key, FeatureCache::featuresKey(params, FeatureType::MFSC, {0, 0}));
+  ASSERT_NE(key, FeatureCache::featuresKey(params, FeatureType::MFCC, {0, 0}));
+  ASSERT_NE(key, FeatureCache::featuresKey(params, FeatureType::MFSC, {0, 5}));
+  params.numFilterbankChans = 80;
+  ASSERT_NE(key, FeatureCache::featuresKey(params, FeatureType::MFSC, {0, 0}));
+}
+
+TEST(FeatureCacheTest, AddGetReload) {
+  const std::string prefix = fl::lib::getTmpPath("featurecache");
+  removeSegments(prefix);
+  auto key =
+      FeatureCache::featuresKey(featureParams(), FeatureType::MFSC, {0, 0});
+  std::vector<af::array> features;
+  for (int i = 0; i < 5; ++i) {
+    features.push_back(af::randu(10 + i, 40, 1));
+  }
+  auto path = [](int i) { return "/audio/" + std::to_string(i) + ".flac"; };
+
+  {
+    // Segments of 2 samples: the last one is sealed on destruction
+    FeatureCache cache(prefix, key, 2);
+    ASSERT_EQ(cache.size(), 0);
+    ASSERT_TRUE(cache.get(path(0)).isempty());
+    for (int i = 0; i < 5; ++i) {
+      cache.add(path(i), features[i]);
+      ASSERT_TRUE(sameArray(cache.get(path(i)), features[i]));
+    }
+    ASSERT_EQ(cache.size(), 5);
+    for (int i = 0; i < 5; ++i) {
+      ASSERT_TRUE(sameArray(cache.get(path(i)), features[i]));
+    }
+  }
+
+  {
+    FeatureCache cache(prefix, key, 2);
+    ASSERT_EQ(cache.size(), 5);
+    for (int i = 0; i < 5; ++i) {
+      ASSERT_TRUE(sameArray(cache.get(path(i)), features[i]));
+    }
+    ASSERT_TRUE(cache.get(path(5)).isempty());
+  }
+
+  // Other settings miss
+  {
+    FeatureCache cache(prefix, key + 1, 2);
+    ASSERT_EQ(cache.size(), 0);
+    ASSERT_TRUE(cache.get(path(0)).isempty());
+  }
+
+  // A segment which was not sealed is dropped, the others are kept
+  {
+    std::ofstream file(prefix + ".1.blob", std::ios::binary | std::ios::trunc);
+    file << "not a blob";
+  }
+  {
+    FeatureCache cache(prefix, key, 2);
+    ASSERT_EQ(cache.size(), 3);
+    ASSERT_TRUE(sameArray(cache.get(path(0)), features[0]));
+    ASSERT_TRUE(cache.get(path(2)).isempty());
+    ASSERT_TRUE(sameArray(cache.get(path(4)), features[4]));
+  }
+  removeSegments(prefix);
+}
+
+TEST(FeatureCacheTest, ConcurrentAddGet) {
+  const std::string prefix = fl::lib::getTmpPath("featurecache_concurrent");
+  removeSegments(prefix);
+  auto key =
+      FeatureCache::featuresKey(featureParams(), FeatureType::MFSC, {0, 0});
+  const int kThreads = 4, kSamples = 12;
+  std::vector<af::array> features;
+  for (int i = 0; i < kSamples; ++i) {
+    features.push_back(af::randu(10 + i, 40, 1));
+  }
+  auto path = [](int i) { return "/audio/" + std::to_string(i) + ".flac"; };
+
+  {
+    FeatureCache cache(prefix, key, 5);
+    // Each thread adds its samples and reads them all while the others write
+    std::vector<int> failures(kThreads, 0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+      threads.emplace_back([&, t]() {
+        for (int i = t; i < kSamples; i += kThreads) {
+          cache.add(path(i), features[i]);
+          for (int j = 0; j < kSamples; ++j) {
+            auto cached = cache.get(path(j));
+            if (!cached.isempty() && !sameArray(cached, features[j])) {
+              ++failures[t];
+            }
+          }
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    for (int t = 0; t < kThreads; ++t) {
+      ASSERT_EQ(failures[t], 0);
+    }
+    ASSERT_EQ(cache.size(), kSamples);
+  }
+
+  FeatureCache cache(prefix, key, 5);
+  ASSERT_EQ(cache.size(), kSamples);
+  for (int i = 0; i < kSamples; ++i) {
+    ASSERT_TRUE(sameArray(cache.get(path(i)), features[i]));
+  }
+  removeSegments(prefix);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  fl::init();
+  return RUN_ALL_TESTS();
+}
@@ -31,6 +31,17 @@ auto letterToTarget = [](void* data, af::dim4 dims, af::dtype /* unused */) {
   }
   return af::array(tgt.size(), tgt.data());
 };
+
+// Loads silence of 10 frames for every sample
+class SilenceDataset : public ListFileDataset {
+ public:
+  using ListFileDataset::ListFileDataset;
+
+  std::pair<std::vector<float>, af::dim4> loadAudio(
+      const std::string& /* unused */) const override {
+    return {std::vector<float>(10, 0), af::dim4(1, 10)};
+  }
+};
 } // namespace
 
 TEST(ListFileDatasetTest, LoadData) {
@@ -62,6 +73,73 @@ TEST(ListFileDatasetTest, LoadData) {
   }
 }
 
+TEST(ListFileDatasetTest, LoadAudioOverride) {
+  auto data = getFileContent(pathsConcat(loadPath, "data.lst"));
+  const std::string rootPath = fl::lib::getTmpPath("data_override.lst");
+  std::ofstream out(rootPath);
+  for (auto& d : data) {
+    replaceAll(d, "<TESTDIR>", loadPath);
+    out << d;
+    out << "\n";
+  }
+  out.close();
+  SilenceDataset audiods(rootPath, nullptr, letterToTarget);
+  for (int i = 0; i < 3; ++i) {
+    auto input = audiods.get(i)[0];
+    ASSERT_EQ(input.dims(), af::dim4(1, 10));
+    ASSERT_TRUE(af::allTrue<bool>(input == 0));
+  }
+}
+
+TEST(ListFileDatasetTest, LoadIndex) {
+  auto data = getFileContent(pathsConcat(loadPath, "data.lst"));
+  const std::string listPath = fl::lib::getTmpPath("data_index.lst");
+  std::ofstream out(listPath);
+  for (auto& d : data) {
+    replaceAll(d, "<TESTDIR>", loadPath);
+    out << d;
+    out << "\n";
+  }
+  out.close();
+
+  ListFileIndex parsed(listPath);
+  ASSERT_FALSE(parsed.isMapped());
+  ASSERT_FALSE(ListFileIndex::isIndexFile(listPath));
+  const std::string indexPath = listPath + ".idx";
+  parsed.save(indexPath);
+  ASSERT_TRUE(ListFileIndex::isIndexFile(indexPath));
+
+  ListFileIndex mapped(indexPath);
+  ASSERT_TRUE(mapped.isMapped());
+  ASSERT_EQ(mapped.size(), 3);
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(mapped.id(i), parsed.id(i));
+    ASSERT_EQ(mapped.input(i), parsed.input(i));
+    ASSERT_EQ(mapped.target(i), parsed.target(i));
+    ASSERT_EQ(*mapped.inputSize(i), *parsed.inputSize(i));
+  }
+  // Rows by decreasing duration: 2.1, 1.2, 0.6
+  std::vector<int64_t> expectedOrder = {1, 0, 2};
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(mapped.sortedRow(i), expectedOrder[i]);
+  }
+
+  ListFileDataset fromList(listPath, nullptr, letterToTarget);
+  ListFileDataset fromIndex(indexPath, nullptr, letterToTarget);
+  ASSERT_EQ(fromIndex.size(), fromList.size());
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(fromIndex.getInputSize(i), fromList.getInputSize(i));
+    ASSERT_EQ(fromIndex.getTargetSize(i), fromList.getTargetSize(i));
+    ASSERT_EQ(fromIndex.getSortedIndex(i), expectedOrder[i]);
+    auto expected = fromList.get(i);
+    auto sample = fromIndex.get(i);
+    ASSERT_EQ(sample.size(), expected.size());
+    for (int j = 0; j < sample.size(); ++j) {
+      ASSERT_TRUE(af::allTrue<bool>(sample[j] == expected[j]));
+    }
+  }
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   fl::init();
@@ -161,6 +161,29 @@ TEST(SoundTest, StreamReadWrite) {
   }
 }
 
+TEST(SoundTest, LoadIntoBuffer) {
+  auto stereopath = pathsConcat(loadPath, "test_stereo.wav");
+  auto monopath = pathsConcat(loadPath, "test_mono.wav");
+  auto stereoInfo = loadSoundInfo(stereopath);
+  auto monoInfo = loadSoundInfo(monopath);
+  auto stereo = loadSound<float>(stereopath);
+  auto mono = loadSound<float>(monopath);
+
+  std::vector<float> buffer;
+  auto info = loadSound<float>(stereopath, buffer);
+  ASSERT_EQ(info.samplerate, stereoInfo.samplerate);
+  ASSERT_EQ(info.channels, stereoInfo.channels);
+  ASSERT_EQ(info.frames, stereoInfo.frames);
+  ASSERT_EQ(buffer, stereo);
+
+  // The buffer is resized, and reused, for the next sound
+  info = loadSound<float>(monopath, buffer);
+  ASSERT_EQ(info.samplerate, monoInfo.samplerate);
+  ASSERT_EQ(info.channels, monoInfo.channels);
+  ASSERT_EQ(info.frames, monoInfo.frames);
+  ASSERT_EQ(buffer, mono);
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   fl::init();
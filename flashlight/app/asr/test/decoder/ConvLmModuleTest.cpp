@@ -10,6 +10,7 @@
 #include <arrayfire.h>
 #include "flashlight/fl/flashlight.h"
 
+#include "flashlight/app/asr/decoder/ConvLmModule.h"
 #include "flashlight/ext/common/SequentialBuilder.h"
 #include "flashlight/lib/common/System.h"
 
@@ -114,6 +115,55 @@ TEST(ConvLmModuleTest, SerializationGCNN14BAdaptiveSoftmax) {
   ASSERT_TRUE(allClose(outputl_criterion, output_criterion));
 }
 
+TEST(ConvLmModuleTest, IncrementalScoreGCNN14BCrossEntropy) {
+  const std::string archfile = pathsConcat(archDir, "gcnn_14B_lm_arch_ce.txt");
+  int nclass = 30;
+  int batchsize = 2;
+  int inputlength = 20;
+
+  std::shared_ptr<fl::Module> model =
+      buildSequentialModule(archfile, 1, nclass);
+  model->eval();
+  std::vector<int> tokens(inputlength * batchsize);
+  for (int i = 0; i < tokens.size(); i++) {
+    tokens[i] = (7 * i + 3) % nclass;
+  }
+  auto input = af::array(inputlength, batchsize, tokens.data());
+  auto output = model->forward({noGrad(input)})[0].array();
+  ASSERT_EQ(output.dims(), af::dim4(nclass, inputlength, batchsize));
+
+  // Feed one token per step, hypotheses starting from an empty history
+  using fl::lib::text::ConvLMStreamingStatePtr;
+  auto scoreFunc = fl::app::asr::buildGetConvLmIncrementalScoreFunction(model);
+  std::vector<ConvLMStreamingStatePtr> states(batchsize);
+  std::vector<ConvLMStreamingStatePtr> firstStates;
+  for (int t = 0; t < inputlength; t++) {
+    std::vector<int> lastTokens = {tokens[t], tokens[inputlength + t]};
+    std::vector<ConvLMStreamingStatePtr> newStates;
+    auto scores = scoreFunc(states, lastTokens, newStates);
+    ASSERT_EQ(scores.size(), nclass * batchsize);
+    ASSERT_EQ(newStates.size(), batchsize);
+    auto expected =
+        af::moddims(output(af::span, t, af::span), nclass, batchsize);
+    ASSERT_TRUE(
+        allClose(af::array(nclass, batchsize, scores.data()), expected, 1e-4));
+    states = newStates;
+    if (t == 0) {
+      firstStates = newStates;
+    }
+  }
+
+  // Hypotheses at different positions can be batched together
+  std::vector<ConvLMStreamingStatePtr> newStates;
+  auto scores = scoreFunc(
+      {nullptr, firstStates[1]},
+      {tokens[0], tokens[inputlength + 1]},
+      newStates);
+  auto expected = af::join(
+      1, output(af::span, 0, 0), af::moddims(output(af::span, 1, 1), nclass));
+  ASSERT_TRUE(allClose(af::array(nclass, 2, scores.data()), expected, 1e-4));
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   fl::init();
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/**
+ * Builds the binary index of a list file, which ListFileDataset memory maps
+ * instead of parsing the list file. The index file can be passed wherever
+ * the list file is expected (e.g. with --train, --valid or --test).
+ *
+ * Usage: fl_asr_build_list_index <list file> [index file]
+ * The index is written to `<list file>.idx` if no index file is given.
+ */
+
+#include <exception>
+#include <iostream>
+#include <string>
+
+#include "flashlight/app/asr/data/ListFileIndex.h"
+
+int main(int argc, char** argv) {
+  if (argc != 2 && argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " <list file> [index file]"
+              << std::endl;
+    return 1;
+  }
+  const std::string listPath = argv[1];
+  const std::string indexPath = argc == 3 ? argv[2] : listPath + ".idx";
+  try {
+    fl::app::asr::ListFileIndex index(listPath);
+    index.save(indexPath);
+    std::cout << "Wrote index of " << index.size() << " rows to " << indexPath
+              << std::endl;
+  } catch (const std::exception& ex) {
+    std::cerr << ex.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
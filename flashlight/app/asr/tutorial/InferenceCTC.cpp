@@ -240,6 +240,7 @@ int main(int argc, char** argv) {
   if (!interactive) {
     audioListStream = std::ifstream(FLAGS_audio_list);
   }
+  std::vector<float> audio;
   while (true) {
     std::string audioPath;
     if (interactive) {
@@ -261,8 +262,7 @@ int main(int argc, char** argv) {
                 << "' doesn't exist, please provide valid audio path";
       continue;
     }
-    auto audioInfo = fl::app::asr::loadSoundInfo(audioPath.c_str());
-    auto audio = fl::app::asr::loadSound<float>(audioPath.c_str());
+    auto audioInfo = fl::app::asr::loadSound<float>(audioPath, audio);
     af::array input = inputTransform(
         static_cast<void*>(audio.data()),
         af::dim4(audioInfo.channels, audioInfo.frames),
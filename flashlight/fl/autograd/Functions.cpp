@@ -7,6 +7,7 @@
 
 #include <algorithm>
 #include <array>
+#include <limits>
 #include <stdexcept>
 
 #include <af/internal.h>
@@ -15,6 +16,10 @@
 #include "flashlight/fl/autograd/Variable.h"
 #include "flashlight/fl/tensor/Compute.h"
 
+#if FL_BACKEND_CPU
+#include "flashlight/fl/autograd/backend/cpu/DnnlUtils.h"
+#endif
+
 namespace fl {
 namespace detail {
 
@@ -55,6 +60,28 @@ bool areVariableTypesEqual(const Variable& a, const Variable& b) {
   return a.type() == b.type();
 }
 
+af::array matmul(
+    const af::array& lhs,
+    const af::array& rhs,
+    af::matProp optLhs,
+    af::matProp optRhs,
+    bool constLhs /* = false */) {
+#if FL_BACKEND_CPU
+  // ArrayFire has no bf16: reduced precision products go through DNNL
+  if (lhs.type() == af::dtype::f32 && rhs.type() == af::dtype::f32 &&
+      lhs.numdims() <= 2 && rhs.numdims() <= 2 &&
+      dnnlComputeType(af::dtype::f32) != dnnl::memory::data_type::f32) {
+    return dnnlMatmul(
+        lhs,
+        rhs,
+        optLhs == AF_MAT_TRANS,
+        optRhs == AF_MAT_TRANS,
+        constLhs);
+  }
+#endif
+  return af::matmul(lhs, rhs, optLhs, optRhs);
+}
+
 } // namespace detail
 
 Variable operator+(const Variable& lhs, const Variable& rhs) {
@@ -705,7 +732,8 @@ Variable matmul(const Variable& lhs, const Variable& rhs) {
   // matmul(lhs, rhs)
   // -- matmul([M, N], [N, K]) --  [M, K]
   // result:gradOutput -- [M, K]
-  auto result = matmul(lhs.array(), rhs.array());
+  auto result = detail::matmul(
+      lhs.array(), rhs.array(), AF_MAT_NONE, AF_MAT_NONE);
   auto gradFunc = [](std::vector<Variable>& inputs,
                      const Variable& gradOutput) {
     if (inputs[0].isCalcGrad()) {
@@ -734,7 +762,8 @@ Variable matmulTN(const Variable& lhs, const Variable& rhs) {
   // -- matmulTN([N, M], [N, K])
   // -- matmul([M, N], [N, K]) -- [M, K]
   // result:gradOutput -- [M, K]
-  auto result = matmulTN(lhs.array(), rhs.array());
+  auto result = detail::matmul(
+      lhs.array(), rhs.array(), AF_MAT_TRANS, AF_MAT_NONE);
   auto gradFunc = [](std::vector<Variable>& inputs,
                      const Variable& gradOutput) {
     if (inputs[0].isCalcGrad()) {
@@ -761,7 +790,8 @@ Variable matmulNT(const Variable& lhs, const Variable& rhs) {
   // -- matmulNT([M, N], [K, N])
   // -- matmul([M, N], [N, K]) -- [M, K]
   // result:gradOutput -- [M, K]
-  auto result = matmulNT(lhs.array(), rhs.array());
+  auto result = detail::matmul(
+      lhs.array(), rhs.array(), AF_MAT_NONE, AF_MAT_TRANS);
   auto gradFunc = [](std::vector<Variable>& inputs,
                      const Variable& gradOutput) {
     if (inputs[0].isCalcGrad()) {
@@ -1073,8 +1103,15 @@ Variable linear(const Variable& in, const Variable& wt, const Variable& bs) {
   auto to4d = input.dims();
   to4d[0] = weight.array().dims(0);
 
-  auto output =
-      moddims(af::matmul(weight.array(), moddims(input.array(), to2d)), to4d);
+  // Weights without gradients (e.g. at inference) are converted only once
+  auto output = moddims(
+      detail::matmul(
+          weight.array(),
+          moddims(input.array(), to2d),
+          AF_MAT_NONE,
+          AF_MAT_NONE,
+          !weight.isCalcGrad()),
+      to4d);
 
   auto hasBias = bias.elements() > 0;
   if (hasBias) {
@@ -1252,6 +1289,292 @@ fl::Variable relativePositionEmbeddingRotate(const fl::Variable& input) {
   return fl::Variable(data, {input}, gradFunc);
 }
 
+namespace {
+
+/**
+ * matmulNT(posEmb, q) for queries of T x headDim x (nHeads * B) and relative
+ * positional embeddings of P x headDim x (nHeads * B), or of P x headDim
+ * broadcast over the batch: then a single P x headDim x (T * nHeads * B)
+ * matrix product, without tiling the embeddings.
+ */
+fl::Variable positionProjection(
+    const fl::Variable& posEmb,
+    const fl::Variable& q) {
+  if (posEmb.dims(2) > 1 || q.dims(2) == 1) {
+    return matmulNT(posEmb, q);
+  }
+  int tq = q.dims(0), headDim = q.dims(1), batch = q.dims(2);
+  auto qFlat = moddims(reorder(q, 1, 0, 2), af::dim4(headDim, tq * batch));
+  return moddims(matmul(posEmb, qFlat), af::dim4(posEmb.dims(0), tq, batch));
+}
+
+af::array positionProjection(const af::array& posEmb, const af::array& q) {
+  if (posEmb.dims(2) > 1 || q.dims(2) == 1) {
+    return af::matmulNT(posEmb, q);
+  }
+  int tq = q.dims(0), headDim = q.dims(1), batch = q.dims(2);
+  auto qFlat = af::moddims(af::reorder(q, 1, 0, 2), headDim, tq * batch);
+  return af::moddims(
+      af::matmul(posEmb, qFlat), posEmb.dims(0), tq, batch);
+}
+
+/**
+ * Operands of the blockwise attention kernel, laid out as in
+ * multiheadAttention: time x headDim x (nHeads * B).
+ */
+struct BlockwiseAttentionInputs {
+  // scaled queries and keys
+  af::array q, k;
+  // the same, with a column of ones appended to the queries and the padding
+  // mask appended to the keys: their product already includes the mask
+  af::array qAug, kAug;
+  // Tq x Tk additive mask (or empty)
+  af::array mask;
+  // projection of the queries onto the relative positional embeddings,
+  // (P + 1) * Tq x (nHeads * B) with an extra zero row per query (or empty)
+  af::array posScores;
+  int posOffset{0};
+  int posSize{0};
+};
+
+// Position in `posScores` of the positional score of each (query, key) pair
+// in the key block [k0, k1)
+af::array relativePositionIndex(
+    const BlockwiseAttentionInputs& in,
+    int k0,
+    int k1) {
+  int tq = in.q.dims(0);
+  af::dim4 dims(tq, k1 - k0);
+  auto query = af::range(dims, 0, af::dtype::s32);
+  auto rel = af::range(dims, 1, af::dtype::s32) + (in.posOffset + k0) - query;
+  // out-of-range positions read the zero row
+  auto row = af::select(rel >= 0 && rel < in.posSize, rel, in.posSize);
+  return af::flat(row + (in.posSize + 1) * query);
+}
+
+af::array attentionScoresBlock(
+    const BlockwiseAttentionInputs& in,
+    int k0,
+    int k1) {
+  int tq = in.q.dims(0);
+  int batch = in.q.dims(2);
+  auto block = af::seq(k0, k1 - 1);
+  auto scores = af::matmulNT(in.qAug, in.kAug(block, af::span, af::span));
+  if (!in.mask.isempty()) {
+    // broadcast over the batch rather than materializing a tiled copy
+    scores = af::batchFunc(scores, in.mask(af::span, block), af::operator+);
+  }
+  if (!in.posScores.isempty()) {
+    auto idx = relativePositionIndex(in, k0, k1);
+    scores += af::moddims(
+        af::lookup(in.posScores, idx, 0), af::dim4(tq, k1 - k0, batch));
+  }
+  return scores;
+}
+
+// Dropout mask of block `block`, regenerated from the per-call `seed` in the
+// backward pass. Block seeds are hashed (splitmix64) so that the blocks of
+// calls with nearby seeds don't share masks.
+af::array attentionDropoutBlock(
+    const af::dim4& dims,
+    af::dtype type,
+    unsigned long long seed,
+    int block,
+    double pDropout) {
+  unsigned long long z = seed + (block + 1) * 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  af::randomEngine engine(AF_RANDOM_ENGINE_DEFAULT, z ^ (z >> 31));
+  return (af::randu(dims, type, engine) > pDropout).as(type) /
+      (1.0 - pDropout);
+}
+
+/**
+ * multiheadAttention computed over blocks of `blockSize` keys with an online
+ * softmax: only a Tq x blockSize block of scores exists at any time, and the
+ * backward pass recomputes the blocks from the saved log-sum-exp.
+ */
+fl::Variable blockwiseMultiheadAttention(
+    const fl::Variable& query,
+    const fl::Variable& key,
+    const fl::Variable& value,
+    const fl::Variable& posEmb,
+    const fl::Variable& mask,
+    const fl::Variable& padMask,
+    const int32_t nHeads,
+    const double pDropout,
+    const int32_t offset,
+    const int32_t blockSize) {
+  int32_t bsz = query.dims(2);
+  int32_t modelDim = query.dims(1);
+  int32_t headDim = modelDim / nHeads;
+  int32_t batch = nHeads * bsz;
+  int32_t tq = query.dims(0);
+  int32_t tk = key.dims(0);
+  // accumulate in at least single precision
+  auto type =
+      query.type() == af::dtype::f64 ? af::dtype::f64 : af::dtype::f32;
+  float scale = 1.0 / std::sqrt(float(headDim));
+
+  BlockwiseAttentionInputs in;
+  in.q = af::moddims(query.array(), af::dim4(tq, headDim, batch)).as(type) *
+      scale;
+  in.k = af::moddims(key.array(), af::dim4(tk, headDim, batch)).as(type);
+  auto v = af::moddims(value.array(), af::dim4(tk, headDim, batch)).as(type);
+  in.qAug = in.q;
+  in.kAug = in.k;
+  if (!padMask.isempty()) {
+    if (padMask.dims(0) != query.dims(0) || padMask.dims(0) != tk) {
+      throw std::invalid_argument(
+          "multiheadAttention: invalid padding mask size");
+    }
+    // T x B -> T x 1 x (nHeads * B), matching the head-major batch layout
+    auto padBias =
+        af::moddims(padMask.array().as(type), af::dim4(tk, 1, 1, bsz));
+    padBias = af::moddims(
+        af::tile(padBias, 1, 1, nHeads), af::dim4(tk, 1, batch));
+    in.qAug = af::join(1, in.q, af::constant(1, tq, 1, batch, type));
+    in.kAug = af::join(1, in.k, padBias);
+  }
+  if (!mask.isempty()) {
+    in.mask = mask.array().as(type);
+  }
+  af::array posEmbArr;
+  if (!posEmb.isempty()) {
+    posEmbArr = posEmb.array().as(type);
+    in.posSize = posEmb.dims(0);
+    in.posOffset = in.posSize / 2 - offset;
+    auto proj = positionProjection(posEmbArr, in.q);
+    in.posScores = af::moddims(
+        af::join(0, proj, af::constant(0, 1, tq, batch, type)),
+        af::dim4((in.posSize + 1) * tq, batch));
+  }
+  unsigned long long seed = 0;
+  if (pDropout > 0.0) {
+    seed = af::randu(1, af::dtype::u64).scalar<unsigned long long>();
+  }
+
+  auto runMax =
+      af::constant(std::numeric_limits<float>::lowest(), tq, 1, batch, type);
+  auto runSum = af::constant(0, tq, 1, batch, type);
+  auto acc = af::constant(0, tq, headDim, batch, type);
+  for (int k0 = 0, b = 0; k0 < tk; k0 += blockSize, ++b) {
+    int k1 = std::min(k0 + blockSize, tk);
+    auto scores = attentionScoresBlock(in, k0, k1);
+    auto newMax = af::max(runMax, af::max(scores, 1));
+    auto probs = af::exp(scores - af::tile(newMax, 1, k1 - k0));
+    auto correction = af::exp(runMax - newMax);
+    runSum = runSum * correction + af::sum(probs, 1);
+    if (pDropout > 0.0) {
+      probs *= attentionDropoutBlock(probs.dims(), type, seed, b, pDropout);
+    }
+    acc = acc * af::tile(correction, 1, headDim) +
+        af::matmul(probs, v(af::seq(k0, k1 - 1), af::span, af::span));
+    runMax = newMax;
+    af::eval(runMax, runSum, acc);
+  }
+  auto out = acc / af::tile(runSum, 1, headDim);
+  auto logSumExp = runMax + af::log(runSum);
+  af::eval(out, logSumExp);
+
+  auto queryDims = query.dims();
+  auto keyDims = key.dims();
+  auto valueDims = value.dims();
+  auto gradFunc = [in,
+                   v,
+                   out,
+                   logSumExp,
+                   posEmbArr,
+                   seed,
+                   pDropout,
+                   blockSize,
+                   scale,
+                   queryDims,
+                   keyDims,
+                   valueDims,
+                   type](
+                      std::vector<fl::Variable>& inputs,
+                      const fl::Variable& gradOutput) {
+    int tq = in.q.dims(0), headDim = in.q.dims(1), batch = in.q.dims(2);
+    int tk = in.k.dims(0);
+    auto gradOut =
+        af::moddims(gradOutput.array(), af::dim4(tq, headDim, batch)).as(type);
+    // rowsum(P o dP), which for softmax equals rowsum(dOut o out)
+    auto delta = af::sum(gradOut * out, 1);
+
+    auto gradQ = af::constant(0, tq, headDim, batch, type);
+    auto gradK = af::constant(0, tk, headDim, batch, type);
+    auto gradV = af::constant(0, tk, headDim, batch, type);
+    af::array gradPosScores;
+    if (!in.posScores.isempty()) {
+      gradPosScores = af::constant(0, in.posScores.dims(), type);
+    }
+    for (int k0 = 0, b = 0; k0 < tk; k0 += blockSize, ++b) {
+      int k1 = std::min(k0 + blockSize, tk);
+      auto block = af::seq(k0, k1 - 1);
+      auto probs = af::exp(
+          attentionScoresBlock(in, k0, k1) - af::tile(logSumExp, 1, k1 - k0));
+      auto gradProbs = af::matmulNT(gradOut, v(block, af::span, af::span));
+      auto droppedProbs = probs;
+      if (pDropout > 0.0) {
+        auto keep =
+            attentionDropoutBlock(probs.dims(), type, seed, b, pDropout);
+        droppedProbs = probs * keep;
+        gradProbs *= keep;
+      }
+      gradV(block, af::span, af::span) = af::matmulTN(droppedProbs, gradOut);
+      auto gradScores = probs * (gradProbs - af::tile(delta, 1, k1 - k0));
+      gradQ += af::matmul(gradScores, in.k(block, af::span, af::span));
+      gradK(block, af::span, af::span) = af::matmulTN(gradScores, in.q);
+      if (!in.posScores.isempty()) {
+        // indices are distinct apart from those of the (discarded) zero rows
+        gradPosScores(relativePositionIndex(in, k0, k1), af::span) +=
+            af::moddims(gradScores, af::dim4(tq * (k1 - k0), batch));
+      }
+      af::eval(gradQ, gradK, gradV);
+    }
+    if (!in.posScores.isempty()) {
+      af::array gradProj =
+          af::moddims(gradPosScores, af::dim4(in.posSize + 1, tq, batch))
+              .rows(0, in.posSize - 1);
+      af::array gradPosEmb;
+      if (posEmbArr.dims(2) == 1 && batch > 1) {
+        // broadcast embeddings: the batch is folded in the matrix products
+        gradProj = af::moddims(gradProj, in.posSize, tq * batch);
+        auto gradQFlat = af::matmulTN(gradProj, posEmbArr);
+        gradQ += af::reorder(
+            af::moddims(gradQFlat, tq, batch, headDim), 0, 2, 1);
+        auto qFlat = af::moddims(
+            af::reorder(in.q, 0, 2, 1), tq * batch, headDim);
+        gradPosEmb = af::matmul(gradProj, qFlat);
+      } else {
+        gradQ += af::matmulTN(gradProj, posEmbArr);
+        gradPosEmb = af::matmul(gradProj, in.q);
+      }
+      inputs[3].addGrad(
+          fl::Variable(gradPosEmb.as(inputs[3].type()), false));
+    }
+    inputs[0].addGrad(fl::Variable(
+        af::moddims(gradQ * scale, queryDims).as(inputs[0].type()), false));
+    inputs[1].addGrad(fl::Variable(
+        af::moddims(gradK, keyDims).as(inputs[1].type()), false));
+    inputs[2].addGrad(fl::Variable(
+        af::moddims(gradV, valueDims).as(inputs[2].type()), false));
+  };
+
+  auto result = af::moddims(out, af::dim4(tq, headDim * nHeads, bsz))
+                    .as(value.type());
+  return fl::Variable(
+      result,
+      {query.withoutData(),
+       key.withoutData(),
+       value.withoutData(),
+       posEmb.withoutData()},
+      gradFunc);
+}
+
+} // namespace
+
 fl::Variable multiheadAttention(
     const fl::Variable& query,
     const fl::Variable& key,
@@ -1261,7 +1584,21 @@ fl::Variable multiheadAttention(
     const fl::Variable& padMask,
     const int32_t nHeads,
     const double pDropout,
-    const int32_t offset /* = 0 */) {
+    const int32_t offset /* = 0 */,
+    const int32_t blockSize /* = 0 */) {
+  if (blockSize > 0) {
+    return blockwiseMultiheadAttention(
+        query,
+        key,
+        value,
+        posEmb,
+        mask,
+        padMask,
+        nHeads,
+        pDropout,
+        offset,
+        blockSize);
+  }
   int32_t bsz = query.dims(2);
   int32_t modelDim = query.dims(1);
   int32_t headDim = modelDim / nHeads;
@@ -1274,8 +1611,8 @@ fl::Variable multiheadAttention(
   auto scores = matmulNT(q, k);
   if (!posEmb.isempty()) {
     int n = posEmb.dims(0) / 2 - offset;
-    auto pscores =
-        relativePositionEmbeddingRotate(matmulNT(posEmb.as(q.type()), q));
+    auto pscores = relativePositionEmbeddingRotate(
+        positionProjection(posEmb.as(q.type()), q));
     scores = scores + transpose(pscores.rows(n, n + k.dims(0) - 1));
   }
   if (!mask.isempty()) {
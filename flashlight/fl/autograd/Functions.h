@@ -40,6 +40,18 @@ bool areVariableTypesEqual(
       areVariableTypesEqual(b, args...);
 }
 
+/**
+ * Matrix product of arrays, in bf16 on the CPU backend if enabled (see
+ * OptimMode::setBf16CpuCompute). If `constLhs`, the converted `lhs` is reused
+ * by the next products with the same array.
+ */
+af::array matmul(
+    const af::array& lhs,
+    const af::array& rhs,
+    af::matProp optLhs,
+    af::matProp optRhs,
+    bool constLhs = false);
+
 /**
  * Performs type conversion based on the optim level. Operations that lack
  * sufficient precision are automatically upcast to f32 before computation.
@@ -966,7 +978,8 @@ Variable relativePositionalEmbeddingRotate(const Variable& input);
  * @param key key Variable of size Time x nHeads * headDim x B
  * @param value value Variable of size Time x nHeads * headDim x B
  * @param posEmb if non empty then compute relative
- * positional embedding in additon to standard computations
+ * positional embedding in additon to standard computations, of size
+ * P x headDim x nHeads * B, or P x headDim to share it over heads and batch
  * @param mask mask or not future in the computations T x T
  * if non-empty then don't use future (for example for autoregressive language
  * models or for decoder part in the encoder-decoder transformer models)
@@ -975,6 +988,11 @@ Variable relativePositionalEmbeddingRotate(const Variable& input);
  * @param nHeads number of heads
  * @param pDropout dropout probability
  * @param offset size of the current output from the decoder used now as input
+ * @param blockSize if positive, use a fused implementation which processes
+ * keys in blocks of this size with an online softmax, so that the full
+ * T x T attention matrix (and tiled masks) are never materialized, neither in
+ * the forward nor in the backward pass. Otherwise (default), the reference
+ * implementation is used.
  */
 Variable multiheadAttention(
     const Variable& query,
@@ -985,7 +1003,8 @@ Variable multiheadAttention(
     const Variable& padMask,
     const int32_t nHeads,
     const double pDropout,
-    const int32_t offset = 0);
+    const int32_t offset = 0,
+    const int32_t blockSize = 0);
 
 /**
  * This function computes the gradient of an indexing operator
@@ -9,17 +9,131 @@
 
 #include <af/internal.h>
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <stdexcept>
-#include <unordered_set>
 #include <utility>
 
 #include "flashlight/fl/autograd/Functions.h"
 #include "flashlight/fl/common/Utils.h"
 #include "flashlight/fl/tensor/Compute.h"
 
+namespace {
+
+std::atomic<bool> staticGraph{false};
+std::atomic<bool> inPlaceGradAccumulation{false};
+
+// Number of child gradients buffered by a Variable before they're folded into
+// its gradient; bounds the memory held by pending gradients
+constexpr size_t kMaxPendingGrads = 16;
+
+/**
+ * Open-addressing map from a graph node to its position in the topological
+ * order. Storage is kept between builds so that, once warmed up, sorting a
+ * graph of a familiar size performs no allocations.
+ */
+class NodeIndexMap {
+ public:
+  static constexpr uint32_t kPending = UINT32_MAX;
+
+  void clear() {
+    if (keys_.empty()) {
+      keys_.assign(kMinCapacity, nullptr);
+      values_.resize(kMinCapacity);
+      shift_ = 64 - kMinCapacityLog2;
+    } else if (size_ > 0) {
+      std::fill(keys_.begin(), keys_.end(), nullptr);
+    }
+    size_ = 0;
+  }
+
+  /// Inserts `key` with `value`; returns false if `key` was already present
+  bool insert(const void* key, uint32_t value) {
+    if (2 * (size_ + 1) > keys_.size()) {
+      grow();
+    }
+    size_t slot = probe(key);
+    if (keys_[slot] == key) {
+      return false;
+    }
+    keys_[slot] = key;
+    values_[slot] = value;
+    ++size_;
+    return true;
+  }
+
+  /// `key` must be present
+  uint32_t& at(const void* key) {
+    return values_[probe(key)];
+  }
+
+ private:
+  static constexpr size_t kMinCapacityLog2 = 6;
+  static constexpr size_t kMinCapacity = size_t(1) << kMinCapacityLog2;
+
+  size_t probe(const void* key) const {
+    // Fibonacci hashing; the low bits of heap pointers carry no information
+    size_t slot = static_cast<size_t>(
+        (reinterpret_cast<uintptr_t>(key) * 0x9E3779B97F4A7C15ULL) >> shift_);
+    size_t mask = keys_.size() - 1;
+    while (keys_[slot] != nullptr && keys_[slot] != key) {
+      slot = (slot + 1) & mask;
+    }
+    return slot;
+  }
+
+  void grow() {
+    std::vector<const void*> oldKeys(keys_.size() * 2, nullptr);
+    std::vector<uint32_t> oldValues(values_.size() * 2);
+    oldKeys.swap(keys_);
+    oldValues.swap(values_);
+    --shift_;
+    for (size_t i = 0; i < oldKeys.size(); ++i) {
+      if (oldKeys[i] != nullptr) {
+        size_t slot = probe(oldKeys[i]);
+        keys_[slot] = oldKeys[i];
+        values_[slot] = oldValues[i];
+      }
+    }
+  }
+
+  std::vector<const void*> keys_;
+  std::vector<uint32_t> values_;
+  size_t size_{0};
+  unsigned shift_{0};
+};
+
+/**
+ * Structure of the last graph sorted in static graph mode: for the node at
+ * each position of the topological order, the positions of its inputs.
+ */
+struct GraphOrderCache {
+  std::vector<uint32_t> inputOffsets; // size numNodes + 1
+  std::vector<uint32_t> inputPositions;
+
+  size_t numNodes() const {
+    return inputOffsets.empty() ? 0 : inputOffsets.size() - 1;
+  }
+};
+
+/// Per-thread scratch space for Variable::build()
+struct BuildWorkspace {
+  std::vector<std::pair<const fl::Variable*, size_t>> stack;
+  std::vector<const fl::Variable*> nodes;
+  NodeIndexMap index;
+  GraphOrderCache cache;
+};
+
+BuildWorkspace& getBuildWorkspace() {
+  thread_local BuildWorkspace workspace;
+  return workspace;
+}
+
+} // namespace
+
 namespace fl {
 
 Variable::Variable(af::array data, bool calcGrad) {
@@ -136,6 +250,7 @@ Variable& Variable::grad() const {
     throw std::logic_error("gradient not calculated yet for this Variable");
   }
 
+  accumulatePendingGrads();
   return *sharedGrad_->grad;
 }
 
@@ -201,6 +316,7 @@ void Variable::eval() const {
 
 void Variable::zeroGrad() {
   sharedGrad_->grad.reset();
+  sharedGrad_->pendingGrads.clear();
 }
 
 void Variable::setCalcGrad(bool calcGrad) {
@@ -209,6 +325,7 @@ void Variable::setCalcGrad(bool calcGrad) {
     sharedGrad_->gradFunc = nullptr;
     sharedGrad_->inputs.clear();
     sharedGrad_->grad.reset();
+    sharedGrad_->pendingGrads.clear();
   }
 }
 
@@ -225,7 +342,14 @@ void Variable::addGrad(const Variable& childGrad) {
             "two inputs of different types.";
       throw std::invalid_argument(ss.str());
     }
-    if (sharedGrad_->grad) {
+    if (sharedGrad_->grad && inPlaceGradAccumulation) {
+      // Defer the sum until the gradient is read (or enough have piled up)
+      auto& pending = sharedGrad_->pendingGrads;
+      pending.push_back(childGrad.array());
+      if (pending.size() >= kMaxPendingGrads) {
+        accumulatePendingGrads();
+      }
+    } else if (sharedGrad_->grad) {
       // Prevent increment of array refcount to avoid a copy
       // if getting a device pointer. See
       // https://git.io/fp9oM for more
@@ -236,8 +360,40 @@ void Variable::addGrad(const Variable& childGrad) {
       // to the underlying childGrad.array() rather than copying
       // the array into a new variable
       sharedGrad_->grad = std::make_unique<Variable>(childGrad);
+      sharedGrad_->ownsGrad = false;
+    }
+  }
+}
+
+void Variable::accumulatePendingGrads() const {
+  auto& pending = sharedGrad_->pendingGrads;
+  if (pending.empty()) {
+    return;
+  }
+  // Pairwise (tree) sum: keeps the JIT tree shallow so the whole batch can be
+  // evaluated as one kernel, with no intermediate gradient buffers
+  while (pending.size() > 1) {
+    size_t half = (pending.size() + 1) / 2;
+    for (size_t i = 0; i < pending.size() / 2; ++i) {
+      pending[i] = pending[2 * i] + pending[2 * i + 1];
+    }
+    if (pending.size() % 2 == 1) {
+      pending[half - 1] = pending.back();
     }
+    pending.resize(half);
+  }
+  // The first child gradient is shared rather than copied; detach from its
+  // Variable before writing so that the child is left untouched
+  if (!sharedGrad_->ownsGrad) {
+    sharedGrad_->grad =
+        std::make_unique<Variable>(sharedGrad_->grad->array(), false);
+    sharedGrad_->ownsGrad = true;
   }
+  // Indexed assignment writes into the existing gradient buffer; ArrayFire
+  // only copies it (once) while it is still shared with the first child
+  auto& grad = sharedGrad_->grad->array();
+  grad(af::span) += af::flat(pending[0]);
+  pending.clear();
 }
 
 void Variable::registerGradHook(const GradHook& hook) {
@@ -251,6 +407,7 @@ void Variable::clearGradHook() {
 void Variable::applyGradHook() {
   if (sharedGrad_->onGradAvailable) {
     assert(sharedGrad_->grad);
+    accumulatePendingGrads();
     sharedGrad_->onGradAvailable(*sharedGrad_->grad);
   }
 }
@@ -260,6 +417,7 @@ void Variable::calcGradInputs(bool retainGraph) {
     if (!sharedGrad_->grad) {
       throw std::logic_error("gradient was not propagated to this Variable");
     }
+    accumulatePendingGrads();
 
     sharedGrad_->gradFunc(sharedGrad_->inputs, *sharedGrad_->grad);
   }
@@ -270,14 +428,25 @@ void Variable::calcGradInputs(bool retainGraph) {
 
 void Variable::backward(const Variable& grad, bool retainGraph) {
   addGrad(grad);
-  auto dag = build();
+  // Reuse this thread's DAG storage across calls. It is swapped out for the
+  // duration of the pass so that a backward() issued from a gradient hook
+  // simply gets storage of its own.
+  thread_local DAG dagStorage;
+  DAG dag;
+  dag.swap(dagStorage);
+  build(dag);
   for (auto iter = dag.rbegin(); iter != dag.rend(); iter++) {
     iter->calcGradInputs(retainGraph);
     iter->applyGradHook();
     if (!retainGraph) {
-      *iter = Variable();
+      // Release this node's references right away without constructing a
+      // fresh Variable; the entry is never accessed again
+      iter->sharedData_.reset();
+      iter->sharedGrad_.reset();
     }
   }
+  dag.clear();
+  dag.swap(dagStorage);
 }
 
 void Variable::backward(bool retainGraph) {
@@ -378,26 +547,114 @@ Variable Variable::withoutData() const {
   return other;
 }
 
-Variable::DAG Variable::build() const {
-  std::unordered_set<SharedGrad*> cache;
-  DAG dag;
-  std::function<void(const Variable&)> recurse;
+void Variable::setStaticGraph(bool enabled) {
+  staticGraph = enabled;
+}
+
+bool Variable::isStaticGraph() {
+  return staticGraph;
+}
+
+void Variable::setInPlaceGradAccumulation(bool enabled) {
+  inPlaceGradAccumulation = enabled;
+}
+
+bool Variable::isInPlaceGradAccumulation() {
+  return inPlaceGradAccumulation;
+}
+
+void Variable::build(DAG& dag) const {
+  auto& ws = getBuildWorkspace();
+  dag.clear();
+  if (staticGraph && buildFromCache(dag)) {
+    return;
+  }
+
+  // Iterative post-order DFS; equivalent to visiting inputs recursively, in
+  // order, and appending each Variable once all of its inputs are placed
+  auto& index = ws.index;
+  auto& stack = ws.stack;
+  index.clear();
+  stack.clear();
+  index.insert(sharedGrad_.get(), NodeIndexMap::kPending);
+  stack.emplace_back(this, 0);
+  while (!stack.empty()) {
+    auto& top = stack.back();
+    const auto& inputs = top.first->getInputs();
+    if (top.second < inputs.size()) {
+      const Variable& input = inputs[top.second++];
+      if (index.insert(input.sharedGrad_.get(), NodeIndexMap::kPending)) {
+        stack.emplace_back(&input, 0);
+      }
+    } else {
+      index.at(top.first->sharedGrad_.get()) = dag.size();
+      dag.push_back(*top.first);
+      stack.pop_back();
+    }
+  }
 
-  // Topological sort
-  recurse = [&](const Variable& var) {
-    auto id = var.sharedGrad_.get();
-    if (cache.find(id) != cache.end()) {
-      return;
+  if (staticGraph) {
+    auto& cache = ws.cache;
+    cache.inputOffsets.clear();
+    cache.inputPositions.clear();
+    cache.inputOffsets.push_back(0);
+    for (const auto& var : dag) {
+      for (const auto& input : var.getInputs()) {
+        cache.inputPositions.push_back(index.at(input.sharedGrad_.get()));
+      }
+      cache.inputOffsets.push_back(cache.inputPositions.size());
     }
-    for (const auto& input : var.getInputs()) {
-      recurse(input);
+  }
+}
+
+bool Variable::buildFromCache(DAG& dag) const {
+  auto& ws = getBuildWorkspace();
+  const auto& cache = ws.cache;
+  size_t numNodes = cache.numNodes();
+  if (numNodes == 0) {
+    return false;
+  }
+
+  // Walk the cached order from the root (which comes last), assigning each
+  // input to its cached position. Any difference in arity, sharing or
+  // identity of the inputs means the structure changed.
+  auto& nodes = ws.nodes;
+  auto& seen = ws.index;
+  nodes.assign(numNodes, nullptr);
+  seen.clear();
+  nodes[numNodes - 1] = this;
+  seen.insert(sharedGrad_.get(), numNodes - 1);
+  for (size_t pos = numNodes; pos-- > 0;) {
+    const Variable* var = nodes[pos];
+    if (var == nullptr) {
+      return false;
     }
-    cache.insert(id);
-    dag.push_back(var);
-  };
+    const auto& inputs = var->getInputs();
+    uint32_t begin = cache.inputOffsets[pos];
+    if (inputs.size() != cache.inputOffsets[pos + 1] - begin) {
+      return false;
+    }
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      uint32_t inputPos = cache.inputPositions[begin + i];
+      const Variable*& slot = nodes[inputPos];
+      if (slot != nullptr) {
+        if (slot->sharedGrad_ != inputs[i].sharedGrad_) {
+          return false;
+        }
+      } else if (seen.insert(inputs[i].sharedGrad_.get(), inputPos)) {
+        slot = &inputs[i];
+      } else {
+        // a Variable shared here had distinct positions in the cached graph
+        return false;
+      }
+    }
+  }
 
-  recurse(*this);
-  return dag;
+  dag.reserve(numNodes);
+  for (const auto* var : nodes) {
+    dag.push_back(*var);
+  }
+  return true;
 }
 
 } // namespace fl
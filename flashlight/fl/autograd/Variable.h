@@ -246,6 +246,35 @@ class Variable {
    */
   void clearGradHook();
 
+  /**
+   * Enables or disables static graph mode for backward(). When enabled, the
+   * topological order of the last graph each thread ran backward() on is
+   * cached and reused, after a structural check, if the next graph has the
+   * same shape (e.g. a fixed architecture with fixed input sizes). A graph
+   * whose shape differs is sorted from scratch and replaces the cached one.
+   * Disabled by default.
+   */
+  static void setStaticGraph(bool enabled);
+
+  /**
+   * @return whether static graph mode is enabled for backward()
+   */
+  static bool isStaticGraph();
+
+  /**
+   * Enables or disables in-place gradient accumulation. When enabled, a
+   * Variable receiving several gradients (e.g. a parameter used at many time
+   * steps) buffers them and folds them into its gradient buffer in place with
+   * a single tree sum, once the gradient is read, instead of allocating a new
+   * gradient for every addition. Disabled by default.
+   */
+  static void setInPlaceGradAccumulation(bool enabled);
+
+  /**
+   * @return whether in-place gradient accumulation is enabled
+   */
+  static bool isInPlaceGradAccumulation();
+
   /**
    * Run backward pass on the Variable.  Gradient of all the inputs
    * in the computation graph leading up to the Variable on which the function
@@ -340,9 +369,16 @@ class Variable {
 
   /**
    * Builds the computation graph which comprises of all the input Variables for
-   * which the gradient of `var` can be propagated using chain rule
+   * which the gradient of `var` can be propagated using chain rule, in
+   * topological order, into `dag` (whose storage is reused)
    */
-  DAG build() const;
+  void build(DAG& dag) const;
+
+  /**
+   * Fills `dag` from the order cached in static graph mode; returns false
+   * (without a usable `dag`) if this graph's structure differs from it.
+   */
+  bool buildFromCache(DAG& dag) const;
 
   /**
    * Calculate the gradient of inputs.
@@ -356,6 +392,12 @@ class Variable {
    */
   void applyGradHook();
 
+  /**
+   * Sums gradients buffered by addGrad() (in-place accumulation mode) into
+   * the gradient
+   */
+  void accumulatePendingGrads() const;
+
   struct SharedData {
     /// Array wrapped by this Variable
     af::array data;
@@ -370,6 +412,10 @@ class Variable {
     std::vector<Variable> inputs;
     /// Gradient with respect to this Variable
     std::unique_ptr<Variable> grad{nullptr};
+    /// Child gradients not yet summed into `grad` (in-place accumulation)
+    std::vector<af::array> pendingGrads;
+    /// Whether `grad` has data of its own rather than a child gradient's
+    bool ownsGrad{false};
     /// Function for calculating the gradient of the input Variables
     GradFunc gradFunc{nullptr};
     /// Function applied to gradient after it's computed during bwd pass
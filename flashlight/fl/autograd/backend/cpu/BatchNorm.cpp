@@ -6,6 +6,7 @@
  */
 
 #include <algorithm>
+#include <cstring>
 #include <stdexcept>
 #include <utility>
 
@@ -26,6 +27,17 @@ constexpr size_t kWIdx = 1;
 constexpr size_t kChannelSizeIdx = 2;
 constexpr size_t kBatchSizeIdx = 3;
 
+// Cached primitives
+struct BatchNormForward {
+  dnnl::batch_normalization_forward::primitive_desc primDesc;
+  dnnl::batch_normalization_forward primitive;
+};
+
+struct BatchNormBackward {
+  dnnl::batch_normalization_backward::primitive_desc primDesc;
+  dnnl::batch_normalization_backward primitive;
+};
+
 } // namespace
 
 Variable batchnorm(
@@ -123,12 +135,24 @@ Variable batchnorm(
       ? dnnl::normalization_flags::none
       : dnnl::normalization_flags::use_global_stats;
   flag = flag | dnnl::normalization_flags::use_scale_shift;
-  auto fwdDesc = dnnl::batch_normalization_forward::desc(
-      kind, inputOutputMemDesc, epsilon, flag);
-  auto fwdPrimDesc =
-      std::make_shared<dnnl::batch_normalization_forward::primitive_desc>(
-          fwdDesc, dnnlEngine);
-  auto bn = dnnl::batch_normalization_forward(*fwdPrimDesc);
+  int64_t epsilonBits;
+  std::memcpy(&epsilonBits, &epsilon, sizeof(epsilon));
+  detail::DnnlPrimitiveCache::Key fwdKey = {
+      static_cast<int64_t>(detail::DnnlPrimitiveKind::BN_FWD),
+      static_cast<int64_t>(kind),
+      static_cast<int64_t>(dType),
+      static_cast<int64_t>(flag),
+      epsilonBits};
+  fwdKey.insert(fwdKey.end(), inputOutputDims.begin(), inputOutputDims.end());
+  auto fwd = detail::DnnlPrimitiveCache::getInstance().get<BatchNormForward>(
+      fwdKey, [&]() {
+        auto fwdDesc = dnnl::batch_normalization_forward::desc(
+            kind, inputOutputMemDesc, epsilon, flag);
+        auto fwdPrimDesc = dnnl::batch_normalization_forward::primitive_desc(
+            fwdDesc, dnnlEngine);
+        return std::make_shared<BatchNormForward>(BatchNormForward{
+            fwdPrimDesc, dnnl::batch_normalization_forward(fwdPrimDesc)});
+      });
   std::unordered_map<int, dnnl::memory> bnFwdArgs = {
       {DNNL_ARG_SRC, inputMemory.getMemory()},
       {DNNL_ARG_MEAN, meanMemory.getMemory()},
@@ -139,7 +163,7 @@ Variable batchnorm(
   // Execute
   std::vector<dnnl::primitive> network;
   std::vector<std::unordered_map<int, dnnl::memory>> fwdArgs = {bnFwdArgs};
-  network.push_back(bn);
+  network.push_back(fwd->primitive);
   detail::executeNetwork(network, fwdArgs);
 
   /****************************************************************************/
@@ -148,7 +172,8 @@ Variable batchnorm(
   auto gradFunc = [train,
                    epsilon,
                    nfeatures,
-                   fwdPrimDesc,
+                   fwdKey,
+                   fwd,
                    outputMemDesc = outputMemory.getDescriptor(),
                    inputOutputDims,
                    formatNCHW,
@@ -189,16 +214,21 @@ Variable batchnorm(
         grad_weightsDNNL.array(), weightsDnnlDims, format2d);
 
     // Primitives and descriptors
-    auto bwdDesc = dnnl::batch_normalization_backward::desc(
-        dnnl::prop_kind::backward,
-        gradOutputMem.getDescriptor(),
-        outputMemDesc,
-        epsilon,
-        dnnl::normalization_flags::use_scale_shift);
-    auto bwdPrimDesc = dnnl::batch_normalization_backward::primitive_desc(
-        bwdDesc, dnnlEngineBwd, *fwdPrimDesc);
-    auto bwdPrim =
-        std::make_shared<dnnl::batch_normalization_backward>(bwdPrimDesc);
+    auto bwdKey = fwdKey;
+    bwdKey[0] = static_cast<int64_t>(detail::DnnlPrimitiveKind::BN_BWD);
+    auto bwd = detail::DnnlPrimitiveCache::getInstance().get<BatchNormBackward>(
+        bwdKey, [&]() {
+          auto bwdDesc = dnnl::batch_normalization_backward::desc(
+              dnnl::prop_kind::backward,
+              gradOutputMem.getDescriptor(),
+              outputMemDesc,
+              epsilon,
+              dnnl::normalization_flags::use_scale_shift);
+          auto bwdPrimDesc = dnnl::batch_normalization_backward::primitive_desc(
+              bwdDesc, dnnlEngineBwd, fwd->primDesc);
+          return std::make_shared<BatchNormBackward>(BatchNormBackward{
+              bwdPrimDesc, dnnl::batch_normalization_backward(bwdPrimDesc)});
+        });
 
     // Execute
     std::vector<dnnl::primitive> networkBackwards;
@@ -210,7 +240,7 @@ Variable batchnorm(
          {DNNL_ARG_DIFF_SRC, gradInputMem.getMemory()},
          {DNNL_ARG_DIFF_DST, gradOutputMem.getMemory()},
          {DNNL_ARG_DIFF_SCALE_SHIFT, gradWeightsMem.getMemory()}}};
-    networkBackwards.push_back(*bwdPrim);
+    networkBackwards.push_back(bwd->primitive);
     detail::executeNetwork(networkBackwards, bwdArgs);
 
     // Update grad
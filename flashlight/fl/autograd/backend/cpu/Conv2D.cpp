@@ -34,6 +34,22 @@ constexpr size_t kIOChannelSizeIdx = 2;
 constexpr size_t kIOBatchSizeIdx = 3;
 constexpr size_t kWeightOutputChannelSizeIdx = 3;
 
+// Cached primitives, with the descriptors their memory is checked against
+struct ConvForward {
+  convolution_forward::primitive_desc primDesc;
+  convolution_forward primitive;
+};
+
+struct ConvBackwardData {
+  convolution_backward_data::primitive_desc primDesc;
+  convolution_backward_data primitive;
+};
+
+struct ConvBackwardWeights {
+  convolution_backward_weights::primitive_desc primDesc;
+  convolution_backward_weights primitive;
+};
+
 } // namespace
 
 Variable conv2d(
@@ -48,7 +64,9 @@ Variable conv2d(
     int groups,
     std::shared_ptr<detail::ConvBenchmarks> benchmarks) {
   if (input.type() == f16) {
-    throw std::runtime_error("Half precision is not supported in CPU.");
+    throw std::runtime_error(
+        "Half precision is not supported in CPU. "
+        "Use bf16 compute (OptimMode::setBf16CpuCompute) instead.");
   }
   auto dummy_bias = Variable(af::array(), false);
   return conv2d(input, weights, dummy_bias, sx, sy, px, py, dx, dy, groups);
@@ -67,7 +85,9 @@ Variable conv2d(
     int groups,
     std::shared_ptr<detail::ConvBenchmarks> benchmarks) {
   if (input.type() == f16) {
-    throw std::runtime_error("Half precision is not supported in CPU.");
+    throw std::runtime_error(
+        "Half precision is not supported in CPU. "
+        "Use bf16 compute (OptimMode::setBf16CpuCompute) instead.");
   }
   auto output = af::array(
       1 +
@@ -138,10 +158,18 @@ Variable conv2d(
   memory::dims mDilationDims = {dy - 1, dx - 1};
 
   // Create memory descriptors. using format::any gives the best performance
-  auto inputMD = memory::desc({mInputDims}, dataType, formatAny);
+  // Inputs and weights are converted to the compute type (possibly bf16);
+  // outputs, bias and gradients keep the type of the arrays
+  auto computeType = detail::dnnlComputeType(input.type());
+  auto inputMD = memory::desc({mInputDims}, computeType, formatAny);
   auto outputMD = memory::desc({mOutputDims}, dataType, formatAny);
-  auto weightMD = memory::desc({mWeightDims}, dataType, formatWeight);
+  // Weights too: the primitive may prefer a blocked layout, into which
+  // constant weights are reordered once (see DnnlWeightsCache)
+  auto weightMD = memory::desc({mWeightDims}, computeType, formatAny);
   auto biasMD = memory::desc({mBiasDims}, dataType, formatAny);
+  auto gradInputMD = memory::desc({mInputDims}, dataType, formatAny);
+  auto gradOutputMD = memory::desc({mOutputDims}, computeType, formatAny);
+  auto gradWeightMD = memory::desc({mWeightDims}, dataType, formatAny);
 
   // Choose a mode based on whether gradients are needed
   auto forwardMode =
@@ -149,45 +177,65 @@ Variable conv2d(
       ? prop_kind::forward_training
       : prop_kind::forward_inference;
 
-  // Convolution descriptor
-  std::shared_ptr<convolution_forward::desc> fwdDescriptor;
-  if (hasBias) {
-    fwdDescriptor = std::make_shared<convolution_forward::desc>(
-        forwardMode,
-        algorithm::convolution_direct,
-        inputMD,
-        weightMD,
-        biasMD,
-        outputMD,
-        mStrideDims,
-        mDilationDims,
-        mPaddingDims,
-        mPaddingDims);
-  } else {
-    fwdDescriptor = std::make_shared<convolution_forward::desc>(
-        forwardMode,
-        algorithm::convolution_direct,
-        inputMD,
-        weightMD,
-        outputMD,
-        mStrideDims,
-        mDilationDims,
-        mPaddingDims,
-        mPaddingDims);
-  }
+  // The descriptors and primitives only depend on the shapes and settings:
+  // they are created once, then taken from the cache
+  detail::DnnlPrimitiveCache::Key fwdKey = {
+      static_cast<int64_t>(detail::DnnlPrimitiveKind::CONV_FWD),
+      static_cast<int64_t>(forwardMode),
+      static_cast<int64_t>(dataType),
+      static_cast<int64_t>(computeType),
+      hasBias,
+      groups,
+      sx,
+      sy,
+      px,
+      py,
+      dx,
+      dy};
+  fwdKey.insert(fwdKey.end(), mInputDims.begin(), mInputDims.end());
+  fwdKey.insert(fwdKey.end(), mWeightDims.begin(), mWeightDims.end());
 
-  // Primitive descriptor
   auto& dnnlEngine = detail::DnnlEngine::getInstance().getEngine();
-  auto fwdPrimDesc = std::make_shared<convolution_forward::primitive_desc>(
-      *fwdDescriptor, dnnlEngine);
+  auto fwd = detail::DnnlPrimitiveCache::getInstance().get<ConvForward>(
+      fwdKey, [&]() {
+        // Convolution descriptor
+        std::shared_ptr<convolution_forward::desc> fwdDescriptor;
+        if (hasBias) {
+          fwdDescriptor = std::make_shared<convolution_forward::desc>(
+              forwardMode,
+              algorithm::convolution_direct,
+              inputMD,
+              weightMD,
+              biasMD,
+              outputMD,
+              mStrideDims,
+              mDilationDims,
+              mPaddingDims,
+              mPaddingDims);
+        } else {
+          fwdDescriptor = std::make_shared<convolution_forward::desc>(
+              forwardMode,
+              algorithm::convolution_direct,
+              inputMD,
+              weightMD,
+              outputMD,
+              mStrideDims,
+              mDilationDims,
+              mPaddingDims,
+              mPaddingDims);
+        }
+        // Primitive descriptor
+        auto fwdPrimDesc =
+            convolution_forward::primitive_desc(*fwdDescriptor, dnnlEngine);
+        return std::make_shared<ConvForward>(
+            ConvForward{fwdPrimDesc, convolution_forward(fwdPrimDesc)});
+      });
 
   // Create memory
   const detail::DnnlMemoryWrapper inputMemInit(
       input.array(), {mInputDims}, formatNCHW);
   const detail::DnnlMemoryWrapper outputMemInit(
       output, {mOutputDims}, formatNCHW);
-  const detail::DnnlMemoryWrapper weightsMem(
-      weights.array(), {mWeightDims}, formatWeight);
 
   // Network for execution
   std::vector<primitive> network;
@@ -197,31 +245,48 @@ Variable conv2d(
   // is different from NCHW/OIHW (even if specified), and reordering if
   // necessary, since the convolution itself may request a different
   // ordering
-  auto inputDesc = fwdPrimDesc->src_desc();
-  auto weightsDesc = fwdPrimDesc->weights_desc();
-  auto outputDesc = fwdPrimDesc->dst_desc();
+  auto inputDesc = fwd->primDesc.src_desc();
+  auto weightsDesc = fwd->primDesc.weights_desc();
+  auto outputDesc = fwd->primDesc.dst_desc();
   // Input
   auto inputMemory = detail::dnnlAlignOrdering(
-      network, fwdArgs, inputMemInit.getMemory(), inputDesc);
-  auto weightsMemory = detail::dnnlAlignOrdering(
-      network, fwdArgs, weightsMem.getMemory(), weightsDesc);
+      network, fwdArgs, inputMemInit.getMemory(), inputDesc, fwdKey, 0);
+  // Constant weights are reordered once and kept in that layout until they
+  // change
+  detail::DnnlMemoryWrapper weightsMem;
+  memory weightsMemory;
+  if (weights.isCalcGrad()) {
+    weightsMem = detail::DnnlMemoryWrapper(
+        weights.array(), {mWeightDims}, formatWeight);
+    weightsMemory = detail::dnnlAlignOrdering(
+        network, fwdArgs, weightsMem.getMemory(), weightsDesc, fwdKey, 1);
+  } else {
+    // The layout the primitive picked doesn't depend on the input shape in
+    // general, so the reordered weights are shared between input shapes
+    detail::DnnlWeightsCache::Key weightsKey = {
+        static_cast<int64_t>(detail::DnnlPrimitiveKind::CONV_WEIGHTS),
+        static_cast<int64_t>(dataType),
+        static_cast<int64_t>(computeType),
+        groups};
+    weightsKey.insert(weightsKey.end(), mWeightDims.begin(), mWeightDims.end());
+    detail::appendDescToKey(weightsKey, weightsDesc);
+    weightsMemory = *detail::DnnlWeightsCache::getInstance().get<memory>(
+        weights.array(), weightsKey, [&]() {
+          return std::make_shared<memory>(detail::dnnlReorder(
+              weights.array(), mWeightDims, formatWeight, weightsDesc));
+        });
+  }
   // Output - adds a reorder after the conv if needed
   auto outputMemory = outputMemInit.getMemory();
   if (outputMemInit.getMemory().get_desc() != outputDesc) {
     outputMemory = memory(outputDesc, dnnlEngine);
   }
 
-  // Create convolution
-  std::shared_ptr<convolution_forward> conv;
+  // Convolution
   auto formatBias = memory::format_tag::x;
   const detail::DnnlMemoryWrapper biasMemory(
       bias.array(), mBiasDims, formatBias);
-  if (hasBias) {
-    conv = std::make_shared<convolution_forward>(*fwdPrimDesc);
-  } else {
-    conv = std::make_shared<convolution_forward>(*fwdPrimDesc);
-  }
-  network.push_back(*conv);
+  network.push_back(fwd->primitive);
 
   // Conv fwd args
   std::unordered_map<int, dnnl::memory> convFwdArgs = {
@@ -235,7 +300,8 @@ Variable conv2d(
 
   // Add output reordering if needed
   if (outputMemory != outputMemInit.getMemory()) {
-    network.push_back(dnnl::reorder(outputMemory, outputMemInit.getMemory()));
+    network.push_back(detail::dnnlCachedReorder(
+        outputMemory, outputMemInit.getMemory(), fwdKey, 2));
     fwdArgs.push_back(
         {{DNNL_ARG_FROM, outputMemory},
          {DNNL_ARG_TO, outputMemInit.getMemory()}});
@@ -260,10 +326,13 @@ Variable conv2d(
                    mPaddingDims,
                    // Memory descriptors
                    inputMD,
-                   outputMD,
                    weightMD,
                    biasMD,
-                   fwdPrimDesc // used for creating a bw desc
+                   gradInputMD,
+                   gradOutputMD,
+                   gradWeightMD,
+                   fwdKey,
+                   fwd // used for creating a bw desc
   ](std::vector<Variable>& inputs, const Variable& grad_output) {
     auto& inputRef = inputs[0];
     auto& weightRef = inputs[1];
@@ -276,20 +345,30 @@ Variable conv2d(
       auto gradInput =
           Variable(af::array(inputRef.dims(), inputRef.type()), false);
 
-      // Backward descriptor
-      auto bwdDataDesc = std::make_shared<convolution_backward_data::desc>(
-          algorithm::convolution_direct,
-          inputMD,
-          weightMD,
-          outputMD,
-          mStrideDims,
-          mDilationDims,
-          mPaddingDims,
-          mPaddingDims);
-      // Primitive descriptor
-      auto bwdDataPrimDesc =
-          std::make_shared<convolution_backward_data::primitive_desc>(
-              *bwdDataDesc, dnnlEngineBwd, *fwdPrimDesc);
+      auto bwdDataKey = fwdKey;
+      bwdDataKey[0] =
+          static_cast<int64_t>(detail::DnnlPrimitiveKind::CONV_BWD_DATA);
+      auto bwdData =
+          detail::DnnlPrimitiveCache::getInstance().get<ConvBackwardData>(
+              bwdDataKey, [&]() {
+                // Backward descriptor
+                auto bwdDataDesc = convolution_backward_data::desc(
+                    algorithm::convolution_direct,
+                    gradInputMD,
+                    weightMD,
+                    gradOutputMD,
+                    mStrideDims,
+                    mDilationDims,
+                    mPaddingDims,
+                    mPaddingDims);
+                // Primitive descriptor
+                auto bwdDataPrimDesc =
+                    convolution_backward_data::primitive_desc(
+                        bwdDataDesc, dnnlEngineBwd, fwd->primDesc);
+                return std::make_shared<ConvBackwardData>(ConvBackwardData{
+                    bwdDataPrimDesc,
+                    convolution_backward_data(bwdDataPrimDesc)});
+              });
 
       // Create memory
       const detail::DnnlMemoryWrapper gradOutputMemInit(
@@ -303,39 +382,39 @@ Variable conv2d(
       std::vector<std::unordered_map<int, dnnl::memory>> bwdDataArgs;
 
       // Check for reorderings
-      auto gradOutputDesc = bwdDataPrimDesc->diff_dst_desc();
-      auto weightsDesc = bwdDataPrimDesc->weights_desc();
-      auto gradInputDesc = bwdDataPrimDesc->diff_src_desc();
+      auto gradOutputDesc = bwdData->primDesc.diff_dst_desc();
+      auto weightsDesc = bwdData->primDesc.weights_desc();
+      auto gradInputDesc = bwdData->primDesc.diff_src_desc();
       auto gradOutputMemory = detail::dnnlAlignOrdering(
           networkBackwards,
           bwdDataArgs,
           gradOutputMemInit.getMemory(),
-          gradOutputDesc);
+          gradOutputDesc,
+          bwdDataKey,
+          0);
       auto weightsMemoryBackwards = detail::dnnlAlignOrdering(
           networkBackwards,
           bwdDataArgs,
           weightsMemInitBwd.getMemory(),
-          weightsDesc);
+          weightsDesc,
+          bwdDataKey,
+          1);
       auto gradInputMemory = gradInputMemInit.getMemory();
       // Don't reorder the gradient until after the conv
       if (gradInputMemInit.getMemory().get_desc() != gradInputDesc) {
         gradInputMemory = memory(gradInputDesc, dnnlEngineBwd);
       }
 
-      // Convolution backwards
-      auto convBwdData =
-          std::make_shared<convolution_backward_data>(*bwdDataPrimDesc);
-
       bwdDataArgs.push_back(
           {{DNNL_ARG_DIFF_SRC, gradInputMemory},
            {DNNL_ARG_WEIGHTS, weightsMemoryBackwards},
            {DNNL_ARG_DIFF_DST, gradOutputMemory}});
-      networkBackwards.push_back(*convBwdData);
+      networkBackwards.push_back(bwdData->primitive);
 
       // Reorder the output (which is gradInput here) if necessary
       if (gradInputMemory != gradInputMemInit.getMemory()) {
-        networkBackwards.push_back(
-            dnnl::reorder(gradInputMemory, gradInputMemInit.getMemory()));
+        networkBackwards.push_back(detail::dnnlCachedReorder(
+            gradInputMemory, gradInputMemInit.getMemory(), bwdDataKey, 2));
         bwdDataArgs.push_back(
             {{DNNL_ARG_FROM, gradInputMemory},
              {DNNL_ARG_TO, gradInputMemInit.getMemory()}});
@@ -358,34 +437,48 @@ Variable conv2d(
         gradBias = Variable(af::array(biasRef.dims(), biasRef.type()), false);
       }
 
-      // Weight backward descriptor
-      std::shared_ptr<convolution_backward_weights::desc> bwdWeightDesc;
-      if (hasBias) {
-        bwdWeightDesc = std::make_shared<convolution_backward_weights::desc>(
-            algorithm::convolution_direct,
-            inputMD,
-            weightMD,
-            biasMD,
-            outputMD,
-            mStrideDims,
-            mDilationDims,
-            mPaddingDims,
-            mPaddingDims);
-      } else {
-        bwdWeightDesc = std::make_shared<convolution_backward_weights::desc>(
-            algorithm::convolution_direct,
-            inputMD,
-            weightMD,
-            outputMD,
-            mStrideDims,
-            mDilationDims,
-            mPaddingDims,
-            mPaddingDims);
-      }
-      // Weight backward primitive descriptor
-      auto bwdWeightPrimDesc =
-          std::make_shared<convolution_backward_weights::primitive_desc>(
-              *bwdWeightDesc, dnnlEngineBwd, *fwdPrimDesc);
+      auto bwdWeightsKey = fwdKey;
+      bwdWeightsKey[0] =
+          static_cast<int64_t>(detail::DnnlPrimitiveKind::CONV_BWD_WEIGHTS);
+      auto bwdWeights =
+          detail::DnnlPrimitiveCache::getInstance().get<ConvBackwardWeights>(
+              bwdWeightsKey, [&]() {
+                // Weight backward descriptor
+                std::shared_ptr<convolution_backward_weights::desc>
+                    bwdWeightDesc;
+                if (hasBias) {
+                  bwdWeightDesc =
+                      std::make_shared<convolution_backward_weights::desc>(
+                          algorithm::convolution_direct,
+                          inputMD,
+                          gradWeightMD,
+                          biasMD,
+                          gradOutputMD,
+                          mStrideDims,
+                          mDilationDims,
+                          mPaddingDims,
+                          mPaddingDims);
+                } else {
+                  bwdWeightDesc =
+                      std::make_shared<convolution_backward_weights::desc>(
+                          algorithm::convolution_direct,
+                          inputMD,
+                          gradWeightMD,
+                          gradOutputMD,
+                          mStrideDims,
+                          mDilationDims,
+                          mPaddingDims,
+                          mPaddingDims);
+                }
+                // Weight backward primitive descriptor
+                auto bwdWeightPrimDesc =
+                    convolution_backward_weights::primitive_desc(
+                        *bwdWeightDesc, dnnlEngineBwd, fwd->primDesc);
+                return std::make_shared<ConvBackwardWeights>(
+                    ConvBackwardWeights{
+                        bwdWeightPrimDesc,
+                        convolution_backward_weights(bwdWeightPrimDesc)});
+              });
 
       // Create memory
       const detail::DnnlMemoryWrapper inputRawMemInitBwd(
@@ -399,27 +492,30 @@ Variable conv2d(
       std::vector<std::unordered_map<int, dnnl::memory>> bwdWeightsArgs;
 
       // Check for reorderings, reorder if needed
-      auto inputDesc = bwdWeightPrimDesc->src_desc();
-      auto gradOutputDesc = bwdWeightPrimDesc->diff_dst_desc();
-      auto gradWeightsDesc = bwdWeightPrimDesc->diff_weights_desc();
+      auto inputDesc = bwdWeights->primDesc.src_desc();
+      auto gradOutputDesc = bwdWeights->primDesc.diff_dst_desc();
+      auto gradWeightsDesc = bwdWeights->primDesc.diff_weights_desc();
       auto inputMemoryBackwards = detail::dnnlAlignOrdering(
           networkBackwards,
           bwdWeightsArgs,
           inputRawMemInitBwd.getMemory(),
-          inputDesc);
+          inputDesc,
+          bwdWeightsKey,
+          0);
       auto gradOutputMemory = detail::dnnlAlignOrdering(
           networkBackwards,
           bwdWeightsArgs,
           gradOutputMemInit.getMemory(),
-          gradOutputDesc);
+          gradOutputDesc,
+          bwdWeightsKey,
+          1);
       // Don't reorder the grads until after the conv bwd
       auto gradWeightsMemory = gradWeightsMemInit.getMemory();
       if (gradWeightsMemInit.getMemory().get_desc() != gradWeightsDesc) {
         gradWeightsMemory = memory(gradWeightsDesc, dnnlEngineBwd);
       }
 
-      // Create the convolution backward weight
-      std::shared_ptr<convolution_backward_weights> bwdWeights;
+      // Convolution backward weight
       std::unordered_map<int, dnnl::memory> bwdConvWeightsArgs = {
           {DNNL_ARG_SRC, inputMemoryBackwards},
           {DNNL_ARG_DIFF_WEIGHTS, gradWeightsMemory},
@@ -429,20 +525,18 @@ Variable conv2d(
       const detail::DnnlMemoryWrapper gradBiasMem(
           gradBias.array(), mBiasDims, formatBias);
       if (hasBias) {
-        bwdWeights =
-            std::make_shared<convolution_backward_weights>(*bwdWeightPrimDesc);
         bwdConvWeightsArgs[DNNL_ARG_DIFF_BIAS] = gradBiasMem.getMemory();
-      } else {
-        bwdWeights =
-            std::make_shared<convolution_backward_weights>(*bwdWeightPrimDesc);
       }
-      networkBackwards.push_back(*bwdWeights);
+      networkBackwards.push_back(bwdWeights->primitive);
       bwdWeightsArgs.push_back(bwdConvWeightsArgs);
 
       // Reorder weight gradients if necessary
       if (gradWeightsMemory != gradWeightsMemInit.getMemory()) {
-        networkBackwards.push_back(
-            dnnl::reorder(gradWeightsMemory, gradWeightsMemInit.getMemory()));
+        networkBackwards.push_back(detail::dnnlCachedReorder(
+            gradWeightsMemory,
+            gradWeightsMemInit.getMemory(),
+            bwdWeightsKey,
+            2));
         bwdWeightsArgs.push_back(
             {{DNNL_ARG_FROM, gradWeightsMemory},
              {DNNL_ARG_TO, gradWeightsMemInit.getMemory()}});
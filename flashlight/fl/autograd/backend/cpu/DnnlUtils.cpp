@@ -5,15 +5,19 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <cstdint>
 #include <stdexcept>
 #include <utility>
 
+#include <af/internal.h>
+
 #if FL_BACKEND_OPENCL
 #include <dnnl_ocl.hpp>
 #endif
 
 #include "flashlight/fl/autograd/backend/cpu/DnnlUtils.h"
 #include "flashlight/fl/common/Defines.h"
+#include "flashlight/fl/common/Utils.h"
 #include "flashlight/fl/tensor/Compute.h"
 
 #if FL_BACKEND_OPENCL
@@ -59,6 +63,147 @@ DnnlEngine& DnnlEngine::getInstance() {
   return instance;
 }
 
+namespace {
+
+// Bounds on the number of cached entries. Each model needs a few per layer
+// shape, and entries are small: cached weights share the buffers of the
+// weights arrays as long as these are alive.
+constexpr size_t kPrimitiveCacheCapacity = 1024;
+constexpr size_t kWeightsCacheCapacity = 1024;
+
+// Number of arrays sharing the buffer of `arr`
+int dataRefCount(const af::array& arr) {
+  int count = 0;
+  AF_CHECK(af_get_data_ref_count(&count, arr.get()));
+  return count;
+}
+
+} // namespace
+
+size_t DnnlCacheKeyHash::operator()(const std::vector<int64_t>& key) const {
+  size_t hash = key.size();
+  for (auto k : key) {
+    hash ^= std::hash<int64_t>()(k) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+  }
+  return hash;
+}
+
+DnnlPrimitiveCache::DnnlPrimitiveCache(size_t capacity)
+    : capacity_(capacity) {}
+
+std::shared_ptr<void> DnnlPrimitiveCache::getImpl(
+    const Key& key,
+    const std::function<std::shared_ptr<void>()>& create) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+      entries_.splice(entries_.begin(), entries_, it->second);
+      return it->second->second;
+    }
+  }
+  // Create without holding the lock: this is the expensive part
+  auto value = create();
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    // Created by another thread meanwhile
+    return it->second->second;
+  }
+  entries_.emplace_front(key, value);
+  index_[key] = entries_.begin();
+  while (entries_.size() > capacity_) {
+    index_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+  return value;
+}
+
+void DnnlPrimitiveCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  index_.clear();
+  entries_.clear();
+}
+
+size_t DnnlPrimitiveCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+DnnlPrimitiveCache& DnnlPrimitiveCache::getInstance() {
+  static DnnlPrimitiveCache instance(kPrimitiveCacheCapacity);
+  return instance;
+}
+
+DnnlWeightsCache::DnnlWeightsCache(size_t capacity) : capacity_(capacity) {}
+
+std::shared_ptr<void> DnnlWeightsCache::getImpl(
+    const af::array& weights,
+    const Key& key,
+    const std::function<std::shared_ptr<void>()>& create) {
+  weights.eval();
+  if (weights.isempty() || !af::isOwner(weights)) {
+    return create();
+  }
+  auto bufferKey = key;
+  bufferKey.push_back(reinterpret_cast<intptr_t>(af::getRawPtr(weights)));
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(bufferKey);
+    if (it != index_.end()) {
+      entries_.splice(entries_.begin(), entries_, it->second);
+      return it->second->value;
+    }
+  }
+  auto value = create();
+  // Getting a device pointer while creating the value moves shared weights
+  // to a buffer of their own
+  bufferKey.back() = reinterpret_cast<intptr_t>(af::getRawPtr(weights));
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = index_.find(bufferKey);
+  if (found != index_.end()) {
+    return found->second->value;
+  }
+  // Drop the entries of weights which were updated or destroyed, i.e. whose
+  // buffer is only referenced by the entries of the cache
+  std::unordered_map<int64_t, int> numEntries;
+  for (const auto& entry : entries_) {
+    ++numEntries[entry.key.back()];
+  }
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (dataRefCount(it->weights) <= numEntries[it->key.back()]) {
+      index_.erase(it->key);
+      it = entries_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  entries_.push_front({weights, bufferKey, value});
+  index_[bufferKey] = entries_.begin();
+  while (entries_.size() > capacity_) {
+    index_.erase(entries_.back().key);
+    entries_.pop_back();
+  }
+  return value;
+}
+
+void DnnlWeightsCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  index_.clear();
+  entries_.clear();
+}
+
+size_t DnnlWeightsCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+DnnlWeightsCache& DnnlWeightsCache::getInstance() {
+  static DnnlWeightsCache instance(kWeightsCacheCapacity);
+  return instance;
+}
+
 dnnl::memory::dims convertAfToDnnlDims(const std::vector<dim_t>& afDims) {
   // DNNL uses ints in dims
   std::vector<long int> intVec(afDims.begin(), afDims.end());
@@ -119,6 +264,74 @@ dnnl::memory dnnlAlignOrdering(
   return memoryOut;
 }
 
+dnnl::memory dnnlAlignOrdering(
+    std::vector<dnnl::primitive>& net,
+    std::vector<std::unordered_map<int, dnnl::memory>>& netArgs,
+    const dnnl::memory& memory,
+    const dnnl::memory::desc& desc,
+    const DnnlPrimitiveCache::Key& key,
+    int arg) {
+  auto memoryOut = memory;
+  if (memory.get_desc() != desc) {
+    memoryOut =
+        dnnl::memory(desc, detail::DnnlEngine::getInstance().getEngine());
+    net.push_back(dnnlCachedReorder(memory, memoryOut, key, arg));
+    netArgs.push_back({{DNNL_ARG_FROM, memory}, {DNNL_ARG_TO, memoryOut}});
+  }
+  return memoryOut;
+}
+
+dnnl::primitive dnnlCachedReorder(
+    const dnnl::memory& from,
+    const dnnl::memory& to,
+    const DnnlPrimitiveCache::Key& key,
+    int arg) {
+  DnnlPrimitiveCache::Key reorderKey = {
+      static_cast<int64_t>(DnnlPrimitiveKind::REORDER), arg};
+  reorderKey.insert(reorderKey.end(), key.begin(), key.end());
+  return *DnnlPrimitiveCache::getInstance().get<dnnl::reorder>(
+      reorderKey, [&]() { return std::make_shared<dnnl::reorder>(from, to); });
+}
+
+dnnl::memory dnnlReorder(
+    const af::array& array,
+    const dnnl::memory::dims& dims,
+    dnnl::memory::format_tag format,
+    const dnnl::memory::desc& desc) {
+  const DnnlMemoryWrapper memoryIn(array, dims, format);
+  auto memoryOut =
+      dnnl::memory(desc, detail::DnnlEngine::getInstance().getEngine());
+  std::vector<dnnl::primitive> net = {
+      dnnl::reorder(memoryIn.getMemory(), memoryOut)};
+  std::vector<std::unordered_map<int, dnnl::memory>> netArgs = {
+      {{DNNL_ARG_FROM, memoryIn.getMemory()}, {DNNL_ARG_TO, memoryOut}}};
+  executeNetwork(net, netArgs);
+  return memoryOut;
+}
+
+void appendDescToKey(
+    DnnlPrimitiveCache::Key& key,
+    const dnnl::memory::desc& desc) {
+  const auto& md = desc.data;
+  key.push_back(md.ndims);
+  key.push_back(md.data_type);
+  key.push_back(md.format_kind);
+  key.insert(key.end(), md.dims, md.dims + md.ndims);
+  key.insert(key.end(), md.padded_dims, md.padded_dims + md.ndims);
+  key.insert(key.end(), md.padded_offsets, md.padded_offsets + md.ndims);
+  key.push_back(md.offset0);
+  if (md.format_kind == dnnl_blocked) {
+    const auto& blocking = md.format_desc.blocking;
+    key.insert(key.end(), blocking.strides, blocking.strides + md.ndims);
+    const int nblks = blocking.inner_nblks;
+    key.push_back(nblks);
+    key.insert(key.end(), blocking.inner_blks, blocking.inner_blks + nblks);
+    key.insert(key.end(), blocking.inner_idxs, blocking.inner_idxs + nblks);
+  }
+  key.push_back(md.extra.flags);
+  key.push_back(md.extra.compensation_mask);
+}
+
 void executeNetwork(
     std::vector<dnnl::primitive>& net,
     std::vector<std::unordered_map<int, dnnl::memory>>& netArgs) {
@@ -142,6 +355,105 @@ void executeNetwork(
   }
 }
 
+af::array dnnlMatmul(
+    const af::array& lhs,
+    const af::array& rhs,
+    bool transLhs,
+    bool transRhs,
+    bool constLhs /* = false */) {
+  if (lhs.numdims() > 2 || rhs.numdims() > 2) {
+    throw std::invalid_argument("dnnlMatmul: only 2D arrays are supported");
+  }
+  int64_t M = lhs.dims(transLhs ? 1 : 0);
+  int64_t K = lhs.dims(transLhs ? 0 : 1);
+  int64_t N = rhs.dims(transRhs ? 0 : 1);
+  if (rhs.dims(transRhs ? 1 : 0) != K) {
+    throw std::invalid_argument("dnnlMatmul: inner dimensions don't match");
+  }
+  auto output = af::array(M, N, lhs.type());
+  auto dataType = dnnlMapToType(lhs.type());
+  auto computeType = dnnlComputeType(lhs.type());
+
+  // Column-major arrays read as row-major matrices are transposed, so compute
+  // output^T [N, M] = op(rhs)^T [N, K] x op(lhs)^T [K, M]. A transposed
+  // operand is simply read with swapped strides.
+  auto ab = dnnl::memory::format_tag::ab;
+  auto ba = dnnl::memory::format_tag::ba;
+  dnnl::memory::dims lhsDims = {K, M};
+  dnnl::memory::dims rhsDims = {N, K};
+  dnnl::memory::dims outputDims = {N, M};
+  auto lhsFormat = transLhs ? ba : ab;
+  auto rhsFormat = transRhs ? ba : ab;
+  auto lhsDesc = dnnl::memory::desc(lhsDims, computeType, lhsFormat);
+  auto rhsDesc = dnnl::memory::desc(rhsDims, computeType, rhsFormat);
+  auto outputDesc = dnnl::memory::desc(outputDims, dataType, ab);
+
+  DnnlPrimitiveCache::Key key = {
+      static_cast<int64_t>(DnnlPrimitiveKind::MATMUL),
+      static_cast<int64_t>(dataType),
+      static_cast<int64_t>(computeType),
+      transLhs,
+      transRhs,
+      M,
+      K,
+      N};
+  auto matmul = DnnlPrimitiveCache::getInstance().get<dnnl::matmul>(
+      key, [&]() {
+        auto desc = dnnl::matmul::desc(rhsDesc, lhsDesc, outputDesc);
+        return std::make_shared<dnnl::matmul>(dnnl::matmul::primitive_desc(
+            desc, DnnlEngine::getInstance().getEngine()));
+      });
+
+  std::vector<dnnl::primitive> network;
+  std::vector<std::unordered_map<int, dnnl::memory>> netArgs;
+  const DnnlMemoryWrapper rhsMemInit(rhs, rhsDims, rhsFormat);
+  auto rhsMemory = dnnlAlignOrdering(
+      network, netArgs, rhsMemInit.getMemory(), rhsDesc, key, 0);
+  DnnlMemoryWrapper lhsMemInit;
+  dnnl::memory lhsMemory;
+  if (constLhs) {
+    // The converted lhs doesn't depend on the rhs
+    DnnlWeightsCache::Key weightsKey = {
+        static_cast<int64_t>(DnnlPrimitiveKind::MATMUL_WEIGHTS),
+        static_cast<int64_t>(dataType),
+        static_cast<int64_t>(computeType),
+        transLhs,
+        M,
+        K};
+    lhsMemory = *DnnlWeightsCache::getInstance().get<dnnl::memory>(
+        lhs, weightsKey, [&]() {
+          return std::make_shared<dnnl::memory>(
+              dnnlReorder(lhs, lhsDims, lhsFormat, lhsDesc));
+        });
+  } else {
+    lhsMemInit = DnnlMemoryWrapper(lhs, lhsDims, lhsFormat);
+    lhsMemory = dnnlAlignOrdering(
+        network, netArgs, lhsMemInit.getMemory(), lhsDesc, key, 1);
+  }
+  const DnnlMemoryWrapper outputMem(output, outputDims, ab);
+  network.push_back(*matmul);
+  netArgs.push_back(
+      {{DNNL_ARG_SRC, rhsMemory},
+       {DNNL_ARG_WEIGHTS, lhsMemory},
+       {DNNL_ARG_DST, outputMem.getMemory()}});
+  executeNetwork(network, netArgs);
+  return output;
+}
+
+dnnl::memory::data_type dnnlComputeType(const af::dtype t) {
+  auto type = dnnlMapToType(t);
+  if (t != af::dtype::f32 || !OptimMode::get().getBf16CpuCompute()) {
+    return type;
+  }
+  // DNNL computes in bf16 on AVX-512 CPUs, natively with AVX512-BF16 or AMX
+  static const bool bf16Supported = [] {
+    auto isa = static_cast<unsigned>(dnnl::get_effective_cpu_isa());
+    auto avx512 = static_cast<unsigned>(dnnl::cpu_isa::avx512_core);
+    return (isa & avx512) == avx512;
+  }();
+  return bf16Supported ? dnnl::memory::data_type::bf16 : type;
+}
+
 dnnl::algorithm dnnlMapToPoolingMode(const PoolingMode mode) {
   switch (mode) {
     case PoolingMode::MAX:
@@ -8,6 +8,13 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 #include <arrayfire.h>
 #include <dnnl.hpp>
@@ -56,6 +63,149 @@ class DnnlEngine {
   dnnl::engine engine_;
 };
 
+/**
+ * Kinds of the values held by DnnlPrimitiveCache and DnnlWeightsCache: the
+ * first element of every key, so that entries of different types never
+ * collide.
+ */
+enum class DnnlPrimitiveKind : int64_t {
+  REORDER,
+  CONV_FWD,
+  CONV_BWD_DATA,
+  CONV_BWD_WEIGHTS,
+  CONV_WEIGHTS,
+  POOL_FWD,
+  POOL_BWD,
+  BN_FWD,
+  BN_BWD,
+  RNN_FWD,
+  RNN_WEIGHTS,
+  RNN_PARSED_WEIGHTS,
+  MATMUL,
+  MATMUL_WEIGHTS
+};
+
+struct DnnlCacheKeyHash {
+  size_t operator()(const std::vector<int64_t>& key) const;
+};
+
+/**
+ * A thread-safe cache of DNNL primitives and primitive descriptors, keyed by
+ * the shapes and settings they were created for.
+ *
+ * Creating a primitive descriptor and its primitive (which JITs the kernel) is
+ * much more expensive than executing it on small inputs. Primitives can be
+ * executed concurrently with different arguments, so a cached primitive is
+ * shared by all the calls with the same key. The cache keeps the `capacity`
+ * most recently used entries.
+ */
+class DnnlPrimitiveCache {
+ public:
+  /// A DnnlPrimitiveKind followed by anything the cached value depends on
+  using Key = std::vector<int64_t>;
+
+  explicit DnnlPrimitiveCache(size_t capacity);
+  ~DnnlPrimitiveCache() = default;
+
+  /// Prohibit assignment
+  DnnlPrimitiveCache& operator=(DnnlPrimitiveCache const& c) = delete;
+
+  /**
+   * Returns the value cached for `key`, creating it with `create` (which
+   * returns a `std::shared_ptr<T>`) if there is none.
+   */
+  template <typename T, typename Create>
+  std::shared_ptr<T> get(const Key& key, Create&& create) {
+    return std::static_pointer_cast<T>(getImpl(
+        key, [&create]() -> std::shared_ptr<void> { return create(); }));
+  }
+
+  void clear();
+
+  size_t size() const;
+
+  static DnnlPrimitiveCache& getInstance();
+
+ private:
+  using Entry = std::pair<Key, std::shared_ptr<void>>;
+
+  size_t capacity_;
+  // Most recently used first
+  std::list<Entry> entries_;
+  std::unordered_map<Key, std::list<Entry>::iterator, DnnlCacheKeyHash> index_;
+  mutable std::mutex mutex_;
+
+  std::shared_ptr<void> getImpl(
+      const Key& key,
+      const std::function<std::shared_ptr<void>()>& create);
+
+  friend class DnnlWeightsCache;
+};
+
+/**
+ * A thread-safe cache of values computed from constant weights, such as
+ * weights reordered into the layout a primitive prefers, so that inference
+ * doesn't redo the work on every call.
+ *
+ * Values are keyed by the buffer of the weights array together with a key
+ * describing the computation. The cache keeps a reference to the weights: the
+ * buffer can't be reused by another array while cached, and ArrayFire copies
+ * shared buffers on write, so weights which are updated (even in place) get
+ * a new buffer and miss the cache. Entries whose weights are only referenced
+ * by the cache anymore are dropped.
+ *
+ * Weights which require a gradient change at every step and should not be
+ * cached.
+ */
+class DnnlWeightsCache {
+ public:
+  using Key = DnnlPrimitiveCache::Key;
+
+  explicit DnnlWeightsCache(size_t capacity);
+  ~DnnlWeightsCache() = default;
+
+  /// Prohibit assignment
+  DnnlWeightsCache& operator=(DnnlWeightsCache const& c) = delete;
+
+  /**
+   * Returns the value cached for `weights` and `key`, creating it with
+   * `create` (which returns a `std::shared_ptr<T>`) if there is none. Arrays
+   * which don't own their buffer (e.g. slices) are not cached.
+   */
+  template <typename T, typename Create>
+  std::shared_ptr<T>
+  get(const af::array& weights, const Key& key, Create&& create) {
+    return std::static_pointer_cast<T>(getImpl(
+        weights,
+        key,
+        [&create]() -> std::shared_ptr<void> { return create(); }));
+  }
+
+  void clear();
+
+  size_t size() const;
+
+  static DnnlWeightsCache& getInstance();
+
+ private:
+  struct Entry {
+    af::array weights;
+    Key key;
+    std::shared_ptr<void> value;
+  };
+
+  size_t capacity_;
+  // Most recently used first
+  std::list<Entry> entries_;
+  std::unordered_map<Key, std::list<Entry>::iterator, DnnlCacheKeyHash> index_;
+  mutable std::mutex mutex_;
+
+  std::shared_ptr<void> getImpl(
+      const af::array& weights,
+      const Key& key,
+      const std::function<std::shared_ptr<void>()>& create);
+};
+
 /**
  * Helper for converting an ArrayFire af::dim4 into an DNNL-compatible input
  * for dnnl::memory::dims.
@@ -102,6 +252,48 @@ dnnl::memory dnnlAlignOrdering(
     const dnnl::memory& memory,
     const dnnl::memory::desc& desc);
 
+/**
+ * Same as above, but the reorder primitive is taken from DnnlPrimitiveCache.
+ * `key` must determine the descriptors of `memory` and `desc` (e.g. the key
+ * of the primitive `desc` comes from), and `arg` tells the reordered
+ * arguments of that primitive apart.
+ */
+dnnl::memory dnnlAlignOrdering(
+    std::vector<dnnl::primitive>& net,
+    std::vector<std::unordered_map<int, dnnl::memory>>& netArgs,
+    const dnnl::memory& memory,
+    const dnnl::memory::desc& desc,
+    const DnnlPrimitiveCache::Key& key,
+    int arg);
+
+/**
+ * Returns a reorder primitive from `from` to `to`, taken from
+ * DnnlPrimitiveCache (see dnnlAlignOrdering).
+ */
+dnnl::primitive dnnlCachedReorder(
+    const dnnl::memory& from,
+    const dnnl::memory& to,
+    const DnnlPrimitiveCache::Key& key,
+    int arg);
+
+/**
+ * Copies an array, viewed with the given dims and format, into a new
+ * ``dnnl::memory`` with descriptor `desc`. Executes the reorder right away.
+ */
+dnnl::memory dnnlReorder(
+    const af::array& array,
+    const dnnl::memory::dims& dims,
+    dnnl::memory::format_tag format,
+    const dnnl::memory::desc& desc);
+
+/**
+ * Appends the fields of a memory descriptor (dims, data type and layout) to a
+ * cache key, e.g. to key reordered weights on the layout a primitive picked.
+ */
+void appendDescToKey(
+    DnnlPrimitiveCache::Key& key,
+    const dnnl::memory::desc& desc);
+
 /**
  * Executes a sequence of DNNL primitives in the default execution stream with
  * the default execution engine.
@@ -116,6 +308,19 @@ void executeNetwork(
     std::vector<dnnl::primitive>& net,
     std::vector<std::unordered_map<int, dnnl::memory>>& args);
 
+/**
+ * Matrix product of two 2D arrays (transposed first if `transLhs` or
+ * `transRhs`), computed by DNNL in the compute type of the arrays (see
+ * dnnlComputeType) and returned in their type. If `constLhs`, `lhs` is
+ * converted once and then taken from DnnlWeightsCache.
+ */
+af::array dnnlMatmul(
+    const af::array& lhs,
+    const af::array& rhs,
+    bool transLhs,
+    bool transRhs,
+    bool constLhs = false);
+
 /**
  * Given a flashlight pooling mode, returns the corresponding dnnl pooling
  * mode.
@@ -139,5 +344,13 @@ inline dnnl::memory::data_type dnnlMapToType(const af::dtype t) {
   }
 }
 
+/**
+ * The DNNL data type in which operators compute for arrays of type `t`: bf16
+ * for f32 arrays if enabled (see OptimMode::setBf16CpuCompute) and supported
+ * by the CPU, the type of the arrays otherwise. Results and gradients keep
+ * the type of the arrays.
+ */
+dnnl::memory::data_type dnnlComputeType(const af::dtype t);
+
 } // namespace detail
 } // namespace fl
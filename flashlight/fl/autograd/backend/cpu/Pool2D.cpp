@@ -25,6 +25,17 @@ constexpr size_t kHIdx = 1;
 constexpr size_t kChannelSizeIdx = 2;
 constexpr size_t kBatchSizeIdx = 3;
 
+// Cached primitives, with the descriptors their memory is checked against
+struct PoolForward {
+  pooling_forward::primitive_desc primDesc;
+  pooling_forward primitive;
+};
+
+struct PoolBackward {
+  pooling_backward::primitive_desc primDesc;
+  pooling_backward primitive;
+};
+
 } // namespace
 
 namespace fl {
@@ -79,51 +90,65 @@ Variable pool2d(
   auto forwardMode =
       input.isCalcGrad() ? prop_kind::forward : prop_kind::forward_inference;
 
-  // Descriptors
+  // Descriptors and primitive, created once for the given shapes and settings
   auto poolingMode = detail::dnnlMapToPoolingMode(mode);
-  auto desc = pooling_forward::desc(
-      forwardMode,
-      poolingMode,
-      inputMD,
-      outputMD,
-      strideDims,
-      windowDims,
-      paddingDims,
-      paddingDims);
-  auto primDesc = pooling_forward::primitive_desc(desc, dnnlEngine);
+  detail::DnnlPrimitiveCache::Key fwdKey = {
+      static_cast<int64_t>(detail::DnnlPrimitiveKind::POOL_FWD),
+      static_cast<int64_t>(forwardMode),
+      static_cast<int64_t>(dataType),
+      static_cast<int64_t>(poolingMode),
+      wx,
+      wy,
+      sx,
+      sy,
+      px,
+      py};
+  fwdKey.insert(fwdKey.end(), inputDims.begin(), inputDims.end());
+  auto fwd = detail::DnnlPrimitiveCache::getInstance().get<PoolForward>(
+      fwdKey, [&]() {
+        auto desc = pooling_forward::desc(
+            forwardMode,
+            poolingMode,
+            inputMD,
+            outputMD,
+            strideDims,
+            windowDims,
+            paddingDims,
+            paddingDims);
+        auto primDesc = pooling_forward::primitive_desc(desc, dnnlEngine);
+        return std::make_shared<PoolForward>(
+            PoolForward{primDesc, pooling_forward(primDesc)});
+      });
 
   // Network
   std::vector<primitive> network;
   std::vector<std::unordered_map<int, dnnl::memory>> fwdArgs;
   // Reorder if needed
-  auto inputDesc = primDesc.src_desc();
-  auto outputDesc = primDesc.dst_desc();
+  auto inputDesc = fwd->primDesc.src_desc();
+  auto outputDesc = fwd->primDesc.dst_desc();
   auto inputMemory = detail::dnnlAlignOrdering(
-      network, fwdArgs, inputMemInit.getMemory(), inputDesc);
+      network, fwdArgs, inputMemInit.getMemory(), inputDesc, fwdKey, 0);
   auto outputMemory = outputMemInit.getMemory();
   if (outputMemInit.getMemory().get_desc() != outputDesc) {
     outputMemory = memory(outputDesc, dnnlEngine);
   }
-  // Workspace and layer (only training mode requires a workspace)
+  // Workspace (only training mode requires a workspace)
   std::shared_ptr<memory> workspaceMemory; // no default ctors
-  std::shared_ptr<pooling_forward> pooling;
   std::unordered_map<int, dnnl::memory> fwdPoolingArgs;
   fwdPoolingArgs[DNNL_ARG_SRC] = inputMemory;
   fwdPoolingArgs[DNNL_ARG_DST] = outputMemory;
   if (input.isCalcGrad()) {
     workspaceMemory =
-        std::make_shared<memory>(primDesc.workspace_desc(), dnnlEngine);
-    pooling = std::make_shared<pooling_forward>(primDesc);
+        std::make_shared<memory>(fwd->primDesc.workspace_desc(), dnnlEngine);
     fwdPoolingArgs[DNNL_ARG_WORKSPACE] = *workspaceMemory;
-  } else {
-    pooling = std::make_shared<pooling_forward>(primDesc);
   }
-  network.push_back(*pooling);
+  network.push_back(fwd->primitive);
   fwdArgs.push_back(fwdPoolingArgs);
 
   // Add output reordering if needed
   if (outputMemory != outputMemInit.getMemory()) {
-    network.push_back(dnnl::reorder(outputMemory, outputMemInit.getMemory()));
+    network.push_back(detail::dnnlCachedReorder(
+        outputMemory, outputMemInit.getMemory(), fwdKey, 1));
     fwdArgs.push_back(
         {{DNNL_ARG_FROM, outputMemory},
          {DNNL_ARG_TO, outputMemInit.getMemory()}});
@@ -135,7 +160,8 @@ Variable pool2d(
       [dataType,
        formatNCHW,
        inputDimsRaw, // need to pass if inputs are empty
-       primDescFwd = std::move(primDesc), // forward desc
+       fwdKey,
+       fwd, // forward desc
        poolingMode,
        // needed for backwards pass. null in inference mode
        workspaceMemory,
@@ -164,22 +190,29 @@ Variable pool2d(
         const detail::DnnlMemoryWrapper gradOutputMemInit(
             grad_output.array(), {outputDims}, formatNCHW);
 
-        // Descriptors
-        // Memory descriptors from initialized memory must be used since
-        // pooling_backward descriptors require an ordering
-        auto gradInputMD = gradInputMemInit.getMemory().get_desc();
-        auto gradOutputMD = gradOutputMemInit.getMemory().get_desc();
-        auto bwdDesc = pooling_backward::desc(
-            poolingMode,
-            gradInputMD,
-            gradOutputMD,
-            strideDims,
-            windowDims,
-            paddingDims,
-            paddingDims);
-        // Pass forward descriptor as a hint
-        auto bwdPrimDesc = pooling_backward::primitive_desc(
-            bwdDesc, dnnlEngineBwd, primDescFwd);
+        auto bwdKey = fwdKey;
+        bwdKey[0] = static_cast<int64_t>(detail::DnnlPrimitiveKind::POOL_BWD);
+        auto bwd = detail::DnnlPrimitiveCache::getInstance().get<PoolBackward>(
+            bwdKey, [&]() {
+              // Descriptors
+              // Memory descriptors from initialized memory must be used since
+              // pooling_backward descriptors require an ordering
+              auto gradInputMD = gradInputMemInit.getMemory().get_desc();
+              auto gradOutputMD = gradOutputMemInit.getMemory().get_desc();
+              auto bwdDesc = pooling_backward::desc(
+                  poolingMode,
+                  gradInputMD,
+                  gradOutputMD,
+                  strideDims,
+                  windowDims,
+                  paddingDims,
+                  paddingDims);
+              // Pass forward descriptor as a hint
+              auto bwdPrimDesc = pooling_backward::primitive_desc(
+                  bwdDesc, dnnlEngineBwd, fwd->primDesc);
+              return std::make_shared<PoolBackward>(
+                  PoolBackward{bwdPrimDesc, pooling_backward(bwdPrimDesc)});
+            });
 
         std::vector<primitive> networkBackward;
         std::vector<std::unordered_map<int, dnnl::memory>> bwdArgs;
@@ -188,15 +221,16 @@ Variable pool2d(
             networkBackward,
             bwdArgs,
             gradOutputMemInit.getMemory(),
-            outputMemory.get_desc());
+            outputMemory.get_desc(),
+            bwdKey,
+            0);
 
-        auto poolBwd = pooling_backward(bwdPrimDesc);
         std::unordered_map<int, dnnl::memory> bwdPoolingArgs = {
             {DNNL_ARG_DIFF_SRC, gradInputMemInit.getMemory()},
             {DNNL_ARG_DIFF_DST, gradOutputMemory},
             {DNNL_ARG_WORKSPACE, *workspaceMemory}};
         bwdArgs.push_back(bwdPoolingArgs);
-        networkBackward.push_back(poolBwd);
+        networkBackward.push_back(bwd->primitive);
 
         detail::executeNetwork(networkBackward, bwdArgs);
 
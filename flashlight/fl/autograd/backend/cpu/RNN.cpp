@@ -214,6 +214,18 @@ ParsedWeightsAndBias parseWeights(
   return out;
 }
 
+// Cached RNN primitive: its type depends on the mode
+struct RnnForward {
+  dnnl::primitive primitive;
+  dnnl::memory::desc workspaceDesc;
+};
+
+// Input and hidden weights reordered for the RNN primitive
+struct RnnWeights {
+  dnnl::memory weightsInput;
+  dnnl::memory weightsHidden;
+};
+
 struct RnnResult {
   dnnl::memory workspace;
   af::array y; // output
@@ -222,9 +234,12 @@ struct RnnResult {
 };
 
 /*
- * Does forward for a single dnnl RNN primitive
+ * Does forward for a single dnnl RNN primitive. If `weightsSource` (the
+ * weights the given ones were parsed from) is nonempty, the reordered weights
+ * are cached for these.
  */
 RnnResult rnnImpl(
+    const af::array& weightsSource,
     const af::array& input,
     const af::array& hiddenState,
     const af::array& cellState,
@@ -286,119 +301,232 @@ RnnResult rnnImpl(
     hiddenInMemInit = detail::DnnlMemoryWrapper(hiddenState, {hDims}, ldnc);
   }
   const detail::DnnlMemoryWrapper hiddenOutMemInit(hy, {hDims}, ldnc);
-  const detail::DnnlMemoryWrapper weightsInputMemRawInit(
-      weightsInput, {weightsInputDims}, ldgoi);
-  const detail::DnnlMemoryWrapper weightsHiddenMemRawInit(
-      weightsHidden, {weightsHiddenDims}, ldgoi);
   const detail::DnnlMemoryWrapper biasMemInit(bias, {biasDims}, ldgo);
+  detail::DnnlMemoryWrapper cellInMemInit;
+  detail::DnnlMemoryWrapper cellOutMemInit;
+  if (mode == RnnMode::LSTM) {
+    // LSTM-only
+    // input cell state
+    // TODO(jacobkahn): function that takes the array and
+    // returns the desciptor and memory -- takes an argument for
+    // which determines whether or not it's ok to return empty
+    // descriptors if the array is empty
+    if (!cellState.isempty()) {
+      cellInMemInit = detail::DnnlMemoryWrapper(cellState, {cDims}, ldnc);
+    }
+    // output cell state
+    cellOutMemInit = detail::DnnlMemoryWrapper(cy, cDims, ldnc);
+  }
+
+  // Weights and states are converted to the compute type (possibly bf16), the
+  // bias keeps the type of the arrays
+  auto computeType = detail::dnnlComputeType(input.type());
+  auto inputMemDesc = dnnl::memory::desc(inputDims, computeType, tnc);
+  auto outputMemDesc = dnnl::memory::desc(outputDims, computeType, tnc);
+  auto hiddenInMemDesc = hiddenState.isempty()
+      ? dnnl::memory::desc()
+      : dnnl::memory::desc(hDims, computeType, ldnc);
+  auto hiddenOutMemDesc = dnnl::memory::desc(hDims, computeType, ldnc);
+  auto cellInMemDesc = cellState.isempty()
+      ? dnnl::memory::desc()
+      : dnnl::memory::desc(cDims, computeType, ldnc);
+  auto cellOutMemDesc = dnnl::memory::desc(cDims, computeType, ldnc);
 
   // TODO(jacobkahn): don't force a format tag - use any and do a reorder based
   // on the format of the primitive - what it says - like you're supposed to
-  // Primitive for reordering input weights: ldgoi --> ldigo
+  // Input and iter/hidden weights are reordered: ldgoi --> ldigo
   auto weightsInputMemDesc = dnnl::memory::desc(
-      weightsInputDims, dType, dnnl::memory::format_tag::ldigo);
-  auto weightsInputMemInit = dnnl::memory(weightsInputMemDesc, dnnlEngine);
-  // Primitive for reordering iter/hidden weights: ldgoi --> ldigo
+      weightsInputDims, computeType, dnnl::memory::format_tag::ldigo);
   auto weightsHiddenMemDesc = dnnl::memory::desc(
-      weightsHiddenDims, dType, dnnl::memory::format_tag::ldigo);
-  auto weightsHiddenMemInit = dnnl::memory(weightsHiddenMemDesc, dnnlEngine);
-
-  // Add arguments
-  std::unordered_map<int, dnnl::memory> rnnFwdArgs = {
-      {DNNL_ARG_SRC_LAYER, inputMemInit.getMemory()},
-      {DNNL_ARG_SRC_ITER, hiddenInMemInit.getMemory()},
-      {DNNL_ARG_WEIGHTS_LAYER, weightsInputMemInit},
-      {DNNL_ARG_WEIGHTS_ITER, weightsHiddenMemInit},
-      {DNNL_ARG_BIAS, biasMemInit.getMemory()},
-      {DNNL_ARG_DST_LAYER, outputMemInit.getMemory()},
-      {DNNL_ARG_DST_ITER, hiddenOutMemInit.getMemory()}};
+      weightsHiddenDims, computeType, dnnl::memory::format_tag::ldigo);
+
+  // The primitive is created once for the given shapes and settings
+  detail::DnnlPrimitiveCache::Key fwdKey = {
+      static_cast<int64_t>(detail::DnnlPrimitiveKind::RNN_FWD),
+      static_cast<int64_t>(mode),
+      static_cast<int64_t>(kind),
+      static_cast<int64_t>(activation),
+      static_cast<int64_t>(direction),
+      static_cast<int64_t>(dType),
+      static_cast<int64_t>(computeType),
+      inSize,
+      batchSize,
+      seqLength,
+      hiddenSize,
+      numLayers,
+      hiddenState.isempty(),
+      cellState.isempty()};
+  auto rnnFwd = detail::DnnlPrimitiveCache::getInstance().get<RnnForward>(
+      fwdKey, [&]() {
+        // Initialize descriptors
+        if (mode == RnnMode::RELU || mode == RnnMode::TANH) {
+          auto vanilla = dnnl::vanilla_rnn_forward::desc(
+              kind,
+              activation,
+              direction,
+              inputMemDesc,
+              hiddenInMemDesc,
+              weightsInputMemDesc, // weights "layer"
+              weightsHiddenMemDesc, // weights "iter"
+              biasMemInit.getDescriptor(),
+              outputMemDesc,
+              hiddenOutMemDesc);
+          auto vanillaPd =
+              dnnl::vanilla_rnn_forward::primitive_desc(vanilla, dnnlEngine);
+          return std::make_shared<RnnForward>(RnnForward{
+              dnnl::vanilla_rnn_forward(vanillaPd),
+              vanillaPd.workspace_desc()});
+        } else if (mode == RnnMode::LSTM) {
+          auto lstm = dnnl::lstm_forward::desc(
+              kind,
+              direction,
+              inputMemDesc,
+              hiddenInMemDesc,
+              cellInMemDesc,
+              weightsInputMemDesc, // weights "layer"
+              weightsHiddenMemDesc, // weights "iter"
+              biasMemInit.getDescriptor(),
+              outputMemDesc,
+              hiddenOutMemDesc,
+              cellOutMemDesc);
+          auto lstmPd = dnnl::lstm_forward::primitive_desc(lstm, dnnlEngine);
+          return std::make_shared<RnnForward>(RnnForward{
+              dnnl::lstm_forward(lstmPd), lstmPd.workspace_desc()});
+        } else if (mode == RnnMode::GRU) {
+          // Use a linear-before-reset GRU so we can have parity with cuDNN
+          auto gru = dnnl::lbr_gru_forward::desc(
+              kind,
+              direction,
+              inputMemDesc,
+              hiddenInMemDesc,
+              weightsInputMemDesc,
+              weightsHiddenMemDesc,
+              biasMemInit.getDescriptor(),
+              outputMemDesc,
+              hiddenOutMemDesc);
+          auto gruPd = dnnl::lbr_gru_forward::primitive_desc(gru, dnnlEngine);
+          return std::make_shared<RnnForward>(RnnForward{
+              dnnl::lbr_gru_forward(gruPd), gruPd.workspace_desc()});
+        }
+        throw std::invalid_argument("dnnl rnn: unsupported mode");
+      });
 
   // Workspace memory, if needed
-  dnnl::memory workspace;
+  dnnl::memory workspace = dnnl::memory(rnnFwd->workspaceDesc, dnnlEngine);
   std::vector<dnnl::primitive> network;
   std::vector<std::unordered_map<int, dnnl::memory>> fwdArgs;
 
-  // reorder input weights
-  network.push_back(
-      dnnl::reorder(weightsInputMemRawInit.getMemory(), weightsInputMemInit));
-  fwdArgs.push_back(
-      {{DNNL_ARG_FROM, weightsInputMemRawInit.getMemory()},
-       {DNNL_ARG_TO, weightsInputMemInit}});
-  // reorder iter weights
-  network.push_back(
-      dnnl::reorder(weightsHiddenMemRawInit.getMemory(), weightsHiddenMemInit));
-  fwdArgs.push_back(
-      {{DNNL_ARG_FROM, weightsHiddenMemRawInit.getMemory()},
-       {DNNL_ARG_TO, weightsHiddenMemInit}});
-
-  // Initialize descriptors
-  if (mode == RnnMode::RELU || mode == RnnMode::TANH) {
-    auto vanilla = dnnl::vanilla_rnn_forward::desc(
-        kind,
-        activation,
-        direction,
-        inputMemInit.getDescriptor(),
-        hiddenInMemInit.getDescriptor(),
-        weightsInputMemDesc, // weights "layer"
-        weightsHiddenMemDesc, // weights "iter"
-        biasMemInit.getDescriptor(),
-        outputMemInit.getDescriptor(),
-        hiddenOutMemInit.getDescriptor());
-    auto vanillaPd =
-        dnnl::vanilla_rnn_forward::primitive_desc(vanilla, dnnlEngine);
-    network.push_back(dnnl::vanilla_rnn_forward(vanillaPd));
-    workspace = dnnl::memory(vanillaPd.workspace_desc(), dnnlEngine);
-
-  } else if (mode == RnnMode::LSTM) {
-    // LSTM-only
-    // input cell state
-    // TODO(jacobkahn): function that takes the array and
-    // returns the desciptor and memory -- takes an argument for
-    // which determines whether or not it's ok to return empty
-    // descriptors if the array is empty
-    detail::DnnlMemoryWrapper cellInMemInit;
-    if (!cellState.isempty()) {
-      cellInMemInit = detail::DnnlMemoryWrapper(cellState, {cDims}, ldnc);
+  // Reorder the weights, or take them from the cache if they are constant
+  detail::DnnlMemoryWrapper weightsInputMemRawInit;
+  detail::DnnlMemoryWrapper weightsHiddenMemRawInit;
+  dnnl::memory weightsInputMemInit;
+  dnnl::memory weightsHiddenMemInit;
+  if (weightsSource.isempty()) {
+    weightsInputMemRawInit = detail::DnnlMemoryWrapper(
+        weightsInput, {weightsInputDims}, ldgoi);
+    weightsHiddenMemRawInit = detail::DnnlMemoryWrapper(
+        weightsHidden, {weightsHiddenDims}, ldgoi);
+    weightsInputMemInit = dnnl::memory(weightsInputMemDesc, dnnlEngine);
+    weightsHiddenMemInit = dnnl::memory(weightsHiddenMemDesc, dnnlEngine);
+    // reorder input weights
+    network.push_back(detail::dnnlCachedReorder(
+        weightsInputMemRawInit.getMemory(), weightsInputMemInit, fwdKey, 0));
+    fwdArgs.push_back(
+        {{DNNL_ARG_FROM, weightsInputMemRawInit.getMemory()},
+         {DNNL_ARG_TO, weightsInputMemInit}});
+    // reorder iter weights
+    network.push_back(detail::dnnlCachedReorder(
+        weightsHiddenMemRawInit.getMemory(), weightsHiddenMemInit, fwdKey, 1));
+    fwdArgs.push_back(
+        {{DNNL_ARG_FROM, weightsHiddenMemRawInit.getMemory()},
+         {DNNL_ARG_TO, weightsHiddenMemInit}});
+  } else {
+    // The weights layout is fixed, so the reordered weights don't depend on
+    // the batch size or sequence length
+    detail::DnnlWeightsCache::Key weightsKey = {
+        static_cast<int64_t>(detail::DnnlPrimitiveKind::RNN_WEIGHTS),
+        static_cast<int64_t>(mode),
+        static_cast<int64_t>(direction),
+        static_cast<int64_t>(computeType)};
+    weightsKey.insert(
+        weightsKey.end(), weightsInputDims.begin(), weightsInputDims.end());
+    weightsKey.insert(
+        weightsKey.end(), weightsHiddenDims.begin(), weightsHiddenDims.end());
+    auto weights = detail::DnnlWeightsCache::getInstance().get<RnnWeights>(
+        weightsSource, weightsKey, [&]() {
+          return std::make_shared<RnnWeights>(RnnWeights{
+              detail::dnnlReorder(
+                  weightsInput, weightsInputDims, ldgoi, weightsInputMemDesc),
+              detail::dnnlReorder(
+                  weightsHidden,
+                  weightsHiddenDims,
+                  ldgoi,
+                  weightsHiddenMemDesc)});
+        });
+    weightsInputMemInit = weights->weightsInput;
+    weightsHiddenMemInit = weights->weightsHidden;
+  }
+
+  // Convert the input states to the compute type if needed
+  auto srcLayer = detail::dnnlAlignOrdering(
+      network, fwdArgs, inputMemInit.getMemory(), inputMemDesc, fwdKey, 2);
+  auto srcIter = hiddenState.isempty()
+      ? hiddenInMemInit.getMemory()
+      : detail::dnnlAlignOrdering(
+            network,
+            fwdArgs,
+            hiddenInMemInit.getMemory(),
+            hiddenInMemDesc,
+            fwdKey,
+            3);
+  // Output states are computed in the compute type, then converted back
+  std::vector<std::pair<dnnl::memory, dnnl::memory>> convertedOutputs;
+  auto computedOutput = [&](const dnnl::memory& memory,
+                            const dnnl::memory::desc& desc) {
+    if (memory.get_desc() == desc) {
+      return memory;
     }
-    // output cell state
-    detail::DnnlMemoryWrapper cellOutMemInit(cy, cDims, ldnc);
+    auto computed = dnnl::memory(desc, dnnlEngine);
+    convertedOutputs.emplace_back(computed, memory);
+    return computed;
+  };
 
-    auto lstm = dnnl::lstm_forward::desc(
-        kind,
-        direction,
-        inputMemInit.getDescriptor(),
-        hiddenInMemInit.getDescriptor(),
-        cellInMemInit.getDescriptor(),
-        weightsInputMemDesc, // weights "layer"
-        weightsHiddenMemDesc, // weights "iter"
-        biasMemInit.getDescriptor(),
-        outputMemInit.getDescriptor(),
-        hiddenOutMemInit.getDescriptor(),
-        cellOutMemInit.getDescriptor());
-    auto lstmPd = dnnl::lstm_forward::primitive_desc(lstm, dnnlEngine);
-    network.push_back(dnnl::lstm_forward(lstmPd));
-    workspace = dnnl::memory(lstmPd.workspace_desc(), dnnlEngine);
-    rnnFwdArgs.insert({DNNL_ARG_SRC_ITER_C, cellInMemInit.getMemory()});
-    rnnFwdArgs.insert({DNNL_ARG_DST_ITER_C, cellOutMemInit.getMemory()});
-
-  } else if (mode == RnnMode::GRU) {
-    // Use a linear-before-reset GRU so we can have parity with cuDNN
-    auto gru = dnnl::lbr_gru_forward::desc(
-        kind,
-        direction,
-        inputMemInit.getDescriptor(),
-        hiddenInMemInit.getDescriptor(),
-        weightsInputMemDesc,
-        weightsHiddenMemDesc,
-        biasMemInit.getDescriptor(),
-        outputMemInit.getDescriptor(),
-        hiddenOutMemInit.getDescriptor());
-    auto gruPd = dnnl::lbr_gru_forward::primitive_desc(gru, dnnlEngine);
-    network.push_back(dnnl::lbr_gru_forward(gruPd));
-    workspace = dnnl::memory(gruPd.workspace_desc(), dnnlEngine);
+  // Add arguments
+  std::unordered_map<int, dnnl::memory> rnnFwdArgs = {
+      {DNNL_ARG_SRC_LAYER, srcLayer},
+      {DNNL_ARG_SRC_ITER, srcIter},
+      {DNNL_ARG_WEIGHTS_LAYER, weightsInputMemInit},
+      {DNNL_ARG_WEIGHTS_ITER, weightsHiddenMemInit},
+      {DNNL_ARG_BIAS, biasMemInit.getMemory()},
+      {DNNL_ARG_DST_LAYER,
+       computedOutput(outputMemInit.getMemory(), outputMemDesc)},
+      {DNNL_ARG_DST_ITER,
+       computedOutput(hiddenOutMemInit.getMemory(), hiddenOutMemDesc)},
+      {DNNL_ARG_WORKSPACE, workspace}};
+  if (mode == RnnMode::LSTM) {
+    auto srcIterC = cellState.isempty()
+        ? cellInMemInit.getMemory()
+        : detail::dnnlAlignOrdering(
+              network,
+              fwdArgs,
+              cellInMemInit.getMemory(),
+              cellInMemDesc,
+              fwdKey,
+              4);
+    rnnFwdArgs.insert({DNNL_ARG_SRC_ITER_C, srcIterC});
+    rnnFwdArgs.insert(
+        {DNNL_ARG_DST_ITER_C,
+         computedOutput(cellOutMemInit.getMemory(), cellOutMemDesc)});
   }
-  rnnFwdArgs.insert({DNNL_ARG_WORKSPACE, workspace});
+  network.push_back(rnnFwd->primitive);
   fwdArgs.push_back(rnnFwdArgs);
+  for (size_t i = 0; i < convertedOutputs.size(); ++i) {
+    const auto& output = convertedOutputs[i];
+    network.push_back(detail::dnnlCachedReorder(
+        output.first, output.second, fwdKey, 5 + i));
+    fwdArgs.push_back(
+        {{DNNL_ARG_FROM, output.first}, {DNNL_ARG_TO, output.second}});
+  }
 
   detail::executeNetwork(network, fwdArgs);
 
@@ -463,9 +591,30 @@ std::tuple<Variable, Variable, Variable> rnn(
   // In flashlight, all RNN weights are stored as one contiguous tensor, so we
   // have to parse out the input weights, input biases, hidden weights, and
   // hidden biases from one tensor. Order doesn't matter since the arrangement
-  // is a black box
-  auto parsedWeights = parseWeights(
-      weights, mode, numLayers, directionMult, inSize, numGates, hiddenSize);
+  // is a black box. Constant weights are parsed and reordered once, and cached
+  // until they change
+  af::array weightsSource = weightsV.isCalcGrad() ? af::array() : weights;
+  auto parse = [&]() {
+    return std::make_shared<ParsedWeightsAndBias>(parseWeights(
+        weights, mode, numLayers, directionMult, inSize, numGates, hiddenSize));
+  };
+  std::shared_ptr<ParsedWeightsAndBias> parsedWeightsPtr;
+  if (weightsSource.isempty()) {
+    parsedWeightsPtr = parse();
+  } else {
+    detail::DnnlWeightsCache::Key parsedKey = {
+        static_cast<int64_t>(detail::DnnlPrimitiveKind::RNN_PARSED_WEIGHTS),
+        static_cast<int64_t>(mode),
+        numLayers,
+        directionMult,
+        inSize,
+        numGates,
+        hiddenSize};
+    parsedWeightsPtr =
+        detail::DnnlWeightsCache::getInstance().get<ParsedWeightsAndBias>(
+            weightsSource, parsedKey, parse);
+  }
+  const auto& parsedWeights = *parsedWeightsPtr;
 
   RnnResult result;
   // The oneDNN RNN primitive has an API limitation where input size and
@@ -480,6 +629,7 @@ std::tuple<Variable, Variable, Variable> rnn(
     // Input and hidden size are the same, or we only have one layer, which
     // means we can call the impl as is and parse weights "normally"
     result = rnnImpl(
+        weightsSource,
         input,
         hiddenState,
         cellState,
@@ -500,6 +650,7 @@ std::tuple<Variable, Variable, Variable> rnn(
     // see the above.
     // Seek to the first layer's hidden/cell state, weights, and bias
     RnnResult resultL1 = rnnImpl(
+        weightsSource,
         input,
         hiddenState(af::span, af::span, 0),
         cellState(af::span, af::span, 0),
@@ -519,6 +670,7 @@ std::tuple<Variable, Variable, Variable> rnn(
     /* Layers [2..N] */
     // Seek  past the first layer's hidden/cell state, weights, and bias
     RnnResult resultL2N = rnnImpl(
+        weightsSource,
         resultL1.y, // fixme
         hiddenState(af::span, af::span, af::seq(1, af::end)),
         cellState(af::span, af::span, af::seq(1, af::end)),
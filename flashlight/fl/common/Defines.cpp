@@ -21,6 +21,14 @@ void OptimMode::setOptimLevel(OptimLevel level) {
   optimLevel_ = level;
 }
 
+bool OptimMode::getBf16CpuCompute() {
+  return bf16CpuCompute_;
+}
+
+void OptimMode::setBf16CpuCompute(bool enabled) {
+  bf16CpuCompute_ = enabled;
+}
+
 OptimMode& OptimMode::get() {
   static OptimMode optimMode;
   return optimMode;
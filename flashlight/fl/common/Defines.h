@@ -74,6 +74,9 @@ enum class DistributedInit {
 namespace DistributedConstants {
   constexpr const char* kMaxDevicePerNode = "MAX_DEVICE_PER_NODE";
   constexpr const char* kFilePath = "FILE_PATH";
+  // Gloo: seconds before the rendezvous or a collective fails
+  constexpr const char* kTimeoutSec = "TIMEOUT_SEC";
+  constexpr int kDefaultTimeoutSec = 30 * 60;
   constexpr const std::size_t kCoalesceCacheSize =
       ((size_t)(20) << 20); // 20 MB
 }
@@ -133,6 +136,24 @@ class OptimMode {
    */
   void setOptimLevel(OptimLevel level);
 
+  /**
+   * Gets whether the CPU backend computes in bf16. Not thread safe.
+   *
+   * @return true if bf16 compute is enabled.
+   */
+  bool getBf16CpuCompute();
+
+  /**
+   * Sets whether the CPU backend computes in bf16: convolutions, matrix
+   * products and RNNs convert their f32 inputs and weights to bf16, accumulate
+   * in f32 and return f32 results. Arrays stay in f32, and so do the weights
+   * updated by optimizers. Has no effect on CPUs without AVX-512 and on other
+   * backends. Not thread safe.
+   *
+   * @param[in] enabled whether to compute in bf16
+   */
+  void setBf16CpuCompute(bool enabled);
+
   /**
    *
    */
@@ -142,6 +163,7 @@ class OptimMode {
 
  private:
   OptimLevel optimLevel_{OptimLevel::DEFAULT};
+  bool bf16CpuCompute_{false};
 };
 
 /** @} */
@@ -6,6 +6,7 @@
  */
 
 #include <stdexcept>
+#include <string>
 
 #include "flashlight/fl/contrib/modules/AsymmetricConv1D.h"
 
@@ -101,6 +102,57 @@ Variable AsymmetricConv1D::forward(const Variable& input) {
   return output;
 }
 
+int AsymmetricConv1D::historySize() const {
+  return (xFilter_ - 1) * xDilation_;
+}
+
+Variable AsymmetricConv1D::forwardFrame(const Variable& input) {
+  if (futurePart_ != 0 || xStride_ != 1) {
+    throw std::invalid_argument(
+        "AsymmetricConv1D: frame forward requires a causal convolution "
+        "(futurePart = 0) with stride 1");
+  }
+  // forward() pads only the past by historySize() frames iff the padding is
+  // SAME over an even number of frames
+  int px =
+      fl::derivePadding(historySize() + 1, xFilter_, 1, xPad_, xDilation_);
+  if (xPad_ != static_cast<int>(PaddingMode::SAME) ||
+      2 * px != historySize()) {
+    throw std::invalid_argument(
+        "AsymmetricConv1D: frame forward requires 'SAME' padding with an even "
+        "(wx - 1) * dx");
+  }
+  if (input.dims(0) != historySize() + 1) {
+    throw std::invalid_argument(
+        "AsymmetricConv1D: frame forward expects " +
+        std::to_string(historySize() + 1) + " input frames");
+  }
+  if (bias_) {
+    return conv2d(
+        input,
+        params_[0],
+        params_[1],
+        xStride_,
+        yStride_,
+        0,
+        0,
+        xDilation_,
+        yDilation_,
+        groups_);
+  } else {
+    return conv2d(
+        input,
+        params_[0],
+        xStride_,
+        yStride_,
+        0,
+        0,
+        xDilation_,
+        yDilation_,
+        groups_);
+  }
+}
+
 std::string AsymmetricConv1D::prettyString() const {
   std::ostringstream ss;
   ss << "AsymmetricConv1D";
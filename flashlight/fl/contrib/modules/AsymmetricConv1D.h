@@ -52,6 +52,22 @@ class AsymmetricConv1D : public fl::Conv2D {
 
   fl::Variable forward(const fl::Variable& input) override;
 
+  /**
+   * Number of past input frames a causal (`futurePart = 0`) convolution uses
+   * along with the current one, i.e. `(wx - 1) * dx`.
+   */
+  int historySize() const;
+
+  /**
+   * Streaming forward for a causal (`futurePart = 0`) convolution with unit
+   * stride and `SAME` padding over an even `(wx - 1) * dx`: computes only the
+   * output frame of the last input frame.
+   * @param input of size `historySize() + 1` along the first dimension: the
+   * previous input frames followed by the current one. Frames before the
+   * sequence start must be zeros, as the padding in `forward` is.
+   */
+  fl::Variable forwardFrame(const fl::Variable& input);
+
   std::string prettyString() const override;
 
  private:
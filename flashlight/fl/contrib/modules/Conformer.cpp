@@ -117,7 +117,6 @@ Variable Conformer::conformerInitLinear(int32_t inDim, int32_t outDim) {
 
 Variable Conformer::mhsa(const Variable& input, const Variable& inputPadMask) {
   float pDropout = train_ ? pDropout_ : 0.0;
-  int bsz = input.dims(2);
 
   auto normedInput = (*normMhsa_)(input);
   auto q = transpose((*wq_)(normedInput));
@@ -126,7 +125,8 @@ Variable Conformer::mhsa(const Variable& input, const Variable& inputPadMask) {
 
   Variable mask, posEmb;
   if (posEmbContextSize_ > 0) {
-    posEmb = tile(params_[0].as(input.type()), af::dim4(1, 1, nHeads_ * bsz));
+    // broadcast over the heads and batch by multiheadAttention
+    posEmb = params_[0].as(input.type());
   }
   fl::Variable padMask;
   if (!inputPadMask.isempty()) {
@@ -134,8 +134,17 @@ Variable Conformer::mhsa(const Variable& input, const Variable& inputPadMask) {
     padMaskArr = af::resize(padMaskArr, input.dims(1), input.dims(2));
     padMask = fl::Variable(af::log(padMaskArr), false);
   }
-  auto result =
-      multiheadAttention(q, k, v, posEmb, mask, padMask, nHeads_, pDropout, 0);
+  auto result = multiheadAttention(
+      q,
+      k,
+      v,
+      posEmb,
+      mask,
+      padMask,
+      nHeads_,
+      pDropout,
+      0,
+      attentionBlockSize_);
   result = (*wf_)(transpose(result));
   result = dropout(result, pDropout);
   return result;
@@ -193,6 +202,10 @@ std::vector<Variable> Conformer::forward(const std::vector<Variable>& input) {
   return {x};
 }
 
+void Conformer::setAttentionBlockSize(int32_t blockSize) {
+  attentionBlockSize_ = blockSize;
+}
+
 std::string Conformer::prettyString() const {
   std::ostringstream ss;
   ss << "Conformer "
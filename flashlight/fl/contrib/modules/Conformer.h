@@ -46,6 +46,14 @@ class Conformer : public Container {
       float pLayerDropout = 0.);
 
   std::vector<Variable> forward(const std::vector<Variable>& input) override;
+  /**
+   * Use the fused blockwise attention of multiheadAttention, processing keys
+   * in blocks of `blockSize` (0, the default, uses the reference one).
+   */
+  void setAttentionBlockSize(int32_t blockSize);
+  int32_t attentionBlockSize() const {
+    return attentionBlockSize_;
+  }
   std::string prettyString() const override;
 
  private:
@@ -54,6 +62,7 @@ class Conformer : public Container {
   int32_t convKernelSize_;
   double pDropout_;
   float pLayerDropout_;
+  int32_t attentionBlockSize_{0};
 
   std::shared_ptr<Linear> w11_, w12_, w21_, w22_, wq_, wk_, wv_, wf_, conv1_, conv2_;
   std::shared_ptr<LayerNorm> norm1_, norm2_, normMhsa_, normConv1_, normConv2_,
@@ -89,9 +98,11 @@ class Conformer : public Container {
       pDropout_,
       pLayerDropout_,
       posEmbContextSize_,
-      convKernelSize_)
+      convKernelSize_,
+      fl::versioned(attentionBlockSize_, 1))
 };
 
 } // namespace fl
 
 CEREAL_REGISTER_TYPE(fl::Conformer);
+CEREAL_CLASS_VERSION(fl::Conformer, 1);
@@ -70,6 +70,18 @@ class Residual : public Container {
 
   std::unordered_set<int> getProjectionsIndices() const;
 
+  /**
+   * Returns the shortcut connections as a map from the destination layer
+   * index to a map from the source layer index to the index of the
+   * projection module (-1 if none) in `modules()`.
+   */
+  std::unordered_map<int, std::unordered_map<int, int>> getShortcuts() const;
+
+  /**
+   * Returns the scales applied before layers, keyed by layer index.
+   */
+  std::unordered_map<int, float> getScales() const;
+
   /**
    * Adds a scaling factor to all residual connections connecting to a layer
    * given by some index index. Given some scale \f$ \alpha \f$, the input to
@@ -68,31 +68,105 @@ Variable Transformer::mlp(const Variable& input) {
 }
 
 Variable Transformer::getMask(int32_t n, bool cache) {
-  auto mask = af::lower(af::constant(1.0, n, n), true);
+  // the masks of all the lengths are top left corners of the largest one
+  auto fullMask = std::atomic_load(&mask_);
+  if (!fullMask || fullMask->dims(0) < n) {
+    fullMask = std::make_shared<const af::array>(
+        af::log(af::lower(af::constant(1.0, n, n), true)));
+    std::atomic_store(&mask_, fullMask);
+  }
+  af::array mask = *fullMask;
+  if (fullMask->dims(0) > n) {
+    mask = (*fullMask)(af::seq(n), af::seq(n));
+  }
   if (cache) {
-    auto maskCache = af::upper(af::constant(1.0, n, n));
-    mask = af::join(1, maskCache, mask);
+    mask = af::join(1, mask.T(), mask);
+  }
+  return Variable(mask, false);
+}
+
+bool Transformer::FusedWeight::matches(
+    const std::vector<Variable>& weights,
+    af::dtype type) const {
+  if (weight.type() != type || sources.size() != weights.size()) {
+    return false;
+  }
+  // optimizers and setParams() replace the arrays of the weights
+  for (int i = 0; i < weights.size(); ++i) {
+    if (sources[i].get() != weights[i].array().get()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::vector<Variable> Transformer::project(
+    const Variable& input,
+    const std::vector<std::shared_ptr<Linear>>& layers,
+    std::shared_ptr<const FusedWeight>& cache) {
+  std::vector<Variable> weights;
+  bool calcGrad = false;
+  for (const auto& layer : layers) {
+    weights.push_back(layer->param(0));
+    calcGrad = calcGrad || weights.back().isCalcGrad();
   }
-  return Variable(af::log(mask), false);
+  auto fuse = [&]() {
+    std::vector<Variable> typedWeights;
+    for (const auto& weight : weights) {
+      typedWeights.push_back(weight.as(input.type()));
+    }
+    return concatenate(typedWeights, 0);
+  };
+
+  Variable fused;
+  if (calcGrad) {
+    fused = fuse();
+  } else {
+    // forward() may run on several threads: the cache is replaced atomically
+    auto fusedWeight = std::atomic_load(&cache);
+    if (!fusedWeight || !fusedWeight->matches(weights, input.type())) {
+      auto newWeight = std::make_shared<FusedWeight>();
+      for (const auto& weight : weights) {
+        newWeight->sources.push_back(weight.array());
+      }
+      newWeight->weight = fuse();
+      fusedWeight = newWeight;
+      std::atomic_store(&cache, fusedWeight);
+    }
+    fused = fusedWeight->weight;
+  }
+
+  auto projection = transpose(linear(input, fused));
+  std::vector<Variable> result;
+  for (int i = 0, start = 0; i < weights.size(); ++i) {
+    int end = start + weights[i].dims(0);
+    result.push_back(projection.cols(start, end - 1));
+    start = end;
+  }
+  return result;
 }
 
 Variable Transformer::selfAttention(const std::vector<Variable>& input) {
   // previous step[optionally], input, padMask
   auto encoderInput = input.at(input.size() - 2);
   // in case of previous state input[0] has size CxT_prevxB
-  int n = input[0].dims(1), bsz = input[0].dims(2);
-  double pDrop = train_ ? pDropout_ : 0.0;
+  int n = input[0].dims(1);
 
-  auto q = transpose((*wq_)(encoderInput));
-  std::vector<fl::Variable> inputWithState(input.begin(), input.end() - 1);
-  auto k = transpose((*wk_)(concatenate(inputWithState, 1)));
-  auto v = transpose((*wv_)(concatenate(inputWithState, 1)));
-
-  Variable mask, posEmb;
-  if (bptt_ > 0) {
-    posEmb =
-        tile(params_[0].as(encoderInput.type()), af::dim4(1, 1, nHeads_ * bsz));
+  Variable q, k, v;
+  if (input.size() == 2) {
+    auto qkv = project(encoderInput, {wq_, wk_, wv_}, qkvWeight_);
+    q = qkv[0];
+    k = qkv[1];
+    v = qkv[2];
+  } else {
+    q = transpose((*wq_)(encoderInput));
+    std::vector<fl::Variable> inputWithState(input.begin(), input.end() - 1);
+    auto kv = project(concatenate(inputWithState, 1), {wk_, wv_}, kvWeight_);
+    k = kv[0];
+    v = kv[1];
   }
+
+  Variable mask;
   if (useMask_ && encoderInput.dims(1) > 1) {
     // mask future if we use the previous state (then n is previous time)
     mask = getMask(n, input.size() == 3);
@@ -108,8 +182,34 @@ Variable Transformer::selfAttention(const std::vector<Variable>& input) {
         af::resize(padMaskArr, encoderInput.dims(1), encoderInput.dims(2));
     padMask = fl::Variable(af::log(padMaskArr), false);
   }
+  return attention(q, k, v, mask, padMask, offset);
+}
+
+Variable Transformer::attention(
+    const Variable& q,
+    const Variable& k,
+    const Variable& v,
+    const Variable& mask,
+    const Variable& padMask,
+    int32_t offset) {
+  double pDrop = train_ ? pDropout_ : 0.0;
+
+  // broadcast over the heads and batch by multiheadAttention
+  Variable posEmb;
+  if (bptt_ > 0) {
+    posEmb = params_[0].as(q.type());
+  }
   auto result = multiheadAttention(
-      q, k, v, posEmb, mask, padMask, nHeads_, pDrop, offset);
+      q,
+      k,
+      v,
+      posEmb,
+      mask,
+      padMask,
+      nHeads_,
+      pDrop,
+      offset,
+      attentionBlockSize_);
   result = (*wf_)(transpose(result));
 
   return result;
@@ -134,12 +234,45 @@ std::vector<Variable> Transformer::forward(const std::vector<Variable>& input) {
   if (train_ && (af::randu(1).scalar<float>() < pLayerdrop_)) {
     f = 0.0;
   }
+  return {block(x, selfAttention(input), f)};
+}
+
+std::pair<Variable, TransformerState> Transformer::forwardIncremental(
+    const Variable& input,
+    const TransformerState& state) {
+  int n = state.keys.isempty() ? 0 : state.keys.dims(0);
+  int t = input.dims(1);
+
+  // only the new positions are projected
+  TransformerState outState;
+  auto qkv = project(input, {wq_, wk_, wv_}, qkvWeight_);
+  outState.keys = n > 0 ? concatenate({state.keys, qkv[1]}, 0) : qkv[1];
+  outState.values = n > 0 ? concatenate({state.values, qkv[2]}, 0) : qkv[2];
+
+  Variable mask;
+  if (useMask_ && t > 1) {
+    // new positions see all the previous ones, and not their own future
+    auto maskArr = af::lower(af::constant(1.0, t, t), true);
+    if (n > 0) {
+      maskArr = af::join(1, af::constant(1.0, t, n), maskArr);
+    }
+    mask = Variable(af::log(maskArr), false);
+  }
+  auto h = attention(
+      qkv[0], outState.keys, outState.values, mask, Variable(), n);
+  return {block(input, h, 1.0), outState};
+}
+
+Variable Transformer::block(
+    const Variable& x,
+    const Variable& attention,
+    float f) {
   if (preLN_) {
-    auto h = (f * (*norm1_)(selfAttention(input))).as(x.type()) + x;
-    return {f * (*norm2_)(mlp(h)).as(h.type()) + h};
+    auto h = (f * (*norm1_)(attention)).as(x.type()) + x;
+    return f * (*norm2_)(mlp(h)).as(h.type()) + h;
   } else {
-    auto h = (*norm1_)((f * selfAttention(input)).as(x.type()) + x);
-    return {(*norm2_)((f * mlp(h)).as(h.type()) + h)};
+    auto h = (*norm1_)((f * attention).as(x.type()) + x);
+    return (*norm2_)((f * mlp(h)).as(h.type()) + h);
   }
 }
 
@@ -151,6 +284,10 @@ void Transformer::setLayerDropout(float value) {
   pLayerdrop_ = value;
 }
 
+void Transformer::setAttentionBlockSize(int32_t blockSize) {
+  attentionBlockSize_ = blockSize;
+}
+
 std::string Transformer::prettyString() const {
   std::ostringstream ss;
   ss << "Transformer (nHeads: " << nHeads_ << "), "
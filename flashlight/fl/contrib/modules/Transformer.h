@@ -7,6 +7,9 @@
 
 #pragma once
 
+#include <memory>
+#include <vector>
+
 #include "flashlight/fl/nn/modules/Container.h"
 #include "flashlight/fl/nn/modules/LayerNorm.h"
 #include "flashlight/fl/nn/modules/Linear.h"
@@ -14,6 +17,16 @@
 
 namespace fl {
 
+/**
+ * Keys and values of the positions already forwarded by a Transformer in
+ * incremental decoding (see Transformer::forwardIncremental()), each of size
+ * T x (nHeads * headDim) x B. Empty before the first step.
+ */
+struct TransformerState {
+  Variable keys;
+  Variable values;
+};
+
 /**
  * A module which implements a Transformer.
  *
@@ -59,8 +72,32 @@ class Transformer : public Container {
       bool preLN = false);
 
   std::vector<Variable> forward(const std::vector<Variable>& input) override;
+
+  /**
+   * Incremental decoding: forward the new positions `input` (C x T x B),
+   * which attend to the positions of `state` and (masked as in `forward()`)
+   * to each other. The keys and values of the previous positions are taken
+   * from `state` instead of being projected again, so that decoding U
+   * positions one by one projects each position once. Returns the output
+   * (C x T x B) and `state` extended with the keys and values of `input`.
+   *
+   * Same as `forward({previous inputs, input, empty padMask})`, without layer
+   * drop.
+   */
+  std::pair<Variable, TransformerState> forwardIncremental(
+      const Variable& input,
+      const TransformerState& state);
+
   void setDropout(float value);
   void setLayerDropout(float value);
+  /**
+   * Use the fused blockwise attention of multiheadAttention, processing keys
+   * in blocks of `blockSize` (0, the default, uses the reference one).
+   */
+  void setAttentionBlockSize(int32_t blockSize);
+  int32_t attentionBlockSize() const {
+    return attentionBlockSize_;
+  }
   std::string prettyString() const override;
 
  private:
@@ -70,12 +107,43 @@ class Transformer : public Container {
   double pLayerdrop_;
   bool useMask_;
   bool preLN_;
+  int32_t attentionBlockSize_{0};
+  // not serialized: log causal mask of the largest length seen by forward().
+  // Read and replaced atomically, since forward() may run on several threads
+  std::shared_ptr<const af::array> mask_;
+  // not serialized: the weights of wq/wk/wv concatenated by project(), kept
+  // while they don't need gradients (e.g. in eval mode) and are unchanged
+  struct FusedWeight {
+    // the weights it was built from
+    std::vector<af::array> sources;
+    Variable weight;
+
+    bool matches(const std::vector<Variable>& weights, af::dtype type) const;
+  };
+  std::shared_ptr<const FusedWeight> qkvWeight_, kvWeight_;
   std::shared_ptr<Linear> w1_, w2_, wq_, wk_, wv_, wf_;
   std::shared_ptr<LayerNorm> norm1_, norm2_;
 
   Variable mlp(const Variable& input);
   Variable getMask(int32_t n, bool cache = false);
+  // projections of `input` by `layers` (without bias) with a single matrix
+  // product, each transposed to T x outDim x B. The concatenated weights are
+  // kept in `cache` when they don't need gradients
+  std::vector<Variable> project(
+      const Variable& input,
+      const std::vector<std::shared_ptr<Linear>>& layers,
+      std::shared_ptr<const FusedWeight>& cache);
   Variable selfAttention(const std::vector<Variable>& input);
+  // attention of the projected queries to the projected keys and values
+  Variable attention(
+      const Variable& q,
+      const Variable& k,
+      const Variable& v,
+      const Variable& mask,
+      const Variable& padMask,
+      int32_t offset);
+  // residual connections, layer norms and MLP around the attention
+  Variable block(const Variable& x, const Variable& attention, float f);
 
   FL_SAVE_LOAD_WITH_BASE(
       Container,
@@ -92,7 +160,8 @@ class Transformer : public Container {
       pLayerdrop_,
       bptt_,
       useMask_,
-      preLN_)
+      preLN_,
+      fl::versioned(attentionBlockSize_, 1))
 
   Transformer();
 };
@@ -100,3 +169,4 @@ class Transformer : public Container {
 } // namespace fl
 
 CEREAL_REGISTER_TYPE(fl::Transformer);
+CEREAL_CLASS_VERSION(fl::Transformer, 1);
@@ -6,6 +6,7 @@
  */
 
 #include <array>
+#include <stdexcept>
 #include <thread>
 
 #include "flashlight/fl/dataset/BlobDataset.h"
@@ -78,6 +79,15 @@ std::vector<std::vector<uint8_t>> BlobDataset::rawGet(const int64_t idx) const {
   return sample;
 };
 
+std::vector<uint8_t> BlobDataset::rawGet(
+    const int64_t idx,
+    const int64_t field) const {
+  if (field < 0 || field >= sizes_.at(idx)) {
+    throw std::out_of_range("BlobDataset::rawGet: invalid field");
+  }
+  return readRawArray(entries_.get(offsets_.at(idx) + field));
+}
+
 void BlobDataset::add(const std::vector<af::array>& sample) {
   int64_t entryOffset;
   {
@@ -152,12 +162,24 @@ std::vector<uint8_t> BlobDataset::readRawArray(
 
 af::array BlobDataset::readArray(const BlobDatasetEntry& e, int i) const {
   if (e.dims.elements() > 0) {
-    auto buffer = readRawArray(e);
     auto keyval = hostTransforms_.find(i);
+    // Arrays are created in place when the blob is addressable. Host
+    // transforms may modify their input, so they always get a copy
+    const char* mapped = nullptr;
+    if (keyval == hostTransforms_.end()) {
+      mapped =
+          mappedData(e.offset, af::getSizeOf(e.type) * e.dims.elements());
+    }
+    std::vector<uint8_t> buffer;
+    if (!mapped) {
+      buffer = readRawArray(e);
+    }
     if (keyval == hostTransforms_.end()) {
+      const void* data =
+          mapped ? static_cast<const void*>(mapped) : buffer.data();
       af_array c_array;
       af_err status = af_create_array(
-          &c_array, buffer.data(), e.dims.ndims(), e.dims.get(), e.type);
+          &c_array, data, e.dims.ndims(), e.dims.get(), e.type);
       if (status != AF_SUCCESS) {
         throw af::exception(
             "unable to create array", __FILE__, __LINE__, status);
@@ -171,6 +193,12 @@ af::array BlobDataset::readArray(const BlobDatasetEntry& e, int i) const {
   }
 }
 
+const char* BlobDataset::mappedData(
+    int64_t /* offset */,
+    int64_t /* size */) const {
+  return nullptr;
+}
+
 void BlobDataset::writeArray(
     const BlobDatasetEntry& e,
     const af::array& array) {
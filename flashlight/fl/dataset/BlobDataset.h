@@ -108,6 +108,15 @@ class BlobDataset : public Dataset {
    * @param[in] size Raw data size in bytes.
    */
   virtual int64_t readData(int64_t offset, char* data, int64_t size) const = 0;
+  /* Return a pointer to raw data in the blob if the blob is directly
+   * addressable in memory (e.g. memory-mapped), nullptr otherwise. When
+   * available, arrays without a host transform are created from this
+   * pointer without going through readData().
+   * Implementation must be thread-safe.
+   * @param[in] offset Offset in the blob in bytes.
+   * @param[in] size Raw data size in bytes.
+   */
+  virtual const char* mappedData(int64_t offset, int64_t size) const;
   /* Make sure all written data is flushed in the blob.
    * Implementation must be thread-safe.
    */
@@ -140,6 +149,14 @@ class BlobDataset : public Dataset {
    */
   std::vector<std::vector<uint8_t>> rawGet(const int64_t idx) const;
 
+  /**
+   * Return raw data stored in one array of a given sample, without reading
+   * the other arrays of the sample.
+   * @param[in] idx An index in the dataset.
+   * @param[in] field The index of the array in the sample.
+   */
+  std::vector<uint8_t> rawGet(const int64_t idx, const int64_t field) const;
+
   /**
    * Add a new sample in the dataset. The dataset must have been opened in
    * read-write mode. Data is guaranteed to be on disk only after a flush().
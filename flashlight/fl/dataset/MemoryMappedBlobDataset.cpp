@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "flashlight/fl/dataset/MemoryMappedBlobDataset.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace fl {
+
+namespace {
+
+int toMadvise(MmapAdvice advice) {
+  switch (advice) {
+    case MmapAdvice::NORMAL:
+      return MADV_NORMAL;
+    case MmapAdvice::SEQUENTIAL:
+      return MADV_SEQUENTIAL;
+    case MmapAdvice::RANDOM:
+      return MADV_RANDOM;
+    case MmapAdvice::WILLNEED:
+      return MADV_WILLNEED;
+    default:
+      throw std::invalid_argument("unsupported MmapAdvice");
+  }
+}
+
+} // namespace
+
+MemoryMappedBlobDataset::MemoryMappedBlobDataset(
+    const std::string& name,
+    MmapAdvice advice /* = MmapAdvice::NORMAL */)
+    : name_(name), data_(nullptr), size_(0) {
+  int fd = open(name_.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("could not open file " + name);
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    throw std::runtime_error("could not stat file " + name);
+  }
+  size_ = st.st_size;
+  if (size_ > 0) {
+    void* ptr = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) {
+      close(fd);
+      throw std::runtime_error("could not mmap file " + name);
+    }
+    data_ = static_cast<char*>(ptr);
+    // Only a hint: failures are not fatal
+    madvise(data_, size_, toMadvise(advice));
+  }
+  // The mapping stays valid after the descriptor is closed
+  close(fd);
+  readIndex();
+}
+
+int64_t MemoryMappedBlobDataset::writeData(
+    int64_t /* offset */,
+    const char* /* data */,
+    int64_t /* size */) const {
+  throw std::runtime_error(
+      "MemoryMappedBlobDataset is read-only: cannot write to " + name_);
+}
+
+int64_t MemoryMappedBlobDataset::readData(
+    int64_t offset,
+    char* data,
+    int64_t size) const {
+  // min(what is available, wanted)
+  int64_t maxSize = std::max(static_cast<int64_t>(0), size_ - offset);
+  maxSize = std::min(maxSize, size);
+  if (maxSize > 0) {
+    std::memcpy(data, data_ + offset, maxSize);
+  }
+  return maxSize;
+}
+
+const char* MemoryMappedBlobDataset::mappedData(int64_t offset, int64_t size)
+    const {
+  if (offset < 0 || size < 0 || offset + size > size_) {
+    throw std::out_of_range(
+        "MemoryMappedBlobDataset: entry out of range in " + name_);
+  }
+  return data_ + offset;
+}
+
+void MemoryMappedBlobDataset::flushData() {
+  throw std::runtime_error(
+      "MemoryMappedBlobDataset is read-only: cannot flush " + name_);
+}
+
+bool MemoryMappedBlobDataset::isEmptyData() const {
+  return (size_ == 0);
+}
+
+MemoryMappedBlobDataset::~MemoryMappedBlobDataset() {
+  if (data_) {
+    munmap(data_, size_);
+  }
+}
+
+} // namespace fl
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "flashlight/fl/dataset/BlobDataset.h"
+
+#include <string>
+
+namespace fl {
+
+/**
+ * Access pattern hint given to the kernel (`madvise`) for the mapped blob.
+ */
+enum class MmapAdvice {
+  NORMAL = 0,
+  SEQUENTIAL = 1, // aggressive readahead, pages freed soon after access
+  RANDOM = 2, // no readahead
+  WILLNEED = 3, // start reading the whole blob in the background
+};
+
+/**
+ * A read-only BlobDataset on a memory-mapped file written by a
+ * `FileBlobDataset`.
+ *
+ * Samples are read directly from the mapping: arrays are created from the
+ * mapped bytes, without intermediate copies or per-thread file handles. Host
+ * transforms (see `setHostTransform()`) may modify the data they are given,
+ * so they receive a copy.
+ *
+ * Example:
+  \code{.cpp}
+  auto blob = std::make_shared<MemoryMappedBlobDataset>(
+      "data.blob", MmapAdvice::RANDOM);
+  auto sample = blob->get(0);
+  \endcode
+ */
+class MemoryMappedBlobDataset : public BlobDataset {
+ public:
+  /**
+   * Creates a `MemoryMappedBlobDataset`, specifying a blob file name.
+   * @param[in] name A blob file name.
+   * @param[in] advice Access pattern hint for the kernel page cache.
+   */
+  explicit MemoryMappedBlobDataset(
+      const std::string& name,
+      MmapAdvice advice = MmapAdvice::NORMAL);
+
+  virtual ~MemoryMappedBlobDataset() override;
+
+ protected:
+  int64_t writeData(int64_t offset, const char* data, int64_t size)
+      const override;
+  int64_t readData(int64_t offset, char* data, int64_t size) const override;
+  const char* mappedData(int64_t offset, int64_t size) const override;
+  void flushData() override;
+  bool isEmptyData() const override;
+
+ private:
+  std::string name_;
+  char* data_;
+  int64_t size_;
+};
+
+} // namespace fl
@@ -5,8 +5,10 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
 #include <memory>
 #include <stdexcept>
+#include <unordered_set>
 
 #include "flashlight/fl/common/Serialization.h"
 #include "flashlight/fl/dataset/PrefetchDataset.h"
@@ -21,7 +23,7 @@ PrefetchDataset::PrefetchDataset(
     : dataset_(dataset),
       numThreads_(numThreads),
       prefetchSize_(prefetchSize),
-      curIdx_(-1) {
+      planPos_(-1) {
   if (!dataset_) {
     throw std::invalid_argument("dataset to be prefetched is null");
   }
@@ -37,6 +39,27 @@ PrefetchDataset::PrefetchDataset(
   }
 }
 
+PrefetchDataset::PrefetchDataset(
+    std::shared_ptr<const Dataset> dataset,
+    int64_t numThreads,
+    int64_t prefetchSize,
+    std::vector<int64_t> indexPlan)
+    : PrefetchDataset(dataset, numThreads, prefetchSize) {
+  setIndexPlan(std::move(indexPlan));
+}
+
+void PrefetchDataset::setIndexPlan(std::vector<int64_t> indexPlan) {
+  for (auto idx : indexPlan) {
+    checkIndexBounds(idx);
+  }
+  indexPlan_ = std::move(indexPlan);
+  planPositions_.clear();
+  for (int64_t p = 0; p < indexPlan_.size(); ++p) {
+    planPositions_[indexPlan_[p]].push_back(p);
+  }
+  planPos_ = -1;
+}
+
 std::vector<af::array> PrefetchDataset::get(int64_t idx) const {
   checkIndexBounds(idx);
 
@@ -44,29 +67,69 @@ std::vector<af::array> PrefetchDataset::get(int64_t idx) const {
     return dataset_->get(idx);
   }
 
-  // remove from cache (if necessary)
-  while (!prefetchCache_.empty() && idx != curIdx_) {
-    prefetchCache_.pop();
-    ++curIdx_;
+  // An index outside of the plan is fetched on its own, without moving
+  // forward in the plan
+  auto pos = findPlanPosition(idx);
+  if (pos >= 0) {
+    planPos_ = pos;
   }
 
-  // add to cache (if necessary)
-  while (prefetchCache_.size() < prefetchSize_) {
-    auto fetchIdx = idx + prefetchCache_.size();
-    if (fetchIdx >= size()) {
+  // add to cache (if necessary): idx and the next planned indices
+  std::unordered_set<int64_t> window;
+  auto prefetch = [this, &window](int64_t fetchIdx) {
+    window.insert(fetchIdx);
+    if (prefetchCache_.find(fetchIdx) == prefetchCache_.end()) {
+      prefetchCache_.emplace(
+          fetchIdx, threadPool_->enqueue([this, fetchIdx]() {
+            return this->dataset_->get(fetchIdx);
+          }));
+    }
+  };
+  prefetch(idx);
+  for (int64_t p = planPos_ + 1; p < planPos_ + prefetchSize_; ++p) {
+    auto fetchIdx = plannedIndex(p);
+    if (fetchIdx < 0) {
       break;
     }
-    prefetchCache_.emplace(threadPool_->enqueue(
-        [this, fetchIdx]() { return this->dataset_->get(fetchIdx); }));
+    prefetch(fetchIdx);
   }
 
-  auto curSample = prefetchCache_.front().get();
+  // remove from cache (if necessary): samples which are no longer planned
+  for (auto it = prefetchCache_.begin(); it != prefetchCache_.end();) {
+    if (window.find(it->first) == window.end()) {
+      it = prefetchCache_.erase(it);
+    } else {
+      ++it;
+    }
+  }
 
-  prefetchCache_.pop();
-  curIdx_ = idx + 1;
+  auto curSample = prefetchCache_.at(idx).get();
+  prefetchCache_.erase(idx);
   return curSample;
 }
 
+int64_t PrefetchDataset::plannedIndex(int64_t pos) const {
+  if (indexPlan_.empty()) {
+    return pos < size() ? pos : -1;
+  }
+  return pos < indexPlan_.size() ? indexPlan_[pos] : -1;
+}
+
+int64_t PrefetchDataset::findPlanPosition(int64_t idx) const {
+  if (indexPlan_.empty()) {
+    return idx;
+  }
+  auto it = planPositions_.find(idx);
+  if (it == planPositions_.end()) {
+    return -1;
+  }
+  // The next occurrence after the current position; otherwise the consumer
+  // restarted the plan
+  const auto& positions = it->second;
+  auto next = std::upper_bound(positions.begin(), positions.end(), planPos_);
+  return next != positions.end() ? *next : positions.front();
+}
+
 int64_t PrefetchDataset::size() const {
   return dataset_->size();
 }
@@ -8,7 +8,8 @@
 #pragma once
 
 #include <future>
-#include <queue>
+#include <unordered_map>
+#include <vector>
 
 #include "flashlight/fl/dataset/Dataset.h"
 
@@ -18,9 +19,12 @@ namespace fl {
 
 /**
  * A view into a dataset, where a given number of samples are prefetched in
- * advance in a ThreadPool. PrefetchDataset should be used when there is a
- * sequential access to the underlying dataset. Otherwise, there will a lot of
- * cache misses leading to a degraded performance.
+ * advance in a ThreadPool. By default, samples are prefetched assuming a
+ * sequential access to the underlying dataset. For any other access pattern
+ * (resampled, sharded, multi-epoch...), the order in which indices will be
+ * requested can be given as an index plan; samples are then prefetched
+ * following the plan. Prefetched samples are kept by index, so out-of-order
+ * requests within the prefetch window don't discard any work.
  *
  * Example:
   \code{.cpp}
@@ -34,6 +38,15 @@ namespace fl {
   for (auto& sample : PrefetchDataset(ds, 4, 2)) {
       // do something
   }
+
+  // Read the dataset in a shuffled order
+  std::vector<int64_t> order(ds->size());
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), std::mt19937());
+  PrefetchDataset prefetchds(ds, 4, 8, order);
+  for (auto idx : order) {
+    auto sample = prefetchds.get(idx);
+  }
   \endcode
  */
 class PrefetchDataset : public Dataset {
@@ -49,19 +62,50 @@ class PrefetchDataset : public Dataset {
       int64_t numThreads,
       int64_t prefetchSize);
 
+  /**
+   * Creates a `PrefetchDataset` which prefetches samples in a given order.
+   * @param[in] dataset The underlying dataset.
+   * @param[in] numThreads Number of threads used by the threadpool
+   * @param[in] prefetchSize Number of samples to be prefetched
+   * @param[in] indexPlan Indices in the order they are expected to be
+   * requested with `get()`. Indices may repeat (e.g. multiple epochs).
+   */
+  PrefetchDataset(
+      std::shared_ptr<const Dataset> dataset,
+      int64_t numThreads,
+      int64_t prefetchSize,
+      std::vector<int64_t> indexPlan);
+
   int64_t size() const override;
 
   std::vector<af::array> get(const int64_t idx) const override;
 
+  /**
+   * Sets the order in which indices are expected to be requested. An empty
+   * plan means sequential access. Samples already prefetched are reused if
+   * they are part of the new plan.
+   * @param[in] indexPlan Indices in their expected order of access.
+   */
+  void setIndexPlan(std::vector<int64_t> indexPlan);
+
  protected:
   std::shared_ptr<const Dataset> dataset_;
   int64_t numThreads_, prefetchSize_;
 
  private:
   std::unique_ptr<ThreadPool> threadPool_;
+  std::vector<int64_t> indexPlan_;
+  // Positions of each index in the plan, in increasing order
+  std::unordered_map<int64_t, std::vector<int64_t>> planPositions_;
   // state variables
-  mutable std::queue<std::future<std::vector<af::array>>> prefetchCache_;
-  mutable int64_t curIdx_;
+  mutable std::unordered_map<int64_t, std::future<std::vector<af::array>>>
+      prefetchCache_;
+  mutable int64_t planPos_; // plan position of the last requested index
+
+  // Index at position `pos` of the plan, -1 if past its end
+  int64_t plannedIndex(int64_t pos) const;
+  // Next position of `idx` in the plan after planPos_, -1 if not planned
+  int64_t findPlanPosition(int64_t idx) const;
 };
 
 } // namespace fl
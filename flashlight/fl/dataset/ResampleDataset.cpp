@@ -59,6 +59,10 @@ void ResampleDataset::resample(std::vector<int64_t> resamplevec) {
   resampleVec_ = std::move(resamplevec);
 }
 
+const std::vector<int64_t>& ResampleDataset::getResampleVec() const {
+  return resampleVec_;
+}
+
 std::vector<af::array> ResampleDataset::get(const int64_t idx) const {
   checkIndexBounds(idx);
   return dataset_->get(resampleVec_[idx]);
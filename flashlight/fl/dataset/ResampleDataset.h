@@ -72,6 +72,13 @@ class ResampleDataset : public Dataset {
    */
   void resample(std::vector<int64_t> resamplevec);
 
+  /**
+   * @return The current mapping: `get(i)` reads sample `getResampleVec()[i]`
+   * of the underlying dataset. Can be used as the index plan of a
+   * `PrefetchDataset` wrapping the underlying dataset.
+   */
+  const std::vector<int64_t>& getResampleVec() const;
+
  protected:
   std::shared_ptr<const Dataset> dataset_;
   std::vector<int64_t> resampleVec_;
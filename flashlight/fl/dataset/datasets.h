@@ -14,6 +14,7 @@
 #include "flashlight/fl/dataset/DatasetIterator.h"
 #include "flashlight/fl/dataset/FileBlobDataset.h"
 #include "flashlight/fl/dataset/MemoryBlobDataset.h"
+#include "flashlight/fl/dataset/MemoryMappedBlobDataset.h"
 #include "flashlight/fl/dataset/MergeDataset.h"
 #include "flashlight/fl/dataset/PrefetchDataset.h"
 #include "flashlight/fl/dataset/ResampleDataset.h"
@@ -17,14 +17,31 @@ DistributedBackend distributedBackend() {
   return detail::DistributedInfo::getInstance().backend_;
 }
 
+namespace {
+
+// An asynchronous Gloo reduction only writes its result back on
+// syncDistributed(), so it is scaled beforehand; the sum is linear in the
+// inputs. Other reductions are scaled afterwards, as they always were.
+bool scaleBeforeReduction(bool async) {
+  return async && distributedBackend() == DistributedBackend::GLOO;
+}
+
+} // namespace
+
 void allReduce(
     Variable& var,
     double scale /* = 1.0 */,
     bool async /* = false */) {
+  bool scaleBefore = scaleBeforeReduction(async);
+  if (scaleBefore) {
+    var.array() *= scale;
+  }
   if (getWorldSize() > 1) {
     allReduce(var.array(), async);
   }
-  var.array() *= scale;
+  if (!scaleBefore) {
+    var.array() *= scale;
+  }
 }
 
 void allReduceMultiple(
@@ -32,16 +49,22 @@ void allReduceMultiple(
     double scale /* = 1.0 */,
     bool async /* = false */,
     bool contiguous /* = false */) {
+  bool scaleBefore = scaleBeforeReduction(async);
   // return a vector of pointers to avoid copying
   std::vector<af::array*> arrs;
   for (auto& var : vars) {
+    if (scaleBefore) {
+      var.array() *= scale;
+    }
     arrs.push_back(&var.array());
   }
   if (getWorldSize() > 1) {
     allReduceMultiple(arrs, async, contiguous);
   }
-  for (auto& var : vars) {
-    var.array() *= scale;
+  if (!scaleBefore) {
+    for (auto& var : vars) {
+      var.array() *= scale;
+    }
   }
 }
 
@@ -123,6 +123,10 @@ void allReduceMultiple(
  * Note that if asynchronous allReduce is not used, this operation will be a
  * no-op, since no operations will be enqueued on the distributed compute
  * stream.
+ *
+ * With the Gloo backend, asynchronous reductions run on a background
+ * communication thread and their results are copied back into the reduced
+ * arrays here, so those arrays must outlive this call.
  */
 void syncDistributed();
 
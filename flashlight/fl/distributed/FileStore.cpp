@@ -116,14 +116,16 @@ bool FileStore::check(const std::string& key) {
   return true;
 }
 
-void FileStore::wait(const std::string& key) {
+void FileStore::wait(
+    const std::string& key,
+    std::chrono::milliseconds timeout /* = kDefaultTimeout */) {
   // Not using inotify because it doesn't work on many
   // shared filesystems (such as NFS).
   const auto start = std::chrono::steady_clock::now();
   while (!check(key)) {
-    const auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
         std::chrono::steady_clock::now() - start);
-    if (elapsed > FileStore::kDefaultTimeout) {
+    if (elapsed > timeout) {
       throw std::runtime_error("FileStore timed out for key: " + key);
     }
     /* sleep override */
@@ -25,11 +25,14 @@ class FileStore {
   std::vector<char> get(const std::string& key);
   void set(const std::string& key, const std::vector<char>& data);
   void clear(const std::string& key);
+  // Blocks until `key` is set, throws if it isn't after `timeout`
+  void wait(
+      const std::string& key,
+      std::chrono::milliseconds timeout = kDefaultTimeout);
 
  private:
   std::string basePath_;
 
-  void wait(const std::string& key);
   bool check(const std::string& key);
   std::string objectPath(const std::string& name);
   std::string tmpPath(const std::string& name);
@@ -7,23 +7,83 @@
 
 #include "flashlight/fl/distributed/DistributedApi.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <future>
 #include <iostream>
 #include <list>
 #include <memory>
 #include <mutex>
 #include <stdexcept>
+#include <vector>
 
 #include <gloo/allreduce_halving_doubling.h>
+#include <gloo/barrier_all_to_one.h>
 #include <gloo/config.h>
 #include <gloo/mpi/context.h>
+#include <gloo/rendezvous/context.h>
+#include <gloo/rendezvous/store.h>
 #include <gloo/transport/tcp/device.h>
 #include <mpi.h>
 
+#include "flashlight/fl/common/Defines.h"
 #include "flashlight/fl/common/DevicePtr.h"
+#include "flashlight/fl/common/threadpool/ThreadPool.h"
+#include "flashlight/fl/distributed/FileStore.h"
 #include "flashlight/fl/distributed/LRUCache.h"
 
 namespace {
-std::shared_ptr<gloo::mpi::Context> glooContext_;
+std::shared_ptr<gloo::Context> glooContext_;
+
+// Exposes fl::detail::FileStore (also used for NCCL rendezvous) to Gloo's
+// rendezvous. Keys written by this rank are remembered so that they can be
+// removed once every rank has connected.
+class GlooFileStore : public gloo::rendezvous::Store {
+ public:
+  explicit GlooFileStore(const std::string& path) : store_(path) {}
+
+  void set(const std::string& key, const std::vector<char>& data) override {
+    store_.set(key, data);
+    keys_.push_back(key);
+  }
+
+  std::vector<char> get(const std::string& key) override {
+    return store_.get(key);
+  }
+
+  void wait(const std::vector<std::string>& keys) override {
+    wait(keys, fl::detail::FileStore::kDefaultTimeout);
+  }
+
+  void wait(
+      const std::vector<std::string>& keys,
+      const std::chrono::milliseconds& timeout) override {
+    if (timeout == gloo::kNoTimeout) {
+      wait(keys);
+      return;
+    }
+    // All the keys must be present before the deadline
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (const auto& key : keys) {
+      auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+          deadline - std::chrono::steady_clock::now());
+      store_.wait(key, std::max(remaining, std::chrono::milliseconds(0)));
+    }
+  }
+
+  void clearOwnKeys() {
+    for (const auto& key : keys_) {
+      store_.clear(key);
+    }
+    keys_.clear();
+  }
+
+ private:
+  fl::detail::FileStore store_;
+  std::vector<std::string> keys_;
+};
 
 // Gloo algorithms are "not meant" to be created an deleted often, for some
 // strange reason. Therefore, we emulate THD by providing a cache of the last
@@ -37,14 +97,43 @@ std::shared_ptr<gloo::mpi::Context> glooContext_;
 const int kGlooCacheSize_ = 10;
 using CacheType = fl::detail::LRUCache<std::string, gloo::Algorithm>;
 CacheType glooCache_(kGlooCacheSize_);
-af::array cacheArr_;
+
+// All Gloo collectives run on a single communication thread so that they are
+// issued in the same order on every rank, whether they were requested
+// synchronously or not. Only this thread touches glooCache_.
+fl::ThreadPool& commThread() {
+  static fl::ThreadPool pool(1);
+  return pool;
+}
+
+// Host buffers into which arrays are copied before being reduced. Buffers are
+// handed out in order and recycled once nothing is in flight, so the same
+// addresses (and hence the same cached Gloo algorithms) are reused from one
+// iteration to the next.
+std::vector<std::unique_ptr<std::vector<char>>> stagingBuffers_;
+size_t nextStagingBuffer_ = 0;
+
+struct PendingReduction {
+  std::vector<af::array*> arrs;
+  std::vector<size_t> bytes;
+  std::vector<char>* buffer;
+  std::future<void> done;
+};
+
+// Reductions issued with async = true; results are copied back to their
+// arrays in syncDistributed()
+std::list<PendingReduction> pendingReductions_;
+// Reductions being waited for outside of pendingReductions_ (synchronous ones
+// and those completed by syncDistributed()), whose staging buffers are in use
+size_t reductionsInFlight_ = 0;
+std::mutex pendingMutex_;
 } // namespace
 
 namespace fl {
 
 namespace detail {
 
-std::shared_ptr<gloo::mpi::Context> globalContext() {
+std::shared_ptr<gloo::Context> globalContext() {
   return glooContext_;
 }
 
@@ -64,35 +153,183 @@ inline void allreduceGloo(T* ptr, size_t s) {
   }
   algorithm->run();
 }
+
+void allreduceGloo(void* ptr, size_t count, af::dtype type) {
+  switch (type) {
+    case af::dtype::f32:
+      allreduceGloo(static_cast<float*>(ptr), count);
+      break;
+    case af::dtype::f64:
+      allreduceGloo(static_cast<double*>(ptr), count);
+      break;
+    case af::dtype::s32:
+      allreduceGloo(static_cast<int*>(ptr), count);
+      break;
+    case af::dtype::s64:
+      allreduceGloo(static_cast<int64_t*>(ptr), count);
+      break;
+    default:
+      throw std::runtime_error("unsupported data type for allreduce with gloo");
+  }
+}
+
+// Requires pendingMutex_ to be held
+std::vector<char>* acquireStagingBuffer(size_t bytes) {
+  if (nextStagingBuffer_ == stagingBuffers_.size()) {
+    stagingBuffers_.push_back(std::make_unique<std::vector<char>>());
+  }
+  auto* buffer = stagingBuffers_[nextStagingBuffer_++].get();
+  if (buffer->size() < bytes) {
+    buffer->resize(bytes);
+  }
+  return buffer;
+}
+
+void completeReduction(PendingReduction& reduction) {
+  // rethrows anything raised on the communication thread
+  reduction.done.get();
+  char* cur = reduction.buffer->data();
+  for (size_t i = 0; i < reduction.arrs.size(); ++i) {
+    DevicePtr arrPtr(*reduction.arrs[i]);
+    memcpy(arrPtr.get(), cur, reduction.bytes[i]);
+    cur += reduction.bytes[i];
+  }
+}
+
+/**
+ * Completes ``reductions``, counted in reductionsInFlight_, without holding
+ * pendingMutex_ so that other threads can issue reductions meanwhile. The
+ * staging buffers are recycled once nothing is in flight anymore.
+ */
+void completeInFlight(std::list<PendingReduction>& reductions) {
+  std::exception_ptr error;
+  for (auto& reduction : reductions) {
+    try {
+      completeReduction(reduction);
+    } catch (...) {
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(pendingMutex_);
+    reductionsInFlight_ -= reductions.size();
+    if (pendingReductions_.empty() && reductionsInFlight_ == 0) {
+      nextStagingBuffer_ = 0;
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+/**
+ * Packs ``arrs`` (which must share a type) into a staging buffer and reduces
+ * it with a single Gloo call on the communication thread. The copy is made on
+ * the calling thread, so the arrays may be modified as soon as this returns;
+ * if ``async``, reduced values are only written back by syncDistributed().
+ */
+void enqueueReduction(std::vector<af::array*> arrs, bool async) {
+  af::dtype type = arrs[0]->type();
+  if (type != af::dtype::f32 && type != af::dtype::f64 &&
+      type != af::dtype::s32 && type != af::dtype::s64) {
+    throw std::runtime_error("unsupported data type for allreduce with gloo");
+  }
+
+  std::unique_lock<std::mutex> lock(pendingMutex_);
+  PendingReduction reduction;
+  size_t totalBytes = 0, totalEls = 0;
+  for (auto* arr : arrs) {
+    reduction.bytes.push_back(arr->bytes());
+    totalBytes += arr->bytes();
+    totalEls += arr->elements();
+  }
+  reduction.buffer = acquireStagingBuffer(totalBytes);
+  char* cur = reduction.buffer->data();
+  for (size_t i = 0; i < arrs.size(); ++i) {
+    DevicePtr arrPtr(*arrs[i]);
+    memcpy(cur, arrPtr.get(), reduction.bytes[i]);
+    cur += reduction.bytes[i];
+  }
+  reduction.arrs = std::move(arrs);
+
+  void* data = reduction.buffer->data();
+  reduction.done = commThread().enqueue(
+      [data, totalEls, type]() { allreduceGloo(data, totalEls, type); });
+
+  if (async) {
+    pendingReductions_.push_back(std::move(reduction));
+    return;
+  }
+  std::list<PendingReduction> inFlight;
+  inFlight.push_back(std::move(reduction));
+  ++reductionsInFlight_;
+  lock.unlock();
+  completeInFlight(inFlight);
+}
 } // namespace detail
 
 void distributedInit(
     DistributedInit initMethod,
-    int /* worldRank */,
-    int /* worldSize */,
-    const std::unordered_map<std::string, std::string>& /* params = {} */) {
+    int worldRank,
+    int worldSize,
+    const std::unordered_map<std::string, std::string>& params /* = {} */) {
   if (isDistributedInit()) {
     std::cerr << "warning: fl::distributedInit() called more than once\n";
     return;
   }
-
-  if (initMethod != DistributedInit::MPI) {
-    throw std::runtime_error(
-        "unsupported distributed init method for gloo backend");
-  }
-
-  // using MPI
   if (glooContext_ != nullptr) {
     return;
   }
   // TODO: ibverbs support.
   auto glooDev = gloo::transport::tcp::CreateDevice("");
+  // A rank which dies or never starts makes the others fail after the
+  // timeout instead of hanging
+  std::chrono::seconds timeout(DistributedConstants::kDefaultTimeoutSec);
+  auto timeoutSec = params.find(DistributedConstants::kTimeoutSec);
+  if (timeoutSec != params.end()) {
+    timeout = std::chrono::seconds(std::stoi(timeoutSec->second));
+    if (timeout.count() <= 0) {
+      throw std::invalid_argument("invalid TimeoutSec for Gloo init");
+    }
+  }
 
-  // Create Gloo context from MPI communicator
-  glooContext_ = gloo::mpi::Context::createManaged();
-  glooContext_->setTimeout(gloo::kNoTimeout);
-  glooContext_->connectFullMesh(glooDev);
+  if (initMethod == DistributedInit::MPI) {
+    // Create Gloo context from MPI communicator
+    auto mpiContext = gloo::mpi::Context::createManaged();
+    mpiContext->setTimeout(timeout);
+    mpiContext->connectFullMesh(glooDev);
+    glooContext_ = mpiContext;
+  } else if (initMethod == DistributedInit::FILE_SYSTEM) {
+    // Exchange TCP addresses through a shared (or, for single-host runs,
+    // local) directory; no MPI launcher is needed
+    auto filePath = params.find(DistributedConstants::kFilePath);
+    if (filePath == params.end() || filePath->second.empty()) {
+      throw std::invalid_argument(
+          "invalid FilePath for Gloo initWithFileSystem");
+    }
+    if (worldSize <= 0 || worldRank < 0 || worldRank >= worldSize) {
+      throw std::invalid_argument(
+          "invalid worldRank/worldSize for Gloo initWithFileSystem");
+    }
+    GlooFileStore store(filePath->second);
+    auto rendezvousContext =
+        std::make_shared<gloo::rendezvous::Context>(worldRank, worldSize);
+    rendezvousContext->setTimeout(timeout);
+    rendezvousContext->connectFullMesh(store, glooDev);
 
+    // Once every rank is connected, nobody reads the addresses anymore, so
+    // they can be removed to leave the path clean for the next run
+    gloo::BarrierAllToOne(rendezvousContext).run();
+    store.clearOwnKeys();
+    glooContext_ = rendezvousContext;
+  } else {
+    throw std::runtime_error(
+        "unsupported distributed init method for gloo backend");
+  }
+
+  detail::DistributedInfo::getInstance().initMethod_ = initMethod;
   detail::DistributedInfo::getInstance().backend_ = DistributedBackend::GLOO;
   detail::DistributedInfo::getInstance().isInitialized_ = true;
   if (glooContext_->rank == 0) {
@@ -104,59 +341,57 @@ void allReduce(af::array& arr, bool async /* = false */) {
   if (!isDistributedInit()) {
     throw std::runtime_error("distributed environment not initialized");
   }
-  if (async) {
-    throw std::runtime_error(
-        "Asynchronous allReduce not yet supported for Gloo backend");
-  }
-  size_t arrSize = arr.elements() * af::getSizeOf(arr.type());
-  if (arrSize > cacheArr_.elements()) {
-    cacheArr_ = af::array(arrSize, af::dtype::b8);
-  }
-  DevicePtr arrPtr(arr);
-  DevicePtr cacheArrPtr(cacheArr_);
-  memcpy(cacheArrPtr.get(), arrPtr.get(), arrSize);
-  switch (arr.type()) {
-    case af::dtype::f32:
-      detail::allreduceGloo(
-          static_cast<float*>(cacheArrPtr.get()), arr.elements());
-      break;
-    case af::dtype::f64:
-      detail::allreduceGloo(
-          static_cast<double*>(cacheArrPtr.get()), arr.elements());
-      break;
-    case af::dtype::s32:
-      detail::allreduceGloo(
-          static_cast<int*>(cacheArrPtr.get()), arr.elements());
-      break;
-    case af::dtype::s64:
-      detail::allreduceGloo(
-          static_cast<int64_t*>(cacheArrPtr.get()), arr.elements());
-      break;
-    default:
-      throw std::runtime_error("unsupported data type for allreduce with gloo");
-  }
-  memcpy(arrPtr.get(), cacheArrPtr.get(), arrSize);
+  detail::enqueueReduction({&arr}, async);
 }
 
-// Not yet supported
 void allReduceMultiple(
     std::vector<af::array*> arrs,
     bool async /* = false */,
     bool contiguous /* = false */) {
-  if (contiguous) {
-    throw std::runtime_error(
-        "contiguous allReduceMultiple is not yet supported for Gloo backend");
+  if (!isDistributedInit()) {
+    throw std::runtime_error("distributed environment not initialized");
+  }
+  if (!contiguous) {
+    for (auto& arr : arrs) {
+      allReduce(*arr, async);
+    }
+    return;
+  }
+  if (arrs.empty()) {
+    return;
   }
 
+  // We can only do a contiguous set reduction if all arrays in the set are of
+  // the same type
+  af::dtype type = arrs[0]->type();
+  size_t totalBytes = 0;
   for (auto& arr : arrs) {
-    allReduce(*arr, async);
+    if (arr->type() != type) {
+      throw std::runtime_error(
+          "Cannot perform contiguous set allReduce on a set of tensors "
+          "of different types");
+    }
+    totalBytes += arr->bytes();
   }
+  // Mirror the NCCL backend: callers (e.g. CoalescingReducer) bucket arrays so
+  // that a contiguous set never exceeds the coalescing cache size
+  if (totalBytes > DistributedConstants::kCoalesceCacheSize) {
+    throw std::runtime_error(
+        "Total coalesce buffer size is larger than existing buffer size");
+  }
+  detail::enqueueReduction(std::move(arrs), async);
 }
 
 void syncDistributed() {
-  // NOOP since async distributed operations aren't yet supported with the Gloo
-  // backend
-  return;
+  // Wait for every reduction issued asynchronously, then copy the reduced
+  // values back into their arrays
+  std::list<PendingReduction> inFlight;
+  {
+    std::lock_guard<std::mutex> lock(pendingMutex_);
+    inFlight.swap(pendingReductions_);
+    reductionsInFlight_ += inFlight.size();
+  }
+  detail::completeInFlight(inFlight);
 }
 
 int getWorldRank() {
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/**
+ * Measures the graph bookkeeping overhead of Variable::backward() as a
+ * function of graph size: a chain of cheap elementwise ops on a scalar, so
+ * that the time is dominated by sorting and walking the graph rather than by
+ * the ops themselves. Run with and without static graph mode.
+ */
+
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "flashlight/fl/autograd/autograd.h"
+#include "flashlight/fl/common/Init.h"
+#include "flashlight/fl/tensor/Compute.h"
+
+using namespace fl;
+
+namespace {
+
+// Builds a graph of roughly `numNodes` nodes which mixes chains and reuse of
+// earlier values, as in an unrolled recurrent network
+Variable buildGraph(const Variable& input, int numNodes) {
+  std::vector<Variable> history = {input};
+  auto out = input;
+  for (int i = 0; i < numNodes / 2; ++i) {
+    out = out * 1.0 + history[i / 2];
+    history.push_back(out);
+  }
+  return out;
+}
+
+double timeBackward(int numNodes, int numIters) {
+  auto input = Variable(af::constant(1, 1), true);
+  // warmup
+  buildGraph(input, numNodes).backward();
+  fl::sync();
+
+  double total = 0;
+  for (int i = 0; i < numIters; ++i) {
+    input.zeroGrad();
+    auto out = buildGraph(input, numNodes);
+    fl::eval(out.array());
+    fl::sync();
+    auto start = af::timer::start();
+    out.backward();
+    fl::eval(input.grad().array());
+    fl::sync();
+    total += af::timer::stop(start);
+  }
+  return total / numIters;
+}
+
+} // namespace
+
+int main() {
+  fl::init();
+
+  const int kNumIters = 20;
+  std::cout << std::setw(10) << "nodes" << std::setw(18) << "dynamic (ms)"
+            << std::setw(18) << "static (ms)" << std::endl;
+  for (int numNodes : {100, 1000, 10000, 100000}) {
+    Variable::setStaticGraph(false);
+    double dynamicTime = timeBackward(numNodes, kNumIters);
+    Variable::setStaticGraph(true);
+    double staticTime = timeBackward(numNodes, kNumIters);
+    std::cout << std::setw(10) << numNodes << std::setw(18)
+              << dynamicTime * 1000 << std::setw(18) << staticTime * 1000
+              << std::endl;
+  }
+  Variable::setStaticGraph(false);
+  return 0;
+}
@@ -161,6 +161,65 @@ TEST(AutogradTest, AfArrBackwardNoMutate) {
   ASSERT_TRUE(allClose(v.grad().array(), v.array()));
 }
 
+TEST(AutogradTest, DeepGraphBackward) {
+  // backward must not recurse once per node in the graph
+  auto x = Variable(af::constant(1, 1), true);
+  auto y = x;
+  const int kDepth = 100000;
+  for (int i = 0; i < kDepth; ++i) {
+    y = y * 1.0;
+  }
+  y.backward();
+  ASSERT_TRUE(allClose(x.grad().array(), af::constant(1, 1)));
+}
+
+TEST(AutogradTest, StaticGraphBackward) {
+  Variable::setStaticGraph(true);
+  auto x = Variable(af::randu(5), true);
+  auto y = Variable(af::randu(5), true);
+  for (int iter = 0; iter < 3; ++iter) {
+    // same structure every iteration; reuses the cached order
+    x.zeroGrad();
+    y.zeroGrad();
+    auto z = x * y + x;
+    z.backward();
+    ASSERT_TRUE(allClose(x.grad().array(), y.array() + 1));
+    ASSERT_TRUE(allClose(y.grad().array(), x.array()));
+  }
+
+  // same shape as above, but y is replaced by x: the cache must be rejected
+  x.zeroGrad();
+  auto z = x * x + x;
+  z.backward();
+  ASSERT_TRUE(allClose(x.grad().array(), 2 * x.array() + 1));
+  Variable::setStaticGraph(false);
+}
+
+TEST(AutogradTest, InPlaceGradAccumulation) {
+  Variable::setInPlaceGradAccumulation(true);
+  auto x = Variable(af::randu(5, 2), true);
+  auto w = Variable(af::randu(5, 2), true);
+  // x receives many gradients; the first is the same one w receives
+  auto y = x + w;
+  for (int i = 1; i <= 40; ++i) {
+    y = y + x * static_cast<double>(i);
+  }
+  y.backward();
+  ASSERT_TRUE(allClose(x.grad().array(), af::constant(1 + 820, 5, 2)));
+  // accumulating into x's gradient must leave w's gradient untouched
+  ASSERT_TRUE(allClose(w.grad().array(), af::constant(1, 5, 2)));
+
+  // gradients accumulate across backward passes until zeroGrad()
+  auto z = x * 2.0 + x;
+  z.backward();
+  ASSERT_TRUE(allClose(x.grad().array(), af::constant(1 + 820 + 3, 5, 2)));
+  x.zeroGrad();
+  z = x * 2.0 + x;
+  z.backward();
+  ASSERT_TRUE(allClose(x.grad().array(), af::constant(3, 5, 2)));
+  Variable::setInPlaceGradAccumulation(false);
+}
+
 TEST(AutogradTest, Multiply) {
   auto x = Variable(af::randu(5), true);
   auto y = x * x;
@@ -957,6 +1016,28 @@ TEST(AutogradTest, ConvolveDilation) {
   ASSERT_TRUE(jacobianTestImpl(func_conv_bs, bs, 0.02));
 }
 
+TEST(AutogradTest, ConvolveConstantWeights) {
+  auto in = Variable(af::randu(10, 9, 8, 7, af::dtype::f32), false);
+  auto wt = Variable(af::randu(4, 3, 8, 6, af::dtype::f32), false);
+  auto bs = Variable(af::randu(1, 1, 6, 1, af::dtype::f32), false);
+  auto conv = [&](const Variable& weight) {
+    return conv2d(in, weight, bs, 1, 1, 2, 1, 1, 1, /* groups */ 1);
+  };
+  // Weights requiring a gradient are never served from a cache
+  auto expected = [&]() { return conv(Variable(wt.array().copy(), true)); };
+
+  auto out = conv(wt);
+  ASSERT_TRUE(allClose(out.array(), expected().array(), 1E-4));
+  ASSERT_TRUE(allClose(conv(wt).array(), out.array(), 1E-4));
+
+  // Results follow updates of the weights, in place or not
+  wt.array()(0) = 10;
+  ASSERT_TRUE(allClose(conv(wt).array(), expected().array(), 1E-4));
+  ASSERT_FALSE(allClose(conv(wt).array(), out.array(), 1E-4));
+  wt.array() = wt.array() * 2;
+  ASSERT_TRUE(allClose(conv(wt).array(), expected().array(), 1E-4));
+}
+
 TEST(AutogradTest, Padding) {
   auto in = Variable(af::randu(3, 3, af::dtype::f32), true);
   auto func_pad = [&](Variable& input) {
@@ -1109,6 +1190,32 @@ TEST_F(AutogradTestF16, LinearF16) {
   }
 }
 
+TEST(AutogradTest, LinearBf16Cpu) {
+  if (!FL_BACKEND_CPU) {
+    GTEST_SKIP() << "bf16 compute is only supported on CPU";
+  }
+
+  auto in = Variable(af::randu(16, 8, 4) * 2 - 1, true);
+  auto wt = Variable(af::randu(32, 16) * 2 - 1, true);
+  auto bs = Variable(af::randu(32) * 2 - 1, true);
+  auto expected = linear(in, wt, bs);
+  expected.backward();
+
+  OptimMode::get().setBf16CpuCompute(true);
+  auto in2 = Variable(in.array(), true);
+  auto wt2 = Variable(wt.array(), true);
+  auto bs2 = Variable(bs.array(), true);
+  auto result = linear(in2, wt2, bs2);
+  result.backward();
+  OptimMode::get().setBf16CpuCompute(false);
+
+  // bf16 has 8 bits of mantissa
+  ASSERT_EQ(result.type(), af::dtype::f32);
+  ASSERT_TRUE(allClose(result, expected, 1E-1));
+  ASSERT_TRUE(allClose(in2.grad(), in.grad(), 1E-1));
+  ASSERT_TRUE(allClose(wt2.grad(), wt.grad(), 1E-1));
+}
+
 TEST(AutogradTest, WeightNormLinear) {
   auto v = Variable(af::randu(3, 2), true);
   auto norm_dim = {1};
@@ -1370,6 +1477,75 @@ TEST_F(AutogradTestF16, GruF16) {
   testRnnImpl(RnnMode::GRU, af::dtype::f16);
 }
 
+TEST(AutogradTest, MultiheadAttentionBroadcastPosEmb) {
+  int timesteps = 6, headDim = 4, nHeads = 2, bsz = 3;
+  auto q = Variable(af::randu(timesteps, headDim * nHeads, bsz), true);
+  auto k = Variable(af::randu(timesteps, headDim * nHeads, bsz), true);
+  auto v = Variable(af::randu(timesteps, headDim * nHeads, bsz), true);
+  auto posEmb = Variable(af::randu(2 * timesteps - 1, headDim), true);
+
+  // reference and blockwise implementations
+  for (int blockSize : {0, 4}) {
+    auto tiled = multiheadAttention(
+        q,
+        k,
+        v,
+        tile(posEmb, af::dim4(1, 1, nHeads * bsz)),
+        Variable(),
+        Variable(),
+        nHeads,
+        0,
+        0,
+        blockSize);
+    tiled.backward();
+    auto qGrad = q.grad().array();
+    auto posEmbGrad = posEmb.grad().array();
+    q.zeroGrad();
+    posEmb.zeroGrad();
+
+    auto broadcast = multiheadAttention(
+        q, k, v, posEmb, Variable(), Variable(), nHeads, 0, 0, blockSize);
+    ASSERT_TRUE(allClose(broadcast, tiled, 1E-5));
+    broadcast.backward();
+    ASSERT_TRUE(allClose(q.grad().array(), qGrad, 1E-5));
+    ASSERT_TRUE(allClose(posEmb.grad().array(), posEmbGrad, 1E-5));
+    q.zeroGrad();
+    k.zeroGrad();
+    v.zeroGrad();
+    posEmb.zeroGrad();
+  }
+}
+
+TEST(AutogradTest, BlockwiseMultiheadAttentionDropout) {
+  int timesteps = 5, headDim = 2, nHeads = 2, bsz = 2;
+  auto q = Variable(af::randu(timesteps, headDim * nHeads, bsz, f64), true);
+  auto k = Variable(af::randu(timesteps, headDim * nHeads, bsz, f64), true);
+  auto v = Variable(af::randu(timesteps, headDim * nHeads, bsz, f64), true);
+  auto posEmb = Variable(af::randu(2 * timesteps - 1, headDim, f64), false);
+
+  // The same seed draws the same dropout masks at every evaluation, so the
+  // backward pass must regenerate the masks of the forward pass
+  auto attention =
+      [&](const Variable& query, const Variable& key, const Variable& value) {
+        af::setSeed(42);
+        return multiheadAttention(
+            query, key, value, posEmb, Variable(), Variable(), nHeads, 0.5, 0,
+            2);
+      };
+  auto funcQ = [&](Variable& in) { return attention(in, k, v); };
+  ASSERT_TRUE(jacobianTestImpl(funcQ, q, 1E-5));
+  auto funcK = [&](Variable& in) { return attention(q, in, v); };
+  ASSERT_TRUE(jacobianTestImpl(funcK, k, 1E-5));
+  auto funcV = [&](Variable& in) { return attention(q, k, in); };
+  ASSERT_TRUE(jacobianTestImpl(funcV, v, 1E-5));
+
+  // Dropout is applied
+  af::setSeed(42);
+  auto noDropout = multiheadAttention(
+      q, k, v, posEmb, Variable(), Variable(), nHeads, 0, 0, 2);
+  ASSERT_FALSE(allClose(attention(q, k, v), noDropout, 1E-5));
+}
+
 TEST(AutogradTest, Embedding) {
   int n_words = 10;
   auto input = Variable((af::randu(4, 2) * n_words).as(s32), false);
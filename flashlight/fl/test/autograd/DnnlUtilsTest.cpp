@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <tuple>
+
+#include <gtest/gtest.h>
+
+#include "flashlight/fl/autograd/autograd.h"
+#include "flashlight/fl/autograd/backend/cpu/DnnlUtils.h"
+#include "flashlight/fl/common/Init.h"
+
+using namespace fl;
+
+namespace {
+
+// Enables bf16 compute on the CPU while in scope
+struct Bf16CpuCompute {
+  Bf16CpuCompute() {
+    OptimMode::get().setBf16CpuCompute(true);
+  }
+  ~Bf16CpuCompute() {
+    OptimMode::get().setBf16CpuCompute(false);
+  }
+};
+
+bool bf16Supported() {
+  Bf16CpuCompute bf16;
+  return detail::dnnlComputeType(af::dtype::f32) ==
+      dnnl::memory::data_type::bf16;
+}
+
+// A unidirectional LSTM with 2 layers of 2 units on inputs of size 2 has 96
+// weights: 4 gates x 2 x (2 + 2) weights and 2 x 4 x 2 biases per layer
+Variable runLstm(const Variable& input, const Variable& weights) {
+  return std::get<0>(
+      rnn(input,
+          Variable(),
+          Variable(),
+          weights,
+          /* hiddenSize */ 2,
+          /* numLayers */ 2,
+          RnnMode::LSTM,
+          /* bidirectional */ false,
+          0.0));
+}
+
+} // namespace
+
+TEST(DnnlUtilsTest, ConvWeightsCachedAcrossInputShapes) {
+  auto& cache = detail::DnnlWeightsCache::getInstance();
+  cache.clear();
+
+  // Constant weights are reordered once, whatever the input width
+  auto weights = Variable(af::randu(3, 3, 2, 4), false);
+  auto in1 = Variable(af::randu(10, 10, 2, 1), false);
+  conv2d(in1, weights, 1, 1, 1, 1);
+  auto size = cache.size();
+  ASSERT_EQ(size, 1);
+
+  auto in2 = Variable(af::randu(20, 10, 2, 1), false);
+  auto out2 = conv2d(in2, weights, 1, 1, 1, 1);
+  ASSERT_EQ(cache.size(), size);
+  ASSERT_EQ(out2.dims(), af::dim4(20, 10, 4, 1));
+}
+
+TEST(DnnlUtilsTest, RnnWeightsCachedAcrossInputShapes) {
+  auto& cache = detail::DnnlWeightsCache::getInstance();
+  cache.clear();
+
+  // Constant weights are parsed and reordered once, whatever the batch size
+  // and sequence length
+  auto weights = Variable(af::randu(96), false);
+  runLstm(Variable(af::randu(2, 2, 3), false), weights);
+  auto size = cache.size();
+  ASSERT_GT(size, 0);
+
+  auto out = runLstm(Variable(af::randu(2, 5, 7), false), weights);
+  ASSERT_EQ(cache.size(), size);
+  ASSERT_EQ(out.dims(), af::dim4(2, 5, 7));
+}
+
+TEST(DnnlUtilsTest, ConvBf16) {
+  if (!bf16Supported()) {
+    GTEST_SKIP() << "bf16 compute is not supported on this CPU";
+  }
+  auto in = Variable(af::randu(10, 10, 2, 3) * 2 - 1, false);
+  auto wt = Variable(af::randu(3, 3, 2, 4) * 2 - 1, false);
+  auto bs = Variable(af::randu(1, 1, 4, 1) * 2 - 1, false);
+  auto expected = conv2d(in, wt, bs, 1, 1, 1, 1);
+
+  Bf16CpuCompute bf16;
+  auto result = conv2d(in, wt, bs, 1, 1, 1, 1);
+  // bf16 has 8 bits of mantissa
+  ASSERT_EQ(result.type(), af::dtype::f32);
+  ASSERT_TRUE(allClose(result, expected, 1E-1));
+}
+
+TEST(DnnlUtilsTest, RnnBf16) {
+  if (!bf16Supported()) {
+    GTEST_SKIP() << "bf16 compute is not supported on this CPU";
+  }
+  auto in = Variable(af::randu(2, 4, 5) * 2 - 1, false);
+  auto wt = Variable(af::randu(96) * 2 - 1, false);
+  auto expected = runLstm(in, wt);
+
+  Bf16CpuCompute bf16;
+  auto result = runLstm(in, wt);
+  ASSERT_EQ(result.type(), af::dtype::f32);
+  ASSERT_TRUE(allClose(result, expected, 1E-1));
+}
+
+TEST(DnnlUtilsTest, MatmulBf16WeightsCachedAcrossBatchSizes) {
+  if (!bf16Supported()) {
+    GTEST_SKIP() << "bf16 compute is not supported on this CPU";
+  }
+  auto& cache = detail::DnnlWeightsCache::getInstance();
+  cache.clear();
+
+  // Constant weights are converted once, whatever the number of columns
+  Bf16CpuCompute bf16;
+  auto wt = Variable(af::randu(32, 16), false);
+  linear(Variable(af::randu(16, 8), false), wt);
+  ASSERT_EQ(cache.size(), 1);
+  linear(Variable(af::randu(16, 24), false), wt);
+  ASSERT_EQ(cache.size(), 1);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  fl::init();
+  return RUN_ALL_TESTS();
+}
@@ -130,6 +130,33 @@ TEST(ContribModuleTest, AsymmetricConv1DFwd) {
   ASSERT_FALSE(allClose(output, outputFuture));
 }
 
+TEST(ContribModuleTest, AsymmetricConv1DFwdFrame) {
+  int timesteps = 20;
+  int c = 4;
+
+  auto conv = AsymmetricConv1D(c, c, 3, 1, -1, 0, 2); // use only past
+  auto input = Variable(af::randu(timesteps, 1, c, 1), false);
+  auto output = conv.forward(input);
+
+  int history = conv.historySize();
+  ASSERT_EQ(history, 4);
+  auto padded = af::join(0, af::constant(0, history, 1, c, 1), input.array());
+  for (int t = 0; t < timesteps; ++t) {
+    auto window = Variable(padded.rows(t, t + history), false);
+    ASSERT_TRUE(allClose(conv.forwardFrame(window), output.row(t), 1E-5));
+  }
+
+  // forward() does not pad only the past by historySize() frames
+  auto window = Variable(af::randu(history + 1, 1, c, 1), false);
+  auto noPad = AsymmetricConv1D(c, c, 3, 1, 0, 0, 2);
+  ASSERT_THROW(noPad.forwardFrame(window), std::invalid_argument);
+  auto oddHistory = AsymmetricConv1D(c, c, 4, 1, -1, 0, 1);
+  ASSERT_THROW(
+      oddHistory.forwardFrame(
+          Variable(af::randu(oddHistory.historySize() + 1, 1, c, 1), false)),
+      std::invalid_argument);
+}
+
 void transformerPadMaskFwd(bool isfp16) {
   int timesteps = 10;
   int c = 4;
@@ -226,6 +253,113 @@ TEST_F(ContribModuleTestF16, TransformerFwdF16) {
   transformerFwd(true);
 }
 
+TEST(ContribModuleTest, TransformerBlockwiseAttention) {
+  int batchsize = 3;
+  int timesteps = 13;
+  int c = 8;
+  int nheads = 2;
+
+  // relative positional embeddings, future mask and padding
+  auto tr =
+      Transformer(c, c / nheads, c, nheads, timesteps, 0, 0, true, false);
+  auto input = Variable(af::randu(c, timesteps, batchsize), true);
+  auto padMask = af::constant(1, af::dim4(timesteps, batchsize));
+  padMask(af::seq(timesteps - 4, timesteps - 1), 1) = 0;
+
+  auto output = tr.forward({input, Variable(padMask, false)}).front();
+  output.backward();
+  auto inputGrad = input.grad().array();
+  std::vector<af::array> paramGrads;
+  for (auto& param : tr.params()) {
+    paramGrads.push_back(param.grad().array());
+  }
+
+  // blocks which don't divide the sequence length, and a single block
+  for (int blockSize : {4, timesteps}) {
+    tr.zeroGrad();
+    input.zeroGrad();
+    tr.setAttentionBlockSize(blockSize);
+    auto blockOutput = tr.forward({input, Variable(padMask, false)}).front();
+    ASSERT_TRUE(allClose(output, blockOutput, 1E-5));
+    blockOutput.backward();
+    ASSERT_TRUE(allClose(input.grad().array(), inputGrad, 1E-4));
+    for (size_t i = 0; i < paramGrads.size(); ++i) {
+      ASSERT_TRUE(allClose(tr.param(i).grad().array(), paramGrads[i], 1E-4));
+    }
+  }
+}
+
+TEST(ContribModuleTest, TransformerIncremental) {
+  int batchsize = 3;
+  int timesteps = 9;
+  int c = 8;
+  int nheads = 2;
+
+  // relative positional embeddings and future mask
+  auto tr =
+      Transformer(c, c / nheads, c, nheads, timesteps, 0, 0, true, false);
+  tr.eval();
+  auto input = Variable(af::randu(c, timesteps, batchsize), false);
+  auto output = tr.forward({input, Variable()}).front();
+
+  // a prefix of several positions, then one position at a time
+  int prefix = 4;
+  TransformerState state;
+  Variable stepOutput;
+  std::tie(stepOutput, state) =
+      tr.forwardIncremental(input.cols(0, prefix - 1), state);
+  ASSERT_TRUE(allClose(stepOutput, output.cols(0, prefix - 1), 1E-5));
+  for (int t = prefix; t < timesteps; ++t) {
+    std::tie(stepOutput, state) = tr.forwardIncremental(input.col(t), state);
+    ASSERT_EQ(state.keys.dims(0), t + 1);
+    ASSERT_TRUE(allClose(stepOutput, output.col(t), 1E-5));
+  }
+}
+
+TEST(ContribModuleTest, TransformerFusedWeights) {
+  int batchsize = 2;
+  int timesteps = 7;
+  int c = 8;
+  int nheads = 2;
+
+  auto tr =
+      Transformer(c, c / nheads, c, nheads, timesteps, 0, 0, true, false);
+  tr.eval();
+  auto input = Variable(af::randu(c, timesteps, batchsize), false);
+  auto output = tr.forward({input, Variable()}).front();
+  // the concatenated weights are kept
+  ASSERT_TRUE(allClose(tr.forward({input, Variable()}).front(), output));
+
+  // and rebuilt when the weights change
+  for (int i = 0; i < tr.params().size(); ++i) {
+    tr.setParams(Variable(tr.param(i).array() * 0.5, false), i);
+  }
+  auto evalOutput = tr.forward({input, Variable()}).front();
+  ASSERT_FALSE(allClose(evalOutput, output));
+  // weights which need gradients are concatenated on every call
+  tr.train();
+  auto trainOutput = tr.forward({input, Variable()}).front();
+  ASSERT_TRUE(allClose(evalOutput, trainOutput, 1E-5));
+}
+
+TEST(ContribModuleTest, ConformerBlockwiseAttention) {
+  int batchsize = 2;
+  int timesteps = 17;
+  int c = 8;
+  int nheads = 2;
+
+  auto tr = Conformer(c, c / nheads, c, nheads, timesteps, 3, 0, 0);
+  tr.eval();
+  auto input = Variable(af::randu(c, timesteps, batchsize), false);
+  auto padMask = af::constant(1, af::dim4(timesteps, batchsize));
+  padMask(af::seq(timesteps - 5, timesteps - 1), 0) = 0;
+
+  auto output = tr.forward({input, Variable(padMask, false)}).front();
+  tr.setAttentionBlockSize(5);
+  auto blockOutput = tr.forward({input, Variable(padMask, false)}).front();
+  ASSERT_TRUE(allClose(output, blockOutput, 1E-5));
+}
+
 void conformerFwd(bool isfp16) {
   int batchsize = 10;
   int timesteps = 120;
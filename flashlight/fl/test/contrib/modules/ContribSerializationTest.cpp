@@ -66,6 +66,7 @@ TEST(SerializationTest, Transformer) {
   auto model = std::make_shared<Transformer>(
       c, c / nheads, c, nheads, timesteps, 0.2, 0.1, false, false);
   model->eval();
+  model->setAttentionBlockSize(16);
 
   const std::string path = fl::lib::getTmpPath("Transformer.mdl");
   save(path, model);
@@ -80,6 +81,7 @@ TEST(SerializationTest, Transformer) {
 
   ASSERT_TRUE(allParamsClose(*loaded, *model));
   ASSERT_TRUE(allClose(outputl[0], output[0]));
+  ASSERT_EQ(loaded->attentionBlockSize(), 16);
 }
 
 TEST(SerializationTest, ConformerSerialization) {
@@ -91,6 +93,7 @@ TEST(SerializationTest, ConformerSerialization) {
   auto model = std::make_shared<Conformer>(
       c, c / nheads, c, nheads, timesteps, 33, 0.2, 0.1);
   model->eval();
+  model->setAttentionBlockSize(32);
 
   const std::string path = fl::lib::getTmpPath("Conformer.mdl");
   save(path, model);
@@ -105,6 +108,7 @@ TEST(SerializationTest, ConformerSerialization) {
 
   ASSERT_TRUE(allParamsClose(*loaded, *model));
   ASSERT_TRUE(allClose(outputl[0], output[0]));
+  ASSERT_EQ(loaded->attentionBlockSize(), 32);
 }
 
 TEST(SerializationTest, PositionEmbedding) {
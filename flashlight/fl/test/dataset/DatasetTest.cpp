@@ -6,6 +6,7 @@
  */
 
 #include <chrono>
+#include <mutex>
 #include <thread>
 
 #include <arrayfire.h>
@@ -361,6 +362,68 @@ TEST(DatasetTest, FileBlobDataset) {
   }
 }
 
+TEST(DatasetTest, MemoryMappedBlobDataset) {
+  std::vector<std::vector<af::array>> data;
+  {
+    FileBlobDataset blob(fl::lib::getTmpPath("data-mmap.blob"), true, true);
+    for (int64_t i = 0; i < 20; i++) {
+      std::vector<af::array> sample;
+      for (int64_t j = 0; j < i % 4; j++) {
+        sample.push_back(af::randu(100, 3, j + 1));
+      }
+      data.push_back(sample);
+      blob.add(sample);
+    }
+    blob.writeIndex();
+  }
+
+  auto check = [&data](BlobDataset& blob) {
+    ASSERT_EQ(data.size(), blob.size());
+    for (int64_t i = 0; i < blob.size(); i++) {
+      auto blobSample = blob.get(i);
+      auto datSample = data.at(i);
+      ASSERT_EQ(datSample.size(), blobSample.size());
+      for (int64_t j = 0; j < blobSample.size(); j++) {
+        ASSERT_TRUE(datSample.at(j).dims() == blobSample.at(j).dims());
+        ASSERT_TRUE(
+            af::norm(af::flat(datSample.at(j)) - af::flat(blobSample.at(j))) <=
+            1e-05);
+      }
+    }
+  };
+
+  for (auto advice : {MmapAdvice::NORMAL,
+                      MmapAdvice::SEQUENTIAL,
+                      MmapAdvice::RANDOM,
+                      MmapAdvice::WILLNEED}) {
+    MemoryMappedBlobDataset blob(
+        fl::lib::getTmpPath("data-mmap.blob"), advice);
+    check(blob);
+  }
+
+  // host transforms may write to their input, which is a copy
+  MemoryMappedBlobDataset blob(fl::lib::getTmpPath("data-mmap.blob"));
+  for (auto& vec : data) {
+    if (vec.size() > 0) {
+      vec[0] = vec[0] * 2;
+    }
+  }
+  blob.setHostTransform(
+      0, [](void* ptr, af::dim4 size, af::dtype /* type */) {
+        float* ptrFl = (float*)ptr;
+        for (int64_t i = 0; i < size.elements(); i++) {
+          ptrFl[i] *= 2;
+        }
+        return af::array(size, ptrFl);
+      });
+  check(blob);
+  // the mapped data is unchanged
+  check(blob);
+
+  // read-only
+  ASSERT_THROW(blob.add(data.back()), std::runtime_error);
+}
+
 TEST(DatasetTest, MemoryBlobDataset) {
   std::vector<std::vector<af::array>> data;
 
@@ -538,6 +601,90 @@ TEST(DatasetTest, PrefetchDatasetCorrectness) {
   }
 }
 
+TEST(DatasetTest, PrefetchDatasetIndexPlan) {
+  std::vector<af::array> tensormap = {af::randu(10, 20, 100)};
+  auto tensords = std::make_shared<TensorDataset>(tensormap);
+  auto shuffleds = std::make_shared<ShuffleDataset>(tensords, 1);
+
+  // Two epochs of shuffled access
+  auto plan = shuffleds->getResampleVec();
+  shuffleds->resample();
+  plan.insert(
+      plan.end(),
+      shuffleds->getResampleVec().begin(),
+      shuffleds->getResampleVec().end());
+
+  auto prefetchDs = std::make_shared<PrefetchDataset>(tensords, 3, 5, plan);
+  for (auto idx : plan) {
+    auto sample1 = tensords->get(idx);
+    auto sample2 = prefetchDs->get(idx);
+    ASSERT_EQ(sample1.size(), sample2.size());
+    ASSERT_TRUE(allClose(sample1[0], sample2[0]));
+  }
+
+  // Requests in any order are still served
+  for (int64_t idx : {7, 3, 99, 0}) {
+    ASSERT_TRUE(allClose(tensords->get(idx)[0], prefetchDs->get(idx)[0]));
+  }
+
+  // Back to sequential access
+  prefetchDs->setIndexPlan({});
+  for (int64_t idx = 0; idx < tensords->size(); ++idx) {
+    ASSERT_TRUE(allClose(tensords->get(idx)[0], prefetchDs->get(idx)[0]));
+  }
+}
+
+TEST(DatasetTest, PrefetchDatasetFollowsIndexPlan) {
+  // Counts the requests of each index
+  class CountingDataset : public Dataset {
+   public:
+    explicit CountingDataset(int64_t size) : counts_(size, 0) {}
+
+    int64_t size() const override {
+      return counts_.size();
+    }
+
+    std::vector<af::array> get(const int64_t idx) const override {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++counts_[idx];
+      return {af::constant(idx, 1)};
+    }
+
+    std::vector<int> counts() const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return counts_;
+    }
+
+   private:
+    mutable std::mutex mutex_;
+    mutable std::vector<int> counts_;
+  };
+
+  auto countingDs = std::make_shared<CountingDataset>(100);
+  // Every other index, in reverse order
+  std::vector<int64_t> plan;
+  for (int64_t idx = 98; idx >= 0; idx -= 2) {
+    plan.push_back(idx);
+  }
+
+  PrefetchDataset prefetchDs(countingDs, 3, 5, plan);
+  for (auto idx : plan) {
+    ASSERT_EQ(prefetchDs.get(idx)[0].scalar<float>(), idx);
+  }
+  // Only the planned indices were fetched, each of them once
+  auto counts = countingDs->counts();
+  for (int64_t idx = 0; idx < counts.size(); ++idx) {
+    ASSERT_EQ(counts[idx], idx % 2 == 0 ? 1 : 0);
+  }
+
+  // An index outside of the plan is fetched on its own
+  ASSERT_EQ(prefetchDs.get(51)[0].scalar<float>(), 51);
+  counts = countingDs->counts();
+  ASSERT_EQ(counts[51], 1);
+  ASSERT_EQ(counts[53], 0);
+  ASSERT_EQ(counts[98], 1);
+}
+
 TEST(DatasetTest, DISABLED_PrefetchDatasetPerformance) {
   // Flaky test. Disabled for now.
   std::vector<af::array> tensormap = {af::randu(100, 200, 300)};
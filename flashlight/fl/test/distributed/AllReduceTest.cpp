@@ -63,8 +63,7 @@ TEST(Distributed, AllReduceAsync) {
 
   auto rank = getWorldRank();
   auto size = getWorldSize();
-  // not supported for the CPU backend
-  bool async = true && !FL_BACKEND_CPU;
+  bool async = true;
 
   Variable var(af::constant(rank, 10), false);
 
@@ -82,9 +81,8 @@ TEST(Distributed, AllReduceSetAsync) {
 
   auto rank = getWorldRank();
   auto size = getWorldSize();
-  // not supported for the CPU backend
-  bool async = true && !FL_BACKEND_CPU;
-  bool contiguous = true && !FL_BACKEND_CPU;
+  bool async = true;
+  bool contiguous = true;
 
   size_t vSize = (1 << 20);
   std::vector<Variable> vars;
@@ -112,6 +110,34 @@ TEST(Distributed, AllReduceSetAsync) {
   }
 }
 
+TEST(Distributed, AllReduceMixedAsync) {
+  if (!isDistributedInit()) {
+    GTEST_SKIP() << "Distributed initialization failed or not enabled.";
+  }
+
+  auto rank = getWorldRank();
+  auto size = getWorldSize();
+
+  // Synchronous reductions issued while asynchronous ones are in flight must
+  // neither block on nor reorder them
+  std::vector<Variable> asyncVars, syncVars;
+  for (size_t i = 0; i < 4; ++i) {
+    asyncVars.push_back(Variable(af::constant(rank + 1, 100 + i), false));
+    syncVars.push_back(Variable(af::constant(rank, 10 + i), false));
+  }
+  for (size_t i = 0; i < 4; ++i) {
+    allReduce(asyncVars[i], 2.0, /* async = */ true);
+    allReduce(syncVars[i], 2.0, /* async = */ false);
+    ASSERT_TRUE(
+        af::allTrue<bool>(syncVars[i].array() == size * (size - 1.0)));
+  }
+  syncDistributed();
+
+  for (auto& var : asyncVars) {
+    ASSERT_TRUE(af::allTrue<bool>(var.array() == size * (size + 1.0)));
+  }
+}
+
 TEST(Distributed, Barrier) {
   auto rank = getWorldRank();
   auto size = getWorldSize();
@@ -153,8 +179,8 @@ TEST(Distributed, CoalescingReducer) {
 
   auto s = std::make_shared<fl::CoalescingReducer>(
       /* scale = */ 1.0 / size,
-      /*async=*/true && !FL_BACKEND_CPU,
-      /*contiguous=*/true && !FL_BACKEND_CPU);
+      /*async=*/true,
+      /*contiguous=*/true);
 
   size_t vSize = (1 << 20);
   std::vector<Variable> vars;
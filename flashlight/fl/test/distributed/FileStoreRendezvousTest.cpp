@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <dirent.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "flashlight/fl/common/Init.h"
+#include "flashlight/fl/distributed/FileStore.h"
+#include "flashlight/fl/distributed/distributed.h"
+#include "flashlight/lib/common/System.h"
+
+using namespace fl;
+
+namespace {
+
+// Every test runs on two ranks, forked from the same process, which meet
+// through a local directory
+constexpr int kWorldSize = 2;
+std::string rendezvousPath;
+
+// Number of entries in `path`, besides . and ..
+int numDirEntries(const std::string& path) {
+  DIR* dir = opendir(path.c_str());
+  if (!dir) {
+    throw std::runtime_error("cannot open directory " + path);
+  }
+  int n = 0;
+  while (auto* entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if (name != "." && name != "..") {
+      ++n;
+    }
+  }
+  closedir(dir);
+  return n;
+}
+
+} // namespace
+
+TEST(FileStoreRendezvous, RankAndSize) {
+  if (!isDistributedInit()) {
+    GTEST_SKIP() << "Distributed initialization failed or not enabled.";
+  }
+  ASSERT_EQ(getWorldSize(), kWorldSize);
+  ASSERT_GE(getWorldRank(), 0);
+  ASSERT_LT(getWorldRank(), kWorldSize);
+  ASSERT_EQ(
+      detail::DistributedInfo::getInstance().initMethod_,
+      DistributedInit::FILE_SYSTEM);
+}
+
+TEST(FileStoreRendezvous, AllReduce) {
+  if (!isDistributedInit()) {
+    GTEST_SKIP() << "Distributed initialization failed or not enabled.";
+  }
+  auto rank = getWorldRank();
+  auto size = getWorldSize();
+
+  Variable var(af::constant(rank + 1, 10), false);
+  allReduce(var);
+
+  float expected_val = size * (size + 1) / 2;
+  ASSERT_TRUE(af::allTrue<bool>(var.array() == expected_val));
+}
+
+TEST(FileStoreRendezvous, KeysCleared) {
+  if (!isDistributedInit()) {
+    GTEST_SKIP() << "Distributed initialization failed or not enabled.";
+  }
+  // Every rank removed its addresses once all of them were connected
+  barrier();
+  ASSERT_EQ(numDirEntries(rendezvousPath), 0);
+}
+
+TEST(FileStoreRendezvous, WaitTimesOut) {
+  // A key that no rank sets fails the wait instead of hanging
+  detail::FileStore store(rendezvousPath);
+  ASSERT_THROW(
+      store.wait("never_set", std::chrono::milliseconds(50)),
+      std::runtime_error);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  rendezvousPath = lib::getTmpPath(
+      "fl_filestore_rendezvous_" + std::to_string(getpid()));
+  lib::dirCreate(rendezvousPath);
+
+  // Fork the other rank before anything is initialized
+  int worldRank = 0;
+  pid_t child = fork();
+  if (child < 0) {
+    std::cerr << "fork failed" << std::endl;
+    return 1;
+  }
+  if (child == 0) {
+    worldRank = 1;
+  }
+
+  fl::init();
+  try {
+    distributedInit(
+        DistributedInit::FILE_SYSTEM,
+        worldRank,
+        kWorldSize,
+        {{DistributedConstants::kFilePath, rendezvousPath}});
+  } catch (const std::exception& ex) {
+    // Don't run the test if distributed initialization fails
+    std::cerr
+        << "Distributed initialization failed; tests will be skipped. Reason: "
+        << ex.what() << std::endl;
+  }
+
+  int result = RUN_ALL_TESTS();
+  if (child > 0) {
+    int status;
+    if (waitpid(child, &status, 0) != child || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0) {
+      result = 1;
+    }
+    rmdir(rendezvousPath.c_str());
+  }
+  return result;
+}
@@ -26,24 +26,50 @@ std::vector<float> Derivatives::apply(
     throw std::invalid_argument(
         "Derivatives: input size is not divisible by numFeatures");
   }
+  return apply(input, numfeat, 0, input.size() / numfeat);
+}
+
+std::vector<float> Derivatives::apply(
+    const std::vector<float>& input,
+    int numfeat,
+    int begin,
+    int end) const {
+  if (input.size() % numfeat != 0) {
+    throw std::invalid_argument(
+        "Derivatives: input size is not divisible by numFeatures");
+  }
+  int numframes = input.size() / numfeat;
+  if (begin < 0 || begin > end || end > numframes) {
+    throw std::invalid_argument("Derivatives: invalid range of frames");
+  }
   // Compute deltas
   if (deltaWindow_ <= 0) {
-    return input;
+    return std::vector<float>(
+        input.begin() + begin * numfeat, input.begin() + end * numfeat);
   }
 
-  auto deltas = computeDerivative(input, deltaWindow_, numfeat);
+  // Double deltas of [begin, end) need the deltas of accWindow_ more frames
+  // on each side
+  int deltaBegin = begin, deltaEnd = end;
+  if (accWindow_ > 0) {
+    deltaBegin = std::max(0, begin - accWindow_);
+    deltaEnd = std::min(numframes, end + accWindow_);
+  }
+  auto deltas =
+      computeDerivative(input, deltaWindow_, numfeat, deltaBegin, deltaEnd);
   size_t szMul = 2;
   std::vector<float> doubledeltas;
   if (accWindow_ > 0) {
     // Compute double deltas (only if required)
     szMul = 3;
-    doubledeltas = computeDerivative(deltas, accWindow_, numfeat);
+    doubledeltas = computeDerivative(
+        deltas, accWindow_, numfeat, begin - deltaBegin, end - deltaBegin);
   }
-  std::vector<float> output(input.size() * szMul);
-  int numframes = input.size() / numfeat;
-  for (size_t i = 0; i < numframes; ++i) {
-    size_t curInIdx = i * numfeat;
-    size_t curOutIdx = curInIdx * szMul;
+  std::vector<float> output((end - begin) * numfeat * szMul);
+  for (size_t i = 0; i < end - begin; ++i) {
+    size_t curInIdx = (begin + i) * numfeat;
+    size_t curDeltaIdx = (begin - deltaBegin + i) * numfeat;
+    size_t curOutIdx = i * numfeat * szMul;
     // copy input
     std::copy(
         input.data() + curInIdx,
@@ -51,14 +77,14 @@ std::vector<float> Derivatives::apply(
         output.data() + curOutIdx);
     // copy deltas
     std::copy(
-        deltas.data() + curInIdx,
-        deltas.data() + curInIdx + numfeat,
+        deltas.data() + curDeltaIdx,
+        deltas.data() + curDeltaIdx + numfeat,
         output.data() + curOutIdx + numfeat);
     // copy double-deltas
     if (accWindow_ > 0) {
       std::copy(
-          doubledeltas.data() + curInIdx,
-          doubledeltas.data() + curInIdx + numfeat,
+          doubledeltas.data() + i * numfeat,
+          doubledeltas.data() + (i + 1) * numfeat,
           output.data() + curOutIdx + 2 * numfeat);
     }
   }
@@ -68,19 +94,22 @@ std::vector<float> Derivatives::apply(
 std::vector<float> Derivatives::computeDerivative(
     const std::vector<float>& input,
     int windowlen,
-    int numfeat) const {
+    int numfeat,
+    int begin,
+    int end) const {
   int numframes = input.size() / numfeat;
-  std::vector<float> output(input.size(), 0.0);
+  std::vector<float> output((end - begin) * numfeat, 0.0);
   float denominator = (windowlen * (windowlen + 1) * (2 * windowlen + 1)) / 3.0;
-  for (size_t i = 0; i < numframes; ++i) {
+  for (size_t i = begin; i < end; ++i) {
     for (size_t j = 0; j < numfeat; ++j) {
       size_t curIdx = i * numfeat + j;
+      size_t outIdx = (i - begin) * numfeat + j;
       for (size_t d = 1; d <= windowlen; ++d) {
-        output[curIdx] += d *
+        output[outIdx] += d *
             (input[curIdx + std::min((numframes - i - 1), d) * numfeat] -
              input[curIdx - std::min(i, d) * numfeat]);
       }
-      output[curIdx] /= denominator;
+      output[outIdx] /= denominator;
     }
   }
   return output;
@@ -25,15 +25,26 @@ class Derivatives {
 
   std::vector<float> apply(const std::vector<float>& input, int numfeat) const;
 
+  // Same as apply() for frames [begin, end) of input only, the other frames
+  // being used as context (Col Major : FEAT X (end - begin))
+  std::vector<float> apply(
+      const std::vector<float>& input,
+      int numfeat,
+      int begin,
+      int end) const;
+
  private:
   int deltaWindow_; // delta derivatives lag size
   int accWindow_; // acceleration derivatives lag size
 
-  // Helper function to compute derivatives of single order
+  // Helper function to compute derivatives of single order, for frames
+  // [begin, end) of input
   std::vector<float> computeDerivative(
       const std::vector<float>& input,
       int windowlen,
-      int numfeat) const;
+      int numfeat,
+      int begin,
+      int end) const;
 };
 } // namespace audio
 } // namespace lib
@@ -28,7 +28,11 @@ std::vector<float> Mfcc::apply(const std::vector<float>& input) {
   if (frames.empty()) {
     return {};
   }
+  auto cep = staticFeatures(frames);
+  return derivatives_.apply(cep, staticFeatureSize());
+}
 
+std::vector<float> Mfcc::staticFeatures(std::vector<float>& frames) {
   int nSamples = this->featParams_.numFrameSizeSamples();
   int nFrames = frames.size() / nSamples;
 
@@ -58,7 +62,11 @@ std::vector<float> Mfcc::apply(const std::vector<float>& input) {
       cep[f * nFeat] = energy[f];
     }
   }
-  return derivatives_.apply(cep, nFeat);
+  return cep;
+}
+
+int Mfcc::staticFeatureSize() const {
+  return this->featParams_.numCepstralCoeffs;
 }
 
 int Mfcc::outputSize(int inputSz) {
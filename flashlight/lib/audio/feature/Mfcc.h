@@ -63,6 +63,12 @@ class Mfcc : public Mfsc {
 
   int outputSize(int inputSz) override;
 
+  // frames - output of frameSignal (modified in place)
+  // Returns - MFCC features without derivatives (Col Major : FEAT X FRAMESZ)
+  std::vector<float> staticFeatures(std::vector<float>& frames) override;
+
+  int staticFeatureSize() const override;
+
  private:
   // The following classes are defined in the order they are applied
   Dct dct_;
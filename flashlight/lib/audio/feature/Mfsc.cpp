@@ -8,6 +8,7 @@
 #include "flashlight/lib/audio/feature/Mfsc.h"
 
 #include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <numeric>
 
@@ -35,7 +36,12 @@ std::vector<float> Mfsc::apply(const std::vector<float>& input) {
   if (frames.empty()) {
     return {};
   }
+  auto mfscFeat = staticFeatures(frames);
+  // Derivatives will not be computed if windowsize < 0
+  return derivatives_.apply(mfscFeat, staticFeatureSize());
+}
 
+std::vector<float> Mfsc::staticFeatures(std::vector<float>& frames) {
   int nSamples = this->featParams_.numFrameSizeSamples();
   int nFrames = frames.size() / nSamples;
 
@@ -71,24 +77,38 @@ std::vector<float> Mfsc::apply(const std::vector<float>& input) {
           newMfscFeat.data() + start + f + 1);
     }
     std::swap(mfscFeat, newMfscFeat);
-    ++numFeat;
   }
-  // Derivatives will not be computed if windowsize < 0
-  return derivatives_.apply(mfscFeat, numFeat);
+  return mfscFeat;
+}
+
+int Mfsc::staticFeatureSize() const {
+  return this->featParams_.numFilterbankChans +
+      (this->featParams_.useEnergy ? 1 : 0);
+}
+
+bool Mfsc::appliesDerivatives() const {
+  return true;
 }
 
 std::vector<float> Mfsc::mfscImpl(std::vector<float>& frames) {
-  auto powspectrum = this->powSpectrumImpl(frames);
-  if (this->featParams_.usePower) {
-    std::transform(
-        powspectrum.begin(),
-        powspectrum.end(),
-        powspectrum.begin(),
-        [](float x) { return x * x; });
-  }
-  auto triflt = triFltBank_.apply(powspectrum, this->featParams_.melFloor);
-  std::transform(triflt.begin(), triflt.end(), triflt.begin(), [](float x) {
-    return std::log(x);
+  int nFrames = frames.size() / this->featParams_.numFrameSizeSamples();
+  int K = this->featParams_.filterFreqResponseLen();
+  int numFeat = this->featParams_.numFilterbankChans;
+  bool usePower = this->featParams_.usePower;
+  float melFloor = this->featParams_.melFloor;
+  std::vector<float> triflt(numFeat * nFrames);
+  // Power, filterbank and log are applied on each tile of the spectrum
+  this->powSpectrumTiles(frames, [&](float* dft, size_t start, size_t n) {
+    if (usePower) {
+      for (size_t i = 0; i < n * K; ++i) {
+        dft[i] *= dft[i];
+      }
+    }
+    float* out = triflt.data() + start * numFeat;
+    triFltBank_.apply(dft, n, out, melFloor);
+    for (size_t i = 0; i < n * numFeat; ++i) {
+      out[i] = std::log(out[i]);
+    }
   });
   return triflt;
 }
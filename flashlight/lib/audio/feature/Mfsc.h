@@ -31,6 +31,14 @@ class Mfsc : public PowerSpectrum {
 
   int outputSize(int inputSz) override;
 
+  // frames - output of frameSignal (modified in place)
+  // Returns - MFSC feature without derivatives (Col Major : FEAT X FRAMESZ)
+  std::vector<float> staticFeatures(std::vector<float>& frames) override;
+
+  int staticFeatureSize() const override;
+
+  bool appliesDerivatives() const override;
+
  protected:
   // Helper function which takes input as signal after dividing the signal into
   // frames. Main purpose of this function is to reuse it in MFCC code
@@ -10,11 +10,61 @@
 #include <fftw3.h>
 
 #include <algorithm>
+#include <cmath>
 #include <cstddef>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
 #include <unordered_map>
 
 #include "flashlight/lib/audio/feature/SpeechUtils.h"
 
+namespace {
+
+// The FFTW planner is not thread-safe (only fftw_execute* is), and featurizers
+// are commonly constructed as thread_local instances by data loader threads.
+std::mutex& fftwPlannerMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+struct FftwDeleter {
+  void operator()(void* ptr) const {
+    fftw_free(ptr);
+  }
+};
+
+// SIMD-aligned buffers from fftw_malloc so that new-array execution matches
+// the alignment the plan was created with
+using FftwRealBuffer = std::unique_ptr<double, FftwDeleter>;
+using FftwComplexBuffer = std::unique_ptr<fftw_complex, FftwDeleter>;
+
+// FFT scratch buffers owned by each thread and reused across calls (and across
+// PowerSpectrum instances); grown on demand
+struct FftWorkspace {
+  FftwRealBuffer in;
+  FftwComplexBuffer out;
+  size_t inSize = 0;
+  size_t outSize = 0;
+  std::vector<float> dft;
+};
+
+FftWorkspace& getFftWorkspace(size_t inSize, size_t outSize, size_t dftSize) {
+  thread_local FftWorkspace workspace;
+  if (workspace.inSize < inSize) {
+    workspace.in.reset(fftw_alloc_real(inSize));
+    workspace.inSize = inSize;
+  }
+  if (workspace.outSize < outSize) {
+    workspace.out.reset(fftw_alloc_complex(outSize));
+    workspace.outSize = outSize;
+  }
+  workspace.dft.resize(std::max(workspace.dft.size(), dftSize));
+  return workspace;
+}
+
+} // namespace
+
 namespace fl {
 namespace lib {
 namespace audio {
@@ -25,11 +75,26 @@ PowerSpectrum::PowerSpectrum(const FeatureParams& params)
       preEmphasis_(params.preemCoef, params.numFrameSizeSamples()),
       windowing_(params.numFrameSizeSamples(), params.windowType) {
   validatePowSpecParams();
-  auto nFFt = featParams_.nFft();
-  inFftBuf_.resize(nFFt, 0.0);
-  outFftBuf_.resize(2 * nFFt);
-  fftPlan_ = std::make_unique<fftw_plan>(fftw_plan_dft_r2c_1d(
-      nFFt, inFftBuf_.data(), (fftw_complex*)outFftBuf_.data(), FFTW_MEASURE));
+  int nFft = featParams_.nFft();
+  int K = featParams_.filterFreqResponseLen();
+  // Planning with FFTW_MEASURE overwrites these buffers, so they are only
+  // used to create the plan
+  FftwRealBuffer inFftBuf(fftw_alloc_real(nFft * kFftBatchSize));
+  FftwComplexBuffer outFftBuf(fftw_alloc_complex(K * kFftBatchSize));
+  std::lock_guard<std::mutex> lock(fftwPlannerMutex());
+  fftPlan_ = std::make_unique<fftw_plan>(fftw_plan_many_dft_r2c(
+      /* rank = */ 1,
+      &nFft,
+      kFftBatchSize,
+      inFftBuf.get(),
+      /* inembed = */ nullptr,
+      /* istride = */ 1,
+      /* idist = */ nFft,
+      outFftBuf.get(),
+      /* onembed = */ nullptr,
+      /* ostride = */ 1,
+      /* odist = */ K,
+      FFTW_MEASURE));
 }
 
 std::vector<float> PowerSpectrum::apply(const std::vector<float>& input) {
@@ -37,10 +102,34 @@ std::vector<float> PowerSpectrum::apply(const std::vector<float>& input) {
   if (frames.empty()) {
     return {};
   }
+  return staticFeatures(frames);
+}
+
+std::vector<float> PowerSpectrum::staticFeatures(std::vector<float>& frames) {
   return powSpectrumImpl(frames);
 }
 
+int PowerSpectrum::staticFeatureSize() const {
+  return featParams_.powSpecFeatSz();
+}
+
+bool PowerSpectrum::appliesDerivatives() const {
+  return false;
+}
+
 std::vector<float> PowerSpectrum::powSpectrumImpl(std::vector<float>& frames) {
+  int nFrames = frames.size() / featParams_.numFrameSizeSamples();
+  int K = featParams_.filterFreqResponseLen();
+  std::vector<float> dft(K * nFrames);
+  powSpectrumTiles(frames, [&dft, K](float* tile, size_t start, size_t n) {
+    std::copy(tile, tile + n * K, dft.data() + start * K);
+  });
+  return dft;
+}
+
+void PowerSpectrum::powSpectrumTiles(
+    std::vector<float>& frames,
+    const PowSpectrumTileFunction& tileFn) {
   int nSamples = featParams_.numFrameSizeSamples();
   int nFrames = frames.size() / nSamples;
   int nFft = featParams_.nFft();
@@ -49,42 +138,56 @@ std::vector<float> PowerSpectrum::powSpectrumImpl(std::vector<float>& frames) {
   if (featParams_.ditherVal != 0.0) {
     frames = dither_.apply(frames);
   }
-  if (featParams_.zeroMeanFrame) {
-    for (size_t f = 0; f < nFrames; ++f) {
-      auto begin = frames.data() + f * nSamples;
-      float mean = std::accumulate(begin, begin + nSamples, 0.0);
-      mean /= nSamples;
-      std::transform(
-          begin, begin + nSamples, begin, [mean](float x) { return x - mean; });
+
+  auto& workspace = getFftWorkspace(
+      nFft * kFftBatchSize, K * kFftBatchSize, K * kFftBatchSize);
+  double* inFftBuf = workspace.in.get();
+  const fftw_complex* outFftBuf = workspace.out.get();
+  float* dft = workspace.dft.data();
+  for (size_t f0 = 0; f0 < nFrames; f0 += kFftBatchSize) {
+    // The tail of the last batch may hold stale frames; their output is
+    // computed but never read
+    size_t curBatchSz = std::min<size_t>(kFftBatchSize, nFrames - f0);
+    for (size_t b = 0; b < curBatchSz; ++b) {
+      auto begin = frames.data() + (f0 + b) * nSamples;
+      preprocessFrame(begin);
+      auto in = inFftBuf + b * nFft;
+      std::copy(begin, begin + nSamples, in);
+      std::fill(in + nSamples, in + nFft, 0.0);
+    }
+    fftw_execute_dft_r2c(*fftPlan_, inFftBuf, workspace.out.get());
+
+    for (size_t i = 0; i < curBatchSz * K; ++i) {
+      dft[i] = std::sqrt(
+          outFftBuf[i][0] * outFftBuf[i][0] +
+          outFftBuf[i][1] * outFftBuf[i][1]);
     }
+    tileFn(dft, f0, curBatchSz);
   }
-  if (featParams_.preemCoef != 0) {
-    preEmphasis_.applyInPlace(frames);
+}
+
+void PowerSpectrum::preprocessFrame(float* frame) const {
+  int nSamples = featParams_.numFrameSizeSamples();
+  float mean = 0.0;
+  if (featParams_.zeroMeanFrame) {
+    mean = std::accumulate(frame, frame + nSamples, 0.0);
+    mean /= nSamples;
   }
-  windowing_.applyInPlace(frames);
-  std::vector<float> dft(K * nFrames);
-  for (size_t f = 0; f < nFrames; ++f) {
-    auto begin = frames.data() + f * nSamples;
-    {
-      std::lock_guard<std::mutex> lock(fftMutex_);
-      std::copy(begin, begin + nSamples, inFftBuf_.data());
-      std::fill(outFftBuf_.begin(), outFftBuf_.end(), 0.0);
-      fftw_execute(*fftPlan_);
-
-      // Copy stuff to the redundant part
-      for (size_t i = K; i < nFft; ++i) {
-        outFftBuf_[2 * i] = outFftBuf_[2 * nFft - 2 * i];
-        outFftBuf_[2 * i + 1] = -outFftBuf_[2 * nFft - 2 * i + 1];
-      }
-
-      for (size_t i = 0; i < K; ++i) {
-        dft[f * K + i] = std::sqrt(
-            outFftBuf_[2 * i] * outFftBuf_[2 * i] +
-            outFftBuf_[2 * i + 1] * outFftBuf_[2 * i + 1]);
-      }
+  // Zero mean, pre-emphasis and windowing in one backward pass over the frame.
+  // Matches PreEmphasis::applyInPlace followed by Windowing::applyInPlace.
+  const auto& window = windowing_.coefs();
+  float preem = featParams_.preemCoef;
+  if (preem != 0) {
+    for (size_t i = nSamples - 1; i > 0; --i) {
+      frame[i] =
+          ((frame[i] - mean) - preem * (frame[i - 1] - mean)) * window[i];
+    }
+    frame[0] = (frame[0] - mean) * (1 - preem) * window[0];
+  } else {
+    for (size_t i = 0; i < nSamples; ++i) {
+      frame[i] = (frame[i] - mean) * window[i];
     }
   }
-  return dft;
 }
 
 std::vector<float> PowerSpectrum::batchApply(
@@ -137,6 +240,7 @@ void PowerSpectrum::validatePowSpecParams() const {
 }
 
 PowerSpectrum::~PowerSpectrum() {
+  std::lock_guard<std::mutex> lock(fftwPlannerMutex());
   fftw_destroy_plan(*fftPlan_);
 }
 } // namespace audio
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <mutex>
 
@@ -24,6 +25,12 @@ namespace lib {
 namespace audio {
 
 // Computes Power Spectrum features for a speech signal.
+//
+// The FFT plan is created once per instance and executed with the new-array
+// interface (`fftw_execute_dft_r2c`) on thread-local buffers, so `apply` and
+// `batchApply` can be called concurrently on the same instance. Frames are
+// preprocessed and transformed in tiles of `kFftBatchSize` frames through a
+// single batched plan.
 
 class PowerSpectrum {
  public:
@@ -41,8 +48,24 @@ class PowerSpectrum {
 
   virtual int outputSize(int inputSz);
 
+  // Per-frame features of an already framed signal, i.e. before derivatives
+  // (deltas, accelerations) are appended. Used for streaming featurization.
+  // frames - output of frameSignal (modified in place)
+  // Returns - Static features (Col Major : FEAT X FRAMESZ)
+  virtual std::vector<float> staticFeatures(std::vector<float>& frames);
+
+  // Number of static features per frame
+  virtual int staticFeatureSize() const;
+
+  // Whether the derivatives set in the feature params (deltaWindow,
+  // accWindow) are appended to the static features
+  virtual bool appliesDerivatives() const;
+
   FeatureParams getFeatureParams() const;
 
+  // Number of frames transformed by a single execution of the FFT plan
+  static constexpr int kFftBatchSize = 16;
+
  protected:
   FeatureParams featParams_;
 
@@ -50,17 +73,36 @@ class PowerSpectrum {
   // frames. Main purpose of this function is to reuse it in MFSC, MFCC code
   std::vector<float> powSpectrumImpl(std::vector<float>& frames);
 
+  // (dft, startFrame, numFrames): magnitude spectrum of frames
+  // [startFrame, startFrame + numFrames), row major (numFrames X K). The
+  // buffer is scratch space which may be modified and is reused for the next
+  // tile.
+  using PowSpectrumTileFunction = std::function<void(float*, size_t, size_t)>;
+
+  // Same as powSpectrumImpl, but hands the spectrum over tile by tile so that
+  // later stages (MFSC filterbank, log, ...) run while the tile is in cache.
+  // `frames` are preprocessed in place (dither, zero mean, pre-emphasis and
+  // windowing).
+  void powSpectrumTiles(
+      std::vector<float>& frames,
+      const PowSpectrumTileFunction& tileFn);
+
   void validatePowSpecParams() const;
 
  private:
-  // The following classes are defined in the order they are applied
+  // The following classes are defined in the order they are applied.
+  // Pre-emphasis and windowing are fused in preprocessFrame(); preEmphasis_
+  // validates the parameters.
   Dither dither_;
   PreEmphasis preEmphasis_;
   Windowing windowing_;
 
+  // Zero mean, pre-emphasis and windowing of a single frame, in place
+  void preprocessFrame(float* frame) const;
+
+  // Batched r2c plan over kFftBatchSize frames of nFft() samples each.
+  // Only executed with new arrays, never with the arrays it was created with.
   std::unique_ptr<fftw_plan> fftPlan_; // fftw_plan is an opque pointer type
-  std::vector<double> inFftBuf_, outFftBuf_;
-  std::mutex fftMutex_;
 };
 } // namespace audio
 } // namespace lib
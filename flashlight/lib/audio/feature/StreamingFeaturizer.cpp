@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "flashlight/lib/audio/feature/StreamingFeaturizer.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+
+#include "flashlight/lib/audio/feature/SpeechUtils.h"
+
+namespace fl {
+namespace lib {
+namespace audio {
+
+StreamingFeaturizer::StreamingFeaturizer(
+    std::shared_ptr<PowerSpectrum> featurizer)
+    : featurizer_(featurizer),
+      featParams_(
+          featurizer ? featurizer->getFeatureParams() : FeatureParams()),
+      derivatives_(featParams_.deltaWindow, featParams_.accWindow),
+      staticStart_(0),
+      numStaticFrames_(0),
+      nextFrame_(0) {
+  if (!featurizer_) {
+    throw std::invalid_argument("StreamingFeaturizer: featurizer is null");
+  }
+  numStaticFeat_ = featurizer_->staticFeatureSize();
+  numOutputFeat_ = numStaticFeat_;
+  derivContext_ = 0;
+  // Same as in Derivatives, there are no derivatives at all if
+  // deltaWindow <= 0
+  if (featurizer_->appliesDerivatives() && featParams_.deltaWindow > 0) {
+    numOutputFeat_ += numStaticFeat_;
+    derivContext_ = featParams_.deltaWindow;
+    if (featParams_.accWindow > 0) {
+      numOutputFeat_ += numStaticFeat_;
+      derivContext_ += featParams_.accWindow;
+    }
+  }
+}
+
+std::vector<float> StreamingFeaturizer::apply(const std::vector<float>& input) {
+  samples_.insert(samples_.end(), input.begin(), input.end());
+  auto numFrames = featParams_.numFrames(samples_.size());
+  if (numFrames > 0) {
+    auto frames = frameSignal(samples_, featParams_);
+    auto feat = featurizer_->staticFeatures(frames);
+    staticFeat_.insert(staticFeat_.end(), feat.begin(), feat.end());
+    numStaticFrames_ += numFrames;
+    samples_.erase(
+        samples_.begin(),
+        samples_.begin() + numFrames * featParams_.numFrameStrideSamples());
+  }
+  return emit(false);
+}
+
+std::vector<float> StreamingFeaturizer::finish() {
+  auto output = emit(true);
+  reset();
+  return output;
+}
+
+void StreamingFeaturizer::reset() {
+  samples_.clear();
+  staticFeat_.clear();
+  staticStart_ = 0;
+  numStaticFrames_ = 0;
+  nextFrame_ = 0;
+}
+
+int64_t StreamingFeaturizer::numFramesEmitted() const {
+  return nextFrame_;
+}
+
+int StreamingFeaturizer::outputFeatureSize() const {
+  return numOutputFeat_;
+}
+
+std::vector<float> StreamingFeaturizer::emit(bool endOfStream) {
+  // Derivatives of a frame depend on derivContext_ frames on each side; at the
+  // end of the stream they are clamped to the last frame instead
+  int64_t end =
+      endOfStream ? numStaticFrames_ : numStaticFrames_ - derivContext_;
+  if (end <= nextFrame_) {
+    return {};
+  }
+
+  std::vector<float> output;
+  size_t first = nextFrame_ - staticStart_;
+  size_t last = end - staticStart_;
+  if (derivContext_ > 0) {
+    // The buffer either starts at the first frame of the stream or holds
+    // derivContext_ frames of left context for every frame emitted here, so
+    // those frames get the same derivatives as in the offline computation.
+    output = derivatives_.apply(staticFeat_, numStaticFeat_, first, last);
+  } else {
+    output.assign(
+        staticFeat_.begin() + first * numStaticFeat_,
+        staticFeat_.begin() + last * numStaticFeat_);
+  }
+  nextFrame_ = end;
+
+  // Keep only the left context needed by the next frames to emit
+  int64_t keepFrom = std::max(staticStart_, nextFrame_ - derivContext_);
+  staticFeat_.erase(
+      staticFeat_.begin(),
+      staticFeat_.begin() + (keepFrom - staticStart_) * numStaticFeat_);
+  staticStart_ = keepFrom;
+  return output;
+}
+} // namespace audio
+} // namespace lib
+} // namespace fl
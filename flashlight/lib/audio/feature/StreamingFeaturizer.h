@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "flashlight/lib/audio/feature/Derivatives.h"
+#include "flashlight/lib/audio/feature/FeatureParams.h"
+#include "flashlight/lib/audio/feature/PowerSpectrum.h"
+
+namespace fl {
+namespace lib {
+namespace audio {
+
+// Computes features of a speech signal which arrives in chunks of arbitrary
+// size. Each frame is emitted as soon as it is complete, i.e. once all of its
+// samples have been seen and, if derivatives are used, once the frames in its
+// delta/acceleration window have been seen. Frame overlap and derivative
+// context are carried across calls, so the concatenated output of all `apply`
+// calls followed by `finish` matches `featurizer->apply` on the whole signal
+// (exactly, unless dithering is enabled).
+// Example usage:
+//   StreamingFeaturizer stream(std::make_shared<Mfcc>(params));
+//   for (const auto& chunk : chunks) {
+//     auto feat = stream.apply(chunk); // (Col Major : FEAT X NEWFRAMES)
+//   }
+//   auto lastFeat = stream.finish();
+
+class StreamingFeaturizer {
+ public:
+  // featurizer - PowerSpectrum, Mfsc or Mfcc instance, may be shared
+  explicit StreamingFeaturizer(std::shared_ptr<PowerSpectrum> featurizer);
+
+  // input - next chunk of speech signal (T)
+  // Returns - features of frames completed by this chunk
+  //   (Col Major : FEAT X NEWFRAMES)
+  std::vector<float> apply(const std::vector<float>& input);
+
+  // Ends the stream and returns the features of the frames held back for
+  // derivative context (Col Major : FEAT X NEWFRAMES). The featurizer is reset
+  // and can be used for the next signal.
+  std::vector<float> finish();
+
+  // Drops all buffered samples and frames
+  void reset();
+
+  // Number of frames emitted since the beginning of the stream
+  int64_t numFramesEmitted() const;
+
+  // Number of output features per frame
+  int outputFeatureSize() const;
+
+ private:
+  std::shared_ptr<PowerSpectrum> featurizer_;
+  FeatureParams featParams_;
+  Derivatives derivatives_;
+  int numStaticFeat_; // static features per frame
+  int numOutputFeat_; // output features per frame (static + derivatives)
+  int derivContext_; // frames needed on each side to compute derivatives
+
+  std::vector<float> samples_; // samples not yet consumed by a full frame
+  // Static features of frames [staticStart_, numStaticFrames_)
+  std::vector<float> staticFeat_;
+  int64_t staticStart_;
+  int64_t numStaticFrames_;
+  int64_t nextFrame_; // index of the next frame to emit
+
+  std::vector<float> emit(bool endOfStream);
+};
+} // namespace audio
+} // namespace lib
+} // namespace fl
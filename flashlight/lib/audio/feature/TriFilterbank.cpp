@@ -12,8 +12,6 @@
 #include <cstddef>
 #include <stdexcept>
 
-#include "flashlight/lib/audio/feature/SpeechUtils.h"
-
 namespace fl {
 namespace lib {
 namespace audio {
@@ -51,20 +49,66 @@ TriFilterbank::TriFilterbank(
       H_[i * numFilters_ + j] = std::max(std::min(hislope, loslope), minH);
     }
   }
+
+  // Triangular filters are non-zero over a single contiguous span of bins
+  filterStart_.resize(numFilters_, 0);
+  filterSize_.resize(numFilters_, 0);
+  filterOffset_.resize(numFilters_, 0);
+  for (size_t j = 0; j < numFilters_; ++j) {
+    int first = -1, last = -1;
+    for (size_t i = 0; i < filterLen_; ++i) {
+      if (H_[i * numFilters_ + j] != 0.0) {
+        first = (first < 0) ? i : first;
+        last = i;
+      }
+    }
+    filterOffset_[j] = sparseH_.size();
+    if (first < 0) {
+      continue;
+    }
+    filterStart_[j] = first;
+    filterSize_[j] = last - first + 1;
+    for (size_t i = first; i <= last; ++i) {
+      sparseH_.push_back(H_[i * numFilters_ + j]);
+    }
+  }
 }
 
 std::vector<float> TriFilterbank::apply(
     const std::vector<float>& input,
     float melfloor /* = 0.0 */) const {
-  std::vector<float> output = cblasGemm(input, H_, numFilters_, filterLen_);
-  std::transform(
-      output.begin(),
-      output.end(),
-      output.begin(),
-      [melfloor](float n) -> float { return std::max(n, melfloor); });
+  if (input.size() % filterLen_ != 0) {
+    throw std::invalid_argument(
+        "TriFilterbank: input size is not divisible by filterLen");
+  }
+  int numframes = input.size() / filterLen_;
+  std::vector<float> output(numframes * numFilters_);
+  apply(input.data(), numframes, output.data(), melfloor);
   return output;
 }
 
+void TriFilterbank::apply(
+    const float* input,
+    int numframes,
+    float* output,
+    float melfloor /* = 0.0 */) const {
+  for (size_t f = 0; f < numframes; ++f) {
+    const float* curInput = input + f * filterLen_;
+    float* curOutput = output + f * numFilters_;
+    for (size_t j = 0; j < numFilters_; ++j) {
+      const float* x = curInput + filterStart_[j];
+      const float* h = sparseH_.data() + filterOffset_[j];
+      int size = filterSize_[j];
+      float sum = 0.0;
+#pragma omp simd reduction(+ : sum)
+      for (int i = 0; i < size; ++i) {
+        sum += x[i] * h[i];
+      }
+      curOutput[j] = std::max(sum, melfloor);
+    }
+  }
+}
+
 std::vector<float> TriFilterbank::filterbank() const {
   return H_;
 }
@@ -30,6 +30,15 @@ class TriFilterbank {
       const std::vector<float>& input,
       float melfloor = 0.0) const;
 
+  // Applies the filterbank to `numframes` contiguous frames of `filterlen`
+  // values each and writes `numfilters` values per frame into `output`.
+  // Only the non-zero span of each triangular filter is visited.
+  void apply(
+      const float* input,
+      int numframes,
+      float* output,
+      float melfloor = 0.0) const;
+
   // Returns triangular filterbank matrix
   std::vector<float> filterbank() const;
 
@@ -43,6 +52,12 @@ class TriFilterbank {
   std::vector<float>
       H_; // (numFilters_ x filterLen_) triangular filterbank matrix
 
+  // Sparse copy of H_: filter j has weights
+  // sparseH_[filterOffset_[j], filterOffset_[j] + filterSize_[j]) which apply
+  // to input bins starting at filterStart_[j]
+  std::vector<int> filterStart_, filterSize_, filterOffset_;
+  std::vector<float> sparseH_;
+
   float hertzToWarpedScale(float hz, FrequencyScale freqscale) const;
   float warpedToHertzScale(float wrp, FrequencyScale freqscale) const;
 };
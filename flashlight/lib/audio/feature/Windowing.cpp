@@ -57,6 +57,10 @@ void Windowing::applyInPlace(std::vector<float>& input) const {
     }
   }
 }
+
+const std::vector<float>& Windowing::coefs() const {
+  return coefs_;
+}
 } // namespace audio
 } // namespace lib
 } // namespace fl
@@ -27,6 +27,9 @@ class Windowing {
 
   void applyInPlace(std::vector<float>& input) const;
 
+  // Returns window coefficients w(n)
+  const std::vector<float>& coefs() const;
+
  private:
   int windowLength_;
   WindowType windowType_;
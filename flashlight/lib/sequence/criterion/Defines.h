@@ -18,6 +18,15 @@ enum class CriterionScaleMode {
   TARGET_SZ = 3,
   TARGET_SZ_SQRT = 4,
 };
+
+/// How CPU criterions spread the work over threads: over the sequences of
+/// the batch only, or over the sequences and the tokens of each frame. AUTO
+/// chooses the latter when the batch is too small to use all the cores.
+enum class CriterionParallelism {
+  AUTO = 0,
+  BATCH = 1,
+  FRAME = 2,
+};
 } // namespace seq
 } // namespace lib
 } // namespace fl
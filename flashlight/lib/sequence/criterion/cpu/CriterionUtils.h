@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <cmath>
 #include <cstring>
 
 #include "flashlight/lib/sequence/criterion/Defines.h"
@@ -42,6 +43,26 @@ void setZero(T* ptr, size_t count) {
   std::memset(ptr, 0, count * sizeof(T));
 }
 
+/// Sets `maxValue` to the max of `values`, replaces `values` by
+/// `exp(values - maxValue)` and returns their sum, so that the log-sum-exp of
+/// `values` is `log(sum) + maxValue`. Both loops are vectorized (`exp` too
+/// when the compiler has a vector math library).
+inline double expSumInPlace(double* values, int n, double& maxValue) {
+  double maxVal = -INFINITY;
+#pragma omp simd reduction(max : maxVal)
+  for (int i = 0; i < n; ++i) {
+    maxVal = values[i] > maxVal ? values[i] : maxVal;
+  }
+  double sum = 0;
+#pragma omp simd reduction(+ : sum)
+  for (int i = 0; i < n; ++i) {
+    values[i] = std::exp(values[i] - maxVal);
+    sum += values[i];
+  }
+  maxValue = maxVal;
+  return sum;
+}
+
 } // namespace cpu
 } // namespace lib
 } // namespace fl
@@ -22,7 +22,6 @@ struct WorkspacePtrs {
     ws.request(&scale, B);
     ws.request(&alpha, B, T, L);
     ws.request(&alphaGrad, B, T, L);
-    ws.request(&transBatchGrad, B, N, N);
     ws.request(&transBuf1, B, L);
     ws.request(&transBuf2, B, L);
     ws.request(&transBufGrad1, B, L);
@@ -33,7 +32,6 @@ struct WorkspacePtrs {
   Float* scale;
   double* alpha;
   double* alphaGrad;
-  Float* transBatchGrad;
   Float* transBuf1;
   Float* transBuf2;
   Float* transBufGrad1;
@@ -133,7 +131,6 @@ void ForceAlignmentCriterion<Float>::backward(
   setZero(_inputGrad, B * T * N);
   setZero(transGrad, N * N);
   setZero(ws.alphaGrad, B * T * _L);
-  setZero(ws.transBatchGrad, B * N * N);
   setZero(ws.transBufGrad1, B * _L);
   setZero(ws.transBufGrad2, B * _L);
 
@@ -143,7 +140,6 @@ void ForceAlignmentCriterion<Float>::backward(
     auto* alphaGrad = &ws.alphaGrad[b * T * _L];
     auto* inputGrad = &_inputGrad[b * T * N];
     auto* target = &_target[b * _L];
-    auto* transBatchGrad = &ws.transBatchGrad[b * N * N];
     auto* transBuf1 = &ws.transBuf1[b * _L];
     auto* transBuf2 = &ws.transBuf2[b * _L];
     auto* transBufGrad1 = &ws.transBufGrad1[b * _L];
@@ -202,20 +198,21 @@ void ForceAlignmentCriterion<Float>::backward(
     for (int i = 0; i < T * N; ++i) {
       inputGrad[i] *= gradScale;
     }
-
-    for (int i = 0; i < L; ++i) {
-      transBatchGrad[target[i] * N + target[i]] += transBufGrad1[i];
-      if (i > 0) {
-        transBatchGrad[target[i] * N + target[i - 1]] += transBufGrad2[i];
-      }
-    }
   }
 
+  // Only the transitions along the targets have a gradient: O(B * L) instead
+  // of a dense N x N gradient per sequence
   for (int b = 0; b < B; ++b) {
-    auto transBatchGrad = ws.transBatchGrad + b * N * N;
+    auto* target = &_target[b * _L];
+    auto* transBufGrad1 = &ws.transBufGrad1[b * _L];
+    auto* transBufGrad2 = &ws.transBufGrad2[b * _L];
     auto gradScale = grad[b] * ws.scale[b];
-    for (int i = 0; i < N * N; ++i) {
-      transGrad[i] += gradScale * transBatchGrad[i];
+    for (int i = 0; i < targetSize[b]; ++i) {
+      transGrad[target[i] * N + target[i]] += gradScale * transBufGrad1[i];
+      if (i > 0) {
+        transGrad[target[i] * N + target[i - 1]] +=
+            gradScale * transBufGrad2[i];
+      }
     }
   }
 }
@@ -7,7 +7,9 @@
 
 #include "flashlight/lib/sequence/criterion/cpu/FullConnectionCriterion.h"
 
+#include <algorithm>
 #include <cmath>
+#include <thread>
 
 #include "flashlight/lib/sequence/criterion/Workspace.h"
 #include "flashlight/lib/sequence/criterion/cpu/CriterionUtils.h"
@@ -34,6 +36,36 @@ struct WorkspacePtrs {
   size_t requiredSize;
 };
 
+// Below this many tokens, a frame is too little work to split over threads
+constexpr int kMinFrameParallelTokens = 64;
+// Columns of transBuf summed by each thread in the backward pass
+constexpr int kColumnBlockSize = 256;
+
+bool parallelizeFrames(CriterionParallelism parallelism, int B, int N) {
+  if (parallelism != CriterionParallelism::AUTO) {
+    return parallelism == CriterionParallelism::FRAME;
+  }
+  return B < static_cast<int>(std::thread::hardware_concurrency()) &&
+      N >= kMinFrameParallelTokens;
+}
+
+// transBuf = alphaPrev + trans (alphaPrev if trans is null)
+template <class Float>
+void fillTransBuf(
+    double* transBuf,
+    const double* alphaPrev,
+    const Float* trans,
+    int N) {
+  if (!trans) {
+    std::copy(alphaPrev, alphaPrev + N, transBuf);
+    return;
+  }
+#pragma omp simd
+  for (int n = 0; n < N; ++n) {
+    transBuf[n] = alphaPrev[n] + trans[n];
+  }
+}
+
 } // namespace
 
 namespace fl {
@@ -55,42 +87,53 @@ void FullConnectionCriterion<Float>::forward(
     const int* targetSize,
     const Float* trans,
     Float* loss,
-    void* workspace) {
+    void* workspace,
+    CriterionParallelism parallelism /* = CriterionParallelism::AUTO */) {
   WorkspacePtrs<Float> ws(workspace, B, T, N);
   CriterionUtils<Float>::computeScale(B, T, N, scaleMode, targetSize, ws.scale);
 
-#pragma omp parallel for num_threads(B)
   for (int b = 0; b < B; ++b) {
     for (int n = 0; n < N; ++n) {
       int k = b * T * N + n;
       ws.alpha[k] = input[k];
     }
+  }
 
-    for (int t = 1; t <= T; ++t) {
-      for (int m = 0; m < N; ++m) {
-        const auto* alphaPrev = &ws.alpha[b * T * N + (t - 1) * N];
-        const auto* inputCur = &input[b * T * N + t * N];
-        auto* transBuf = &ws.transBuf[b * N * N + m * N];
-        auto* alphaCur = &ws.alpha[b * T * N + t * N];
-
-        double maxValue = -INFINITY;
-        for (int n = 0; n < N; ++n) {
-          double val = transBuf[n] =
-              alphaPrev[n] + (t == T ? 0 : trans[m * N + n]);
-          maxValue = val > maxValue ? val : maxValue;
-        }
+  // alpha[b][t][m] from alpha[b][t - 1], or the loss for t == T (and m == 0)
+  auto computeAlpha = [&](int b, int t, int m) {
+    const auto* alphaPrev = &ws.alpha[b * T * N + (t - 1) * N];
+    auto* transBuf = &ws.transBuf[b * N * N + m * N];
+    fillTransBuf(transBuf, alphaPrev, t == T ? nullptr : &trans[m * N], N);
+
+    double maxValue;
+    double sumValue = expSumInPlace(transBuf, N, maxValue);
+    if (t == T) {
+      loss[b] = ws.scale[b] * (log(sumValue) + maxValue);
+      return;
+    }
+    int k = b * T * N + t * N + m;
+    ws.alpha[k] = log(sumValue) + maxValue + input[k];
+  };
 
-        double sumValue = 0;
-        for (int n = 0; n < N; ++n) {
-          sumValue += exp(transBuf[n] - maxValue);
+  if (parallelizeFrames(parallelism, B, N)) {
+#pragma omp parallel
+    for (int t = 1; t <= T; ++t) {
+      int M = t == T ? 1 : N;
+#pragma omp for collapse(2)
+      for (int b = 0; b < B; ++b) {
+        for (int m = 0; m < M; ++m) {
+          computeAlpha(b, t, m);
         }
-
-        if (t == T) {
-          loss[b] = ws.scale[b] * (log(sumValue) + maxValue);
-          break;
+      }
+    }
+  } else {
+#pragma omp parallel for num_threads(B)
+    for (int b = 0; b < B; ++b) {
+      for (int t = 1; t <= T; ++t) {
+        int M = t == T ? 1 : N;
+        for (int m = 0; m < M; ++m) {
+          computeAlpha(b, t, m);
         }
-
-        alphaCur[m] = log(sumValue) + maxValue + inputCur[m];
       }
     }
   }
@@ -105,75 +148,100 @@ void FullConnectionCriterion<Float>::backward(
     const Float* grad,
     Float* _inputGrad,
     Float* transGrad,
-    void* workspace) {
+    void* workspace,
+    CriterionParallelism parallelism /* = CriterionParallelism::AUTO */) {
   WorkspacePtrs<Float> ws(workspace, B, T, N);
   setZero(_inputGrad, B * T * N);
   setZero(transGrad, N * N);
   setZero(ws.alphaGrad, B * T * N);
   setZero(ws.transBatchGrad, B * N * N);
 
-#pragma omp parallel for num_threads(B)
-  for (int b = 0; b < B; ++b) {
-    for (int t = T; t > 0; --t) {
-      for (int m = 0; m < N; ++m) {
-        const auto* alphaPrev = &ws.alpha[b * T * N + (t - 1) * N];
-        const auto* alphaCurGrad = &ws.alphaGrad[b * T * N + t * N];
-        auto* alphaPrevGrad = &ws.alphaGrad[b * T * N + (t - 1) * N];
-        auto* transBuf = &ws.transBuf[b * N * N + m * N];
-        auto* transBatchGrad = &ws.transBatchGrad[b * N * N + m * N];
-
-        double maxValue = -INFINITY;
-        for (int n = 0; n < N; ++n) {
-          double val = transBuf[n] =
-              alphaPrev[n] + (t == T ? 0 : trans[m * N + n]);
-          maxValue = val > maxValue ? val : maxValue;
-        }
-
-        double sumValue = 0;
-        for (int n = 0; n < N; ++n) {
-          transBuf[n] = exp(transBuf[n] - maxValue);
-          sumValue += transBuf[n];
-        }
-
-        if (t == T) {
-          for (int n = 0; n < N; ++n) {
-            alphaPrevGrad[n] = transBuf[n] / sumValue;
-          }
-          break;
-        }
-
-        for (int n = 0; n < N; ++n) {
-          transBuf[n] = transBuf[n] / sumValue * alphaCurGrad[m];
-          transBatchGrad[n] += transBuf[n];
-        }
+  // For t < T, row m of transBuf[b] gets the gradient of alpha[b][t][m]
+  // spread over alpha[b][t - 1] (and the transitions). For t == T (and
+  // m == 0), the gradient of alpha[b][T - 1] is that of the loss.
+  auto backwardRow = [&](int b, int t, int m) {
+    const auto* alphaPrev = &ws.alpha[b * T * N + (t - 1) * N];
+    auto* transBuf = &ws.transBuf[b * N * N + m * N];
+    fillTransBuf(transBuf, alphaPrev, t == T ? nullptr : &trans[m * N], N);
+
+    double maxValue;
+    double sumValue = expSumInPlace(transBuf, N, maxValue);
+    if (t == T) {
+      auto* alphaPrevGrad = &ws.alphaGrad[b * T * N + (t - 1) * N];
+#pragma omp simd
+      for (int n = 0; n < N; ++n) {
+        alphaPrevGrad[n] = transBuf[n] / sumValue;
       }
+      return;
+    }
+    double alphaCurGrad = ws.alphaGrad[b * T * N + t * N + m];
+    auto* transBatchGrad = &ws.transBatchGrad[b * N * N + m * N];
+#pragma omp simd
+    for (int n = 0; n < N; ++n) {
+      transBuf[n] = transBuf[n] / sumValue * alphaCurGrad;
+      transBatchGrad[n] += transBuf[n];
+    }
+  };
 
-      if (t == T) {
-        continue;
+  // Sums the columns [m0, m1) of transBuf[b] into the gradient of
+  // alpha[b][t - 1], reading the rows contiguously
+  auto backwardColumns = [&](int b, int t, int m0, int m1) {
+    auto* alphaPrevGrad = &ws.alphaGrad[b * T * N + (t - 1) * N];
+    for (int n = 0; n < N; ++n) {
+      const auto* transBuf = &ws.transBuf[b * N * N + n * N];
+#pragma omp simd
+      for (int m = m0; m < m1; ++m) {
+        alphaPrevGrad[m] += transBuf[m];
       }
+    }
+  };
 
-      for (int m = 0; m < N; ++m) {
-        auto* alphaPrevGrad = &ws.alphaGrad[b * T * N + (t - 1) * N];
-
-        for (int n = 0; n < N; ++n) {
-          alphaPrevGrad[m] += ws.transBuf[b * N * N + n * N + m];
+  if (parallelizeFrames(parallelism, B, N)) {
+    int nBlocks = (N + kColumnBlockSize - 1) / kColumnBlockSize;
+#pragma omp parallel
+    for (int t = T; t > 0; --t) {
+      int M = t == T ? 1 : N;
+#pragma omp for collapse(2)
+      for (int b = 0; b < B; ++b) {
+        for (int m = 0; m < M; ++m) {
+          backwardRow(b, t, m);
+        }
+      }
+      if (t < T) {
+#pragma omp for collapse(2)
+        for (int b = 0; b < B; ++b) {
+          for (int i = 0; i < nBlocks; ++i) {
+            int m0 = i * kColumnBlockSize;
+            backwardColumns(b, t, m0, std::min(N, m0 + kColumnBlockSize));
+          }
         }
       }
     }
-
-    auto* alphaGrad = &ws.alphaGrad[b * T * N];
-    auto* inputGrad = &_inputGrad[b * T * N];
-
-    for (int i = 0; i < T * N; ++i) {
-      inputGrad[i] = ws.scale[b] * grad[b] * alphaGrad[i];
+  } else {
+#pragma omp parallel for num_threads(B)
+    for (int b = 0; b < B; ++b) {
+      for (int t = T; t > 0; --t) {
+        int M = t == T ? 1 : N;
+        for (int m = 0; m < M; ++m) {
+          backwardRow(b, t, m);
+        }
+        if (t < T) {
+          backwardColumns(b, t, 0, N);
+        }
+      }
     }
   }
 
-  for (int b = 0; b < B; ++b) {
-    auto* transBatchGrad = &ws.transBatchGrad[b * N * N];
+#pragma omp parallel for
+  for (int i = 0; i < B * T * N; ++i) {
+    int b = i / (T * N);
+    _inputGrad[i] = ws.scale[b] * grad[b] * ws.alphaGrad[i];
+  }
 
-    for (int i = 0; i < N * N; ++i) {
-      transGrad[i] += ws.scale[b] * grad[b] * transBatchGrad[i];
+#pragma omp parallel for
+  for (int i = 0; i < N * N; ++i) {
+    for (int b = 0; b < B; ++b) {
+      transGrad[i] += ws.scale[b] * grad[b] * ws.transBatchGrad[b * N * N + i];
     }
   }
 }
@@ -10,6 +10,7 @@
 #include <cstddef>
 
 #include "flashlight/lib/sequence/criterion/Defines.h"
+using fl::lib::seq::CriterionParallelism;
 using fl::lib::seq::CriterionScaleMode;
 
 namespace fl {
@@ -30,7 +31,8 @@ struct FullConnectionCriterion {
       const int* targetSize,
       const Float* trans,
       Float* loss,
-      void* workspace);
+      void* workspace,
+      CriterionParallelism parallelism = CriterionParallelism::AUTO);
 
   static void backward(
       int B,
@@ -40,7 +42,8 @@ struct FullConnectionCriterion {
       const Float* grad,
       Float* inputGrad,
       Float* transGrad,
-      void* workspace);
+      void* workspace,
+      CriterionParallelism parallelism = CriterionParallelism::AUTO);
 };
 
 } // namespace cpu
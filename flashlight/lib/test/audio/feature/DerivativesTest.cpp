@@ -7,6 +7,8 @@
 
 #include <gtest/gtest.h>
 #include <numeric>
+#include <stdexcept>
+#include <utility>
 
 #include "flashlight/lib/audio/feature/Derivatives.h"
 #include "flashlight/lib/test/audio/feature/TestUtils.h"
@@ -110,6 +112,34 @@ TEST(DerivativesTest, batchingTest) {
   }
 }
 
+TEST(DerivativesTest, rangeTest) {
+  int numFeat = 5, frameSz = 30;
+  auto input = randVec<float>(numFeat * frameSz);
+  for (auto windows : {std::make_pair(0, 0),
+                       std::make_pair(4, 0),
+                       std::make_pair(3, 2)}) {
+    Derivatives dev(windows.first, windows.second);
+    auto output = dev.apply(input, numFeat);
+    int outFeat = output.size() / frameSz;
+    // Frames of a range get the same derivatives as in the whole input
+    for (auto range : {std::make_pair(0, frameSz),
+                       std::make_pair(0, 3),
+                       std::make_pair(10, 17),
+                       std::make_pair(28, frameSz),
+                       std::make_pair(12, 12)}) {
+      std::vector<float> expOutput(
+          output.begin() + range.first * outFeat,
+          output.begin() + range.second * outFeat);
+      auto curOutput = dev.apply(input, numFeat, range.first, range.second);
+      ASSERT_TRUE(compareVec<float>(curOutput, expOutput));
+    }
+  }
+  Derivatives dev(2, 2);
+  ASSERT_THROW(dev.apply(input, numFeat, 5, 4), std::invalid_argument);
+  ASSERT_THROW(
+      dev.apply(input, numFeat, 0, frameSz + 1), std::invalid_argument);
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -11,6 +11,7 @@
 #include <iostream>
 #include <iterator>
 #include <sstream>
+#include <thread>
 
 #include "flashlight/lib/audio/feature/FeatureParams.h"
 #include "flashlight/lib/audio/feature/Mfcc.h"
@@ -174,6 +175,32 @@ TEST(MfccTest, BatchingTest2) {
   }
 }
 
+TEST(MfccTest, ConcurrentApplyTest) {
+  int Tmax = 10000;
+  int nThreads = 8;
+  FeatureParams featparams;
+  Mfcc mfcc(featparams);
+
+  std::vector<std::vector<float>> inputs, expected;
+  for (int i = 0; i < nThreads; ++i) {
+    // Lengths not multiple of the FFT batch size exercise the tail batch
+    inputs.push_back(randVec<float>(Tmax + 137 * i));
+    expected.push_back(mfcc.apply(inputs.back()));
+  }
+
+  std::vector<std::vector<float>> outputs(nThreads);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < nThreads; ++i) {
+    threads.emplace_back([&, i]() { outputs[i] = mfcc.apply(inputs[i]); });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  for (int i = 0; i < nThreads; ++i) {
+    ASSERT_TRUE(compareVec<float>(outputs[i], expected[i], 1E-4));
+  }
+}
+
 TEST(MfccTest, EmptyTest) {
   std::vector<float> input;
   FeatureParams featparams;
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <memory>
+
+#include "flashlight/lib/audio/feature/Mfcc.h"
+#include "flashlight/lib/audio/feature/Mfsc.h"
+#include "flashlight/lib/audio/feature/PowerSpectrum.h"
+#include "flashlight/lib/audio/feature/StreamingFeaturizer.h"
+#include "flashlight/lib/test/audio/feature/TestUtils.h"
+
+using namespace fl::lib::audio;
+
+namespace {
+
+// Feeds `input` in chunks of `chunkSz` samples and concatenates the output
+std::vector<float> streamApply(
+    StreamingFeaturizer& stream,
+    const std::vector<float>& input,
+    int chunkSz) {
+  std::vector<float> output;
+  for (size_t i = 0; i < input.size(); i += chunkSz) {
+    auto end = std::min(input.size(), i + chunkSz);
+    auto feat = stream.apply(
+        std::vector<float>(input.begin() + i, input.begin() + end));
+    EXPECT_EQ(feat.size() % stream.outputFeatureSize(), 0);
+    output.insert(output.end(), feat.begin(), feat.end());
+  }
+  auto feat = stream.finish();
+  output.insert(output.end(), feat.begin(), feat.end());
+  return output;
+}
+
+void checkStreaming(std::shared_ptr<PowerSpectrum> featurizer) {
+  auto input = randVec<float>(16000);
+  auto expOutput = featurizer->apply(input);
+  StreamingFeaturizer stream(featurizer);
+  for (int chunkSz : {1, 7, 160, 399, 400, 1000, 16000, 20000}) {
+    auto output = streamApply(stream, input, chunkSz);
+    ASSERT_TRUE(compareVec<float>(output, expOutput, 1E-4))
+        << "chunk size " << chunkSz;
+  }
+}
+
+} // namespace
+
+TEST(StreamingFeaturizerTest, PowerSpectrumTest) {
+  FeatureParams params;
+  checkStreaming(std::make_shared<PowerSpectrum>(params));
+}
+
+TEST(StreamingFeaturizerTest, MfscTest) {
+  FeatureParams params;
+  checkStreaming(std::make_shared<Mfsc>(params));
+  params.useEnergy = false;
+  params.accWindow = 0;
+  checkStreaming(std::make_shared<Mfsc>(params));
+}
+
+TEST(StreamingFeaturizerTest, MfccTest) {
+  FeatureParams params;
+  checkStreaming(std::make_shared<Mfcc>(params));
+  params.deltaWindow = 3;
+  params.accWindow = 1;
+  params.rawEnergy = false;
+  checkStreaming(std::make_shared<Mfcc>(params));
+  params.deltaWindow = 0;
+  checkStreaming(std::make_shared<Mfcc>(params));
+}
+
+TEST(StreamingFeaturizerTest, LatencyTest) {
+  FeatureParams params;
+  auto mfcc = std::make_shared<Mfcc>(params);
+  StreamingFeaturizer stream(mfcc);
+  int stride = params.numFrameStrideSamples();
+  int context = params.deltaWindow + params.accWindow;
+  // Nothing is emitted until a frame and its derivative context are complete
+  auto feat = stream.apply(randVec<float>(params.numFrameSizeSamples()));
+  ASSERT_TRUE(feat.empty());
+  feat = stream.apply(randVec<float>(context * stride));
+  ASSERT_EQ(feat.size(), params.mfccFeatSz());
+  // Then every stride of new samples emits one frame
+  for (int i = 0; i < 10; ++i) {
+    feat = stream.apply(randVec<float>(stride));
+    ASSERT_EQ(feat.size(), params.mfccFeatSz());
+  }
+  ASSERT_EQ(stream.numFramesEmitted(), 11);
+  feat = stream.finish();
+  ASSERT_EQ(feat.size(), context * params.mfccFeatSz());
+  ASSERT_EQ(stream.numFramesEmitted(), 0);
+}
+
+TEST(StreamingFeaturizerTest, EmptyTest) {
+  FeatureParams params;
+  StreamingFeaturizer stream(std::make_shared<Mfcc>(params));
+  ASSERT_TRUE(stream.apply({}).empty());
+  ASSERT_TRUE(stream.apply(randVec<float>(10)).empty());
+  ASSERT_TRUE(stream.finish().empty());
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
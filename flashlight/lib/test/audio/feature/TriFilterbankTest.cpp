@@ -6,6 +6,7 @@
  */
 
 #include <gtest/gtest.h>
+#include <algorithm>
 
 #include "flashlight/lib/audio/feature/TriFilterbank.h"
 #include "flashlight/lib/test/audio/feature/TestUtils.h"
@@ -75,6 +76,32 @@ TEST(TriFilterbankTest, batchingTest) {
   }
 }
 
+TEST(TriFilterbankTest, sparseApplyTest) {
+  int numFilters = 40, filterLen = 257, B = 37;
+  auto input = randVec<float>(filterLen * B, 0.0, 10.0);
+  auto triflt = TriFilterbank(numFilters, filterLen, 16000, 20, 7600);
+  auto H = triflt.filterbank();
+  float melfloor = 1.0;
+
+  // Dense reference: output = max(input * H, melfloor)
+  std::vector<float> expOutput(numFilters * B, 0.0);
+  for (int b = 0; b < B; ++b) {
+    for (int j = 0; j < numFilters; ++j) {
+      float sum = 0.0;
+      for (int i = 0; i < filterLen; ++i) {
+        sum += input[b * filterLen + i] * H[i * numFilters + j];
+      }
+      expOutput[b * numFilters + j] = std::max(sum, melfloor);
+    }
+  }
+  auto output = triflt.apply(input, melfloor);
+  ASSERT_TRUE(compareVec<float>(output, expOutput, 1E-4));
+
+  std::vector<float> rawOutput(numFilters * B);
+  triflt.apply(input.data(), B, rawOutput.data(), melfloor);
+  ASSERT_TRUE(compareVec<float>(rawOutput, expOutput, 1E-4));
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/**
+ * Measures the forward and backward passes of the CPU FullConnectionCriterion
+ * (the normalization term of ASG) with the work spread over the sequences of
+ * the batch only, as before, and over the sequences and the tokens of each
+ * frame, for several batch sizes B, numbers of frames T and of tokens N.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "flashlight/lib/sequence/criterion/cpu/FullConnectionCriterion.h"
+
+using fl::lib::cpu::FullConnectionCriterion;
+using fl::lib::seq::CriterionParallelism;
+using fl::lib::seq::CriterionScaleMode;
+
+namespace {
+
+constexpr int kRuns = 3;
+
+struct Result {
+  double msec;
+  std::vector<float> loss;
+};
+
+Result benchmark(
+    int B,
+    int T,
+    int N,
+    const std::vector<float>& input,
+    const std::vector<float>& trans,
+    CriterionParallelism parallelism) {
+  std::vector<int> targetSize(B, 1);
+  std::vector<float> loss(B), grad(B, 1), inputGrad(B * T * N),
+      transGrad(N * N);
+  std::vector<char> workspace(
+      FullConnectionCriterion<float>::getWorkspaceSize(B, T, N));
+
+  double msec = INFINITY;
+  for (int i = 0; i < kRuns; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    FullConnectionCriterion<float>::forward(
+        B,
+        T,
+        N,
+        CriterionScaleMode::NONE,
+        input.data(),
+        targetSize.data(),
+        trans.data(),
+        loss.data(),
+        workspace.data(),
+        parallelism);
+    FullConnectionCriterion<float>::backward(
+        B,
+        T,
+        N,
+        trans.data(),
+        grad.data(),
+        inputGrad.data(),
+        transGrad.data(),
+        workspace.data(),
+        parallelism);
+    msec = std::min(
+        msec,
+        std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start)
+            .count());
+  }
+  return {msec, loss};
+}
+
+} // namespace
+
+int main() {
+  // {B, T, N}: letters, word pieces, large word-piece vocabularies
+  std::vector<std::vector<int>> sizes = {
+      {4, 500, 30},
+      {16, 500, 30},
+      {4, 200, 300},
+      {16, 200, 300},
+      {1, 50, 2000},
+      {4, 50, 2000}};
+
+  std::cout << "fwd+bwd, best of " << kRuns << " runs, in ms" << std::endl;
+  std::cout << std::setw(6) << "B" << std::setw(6) << "T" << std::setw(8)
+            << "N" << std::setw(12) << "batch" << std::setw(12) << "frame"
+            << std::setw(10) << "speedup" << std::setw(14) << "loss diff"
+            << std::endl;
+  std::mt19937 gen(0);
+  std::normal_distribution<float> dist;
+  for (const auto& size : sizes) {
+    int B = size[0], T = size[1], N = size[2];
+    std::vector<float> input(B * T * N), trans(N * N);
+    for (auto& x : input) {
+      x = dist(gen);
+    }
+    for (auto& x : trans) {
+      x = dist(gen);
+    }
+
+    auto batch =
+        benchmark(B, T, N, input, trans, CriterionParallelism::BATCH);
+    auto frame =
+        benchmark(B, T, N, input, trans, CriterionParallelism::FRAME);
+    double lossDiff = 0;
+    for (int b = 0; b < B; ++b) {
+      lossDiff = std::max<double>(
+          lossDiff, std::abs(batch.loss[b] - frame.loss[b]));
+    }
+    std::cout << std::setw(6) << B << std::setw(6) << T << std::setw(8) << N
+              << std::setw(12) << std::fixed << std::setprecision(2)
+              << batch.msec << std::setw(12) << frame.msec << std::setw(10)
+              << batch.msec / frame.msec << std::setw(14)
+              << std::scientific << lossDiff << std::defaultfloat
+              << std::endl;
+  }
+  return 0;
+}
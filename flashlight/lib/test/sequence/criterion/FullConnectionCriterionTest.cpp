@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "flashlight/lib/sequence/criterion/cpu/FullConnectionCriterion.h"
+
+using fl::lib::cpu::FullConnectionCriterion;
+using fl::lib::seq::CriterionParallelism;
+using fl::lib::seq::CriterionScaleMode;
+
+namespace {
+
+struct Result {
+  std::vector<float> loss;
+  std::vector<float> inputGrad;
+  std::vector<float> transGrad;
+};
+
+Result run(
+    int B,
+    int T,
+    int N,
+    const std::vector<float>& input,
+    const std::vector<float>& trans,
+    CriterionParallelism parallelism) {
+  std::vector<int> targetSize(B, 2);
+  std::vector<float> grad(B, 1);
+  Result result{
+      std::vector<float>(B),
+      std::vector<float>(B * T * N),
+      std::vector<float>(N * N)};
+  std::vector<char> workspace(
+      FullConnectionCriterion<float>::getWorkspaceSize(B, T, N));
+  FullConnectionCriterion<float>::forward(
+      B,
+      T,
+      N,
+      CriterionScaleMode::INPUT_SZ_SQRT,
+      input.data(),
+      targetSize.data(),
+      trans.data(),
+      result.loss.data(),
+      workspace.data(),
+      parallelism);
+  FullConnectionCriterion<float>::backward(
+      B,
+      T,
+      N,
+      trans.data(),
+      grad.data(),
+      result.inputGrad.data(),
+      result.transGrad.data(),
+      workspace.data(),
+      parallelism);
+  return result;
+}
+
+// The reductions sum in a different order, so only match up to rounding
+bool allClose(
+    const std::vector<float>& a,
+    const std::vector<float>& b,
+    float tolerance = 1e-4) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (std::abs(a[i] - b[i]) > tolerance * (1 + std::abs(b[i]))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void testFrameMatchesBatch(int B, int T, int N) {
+  std::mt19937 gen(0);
+  std::normal_distribution<float> dist;
+  std::vector<float> input(B * T * N), trans(N * N);
+  for (auto& x : input) {
+    x = dist(gen);
+  }
+  for (auto& x : trans) {
+    x = dist(gen);
+  }
+
+  auto batch = run(B, T, N, input, trans, CriterionParallelism::BATCH);
+  auto frame = run(B, T, N, input, trans, CriterionParallelism::FRAME);
+  ASSERT_TRUE(allClose(frame.loss, batch.loss));
+  ASSERT_TRUE(allClose(frame.inputGrad, batch.inputGrad));
+  ASSERT_TRUE(allClose(frame.transGrad, batch.transGrad));
+}
+
+} // namespace
+
+TEST(FullConnectionCriterionTest, FrameMatchesBatchSmallTokenSet) {
+  testFrameMatchesBatch(3, 12, 7);
+}
+
+TEST(FullConnectionCriterionTest, FrameMatchesBatchLargeTokenSet) {
+  testFrameMatchesBatch(2, 10, 150);
+}
+
+TEST(FullConnectionCriterionTest, FrameMatchesBatchSingleSequence) {
+  testFrameMatchesBatch(1, 30, 70);
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "flashlight/lib/test/text/decoder/DecoderTestUtils.h"
+#include "flashlight/lib/text/decoder/BatchLexiconDecoder.h"
+#include "flashlight/lib/text/decoder/lm/ZeroLM.h"
+
+using namespace fl::lib::text;
+using namespace fl::lib::text::test;
+
+namespace {
+
+constexpr int kNumTokens = 30;
+
+// Word-level LM with token dependent scores, counting the cache updates
+class TestLM : public ZeroLM {
+ public:
+  int nCacheUpdates = 0;
+
+  std::pair<LMStatePtr, float> score(
+      const LMStatePtr& state,
+      const int usrTokenIdx) override {
+    return {ZeroLM::score(state, usrTokenIdx).first, -0.1 * (usrTokenIdx % 7)};
+  }
+
+  void updateCache(std::vector<LMStatePtr> /* unused */) override {
+    ++nCacheUpdates;
+  }
+};
+
+} // namespace
+
+TEST(BatchLexiconDecoderTest, SelectTopTokens) {
+  std::vector<int> tokens;
+  std::vector<float> buffer;
+  std::vector<float> emissions = {0.5, 3, -1, 3, 2, 0.5, 7, 0.5};
+  EXPECT_EQ(selectTopTokens(emissions.data(), 8, 10, tokens, buffer), 8);
+  for (int i = 0; i < 8; i++) {
+    EXPECT_EQ(tokens[i], i);
+  }
+  EXPECT_EQ(selectTopTokens(emissions.data(), 8, 4, tokens, buffer), 4);
+  EXPECT_EQ(tokens[0], 6);
+  EXPECT_EQ(std::min(tokens[1], tokens[2]), 1);
+  EXPECT_EQ(std::max(tokens[1], tokens[2]), 3);
+  EXPECT_EQ(tokens[3], 4);
+  // Ties at the k-th value
+  EXPECT_EQ(selectTopTokens(emissions.data(), 8, 6, tokens, buffer), 6);
+  EXPECT_EQ(emissions[tokens[5]], 0.5);
+
+  auto random = randomEmissions(100, kNumTokens, 1);
+  std::vector<int> expected(random.size());
+  std::iota(expected.begin(), expected.end(), 0);
+  std::partial_sort(
+      expected.begin(),
+      expected.begin() + 50,
+      expected.end(),
+      [&random](int l, int r) { return random[l] > random[r]; });
+  EXPECT_EQ(
+      selectTopTokens(random.data(), random.size(), 50, tokens, buffer), 50);
+  for (int i = 0; i < 50; i++) {
+    EXPECT_EQ(tokens[i], expected[i]);
+  }
+}
+
+TEST(BatchLexiconDecoderTest, MatchesLexiconDecoder) {
+  auto lexicon = buildLexicon(
+      randomSpellings(300, 1, kNumTokens - 2, 1, 6, /* unique */ false),
+      kNumTokens,
+      0,
+      [](int i) { return -0.01 * (i % 11); });
+  for (auto criterionType : {CriterionType::ASG, CriterionType::CTC}) {
+    LexiconDecoderOptions opt{.beamSize = 30,
+                              .beamSizeToken = 10,
+                              .beamThreshold = 25,
+                              .lmWeight = 1.5,
+                              .wordScore = -0.5,
+                              .unkScore = -INFINITY,
+                              .silScore = 0,
+                              .logAdd = false,
+                              .criterionType = criterionType};
+    std::vector<float> transitions;
+    int blank = -1;
+    if (criterionType == CriterionType::ASG) {
+      transitions = randomEmissions(kNumTokens, kNumTokens, 7);
+    } else {
+      blank = kNumTokens - 1;
+    }
+
+    std::vector<int> T = {40, 17, 0, 33};
+    std::vector<std::vector<float>> emissions;
+    std::vector<const float*> emissionPtrs;
+    for (int b = 0; b < T.size(); b++) {
+      emissions.push_back(randomEmissions(T[b], kNumTokens, b));
+      emissionPtrs.push_back(emissions.back().data());
+    }
+
+    auto lm = std::make_shared<TestLM>();
+    BatchLexiconDecoder batchDecoder(
+        opt, lexicon, lm, 0, blank, -1, transitions, false);
+    // Decoders are reused across calls
+    for (int pass = 0; pass < 2; pass++) {
+      lm->nCacheUpdates = 0;
+      auto results = batchDecoder.decode(emissionPtrs, T, kNumTokens);
+      EXPECT_EQ(lm->nCacheUpdates, 40);
+      ASSERT_EQ(results.size(), T.size());
+      for (int b = 0; b < T.size(); b++) {
+        LexiconDecoder decoder(
+            opt, lexicon, lm, 0, blank, -1, transitions, false);
+        auto expected =
+            decoder.decode(emissions[b].data(), T[b], kNumTokens);
+        ASSERT_EQ(results[b].size(), expected.size());
+        for (int i = 0; i < expected.size(); i++) {
+          EXPECT_DOUBLE_EQ(results[b][i].score, expected[i].score);
+          EXPECT_EQ(results[b][i].words, expected[i].words);
+          EXPECT_EQ(results[b][i].tokens, expected[i].tokens);
+        }
+      }
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "flashlight/lib/test/text/decoder/DecoderTestUtils.h"
+#include "flashlight/lib/text/decoder/BatchSeq2SeqDecoder.h"
+#include "flashlight/lib/text/decoder/LexiconFreeSeq2SeqDecoder.h"
+#include "flashlight/lib/text/decoder/LexiconSeq2SeqDecoder.h"
+#include "flashlight/lib/text/decoder/lm/ZeroLM.h"
+
+using namespace fl::lib::text;
+using namespace fl::lib::text::test;
+
+namespace {
+
+constexpr int kNumTokens = 20;
+constexpr int kEos = kNumTokens - 1;
+constexpr int kMaxOutputLength = 25;
+
+// Toy attention model: the scores depend on the emissions, the step and the
+// whole token history, which the AM state hashes
+std::pair<std::vector<float>, AMStatePtr> amStep(
+    const float* emissions,
+    int T,
+    int y,
+    const AMStatePtr& prevState,
+    int t) {
+  size_t history = prevState ? *static_cast<size_t*>(prevState.get()) : 0;
+  history = history * 1000003 + y + 1;
+  const float* frame = emissions + std::min(t, T - 1) * kNumTokens;
+  std::vector<float> scores(kNumTokens);
+  for (int n = 0; n < kNumTokens; n++) {
+    scores[n] = frame[n] + 0.5 * std::sin((history % 1000) + n);
+  }
+  // Make the hypothesis end
+  scores[kEos] += 0.3 * t - 2;
+  return {scores, std::make_shared<size_t>(history)};
+}
+
+AMUpdateFunc buildAmUpdateFunc(int& nCalls) {
+  return [&nCalls](
+             const float* emissions,
+             const int /* N */,
+             const int T,
+             const std::vector<int>& rawY,
+             const std::vector<AMStatePtr>& rawPrevStates,
+             int& t) {
+    ++nCalls;
+    std::pair<std::vector<std::vector<float>>, std::vector<AMStatePtr>> out;
+    for (int i = 0; i < rawY.size(); i++) {
+      auto step = amStep(emissions, T, rawY[i], rawPrevStates[i], t);
+      out.first.push_back(std::move(step.first));
+      out.second.push_back(std::move(step.second));
+    }
+    return out;
+  };
+}
+
+BatchAMUpdateFunc buildBatchAmUpdateFunc(int& nCalls) {
+  return [&nCalls](
+             const std::vector<const float*>& emissions,
+             const int /* N */,
+             const std::vector<int>& T,
+             const std::vector<int>& rawY,
+             const std::vector<AMStatePtr>& rawPrevStates,
+             const std::vector<int>& nHyps,
+             int& t) {
+    ++nCalls;
+    std::pair<std::vector<std::vector<float>>, std::vector<AMStatePtr>> out;
+    for (int b = 0, i = 0; b < nHyps.size(); b++) {
+      for (int end = i + nHyps[b]; i < end; i++) {
+        auto step = amStep(emissions[b], T[b], rawY[i], rawPrevStates[i], t);
+        out.first.push_back(std::move(step.first));
+        out.second.push_back(std::move(step.second));
+      }
+    }
+    return out;
+  };
+}
+
+} // namespace
+
+TEST(BatchSeq2SeqDecoderTest, MatchesSeq2SeqDecoders) {
+  auto lm = std::make_shared<ZeroLM>();
+  // No homophones nor equal word scores, which would tie
+  auto lexicon = buildLexicon(
+      randomSpellings(200, 0, kNumTokens - 2, 1, 4, /* unique */ true),
+      kNumTokens,
+      -1,
+      [](int i) { return -0.001 * i; });
+  int nCalls = 0;
+  auto amUpdateFunc = buildAmUpdateFunc(nCalls);
+  std::vector<std::function<Seq2SeqDecoderPtr(const AMUpdateFunc&)>>
+      buildDecoders = {
+          [&](const AMUpdateFunc& func) {
+            return std::make_shared<LexiconFreeSeq2SeqDecoder>(
+                LexiconFreeSeq2SeqDecoderOptions{.beamSize = 10,
+                                                 .beamSizeToken = 5,
+                                                 .beamThreshold = 20,
+                                                 .lmWeight = 0.5,
+                                                 .eosScore = 0,
+                                                 .logAdd = false},
+                lm,
+                kEos,
+                func,
+                kMaxOutputLength);
+          },
+          [&](const AMUpdateFunc& func) {
+            return std::make_shared<LexiconSeq2SeqDecoder>(
+                LexiconSeq2SeqDecoderOptions{.beamSize = 10,
+                                             .beamSizeToken = 5,
+                                             .beamThreshold = 20,
+                                             .lmWeight = 0.5,
+                                             .wordScore = 0.2,
+                                             .eosScore = 0,
+                                             .logAdd = false},
+                lexicon,
+                lm,
+                kEos,
+                func,
+                kMaxOutputLength,
+                false);
+          }};
+
+  std::vector<int> T = {12, 5, 30, 9};
+  std::vector<std::vector<float>> emissions;
+  std::vector<const float*> emissionPtrs;
+  for (int b = 0; b < T.size(); b++) {
+    emissions.push_back(randomEmissions(T[b], kNumTokens, b));
+    emissionPtrs.push_back(emissions.back().data());
+  }
+
+  for (const auto& buildDecoder : buildDecoders) {
+    int nBatchCalls = 0;
+    std::vector<Seq2SeqDecoderPtr> decoders;
+    for (int b = 0; b < T.size(); b++) {
+      decoders.push_back(buildDecoder(nullptr));
+    }
+    BatchSeq2SeqDecoder batchDecoder(
+        decoders, buildBatchAmUpdateFunc(nBatchCalls));
+    // Decoders are reused across calls
+    for (int pass = 0; pass < 2; pass++) {
+      nBatchCalls = 0;
+      auto results = batchDecoder.decode(emissionPtrs, T, kNumTokens);
+      ASSERT_EQ(results.size(), T.size());
+
+      nCalls = 0;
+      int maxCalls = 0;
+      for (int b = 0; b < T.size(); b++) {
+        int prevCalls = nCalls;
+        auto expected = buildDecoder(amUpdateFunc)
+                            ->decode(emissions[b].data(), T[b], kNumTokens);
+        maxCalls = std::max(maxCalls, nCalls - prevCalls);
+        ASSERT_FALSE(expected.empty());
+        ASSERT_EQ(results[b].size(), expected.size());
+        for (int i = 0; i < expected.size(); i++) {
+          EXPECT_DOUBLE_EQ(results[b][i].score, expected[i].score);
+          EXPECT_EQ(results[b][i].tokens, expected[i].tokens);
+          // ZeroLM scores permutations of the same words equally
+          auto words = results[b][i].words;
+          auto expectedWords = expected[i].words;
+          std::sort(words.begin(), words.end());
+          std::sort(expectedWords.begin(), expectedWords.end());
+          EXPECT_EQ(words, expectedWords);
+        }
+      }
+      // One AM call per step for the whole batch
+      EXPECT_EQ(nBatchCalls, maxCalls);
+      EXPECT_LT(nBatchCalls, nCalls);
+    }
+  }
+
+  // Subsets of the decoders can be used, not more utterances
+  BatchSeq2SeqDecoder batchDecoder(
+      {buildDecoders[0](nullptr)}, buildBatchAmUpdateFunc(nCalls));
+  EXPECT_THROW(
+      batchDecoder.decode(emissionPtrs, T, kNumTokens), std::invalid_argument);
+  EXPECT_THROW(
+      BatchSeq2SeqDecoder(
+          {buildDecoders[0](nullptr),
+           std::make_shared<LexiconFreeSeq2SeqDecoder>(
+               LexiconFreeSeq2SeqDecoderOptions{},
+               std::make_shared<ZeroLM>(),
+               kEos,
+               nullptr,
+               kMaxOutputLength)},
+          buildBatchAmUpdateFunc(nCalls)),
+      std::invalid_argument);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
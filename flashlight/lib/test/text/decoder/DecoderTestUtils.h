@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/*
+ * Synthetic lexicons and emissions shared by the decoder tests and
+ * benchmarks.
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "flashlight/lib/text/decoder/FlatTrie.h"
+#include "flashlight/lib/text/decoder/Trie.h"
+
+namespace fl {
+namespace lib {
+namespace text {
+namespace test {
+
+/*
+ * Spellings of `nWords` random words of `minLength` to `maxLength` tokens in
+ * [`minToken`, `maxToken`]. Without homophones, which would tie, if
+ * `unique` (the spellings are then sorted).
+ */
+inline std::vector<std::vector<int>> randomSpellings(
+    int nWords,
+    int minToken,
+    int maxToken,
+    int minLength,
+    int maxLength,
+    bool unique) {
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int> token(minToken, maxToken);
+  std::uniform_int_distribution<int> length(minLength, maxLength);
+  std::vector<std::vector<int>> spellings;
+  std::set<std::vector<int>> uniqueSpellings;
+  while ((unique ? uniqueSpellings.size() : spellings.size()) < nWords) {
+    std::vector<int> spelling(length(gen));
+    for (auto& t : spelling) {
+      t = token(gen);
+    }
+    if (unique) {
+      uniqueSpellings.insert(spelling);
+    } else {
+      spellings.push_back(spelling);
+    }
+  }
+  if (unique) {
+    spellings.assign(uniqueSpellings.begin(), uniqueSpellings.end());
+  }
+  return spellings;
+}
+
+/*
+ * Trie over `nTokens` tokens where the i-th spelling is word i, with score
+ * `wordScore(i)`, smeared with the max
+ */
+inline TriePtr buildTrie(
+    const std::vector<std::vector<int>>& spellings,
+    int nTokens,
+    int silIdx,
+    const std::function<float(int)>& wordScore) {
+  auto trie = std::make_shared<Trie>(nTokens, silIdx);
+  for (int i = 0; i < spellings.size(); i++) {
+    trie->insert(spellings[i], i, wordScore(i));
+  }
+  trie->smear(SmearingMode::MAX);
+  return trie;
+}
+
+/* Flattened buildTrie(), as the lexicon decoders take it */
+inline FlatTriePtr buildLexicon(
+    const std::vector<std::vector<int>>& spellings,
+    int nTokens,
+    int silIdx,
+    const std::function<float(int)>& wordScore) {
+  return std::make_shared<FlatTrie>(
+      *buildTrie(spellings, nTokens, silIdx, wordScore));
+}
+
+/*
+ * `T` x `nTokens` Gaussian emissions. With a positive `peak`, a random token
+ * of each frame gets `peak` more, as in an acoustic model's output.
+ */
+inline std::vector<float>
+randomEmissions(int T, int nTokens, int seed, float peak = 0) {
+  std::mt19937 gen(seed);
+  std::normal_distribution<float> dist;
+  std::vector<float> emissions(T * nTokens);
+  for (auto& e : emissions) {
+    e = dist(gen);
+  }
+  if (peak > 0) {
+    std::uniform_int_distribution<int> token(0, nTokens - 1);
+    for (int t = 0; t < T; t++) {
+      emissions[t * nTokens + token(gen)] += peak;
+    }
+  }
+  return emissions;
+}
+
+} // namespace test
+} // namespace text
+} // namespace lib
+} // namespace fl
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "flashlight/lib/common/System.h"
+#include "flashlight/lib/test/text/decoder/DecoderTestUtils.h"
+#include "flashlight/lib/text/decoder/FlatTrie.h"
+#include "flashlight/lib/text/decoder/LexiconDecoder.h"
+#include "flashlight/lib/text/decoder/lm/ZeroLM.h"
+
+using namespace fl::lib;
+using namespace fl::lib::text;
+using namespace fl::lib::text::test;
+
+namespace {
+
+constexpr int kNumTokens = 30;
+
+// Random lexicon: spellings over kNumTokens tokens, with prefixes of other
+// words, homophones and nodes with many children
+std::vector<std::vector<int>> lexiconSpellings(int nWords) {
+  return randomSpellings(nWords, 0, kNumTokens - 1, 2, 7, /* unique */ false);
+}
+
+TriePtr buildLexiconTrie(const std::vector<std::vector<int>>& spellings) {
+  return buildTrie(
+      spellings, kNumTokens, 0, [](int i) { return -0.01 * (i % 17); });
+}
+
+void expectSameTrie(Trie& trie, const FlatTrie& flatTrie) {
+  EXPECT_EQ(flatTrie.getRoot()->maxScore, trie.getRoot()->maxScore);
+  // Walk both tries along every token sequence present in the flat one
+  std::vector<std::pair<const TrieNode*, const FlatTrieNode*>> stack = {
+      {trie.getRoot(), flatTrie.getRoot()}};
+  size_t nNodes = 0;
+  while (!stack.empty()) {
+    auto node = stack.back();
+    stack.pop_back();
+    ++nNodes;
+    ASSERT_EQ(node.first->children.size(), node.second->nChildren);
+    ASSERT_EQ(node.first->labels.size(), node.second->nLabels);
+    EXPECT_EQ(node.first->maxScore, node.second->maxScore);
+    for (int i = 0; i < node.second->nLabels; i++) {
+      EXPECT_EQ(node.first->labels[i], flatTrie.labels(node.second)[i]);
+      EXPECT_EQ(node.first->scores[i], flatTrie.scores(node.second)[i]);
+    }
+    for (int idx = -1; idx <= kNumTokens; idx++) {
+      auto child = node.first->children.find(idx);
+      auto flatChild = flatTrie.child(node.second, idx);
+      if (child == node.first->children.end()) {
+        EXPECT_EQ(flatChild, nullptr);
+      } else {
+        ASSERT_NE(flatChild, nullptr);
+        EXPECT_EQ(flatTrie.token(flatChild), idx);
+        stack.emplace_back(child->second.get(), flatChild);
+      }
+    }
+  }
+  EXPECT_EQ(nNodes, flatTrie.numNodes());
+}
+
+} // namespace
+
+TEST(FlatTrieTest, Flatten) {
+  auto spellings = lexiconSpellings(2000);
+  auto trie = buildLexiconTrie(spellings);
+  FlatTrie flatTrie(*trie);
+  EXPECT_FALSE(flatTrie.isMapped());
+  expectSameTrie(*trie, flatTrie);
+
+  for (const auto& spelling : spellings) {
+    auto node = flatTrie.search(spelling);
+    ASSERT_NE(node, nullptr);
+    EXPECT_EQ(node->maxScore, trie->search(spelling)->maxScore);
+  }
+  EXPECT_EQ(flatTrie.search({kNumTokens}), nullptr);
+}
+
+TEST(FlatTrieTest, SaveAndMap) {
+  auto trie = buildLexiconTrie(lexiconSpellings(500));
+  const std::string path = getTmpPath("flattrie.bin");
+  FlatTrie(*trie, 42).save(path);
+
+  FlatTrie mapped(path);
+  EXPECT_TRUE(mapped.isMapped());
+  EXPECT_EQ(mapped.fingerprint(), 42);
+  expectSameTrie(*trie, mapped);
+
+  // Saving another trie in its place leaves the mapped one untouched
+  auto otherTrie = buildLexiconTrie(lexiconSpellings(50));
+  FlatTrie(*otherTrie, 7).save(path);
+  expectSameTrie(*trie, mapped);
+  FlatTrie otherMapped(path);
+  EXPECT_EQ(otherMapped.fingerprint(), 7);
+  expectSameTrie(*otherTrie, otherMapped);
+
+  // Truncated files are rejected
+  {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << "FLTRIE02";
+  }
+  EXPECT_THROW(FlatTrie{path}, std::runtime_error);
+  std::remove(path.c_str());
+  EXPECT_THROW(FlatTrie{path}, std::runtime_error);
+}
+
+TEST(FlatTrieTest, LexiconDecoder) {
+  auto spellings = lexiconSpellings(200);
+  auto trie = buildLexiconTrie(spellings);
+  const std::string path = getTmpPath("flattrie_decoder.bin");
+  FlatTrie(*trie).save(path);
+
+  int T = 40;
+  auto emissions = randomEmissions(T, kNumTokens, 1);
+  LexiconDecoderOptions opt{.beamSize = 20,
+                            .beamSizeToken = kNumTokens,
+                            .beamThreshold = 100,
+                            .lmWeight = 1,
+                            .wordScore = 0,
+                            .unkScore = -INFINITY,
+                            .silScore = 0,
+                            .logAdd = false,
+                            .criterionType = CriterionType::CTC};
+  auto lm = std::make_shared<ZeroLM>();
+  LexiconDecoder fromTrie(opt, trie, lm, 0, kNumTokens - 1, -1, {}, false);
+  LexiconDecoder fromFile(
+      opt,
+      std::make_shared<FlatTrie>(path),
+      lm,
+      0,
+      kNumTokens - 1,
+      -1,
+      {},
+      false);
+  auto expected = fromTrie.decode(emissions.data(), T, kNumTokens);
+  auto results = fromFile.decode(emissions.data(), T, kNumTokens);
+  ASSERT_FALSE(expected.empty());
+  ASSERT_EQ(results.size(), expected.size());
+  for (int i = 0; i < results.size(); i++) {
+    EXPECT_EQ(results[i].score, expected[i].score);
+    EXPECT_EQ(results[i].words, expected[i].words);
+    EXPECT_EQ(results[i].tokens, expected[i].tokens);
+  }
+  std::remove(path.c_str());
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "flashlight/lib/text/decoder/lm/LM.h"
+#include "flashlight/lib/text/decoder/lm/LMStateArena.h"
+#include "flashlight/lib/text/decoder/lm/MemoizedLM.h"
+#include "flashlight/lib/text/decoder/lm/ZeroLM.h"
+
+using namespace fl::lib::text;
+
+namespace {
+
+// Scores token i with -i and counts the queries
+class CountingLM : public ZeroLM {
+ public:
+  int nScores = 0, nFinishes = 0;
+  std::vector<LMStatePtr> cachedStates;
+
+  std::pair<LMStatePtr, float> score(
+      const LMStatePtr& state,
+      const int usrTokenIdx) override {
+    ++nScores;
+    return {ZeroLM::score(state, usrTokenIdx).first, -usrTokenIdx};
+  }
+
+  std::pair<LMStatePtr, float> finish(const LMStatePtr& state) override {
+    ++nFinishes;
+    return {state, -100};
+  }
+
+  void updateCache(std::vector<LMStatePtr> states) override {
+    cachedStates.insert(cachedStates.end(), states.begin(), states.end());
+  }
+};
+
+// Returns a new state for every query, scoring token i with -i
+class FreshStateLM : public CountingLM {
+ public:
+  std::pair<LMStatePtr, float> score(
+      const LMStatePtr& state,
+      const int usrTokenIdx) override {
+    ++nScores;
+    return {std::make_shared<LMState>(), -usrTokenIdx};
+  }
+
+  std::pair<LMStatePtr, float> finish(const LMStatePtr& state) override {
+    ++nFinishes;
+    return {std::make_shared<LMState>(), -100};
+  }
+};
+
+} // namespace
+
+TEST(LMStateTest, ArenaRecyclesBlocks) {
+  auto arena = LMStateArena::create(4096);
+  void* a = arena->allocate(40);
+  void* b = arena->allocate(48);
+  EXPECT_NE(a, b);
+  EXPECT_EQ(arena->numLiveBlocks(), 2);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(a) % alignof(std::max_align_t), 0);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % alignof(std::max_align_t), 0);
+
+  // Same size class is recycled, LIFO
+  arena->deallocate(a, 40);
+  EXPECT_EQ(arena->allocate(33), a);
+
+  // Large blocks go to the global allocator
+  void* large = arena->allocate(1 << 12);
+  EXPECT_EQ(arena->numLiveBlocks(), 3);
+  arena->deallocate(large, 1 << 12);
+  EXPECT_EQ(arena->numLiveBlocks(), 2);
+
+  // New chunks are allocated on demand
+  std::vector<void*> blocks;
+  for (int i = 0; i < 1000; i++) {
+    blocks.push_back(arena->allocate(64));
+  }
+  EXPECT_GT(arena->capacity(), 4096);
+  arena->reset(); // blocks in use: no-op
+  EXPECT_EQ(arena->numLiveBlocks(), 1002);
+
+  for (auto block : blocks) {
+    arena->deallocate(block, 64);
+  }
+  arena->deallocate(a, 40);
+  arena->deallocate(b, 48);
+  EXPECT_EQ(arena->numLiveBlocks(), 0);
+}
+
+TEST(LMStateTest, LargeBlocksKeepArenaAlive) {
+  // The table of 100 children is above the largest size class
+  LMStateChildren children;
+  LMStateArena* rawArena;
+  {
+    auto arena = LMStateArena::create();
+    rawArena = arena.get();
+    void* small = rawArena->allocate(40);
+    for (int i = 0; i < 100; i++) {
+      children.insert(i, rawArena) = std::make_shared<LMState>();
+    }
+    EXPECT_EQ(rawArena->numLiveBlocks(), 2);
+    rawArena->deallocate(small, 40);
+  }
+  // No reference left, but the arena is kept alive by the children table
+  EXPECT_EQ(rawArena->numLiveBlocks(), 1);
+  EXPECT_EQ(children.size(), 100);
+}
+
+TEST(LMStateTest, ArenaRewind) {
+  auto arena = LMStateArena::create(4096);
+  std::vector<void*> blocks;
+  for (int i = 0; i < 200; i++) {
+    blocks.push_back(arena->allocate(96));
+  }
+  size_t capacity = arena->capacity();
+  for (auto block : blocks) {
+    arena->deallocate(block, 96);
+  }
+  arena->reset();
+  EXPECT_EQ(arena->allocate(96), blocks.front());
+  for (int i = 1; i < 200; i++) {
+    blocks[i] = arena->allocate(96);
+  }
+  EXPECT_EQ(arena->capacity(), capacity);
+  for (auto block : blocks) {
+    arena->deallocate(block, 96);
+  }
+}
+
+TEST(LMStateTest, Children) {
+  auto root = LMState::create<LMState>(LMStateArena::create());
+  std::vector<LMStatePtr> children;
+  for (int i = -1; i < 100; i++) {
+    children.push_back(root->child<LMState>(i * 7));
+  }
+  EXPECT_EQ(root->children.size(), 101);
+  for (int i = -1; i < 100; i++) {
+    EXPECT_EQ(root->child<LMState>(i * 7), children[i + 1]);
+    ASSERT_NE(root->children.find(i * 7), nullptr);
+  }
+  EXPECT_EQ(root->children.find(1), nullptr);
+
+  int nChildren = 0;
+  root->children.forEach([&](int usrIdx, const LMStatePtr& child) {
+    EXPECT_EQ(child, children[usrIdx / 7 + 1]);
+    ++nChildren;
+  });
+  EXPECT_EQ(nChildren, 101);
+}
+
+TEST(LMStateTest, StatesOutliveArenaOwner) {
+  LMStatePtr leaf;
+  LMStateArena* rawArena;
+  {
+    auto arena = LMStateArena::create();
+    rawArena = arena.get();
+    ZeroLM lm;
+    auto root = lm.start(false);
+    root->arena = arena;
+    leaf = lm.score(lm.score(root, 3).first, 5).first;
+    EXPECT_EQ(leaf->arena.get(), rawArena);
+    EXPECT_GT(rawArena->numLiveBlocks(), 0);
+  }
+  // The arena is kept alive by the remaining state
+  auto next = leaf->child<LMState>(2);
+  EXPECT_EQ(next->arena.get(), rawArena);
+  EXPECT_EQ(leaf->child<LMState>(2), next);
+}
+
+TEST(LMStateTest, NoArena) {
+  ZeroLM lm;
+  auto root = lm.start(false);
+  auto child = lm.score(root, 1).first;
+  EXPECT_FALSE(child->arena);
+  EXPECT_EQ(lm.score(root, 1).first, child);
+  EXPECT_EQ(root->compare(child), root.get() < child.get() ? -1 : 1);
+}
+
+TEST(LMStateTest, MemoizedLM) {
+  auto lm = std::make_shared<CountingLM>();
+  MemoizedLM memoLm(lm);
+  for (int pass = 0; pass < 3; pass++) {
+    auto root = memoLm.start(false);
+    auto a = memoLm.score(root, 3);
+    auto b = memoLm.score(a.first, 5);
+    EXPECT_EQ(a.second, -3);
+    EXPECT_EQ(b.second, -5);
+    EXPECT_EQ(memoLm.score(root, 3).first, a.first);
+    EXPECT_EQ(memoLm.finish(b.first).second, -100);
+    memoLm.updateCache({a.first, b.first});
+  }
+  // The second query of (root, 3) tells that the LM shares states
+  EXPECT_EQ(lm->nScores, 3);
+  EXPECT_EQ(lm->nFinishes, 1);
+  EXPECT_EQ(lm->cachedStates.size(), 2);
+  EXPECT_EQ(memoLm.numLmQueries(), 4);
+
+  // Cleared for the next utterance
+  auto root = memoLm.start(false);
+  memoLm.clear();
+  EXPECT_NE(memoLm.start(false), root);
+  EXPECT_EQ(memoLm.score(memoLm.start(false), 3).second, -3);
+  EXPECT_EQ(lm->nScores, 4);
+  EXPECT_EQ(memoLm.numLmQueries(), 1);
+}
+
+TEST(LMStateTest, MemoizedLMKeepsStateIdentity) {
+  // As ConvLM, the LM returns a new state for every query
+  auto lm = std::make_shared<FreshStateLM>();
+  MemoizedLM memoLm(lm);
+  std::vector<LMStatePtr> firstPass;
+  for (int pass = 0; pass < 3; pass++) {
+    auto root = memoLm.start(false);
+    auto a = memoLm.score(root, 3);
+    auto b = memoLm.score(root, 3);
+    auto c = memoLm.finish(a.first);
+    auto d = memoLm.finish(a.first);
+    EXPECT_EQ(a.second, -3);
+    EXPECT_EQ(b.second, -3);
+    // States the decoder would not merge without the memo stay apart
+    EXPECT_NE(a.first, b.first);
+    EXPECT_NE(c.first, d.first);
+    // The same states are replayed in the next passes
+    std::vector<LMStatePtr> states = {a.first, b.first, c.first, d.first};
+    if (pass == 0) {
+      firstPass = states;
+    }
+    EXPECT_EQ(states, firstPass);
+  }
+  EXPECT_EQ(lm->nScores, 2);
+  EXPECT_EQ(lm->nFinishes, 2);
+  EXPECT_EQ(memoLm.numLmQueries(), 4);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
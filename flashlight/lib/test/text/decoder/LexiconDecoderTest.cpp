@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <cmath>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "flashlight/lib/test/text/decoder/DecoderTestUtils.h"
+#include "flashlight/lib/text/decoder/LexiconDecoder.h"
+#include "flashlight/lib/text/decoder/lm/ZeroLM.h"
+
+using namespace fl::lib::text;
+using namespace fl::lib::text::test;
+
+namespace {
+
+constexpr int kNumTokens = 30;
+constexpr int kSil = 0;
+constexpr int kBlank = kNumTokens - 1;
+
+LexiconDecoder buildDecoder(const FlatTriePtr& lexicon) {
+  return LexiconDecoder(
+      {.beamSize = 20,
+       .beamSizeToken = 10,
+       .beamThreshold = 20,
+       .lmWeight = 0,
+       .wordScore = 1,
+       .unkScore = -INFINITY,
+       .silScore = 0,
+       .logAdd = false,
+       .criterionType = CriterionType::CTC},
+      lexicon,
+      std::make_shared<ZeroLM>(),
+      kSil,
+      kBlank,
+      -1,
+      {},
+      false);
+}
+
+// Decodes in chunks, committing after each one, and returns the words and
+// tokens of the best path
+std::pair<std::vector<int>, std::vector<int>> decodeStreaming(
+    LexiconDecoder& decoder,
+    const std::vector<float>& emissions,
+    int chunkSize,
+    int maxUncommittedFrames,
+    int& maxBufferedFrames) {
+  std::vector<int> words, tokens;
+  auto append = [&](const DecodeResult& result, int start) {
+    words.insert(words.end(), result.words.begin() + start, result.words.end());
+    tokens.insert(
+        tokens.end(), result.tokens.begin() + start, result.tokens.end());
+  };
+  int T = emissions.size() / kNumTokens;
+  maxBufferedFrames = 0;
+  decoder.decodeBegin();
+  for (int t = 0; t < T; t += chunkSize) {
+    decoder.decodeStep(
+        emissions.data() + t * kNumTokens,
+        std::min(chunkSize, T - t),
+        kNumTokens);
+    append(decoder.commit(maxUncommittedFrames), 0);
+    maxBufferedFrames =
+        std::max(maxBufferedFrames, decoder.nDecodedFramesInBuffer());
+  }
+  decoder.decodeEnd();
+  append(decoder.getBestHypothesis(), 1);
+  return {words, tokens};
+}
+
+} // namespace
+
+TEST(LexiconDecoderTest, StreamingCommit) {
+  auto lexicon = buildLexicon(
+      randomSpellings(300, 1, kNumTokens - 2, 1, 5, /* unique */ true),
+      kNumTokens,
+      kSil,
+      [](int i) { return -0.01 * (i % 11); });
+  const int T = 600;
+  auto emissions = randomEmissions(T, kNumTokens, 1, /* peak */ 4);
+
+  auto offlineDecoder = buildDecoder(lexicon);
+  offlineDecoder.decodeBegin();
+  offlineDecoder.decodeStep(emissions.data(), T, kNumTokens);
+  offlineDecoder.decodeEnd();
+  auto expected = offlineDecoder.getBestHypothesis();
+  // Drop the initial frame
+  std::vector<int> expectedWords(
+      expected.words.begin() + 1, expected.words.end());
+  std::vector<int> expectedTokens(
+      expected.tokens.begin() + 1, expected.tokens.end());
+
+  // Committing the shared prefix does not change the result
+  auto decoder = buildDecoder(lexicon);
+  int maxBufferedFrames;
+  auto streamed =
+      decodeStreaming(decoder, emissions, 25, -1, maxBufferedFrames);
+  EXPECT_EQ(streamed.first, expectedWords);
+  EXPECT_EQ(streamed.second, expectedTokens);
+  EXPECT_LT(maxBufferedFrames, T);
+
+  // The beam is bounded if forced to commit, and the decoder can be reused
+  streamed = decodeStreaming(decoder, emissions, 25, 10, maxBufferedFrames);
+  EXPECT_LE(maxBufferedFrames, 10 + 1);
+  EXPECT_EQ(streamed.first.size(), T + 1);
+  EXPECT_EQ(streamed.second.size(), T + 1);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/**
+ * Measures the per-chunk latency and the memory of LexiconDecoder decoding
+ * long synthetic emissions chunk by chunk, without committing (the beam keeps
+ * every frame), committing the shared prefix after each chunk, and
+ * committing with a bounded number of uncommitted frames.
+ */
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "flashlight/lib/test/text/decoder/DecoderTestUtils.h"
+#include "flashlight/lib/text/decoder/LexiconDecoder.h"
+#include "flashlight/lib/text/decoder/lm/ZeroLM.h"
+
+using namespace fl::lib::text;
+using namespace fl::lib::text::test;
+
+namespace {
+
+constexpr int kNumTokens = 30;
+constexpr int kSil = 0;
+constexpr int kBlank = kNumTokens - 1;
+constexpr int kChunkSize = 20;
+// No commit
+constexpr int kNoCommit = -2;
+
+long maxRssKb() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+void benchmark(
+    const FlatTriePtr& lexicon,
+    const std::vector<float>& emissions,
+    int maxUncommittedFrames) {
+  LexiconDecoder decoder(
+      {.beamSize = 100,
+       .beamSizeToken = 10,
+       .beamThreshold = 25,
+       .lmWeight = 0,
+       .wordScore = 0,
+       .unkScore = -INFINITY,
+       .silScore = 0,
+       .logAdd = false,
+       .criterionType = CriterionType::CTC},
+      lexicon,
+      std::make_shared<ZeroLM>(),
+      kSil,
+      kBlank,
+      -1,
+      {},
+      false);
+
+  int T = emissions.size() / kNumTokens;
+  std::vector<double> latencies;
+  int maxBufferedFrames = 0;
+  decoder.decodeBegin();
+  for (int t = 0; t < T; t += kChunkSize) {
+    auto start = std::chrono::steady_clock::now();
+    decoder.decodeStep(
+        emissions.data() + t * kNumTokens,
+        std::min(kChunkSize, T - t),
+        kNumTokens);
+    if (maxUncommittedFrames != kNoCommit) {
+      decoder.commit(maxUncommittedFrames);
+    }
+    latencies.push_back(std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - start)
+                            .count());
+    maxBufferedFrames =
+        std::max(maxBufferedFrames, decoder.nDecodedFramesInBuffer());
+  }
+  decoder.decodeEnd();
+
+  std::sort(latencies.begin(), latencies.end());
+  double mean = 0;
+  for (auto l : latencies) {
+    mean += l / latencies.size();
+  }
+  std::string mode = maxUncommittedFrames == kNoCommit
+      ? "no commit"
+      : (maxUncommittedFrames < 0
+             ? "commit"
+             : "commit <= " + std::to_string(maxUncommittedFrames));
+  std::cout << std::setw(16) << mode << std::setw(12) << std::fixed
+            << std::setprecision(3) << mean << std::setw(12)
+            << latencies[latencies.size() * 99 / 100] << std::setw(12)
+            << latencies.back() << std::setw(16) << maxBufferedFrames
+            << std::setw(16) << maxRssKb() << std::endl;
+}
+
+} // namespace
+
+int main() {
+  auto lexicon = buildLexicon(
+      randomSpellings(10000, 1, kNumTokens - 2, 2, 8, /* unique */ true),
+      kNumTokens,
+      kSil,
+      [](int /* unused */) { return 0; });
+  // 5 minutes at 10ms per frame
+  auto emissions = randomEmissions(30000, kNumTokens, 1, /* peak */ 4);
+
+  std::cout << "chunks of " << kChunkSize << " frames, latencies in ms"
+            << std::endl;
+  std::cout << std::setw(16) << "mode" << std::setw(12) << "mean"
+            << std::setw(12) << "p99" << std::setw(12) << "max"
+            << std::setw(16) << "max frames" << std::setw(16)
+            << "max rss (KB)" << std::endl;
+  // Bounded runs first: the resident set size only grows
+  benchmark(lexicon, emissions, 100);
+  benchmark(lexicon, emissions, -1);
+  benchmark(lexicon, emissions, kNoCommit);
+  return 0;
+}
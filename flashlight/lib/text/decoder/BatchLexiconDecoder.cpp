@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "flashlight/lib/text/decoder/BatchLexiconDecoder.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace fl {
+namespace lib {
+namespace text {
+
+BatchLexiconDecoder::BatchLexiconDecoder(
+    LexiconDecoderOptions opt,
+    const FlatTriePtr& lexicon,
+    const LMPtr& lm,
+    const int sil,
+    const int blank,
+    const int unk,
+    const std::vector<float>& transitions,
+    const bool isLmToken)
+    : opt_(std::move(opt)),
+      lexicon_(lexicon),
+      lm_(lm),
+      sil_(sil),
+      blank_(blank),
+      unk_(unk),
+      transitions_(transitions),
+      isLmToken_(isLmToken) {}
+
+std::vector<std::vector<DecodeResult>> BatchLexiconDecoder::decode(
+    const std::vector<const float*>& emissions,
+    const std::vector<int>& T,
+    int N) {
+  if (emissions.size() != T.size()) {
+    throw std::invalid_argument(
+        "[BatchLexiconDecoder] emissions and lengths size mismatch");
+  }
+  const int batchSize = emissions.size();
+  while (decoders_.size() < batchSize) {
+    decoders_.push_back(std::make_unique<LexiconDecoder>(
+        opt_, lexicon_, lm_, sil_, blank_, unk_, transitions_, isLmToken_));
+  }
+
+  int maxT = 0;
+  for (int b = 0; b < batchSize; b++) {
+    decoders_[b]->decodeBegin();
+    maxT = std::max(maxT, T[b]);
+  }
+
+  for (int t = 0; t < maxT; t++) {
+    lmStates_.clear();
+    for (int b = 0; b < batchSize; b++) {
+      if (t >= T[b]) {
+        continue;
+      }
+      LexiconDecoder& decoder = *decoders_[b];
+      decoder.decodeFrame(emissions[b] + t * N, N);
+      for (const auto& hyp :
+           decoder.hyp_[decoder.nDecodedFrames_ - decoder.nPrunedFrames_]) {
+        lmStates_.push_back(hyp.lmState);
+      }
+    }
+    lm_->updateCache(lmStates_);
+  }
+  lmStates_.clear();
+
+  std::vector<std::vector<DecodeResult>> results(batchSize);
+  for (int b = 0; b < batchSize; b++) {
+    decoders_[b]->decodeEnd();
+    results[b] = decoders_[b]->getAllFinalHypothesis();
+  }
+  return results;
+}
+} // namespace text
+} // namespace lib
+} // namespace fl
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "flashlight/lib/text/decoder/LexiconDecoder.h"
+
+namespace fl {
+namespace lib {
+namespace text {
+
+/**
+ * BatchLexiconDecoder decodes several utterances at once: the beams of one
+ * LexiconDecoder per utterance are advanced in lockstep, frame by frame.
+ *
+ * The LM is shared by all the utterances and its cache is updated once per
+ * frame with the new hypothesis of the whole batch, so that an LM scoring
+ * states in batches (e.g. ConvLM) runs a single forward pass per frame. Such
+ * an LM should be able to cache `beamSize` states per utterance in the batch.
+ * Not thread-safe: use one BatchLexiconDecoder (and LM) per thread.
+ */
+class BatchLexiconDecoder {
+ public:
+  BatchLexiconDecoder(
+      LexiconDecoderOptions opt,
+      const FlatTriePtr& lexicon,
+      const LMPtr& lm,
+      const int sil,
+      const int blank,
+      const int unk,
+      const std::vector<float>& transitions,
+      const bool isLmToken);
+
+  /**
+   * Decode `emissions.size()` utterances, the b-th one with `T[b]` x `N`
+   * emissions. Returns all the final hypothesis of each utterance.
+   */
+  std::vector<std::vector<DecodeResult>> decode(
+      const std::vector<const float*>& emissions,
+      const std::vector<int>& T,
+      int N);
+
+ private:
+  LexiconDecoderOptions opt_;
+  FlatTriePtr lexicon_;
+  LMPtr lm_;
+  int sil_;
+  int blank_;
+  int unk_;
+  std::vector<float> transitions_;
+  bool isLmToken_;
+
+  // One decoder per utterance of the batch, reused across calls
+  std::vector<std::unique_ptr<LexiconDecoder>> decoders_;
+
+  // LM states of the new hypothesis of the batch, to update the LM cache
+  std::vector<LMStatePtr> lmStates_;
+};
+} // namespace text
+} // namespace lib
+} // namespace fl
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "flashlight/lib/text/decoder/BatchSeq2SeqDecoder.h"
+
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+
+namespace fl {
+namespace lib {
+namespace text {
+
+BatchSeq2SeqDecoder::BatchSeq2SeqDecoder(
+    std::vector<Seq2SeqDecoderPtr> decoders,
+    BatchAMUpdateFunc amUpdateFunc)
+    : decoders_(std::move(decoders)), amUpdateFunc_(std::move(amUpdateFunc)) {
+  if (decoders_.empty()) {
+    throw std::invalid_argument("[BatchSeq2SeqDecoder] no decoder");
+  }
+  lm_ = decoders_.front()->lm_;
+  for (const auto& decoder : decoders_) {
+    if (!decoder || decoder->lm_ != lm_) {
+      throw std::invalid_argument(
+          "[BatchSeq2SeqDecoder] decoders should share the same LM");
+    }
+  }
+}
+
+std::vector<std::vector<DecodeResult>> BatchSeq2SeqDecoder::decode(
+    const std::vector<const float*>& emissions,
+    const std::vector<int>& T,
+    int N) {
+  if (emissions.size() != T.size()) {
+    throw std::invalid_argument(
+        "[BatchSeq2SeqDecoder] emissions and lengths size mismatch");
+  }
+  if (emissions.size() > decoders_.size()) {
+    throw std::invalid_argument(
+        "[BatchSeq2SeqDecoder] more utterances than decoders");
+  }
+  const int batchSize = emissions.size();
+  for (int b = 0; b < batchSize; b++) {
+    decoders_[b]->searchBegin();
+  }
+
+  std::vector<std::vector<float>> amScores;
+  std::vector<AMStatePtr> outStates;
+  // Step at which the search of each utterance stopped, -1 while running
+  std::vector<int> lastStep(batchSize, -1);
+  for (int t = 0;; t++) {
+    rawY_.clear();
+    rawPrevStates_.clear();
+    nHyps_.assign(batchSize, 0);
+    for (int b = 0; b < batchSize; b++) {
+      Seq2SeqDecoder& decoder = *decoders_[b];
+      if (lastStep[b] >= 0) {
+        continue;
+      }
+      if (t >= decoder.maxOutputLength_ || !decoder.gatherAmInputs(t)) {
+        lastStep[b] = t;
+        continue;
+      }
+      nHyps_[b] = decoder.rawY_.size();
+      rawY_.insert(rawY_.end(), decoder.rawY_.begin(), decoder.rawY_.end());
+      rawPrevStates_.insert(
+          rawPrevStates_.end(),
+          decoder.rawPrevStates_.begin(),
+          decoder.rawPrevStates_.end());
+    }
+    if (rawY_.empty()) {
+      break;
+    }
+
+    std::tie(amScores, outStates) =
+        amUpdateFunc_(emissions, N, T, rawY_, rawPrevStates_, nHyps_, t);
+    if (amScores.size() != rawY_.size() || outStates.size() != rawY_.size()) {
+      throw std::runtime_error(
+          "[BatchSeq2SeqDecoder] AM update returned " +
+          std::to_string(amScores.size()) + " scores and " +
+          std::to_string(outStates.size()) + " states for " +
+          std::to_string(rawY_.size()) + " hypothesis");
+    }
+
+    lmStates_.clear();
+    size_t offset = 0;
+    for (int b = 0; b < batchSize; b++) {
+      if (nHyps_[b] > 0) {
+        decoders_[b]->expandHypothesis(
+            t, amScores, outStates, offset, lmStates_);
+        offset += nHyps_[b];
+      }
+    }
+    lm_->updateCache(lmStates_);
+  }
+  rawPrevStates_.clear();
+  lmStates_.clear();
+
+  std::vector<std::vector<DecodeResult>> results(batchSize);
+  for (int b = 0; b < batchSize; b++) {
+    decoders_[b]->searchEnd(lastStep[b]);
+    results[b] = decoders_[b]->getAllFinalHypothesis();
+  }
+  return results;
+}
+} // namespace text
+} // namespace lib
+} // namespace fl
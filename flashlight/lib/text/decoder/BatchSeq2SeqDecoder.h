@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "flashlight/lib/text/decoder/Seq2SeqDecoder.h"
+
+namespace fl {
+namespace lib {
+namespace text {
+
+/**
+ * AM update for the hypothesis of several utterances, which are grouped by
+ * utterance: the first `nHyps[0]` entries of `rawY` and `rawPrevStates`
+ * belong to the first utterance, the next `nHyps[1]` ones to the second, and
+ * so on. Utterances whose search is over have no hypothesis. Returns the
+ * scores and the new AM state of each hypothesis, in the same order.
+ */
+using BatchAMUpdateFunc = std::function<
+    std::pair<std::vector<std::vector<float>>, std::vector<AMStatePtr>>(
+        const std::vector<const float*>& /* emissions */,
+        const int /* N */,
+        const std::vector<int>& /* T */,
+        const std::vector<int>& /* rawY */,
+        const std::vector<AMStatePtr>& /* rawPrevStates */,
+        const std::vector<int>& /* nHyps */,
+        int& /* step */)>;
+
+/**
+ * BatchSeq2SeqDecoder decodes several utterances at once with
+ * sequence-to-sequence decoders advanced in lockstep. At each step, the
+ * unfinished hypothesis of all the utterances are forwarded through the AM
+ * with a single `BatchAMUpdateFunc` call, so that the AM runs on batches of
+ * `batch size x beam size` hypothesis rather than one beam at a time, and
+ * the LM cache is updated once for the whole batch.
+ *
+ * Each decoder decodes one utterance of the batch, and they should all
+ * share the same LM. Not thread-safe: use one BatchSeq2SeqDecoder per thread.
+ */
+class BatchSeq2SeqDecoder {
+ public:
+  BatchSeq2SeqDecoder(
+      std::vector<Seq2SeqDecoderPtr> decoders,
+      BatchAMUpdateFunc amUpdateFunc);
+
+  /**
+   * Decode `emissions.size()` utterances (at most the number of decoders),
+   * the b-th one with `T[b]` x `N` emissions. Returns all the final
+   * hypothesis of each utterance.
+   */
+  std::vector<std::vector<DecodeResult>> decode(
+      const std::vector<const float*>& emissions,
+      const std::vector<int>& T,
+      int N);
+
+ private:
+  std::vector<Seq2SeqDecoderPtr> decoders_;
+  BatchAMUpdateFunc amUpdateFunc_;
+  LMPtr lm_;
+
+  // AM inputs of the whole batch for a step
+  std::vector<int> rawY_;
+  std::vector<AMStatePtr> rawPrevStates_;
+  std::vector<int> nHyps_;
+  // LM states of the new hypothesis of the batch, to update the LM cache
+  std::vector<LMStatePtr> lmStates_;
+};
+} // namespace text
+} // namespace lib
+} // namespace fl
@@ -71,6 +71,22 @@ class Decoder {
 
   /* Get all the final hypothesis */
   virtual std::vector<DecodeResult> getAllFinalHypothesis() const = 0;
+
+ protected:
+  /* Pool for the LM states of the hypothesis, rewound for each utterance */
+  LMStateArenaPtr lmStateArena_{LMStateArena::create()};
+
+  /**
+   * Start `lm` for a new utterance: LM states expanded from the returned one
+   * are allocated from the decoder arena. Previous hypothesis should be
+   * released beforehand so that the arena can be rewound.
+   */
+  LMStatePtr startLm(LM& lm) {
+    lmStateArena_->reset();
+    auto lmState = lm.start(0);
+    lmState->arena = lmStateArena_;
+    return lmState;
+  }
 };
 } // namespace text
 } // namespace lib
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "flashlight/lib/text/decoder/FlatTrie.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace fl {
+namespace lib {
+namespace text {
+
+namespace {
+
+constexpr char kFlatTrieMagic[8] = {'F', 'L', 'T', 'R', 'I', 'E', '0', '2'};
+
+// File layout: header, nodes, tokens, labels, scores
+struct FlatTrieHeader {
+  char magic[8];
+  uint64_t fingerprint;
+  uint64_t numNodes;
+  uint64_t numLabels;
+};
+
+size_t serializedSize(size_t numNodes, size_t numLabels) {
+  return sizeof(FlatTrieHeader) +
+      numNodes * (sizeof(FlatTrieNode) + sizeof(int32_t)) +
+      numLabels * (sizeof(int32_t) + sizeof(float));
+}
+
+} // namespace
+
+FlatTrie::FlatTrie(const Trie& trie, uint64_t fingerprint) {
+  // Breadth-first order: children of a node are contiguous
+  std::vector<const TrieNode*> order = {trie.getRoot()};
+  std::vector<std::pair<int, const TrieNode*>> children;
+  for (size_t i = 0; i < order.size(); i++) {
+    children.clear();
+    for (const auto& child : order[i]->children) {
+      children.emplace_back(child.first, child.second.get());
+    }
+    std::sort(children.begin(), children.end());
+    for (const auto& child : children) {
+      order.push_back(child.second);
+    }
+    numLabels_ += order[i]->labels.size();
+  }
+  numNodes_ = order.size();
+  if (numNodes_ > std::numeric_limits<uint32_t>::max() ||
+      numLabels_ > std::numeric_limits<uint32_t>::max()) {
+    throw std::invalid_argument("[FlatTrie] Trie is too large");
+  }
+
+  size_t size = serializedSize(numNodes_, numLabels_);
+  buffer_.resize((size + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+  char* data = reinterpret_cast<char*>(buffer_.data());
+  FlatTrieHeader header;
+  std::memcpy(header.magic, kFlatTrieMagic, sizeof(kFlatTrieMagic));
+  header.fingerprint = fingerprint;
+  header.numNodes = numNodes_;
+  header.numLabels = numLabels_;
+  std::memcpy(data, &header, sizeof(header));
+
+  auto* nodes = reinterpret_cast<FlatTrieNode*>(data + sizeof(header));
+  auto* tokens = reinterpret_cast<int32_t*>(nodes + numNodes_);
+  auto* labels = tokens + numNodes_;
+  auto* scores = reinterpret_cast<float*>(labels + numLabels_);
+  uint32_t nextChild = 1, nextLabel = 0;
+  for (size_t i = 0; i < numNodes_; i++) {
+    const TrieNode* node = order[i];
+    nodes[i].childBegin = nextChild;
+    nodes[i].nChildren = node->children.size();
+    nodes[i].labelBegin = nextLabel;
+    nodes[i].nLabels = node->labels.size();
+    nodes[i].maxScore = node->maxScore;
+    tokens[i] = node->idx;
+    std::copy(node->labels.begin(), node->labels.end(), labels + nextLabel);
+    std::copy(node->scores.begin(), node->scores.end(), scores + nextLabel);
+    nextChild += node->children.size();
+    nextLabel += node->labels.size();
+  }
+  setView(data, size, "trie");
+}
+
+FlatTrie::FlatTrie(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("[FlatTrie] could not open file " + path);
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    throw std::runtime_error("[FlatTrie] could not stat file " + path);
+  }
+  mappedSize_ = st.st_size;
+  void* ptr = mappedSize_ > 0
+      ? mmap(nullptr, mappedSize_, PROT_READ, MAP_SHARED, fd, 0)
+      : MAP_FAILED;
+  // The mapping stays valid after the descriptor is closed
+  close(fd);
+  if (ptr == MAP_FAILED) {
+    throw std::runtime_error("[FlatTrie] could not mmap file " + path);
+  }
+  mapped_ = ptr;
+  try {
+    setView(static_cast<const char*>(mapped_), mappedSize_, path);
+  } catch (...) {
+    munmap(mapped_, mappedSize_);
+    throw;
+  }
+}
+
+FlatTrie::~FlatTrie() {
+  if (mapped_) {
+    munmap(mapped_, mappedSize_);
+  }
+}
+
+void FlatTrie::setView(
+    const char* data,
+    size_t size,
+    const std::string& source) {
+  FlatTrieHeader header;
+  if (size < sizeof(header)) {
+    throw std::runtime_error("[FlatTrie] invalid trie in " + source);
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, kFlatTrieMagic, sizeof(kFlatTrieMagic)) != 0 ||
+      header.numNodes == 0 ||
+      size != serializedSize(header.numNodes, header.numLabels)) {
+    throw std::runtime_error("[FlatTrie] invalid trie in " + source);
+  }
+  fingerprint_ = header.fingerprint;
+  numNodes_ = header.numNodes;
+  numLabels_ = header.numLabels;
+  nodes_ = reinterpret_cast<const FlatTrieNode*>(data + sizeof(header));
+  tokens_ = reinterpret_cast<const int32_t*>(nodes_ + numNodes_);
+  labels_ = tokens_ + numNodes_;
+  scores_ = reinterpret_cast<const float*>(labels_ + numLabels_);
+}
+
+void FlatTrie::save(const std::string& path) const {
+  // Truncating a file which is mapped elsewhere would invalidate the mapping:
+  // write a new file and move it in place instead
+  const std::string tmpPath = path + ".tmp";
+  {
+    std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+      throw std::runtime_error("[FlatTrie] could not open file " + tmpPath);
+    }
+    const char* data =
+        reinterpret_cast<const char*>(nodes_) - sizeof(FlatTrieHeader);
+    file.write(data, serializedSize(numNodes_, numLabels_));
+    if (!file.good()) {
+      throw std::runtime_error("[FlatTrie] could not write file " + tmpPath);
+    }
+  }
+  if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+    std::remove(tmpPath.c_str());
+    throw std::runtime_error("[FlatTrie] could not write file " + path);
+  }
+}
+
+const FlatTrieNode* FlatTrie::search(const std::vector<int>& indices) const {
+  const FlatTrieNode* node = getRoot();
+  for (auto idx : indices) {
+    node = child(node, idx);
+    if (!node) {
+      return nullptr;
+    }
+  }
+  return node;
+}
+} // namespace text
+} // namespace lib
+} // namespace fl
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "flashlight/lib/text/decoder/Trie.h"
+
+namespace fl {
+namespace lib {
+namespace text {
+
+/**
+ * FlatTrieNode is a node of FlatTrie. Its children and its labels are
+ * contiguous ranges of the trie arrays.
+ */
+struct FlatTrieNode {
+  // Children are nodes [childBegin, childBegin + nChildren)
+  uint32_t childBegin;
+  uint32_t nChildren;
+  // Labels and scores are [labelBegin, labelBegin + nLabels)
+  uint32_t labelBegin;
+  uint32_t nLabels;
+  // Maximum score of all the labels (after smearing)
+  float maxScore;
+};
+
+/**
+ * FlatTrie is a read-only, cache-friendly layout of a (smeared) Trie used by
+ * the lexicon decoders. Nodes are stored in breadth-first order so that the
+ * children of a node are contiguous, sorted by token index and found with a
+ * binary search; word labels and scores are packed in flat arrays.
+ *
+ * Everything lives in a single buffer which can be saved to a file and
+ * memory mapped back: decoders (and processes) loading the same file share
+ * one read-only copy and skip building and smearing the trie. The file keeps
+ * a fingerprint of the inputs the trie was built from, so that callers can
+ * tell a stale file apart.
+ */
+class FlatTrie {
+ public:
+  /*
+   * Flatten a trie, which should already be smeared. `fingerprint` identifies
+   * the inputs of the trie and is saved with it.
+   */
+  explicit FlatTrie(const Trie& trie, uint64_t fingerprint = 0);
+
+  /* Memory map a trie written with `save()` */
+  explicit FlatTrie(const std::string& path);
+
+  FlatTrie(const FlatTrie&) = delete;
+  FlatTrie& operator=(const FlatTrie&) = delete;
+
+  ~FlatTrie();
+
+  /*
+   * Write the trie in a file which can be memory mapped. The file is
+   * replaced atomically, so that tries mapped from a previous version of it
+   * stay valid.
+   */
+  void save(const std::string& path) const;
+
+  /* Fingerprint of the inputs the trie was built from */
+  uint64_t fingerprint() const {
+    return fingerprint_;
+  }
+
+  /* Return the root node pointer */
+  const FlatTrieNode* getRoot() const {
+    return nodes_;
+  }
+
+  /* Return the child of `node` for token `idx`, nullptr if there is none */
+  const FlatTrieNode* child(const FlatTrieNode* node, int idx) const {
+    const int32_t* begin = tokens_ + node->childBegin;
+    const int32_t* end = begin + node->nChildren;
+    // Most nodes have few children: scan them, binary search otherwise
+    if (node->nChildren <= kLinearSearchMaxChildren) {
+      for (const int32_t* it = begin; it != end; ++it) {
+        if (*it == idx) {
+          return nodes_ + (it - tokens_);
+        }
+      }
+      return nullptr;
+    }
+    while (begin < end) {
+      const int32_t* mid = begin + (end - begin) / 2;
+      if (*mid < idx) {
+        begin = mid + 1;
+      } else {
+        end = mid;
+      }
+    }
+    return (begin != tokens_ + node->childBegin + node->nChildren &&
+            *begin == idx)
+        ? nodes_ + (begin - tokens_)
+        : nullptr;
+  }
+
+  /* Token index leading to `node` */
+  int token(const FlatTrieNode* node) const {
+    return tokens_[node - nodes_];
+  }
+
+  /* Labels of the words ending at `node` (`node->nLabels` of them) */
+  const int32_t* labels(const FlatTrieNode* node) const {
+    return labels_ + node->labelBegin;
+  }
+
+  /* Scores of the words ending at `node` (`node->nLabels` of them) */
+  const float* scores(const FlatTrieNode* node) const {
+    return scores_ + node->labelBegin;
+  }
+
+  /* Find the node for a given token sequence, nullptr if there is none */
+  const FlatTrieNode* search(const std::vector<int>& indices) const;
+
+  size_t numNodes() const {
+    return numNodes_;
+  }
+
+  /* Whether the trie is memory mapped from a file */
+  bool isMapped() const {
+    return mapped_ != nullptr;
+  }
+
+ private:
+  static constexpr uint32_t kLinearSearchMaxChildren = 8;
+
+  // Owned storage when built from a Trie
+  std::vector<uint64_t> buffer_;
+  // Mapped storage when loaded from a file
+  void* mapped_{nullptr};
+  size_t mappedSize_{0};
+
+  uint64_t fingerprint_{0};
+  size_t numNodes_{0};
+  size_t numLabels_{0};
+  const FlatTrieNode* nodes_{nullptr};
+  const int32_t* tokens_{nullptr};
+  const int32_t* labels_{nullptr};
+  const float* scores_{nullptr};
+
+  /* Set the array pointers from a buffer holding a serialized trie */
+  void setView(const char* data, size_t size, const std::string& source);
+};
+
+using FlatTriePtr = std::shared_ptr<FlatTrie>;
+} // namespace text
+} // namespace lib
+} // namespace fl
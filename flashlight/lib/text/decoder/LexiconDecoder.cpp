@@ -24,7 +24,7 @@ void LexiconDecoder::decodeBegin() {
 
   /* note: the lm reset itself with :start() */
   hyp_[0].emplace_back(
-      0.0, lm_->start(0), lexicon_->getRoot(), nullptr, sil_, -1);
+      0.0, startLm(*lm_), lexicon_->getRoot(), nullptr, sil_, -1);
   nDecodedFrames_ = 0;
   nPrunedFrames_ = 0;
 }
@@ -38,194 +38,175 @@ void LexiconDecoder::decodeStep(const float* emissions, int T, int N) {
     }
   }
 
-  std::vector<size_t> idx(N);
   for (int t = 0; t < T; t++) {
-    std::iota(idx.begin(), idx.end(), 0);
-    if (N > opt_.beamSizeToken) {
-      std::partial_sort(
-          idx.begin(),
-          idx.begin() + opt_.beamSizeToken,
-          idx.end(),
-          [&t, &N, &emissions](const size_t& l, const size_t& r) {
-            return emissions[t * N + l] > emissions[t * N + r];
-          });
-    }
-
-    candidatesReset(candidatesBestScore_, candidates_, candidatePtrs_);
-    for (const LexiconDecoderState& prevHyp : hyp_[startFrame + t]) {
-      const TrieNode* prevLex = prevHyp.lex;
-      const int prevIdx = prevHyp.token;
-      const float lexMaxScore =
-          prevLex == lexicon_->getRoot() ? 0 : prevLex->maxScore;
-
-      /* (1) Try children */
-      for (int r = 0; r < std::min(opt_.beamSizeToken, N); ++r) {
-        int n = idx[r];
-        auto iter = prevLex->children.find(n);
-        if (iter == prevLex->children.end()) {
-          continue;
-        }
-        const TrieNodePtr& lex = iter->second;
-        double amScore = emissions[t * N + n];
-        if (nDecodedFrames_ + t > 0 &&
-            opt_.criterionType == CriterionType::ASG) {
-          amScore += transitions_[n * N + prevIdx];
-        }
-        double score = prevHyp.score + amScore;
-        if (n == sil_) {
-          score += opt_.silScore;
-        }
-
-        LMStatePtr lmState;
-        double lmScore = 0.;
+    decodeFrame(emissions + t * N, N);
+    updateLMCache(lm_, hyp_[nDecodedFrames_ - nPrunedFrames_]);
+  }
+}
 
-        if (isLmToken_) {
-          auto lmStateScorePair = lm_->score(prevHyp.lmState, n);
-          lmState = lmStateScorePair.first;
-          lmScore = lmStateScorePair.second;
-        }
+void LexiconDecoder::decodeFrame(const float* emissions, int N) {
+  const int frame = nDecodedFrames_ - nPrunedFrames_;
+  const int nTokens = selectTopTokens(
+      emissions, N, opt_.beamSizeToken, tokenIdx_, tokenBuffer_);
 
-        // We eat-up a new token
-        if (opt_.criterionType != CriterionType::CTC || prevHyp.prevBlank ||
-            n != prevIdx) {
-          if (!lex->children.empty()) {
-            if (!isLmToken_) {
-              lmState = prevHyp.lmState;
-              lmScore = lex->maxScore - lexMaxScore;
-            }
-            candidatesAdd(
-                candidates_,
-                candidatesBestScore_,
-                opt_.beamThreshold,
-                score + opt_.lmWeight * lmScore,
-                lmState,
-                lex.get(),
-                &prevHyp,
-                n,
-                -1,
-                false, // prevBlank
-                prevHyp.amScore + amScore,
-                prevHyp.lmScore + lmScore);
-          }
-        }
+  candidatesReset(candidatesBestScore_, candidates_, candidatePtrs_);
+  candidateScores_.clear();
+  for (const LexiconDecoderState& prevHyp : hyp_[frame]) {
+    const FlatTrieNode* prevLex = prevHyp.lex;
+    const int prevIdx = prevHyp.token;
+    const float lexMaxScore =
+        prevLex == lexicon_->getRoot() ? 0 : prevLex->maxScore;
+
+    /* (1) Try children */
+    for (int r = 0; r < nTokens; ++r) {
+      int n = tokenIdx_[r];
+      const FlatTrieNode* lex = lexicon_->child(prevLex, n);
+      if (!lex) {
+        continue;
+      }
+      double amScore = emissions[n];
+      if (nDecodedFrames_ > 0 && opt_.criterionType == CriterionType::ASG) {
+        amScore += transitions_[n * N + prevIdx];
+      }
+      double score = prevHyp.score + amScore;
+      if (n == sil_) {
+        score += opt_.silScore;
+      }
 
-        // If we got a true word
-        for (auto label : lex->labels) {
-          if (prevLex == lexicon_->getRoot() && prevHyp.token == n) {
-            // This is to avoid an situation that, when there is word with
-            // single token spelling (e.g. X -> x) in the lexicon and token `x`
-            // is predicted in several consecutive frames, multiple word `X`
-            // will be emitted. This violates the property of CTC, where
-            // there must be an blank token in between to predict 2 identical
-            // tokens consecutively.
-            continue;
-          }
+      LMStatePtr lmState;
+      double lmScore = 0.;
 
-          if (!isLmToken_) {
-            auto lmStateScorePair = lm_->score(prevHyp.lmState, label);
-            lmState = lmStateScorePair.first;
-            lmScore = lmStateScorePair.second - lexMaxScore;
-          }
-          candidatesAdd(
-              candidates_,
-              candidatesBestScore_,
-              opt_.beamThreshold,
-              score + opt_.lmWeight * lmScore + opt_.wordScore,
-              lmState,
-              lexicon_->getRoot(),
-              &prevHyp,
-              n,
-              label,
-              false, // prevBlank
-              prevHyp.amScore + amScore,
-              prevHyp.lmScore + lmScore);
-        }
+      if (isLmToken_) {
+        auto lmStateScorePair = lm_->score(prevHyp.lmState, n);
+        lmState = lmStateScorePair.first;
+        lmScore = lmStateScorePair.second;
+      }
 
-        // If we got an unknown word
-        if (lex->labels.empty() && (opt_.unkScore > kNegativeInfinity)) {
+      // We eat-up a new token
+      if (opt_.criterionType != CriterionType::CTC || prevHyp.prevBlank ||
+          n != prevIdx) {
+        if (lex->nChildren > 0) {
           if (!isLmToken_) {
-            auto lmStateScorePair = lm_->score(prevHyp.lmState, unk_);
-            lmState = lmStateScorePair.first;
-            lmScore = lmStateScorePair.second - lexMaxScore;
+            lmState = prevHyp.lmState;
+            lmScore = lex->maxScore - lexMaxScore;
           }
-          candidatesAdd(
-              candidates_,
-              candidatesBestScore_,
-              opt_.beamThreshold,
-              score + opt_.lmWeight * lmScore + opt_.unkScore,
+          addCandidate(
+              score + opt_.lmWeight * lmScore,
               lmState,
-              lexicon_->getRoot(),
+              lex,
               &prevHyp,
               n,
-              unk_,
+              -1,
               false, // prevBlank
               prevHyp.amScore + amScore,
               prevHyp.lmScore + lmScore);
         }
       }
 
-      /* (2) Try same lexicon node */
-      if (opt_.criterionType != CriterionType::CTC || !prevHyp.prevBlank ||
-          prevLex == lexicon_->getRoot()) {
-        int n = prevLex == lexicon_->getRoot() ? sil_ : prevIdx;
-        double amScore = emissions[t * N + n];
-        if (nDecodedFrames_ + t > 0 &&
-            opt_.criterionType == CriterionType::ASG) {
-          amScore += transitions_[n * N + prevIdx];
-        }
-        double score = prevHyp.score + amScore;
-        if (n == sil_) {
-          score += opt_.silScore;
+      // If we got a true word
+      const int32_t* labels = lexicon_->labels(lex);
+      for (uint32_t i = 0; i < lex->nLabels; i++) {
+        int label = labels[i];
+        if (prevLex == lexicon_->getRoot() && prevHyp.token == n) {
+          // This is to avoid an situation that, when there is word with
+          // single token spelling (e.g. X -> x) in the lexicon and token `x`
+          // is predicted in several consecutive frames, multiple word `X`
+          // will be emitted. This violates the property of CTC, where
+          // there must be an blank token in between to predict 2 identical
+          // tokens consecutively.
+          continue;
         }
 
-        candidatesAdd(
-            candidates_,
-            candidatesBestScore_,
-            opt_.beamThreshold,
-            score,
-            prevHyp.lmState,
-            prevLex,
+        if (!isLmToken_) {
+          auto lmStateScorePair = lm_->score(prevHyp.lmState, label);
+          lmState = lmStateScorePair.first;
+          lmScore = lmStateScorePair.second - lexMaxScore;
+        }
+        addCandidate(
+            score + opt_.lmWeight * lmScore + opt_.wordScore,
+            lmState,
+            lexicon_->getRoot(),
             &prevHyp,
             n,
-            -1,
+            label,
             false, // prevBlank
             prevHyp.amScore + amScore,
-            prevHyp.lmScore);
+            prevHyp.lmScore + lmScore);
       }
 
-      /* (3) CTC only, try blank */
-      if (opt_.criterionType == CriterionType::CTC) {
-        int n = blank_;
-        double amScore = emissions[t * N + n];
-        candidatesAdd(
-            candidates_,
-            candidatesBestScore_,
-            opt_.beamThreshold,
-            prevHyp.score + amScore,
-            prevHyp.lmState,
-            prevLex,
+      // If we got an unknown word
+      if (lex->nLabels == 0 && (opt_.unkScore > kNegativeInfinity)) {
+        if (!isLmToken_) {
+          auto lmStateScorePair = lm_->score(prevHyp.lmState, unk_);
+          lmState = lmStateScorePair.first;
+          lmScore = lmStateScorePair.second - lexMaxScore;
+        }
+        addCandidate(
+            score + opt_.lmWeight * lmScore + opt_.unkScore,
+            lmState,
+            lexicon_->getRoot(),
             &prevHyp,
             n,
-            -1,
-            true, // prevBlank
+            unk_,
+            false, // prevBlank
             prevHyp.amScore + amScore,
-            prevHyp.lmScore);
+            prevHyp.lmScore + lmScore);
+      }
+    }
+
+    /* (2) Try same lexicon node */
+    if (opt_.criterionType != CriterionType::CTC || !prevHyp.prevBlank ||
+        prevLex == lexicon_->getRoot()) {
+      int n = prevLex == lexicon_->getRoot() ? sil_ : prevIdx;
+      double amScore = emissions[n];
+      if (nDecodedFrames_ > 0 && opt_.criterionType == CriterionType::ASG) {
+        amScore += transitions_[n * N + prevIdx];
+      }
+      double score = prevHyp.score + amScore;
+      if (n == sil_) {
+        score += opt_.silScore;
       }
-      // finish proposing
+
+      addCandidate(
+          score,
+          prevHyp.lmState,
+          prevLex,
+          &prevHyp,
+          n,
+          -1,
+          false, // prevBlank
+          prevHyp.amScore + amScore,
+          prevHyp.lmScore);
     }
 
-    candidatesStore(
-        candidates_,
-        candidatePtrs_,
-        hyp_[startFrame + t + 1],
-        opt_.beamSize,
-        candidatesBestScore_ - opt_.beamThreshold,
-        opt_.logAdd,
-        false);
-    updateLMCache(lm_, hyp_[startFrame + t + 1]);
+    /* (3) CTC only, try blank */
+    if (opt_.criterionType == CriterionType::CTC) {
+      int n = blank_;
+      double amScore = emissions[n];
+      addCandidate(
+          prevHyp.score + amScore,
+          prevHyp.lmState,
+          prevLex,
+          &prevHyp,
+          n,
+          -1,
+          true, // prevBlank
+          prevHyp.amScore + amScore,
+          prevHyp.lmScore);
+    }
+    // finish proposing
   }
 
-  nDecodedFrames_ += T;
+  candidatesStore(
+      candidates_,
+      candidateScores_,
+      candidatePtrs_,
+      hyp_[frame + 1],
+      opt_.beamSize,
+      candidatesBestScore_ - opt_.beamThreshold,
+      opt_.logAdd,
+      false);
+  ++nDecodedFrames_;
 }
 
 void LexiconDecoder::decodeEnd() {
@@ -240,7 +221,7 @@ void LexiconDecoder::decodeEnd() {
   }
   for (const LexiconDecoderState& prevHyp :
        hyp_[nDecodedFrames_ - nPrunedFrames_]) {
-    const TrieNode* prevLex = prevHyp.lex;
+    const FlatTrieNode* prevLex = prevHyp.lex;
     const LMStatePtr& prevLmState = prevHyp.lmState;
 
     if (!hasNiceEnding || prevHyp.lex == lexicon_->getRoot()) {
@@ -323,6 +304,97 @@ void LexiconDecoder::prune(int lookBack) {
 
   nPrunedFrames_ = nDecodedFrames_ - lookBack;
 }
+
+DecodeResult LexiconDecoder::commit(int maxUncommittedFrames) {
+  const int lastFrame = nDecodedFrames_ - nPrunedFrames_;
+  auto& lastHyps = hyp_[lastFrame];
+  if (lastFrame < 1 || lastHyps.empty()) {
+    return DecodeResult();
+  }
+
+  /* (1) Bound the number of uncommitted frames */
+  if (maxUncommittedFrames >= 0 && lastFrame > maxUncommittedFrames) {
+    auto ancestorOf = [maxUncommittedFrames](const LexiconDecoderState* hyp) {
+      for (int i = 0; hyp && i < maxUncommittedFrames; i++) {
+        hyp = hyp->parent;
+      }
+      return hyp;
+    };
+    const LexiconDecoderState* anchor = ancestorOf(&*std::max_element(
+        lastHyps.begin(),
+        lastHyps.end(),
+        [](const LexiconDecoderState& l, const LexiconDecoderState& r) {
+          return l.score < r.score;
+        }));
+    // Nothing points to the hypothesis of the last frame yet
+    lastHyps.erase(
+        std::remove_if(
+            lastHyps.begin(),
+            lastHyps.end(),
+            [&](const LexiconDecoderState& hyp) {
+              return ancestorOf(&hyp) != anchor;
+            }),
+        lastHyps.end());
+  }
+
+  /* (2) Find the latest ancestor shared by all the hypothesis */
+  ancestors_.clear();
+  for (const auto& hyp : lastHyps) {
+    ancestors_.push_back(&hyp);
+  }
+  int frame = lastFrame;
+  while (true) {
+    std::sort(ancestors_.begin(), ancestors_.end());
+    ancestors_.erase(
+        std::unique(ancestors_.begin(), ancestors_.end()), ancestors_.end());
+    if (ancestors_.size() == 1 || frame == 0 || !ancestors_.front()) {
+      break;
+    }
+    for (auto& ancestor : ancestors_) {
+      ancestor = ancestor->parent;
+    }
+    --frame;
+  }
+  if (frame == 0 || ancestors_.size() != 1 || !ancestors_.front()) {
+    return DecodeResult();
+  }
+
+  /* (3) Trace back the committed frames, excluding the previous first one */
+  const LexiconDecoderState* node = ancestors_.front();
+  DecodeResult result(frame);
+  result.score = node->score;
+  result.amScore = node->amScore;
+  result.lmScore = node->lmScore;
+  for (int i = frame - 1; i >= 0; i--) {
+    result.words[i] = node->getWord();
+    result.tokens[i] = node->token;
+    node = node->parent;
+  }
+
+  /* (4) Compact: the shared ancestor becomes the first frame */
+  for (int i = 0; i < hyp_.size(); i++) {
+    if (i + frame <= lastFrame) {
+      hyp_[i].swap(hyp_[i + frame]);
+    } else {
+      hyp_[i].clear();
+    }
+  }
+  // Previous frames are gone, including the parents of dead hypothesis
+  for (auto& hyp : hyp_[0]) {
+    hyp.parent = nullptr;
+  }
+  // Avoid score underflow/overflow
+  auto& hyps = hyp_[lastFrame - frame];
+  double largestScore = hyps.front().score;
+  for (const auto& hyp : hyps) {
+    largestScore = std::max(largestScore, hyp.score);
+  }
+  for (auto& hyp : hyps) {
+    hyp.score -= largestScore;
+  }
+  nPrunedFrames_ += frame;
+  return result;
+}
 } // namespace text
 } // namespace lib
 } // namespace fl
@@ -10,7 +10,7 @@
 #include <unordered_map>
 
 #include "flashlight/lib/text/decoder/Decoder.h"
-#include "flashlight/lib/text/decoder/Trie.h"
+#include "flashlight/lib/text/decoder/FlatTrie.h"
 #include "flashlight/lib/text/decoder/lm/LM.h"
 
 namespace fl {
@@ -35,7 +35,7 @@ struct LexiconDecoderOptions {
 struct LexiconDecoderState {
   double score; // Accumulated total score so far
   LMStatePtr lmState; // Language model state
-  const TrieNode* lex; // Trie node in the lexicon
+  const FlatTrieNode* lex; // Trie node in the lexicon
   const LexiconDecoderState* parent; // Parent hypothesis
   int token; // Label of token
   int word; // Label of word (-1 if incomplete)
@@ -47,7 +47,7 @@ struct LexiconDecoderState {
   LexiconDecoderState(
       const double score,
       const LMStatePtr& lmState,
-      const TrieNode* lex,
+      const FlatTrieNode* lex,
       const LexiconDecoderState* parent,
       const int token,
       const int word,
@@ -115,7 +115,7 @@ class LexiconDecoder : public Decoder {
  public:
   LexiconDecoder(
       LexiconDecoderOptions opt,
-      const TriePtr& lexicon,
+      const FlatTriePtr& lexicon,
       const LMPtr& lm,
       const int sil,
       const int blank,
@@ -131,6 +131,26 @@ class LexiconDecoder : public Decoder {
         transitions_(transitions),
         isLmToken_(isLmToken) {}
 
+  /* Flattens `lexicon`, prefer sharing a FlatTrie between decoders */
+  LexiconDecoder(
+      LexiconDecoderOptions opt,
+      const TriePtr& lexicon,
+      const LMPtr& lm,
+      const int sil,
+      const int blank,
+      const int unk,
+      const std::vector<float>& transitions,
+      const bool isLmToken)
+      : LexiconDecoder(
+            std::move(opt),
+            std::make_shared<FlatTrie>(*lexicon),
+            lm,
+            sil,
+            blank,
+            unk,
+            transitions,
+            isLmToken) {}
+
   void decodeBegin() override;
 
   void decodeStep(const float* emissions, int T, int N) override;
@@ -141,6 +161,21 @@ class LexiconDecoder : public Decoder {
 
   void prune(int lookBack = 0) override;
 
+  /**
+   * Streaming decoding: commit the part of the transcription shared by all
+   * the hypothesis, which cannot change anymore, and drop it from the beam.
+   * If more than `maxUncommittedFrames` (when non-negative) frames are left
+   * uncommitted, the hypothesis which do not descend from the best one
+   * `maxUncommittedFrames` frames back are discarded first, so that memory
+   * and latency stay bounded on arbitrarily long streams.
+   *
+   * Returns the words and tokens of the newly committed frames (empty if
+   * none). The last committed frame is kept as the first frame of the beam:
+   * hypothesis returned afterwards start with it, as they start with the
+   * initial silence after `decodeBegin()`.
+   */
+  DecodeResult commit(int maxUncommittedFrames = -1);
+
   int nDecodedFramesInBuffer() const override;
 
   DecodeResult getBestHypothesis(int lookBack = 0) const override;
@@ -148,9 +183,27 @@ class LexiconDecoder : public Decoder {
   std::vector<DecodeResult> getAllFinalHypothesis() const override;
 
  protected:
+  friend class BatchLexiconDecoder;
+
+  /* Decode one frame of N emissions, leaving the LM cache as is */
+  void decodeFrame(const float* emissions, int N);
+
+  /**
+   * Same as `candidatesAdd()`, also storing the candidate score in
+   * `candidateScores_`
+   */
+  template <class... Args>
+  void addCandidate(const double score, const Args&... args) {
+    candidatesAdd(
+        candidates_, candidatesBestScore_, opt_.beamThreshold, score, args...);
+    if (candidates_.size() > candidateScores_.size()) {
+      candidateScores_.push_back(score);
+    }
+  }
+
   LexiconDecoderOptions opt_;
   // Lexicon trie to restrict beam-search decoder
-  TriePtr lexicon_;
+  FlatTriePtr lexicon_;
   LMPtr lm_;
   // Index of silence label
   int sil_;
@@ -172,9 +225,19 @@ class LexiconDecoder : public Decoder {
   // so instead of moving around objects, we only need to sort pointers
   std::vector<LexiconDecoderState*> candidatePtrs_;
 
+  // Scores of candidates_, stored contiguously for pruning
+  std::vector<double> candidateScores_;
+
   // Best candidate score of current frame
   double candidatesBestScore_;
 
+  // Tokens considered at the current frame and scratch buffer to select them
+  std::vector<int> tokenIdx_;
+  std::vector<float> tokenBuffer_;
+
+  // Ancestors of the hypothesis, to find the ones they share in commit()
+  std::vector<const LexiconDecoderState*> ancestors_;
+
   // Vector of hypothesis for all the frames so far
   std::unordered_map<int, std::vector<LexiconDecoderState>> hyp_;
 
@@ -17,10 +17,7 @@ namespace fl {
 namespace lib {
 namespace text {
 
-void LexiconFreeSeq2SeqDecoder::decodeStep(
-    const float* emissions,
-    int T,
-    int N) {
+void LexiconFreeSeq2SeqDecoder::searchBegin() {
   // Extend hyp_ buffer
   if (hyp_.size() < maxOutputLength_ + 2) {
     for (int i = hyp_.size(); i < maxOutputLength_ + 2; i++) {
@@ -30,122 +27,124 @@ void LexiconFreeSeq2SeqDecoder::decodeStep(
 
   // Start from here.
   hyp_[0].clear();
-  hyp_[0].emplace_back(0.0, lm_->start(0), nullptr, -1, nullptr);
-
-  // Decode frame by frame
-  int t = 0;
-  for (; t < maxOutputLength_; t++) {
-    candidatesReset(candidatesBestScore_, candidates_, candidatePtrs_);
-
-    // Batch forwarding
-    rawY_.clear();
-    rawPrevStates_.clear();
-    for (const LexiconFreeSeq2SeqDecoderState& prevHyp : hyp_[t]) {
-      const AMStatePtr& prevState = prevHyp.amState;
-      if (prevHyp.token == eos_) {
-        continue;
-      }
-      rawY_.push_back(prevHyp.token);
-      rawPrevStates_.push_back(prevState);
+  hyp_[0].emplace_back(0.0, startLm(*lm_), nullptr, -1, nullptr);
+}
+
+bool LexiconFreeSeq2SeqDecoder::gatherAmInputs(int t) {
+  candidatesReset(candidatesBestScore_, candidates_, candidatePtrs_);
+
+  // Batch forwarding
+  rawY_.clear();
+  rawPrevStates_.clear();
+  for (const LexiconFreeSeq2SeqDecoderState& prevHyp : hyp_[t]) {
+    const AMStatePtr& prevState = prevHyp.amState;
+    if (prevHyp.token == eos_) {
+      continue;
     }
-    if (rawY_.size() == 0) {
-      break;
+    rawY_.push_back(prevHyp.token);
+    rawPrevStates_.push_back(prevState);
+  }
+  return !rawY_.empty();
+}
+
+void LexiconFreeSeq2SeqDecoder::expandHypothesis(
+    int t,
+    const std::vector<std::vector<float>>& amScores,
+    const std::vector<AMStatePtr>& outStates,
+    size_t offset,
+    std::vector<LMStatePtr>& lmStates) {
+  std::vector<size_t> idx(amScores[offset].size());
+
+  // Generate new hypothesis
+  for (int hypo = 0, validHypo = 0; hypo < hyp_[t].size(); hypo++) {
+    const LexiconFreeSeq2SeqDecoderState& prevHyp = hyp_[t][hypo];
+    // Change nothing for completed hypothesis
+    if (prevHyp.token == eos_) {
+      candidatesAdd(
+          candidates_,
+          candidatesBestScore_,
+          opt_.beamThreshold,
+          prevHyp.score,
+          prevHyp.lmState,
+          &prevHyp,
+          eos_,
+          nullptr,
+          prevHyp.amScore,
+          prevHyp.lmScore);
+      continue;
     }
 
-    std::vector<std::vector<float>> amScores;
-    std::vector<AMStatePtr> outStates;
+    const AMStatePtr& outState = outStates[offset + validHypo];
+    if (!outState) {
+      validHypo++;
+      continue;
+    }
+    const std::vector<float>& hypAmScores = amScores[offset + validHypo];
+
+    std::iota(idx.begin(), idx.end(), 0);
+    if (hypAmScores.size() > opt_.beamSizeToken) {
+      std::partial_sort(
+          idx.begin(),
+          idx.begin() + opt_.beamSizeToken,
+          idx.end(),
+          [&hypAmScores](const size_t& l, const size_t& r) {
+            return hypAmScores[l] > hypAmScores[r];
+          });
+    }
 
-    std::tie(amScores, outStates) =
-        amUpdateFunc_(emissions, N, T, rawY_, rawPrevStates_, t);
+    for (int r = 0;
+         r < std::min(hypAmScores.size(), (size_t)opt_.beamSizeToken);
+         r++) {
+      int n = idx[r];
+      double amScore = hypAmScores[n];
 
-    std::vector<size_t> idx(amScores.back().size());
+      if (n == eos_) { /* (1) Try eos */
+        auto lmStateScorePair = lm_->finish(prevHyp.lmState);
+        auto lmScore = lmStateScorePair.second;
 
-    // Generate new hypothesis
-    for (int hypo = 0, validHypo = 0; hypo < hyp_[t].size(); hypo++) {
-      const LexiconFreeSeq2SeqDecoderState& prevHyp = hyp_[t][hypo];
-      // Change nothing for completed hypothesis
-      if (prevHyp.token == eos_) {
         candidatesAdd(
             candidates_,
             candidatesBestScore_,
             opt_.beamThreshold,
-            prevHyp.score,
-            prevHyp.lmState,
+            prevHyp.score + amScore + opt_.eosScore + opt_.lmWeight * lmScore,
+            lmStateScorePair.first,
             &prevHyp,
-            eos_,
+            n,
             nullptr,
-            prevHyp.amScore,
-            prevHyp.lmScore);
-        continue;
-      }
-
-      const AMStatePtr& outState = outStates[validHypo];
-      if (!outState) {
-        validHypo++;
-        continue;
-      }
-
-      std::iota(idx.begin(), idx.end(), 0);
-      if (amScores[validHypo].size() > opt_.beamSizeToken) {
-        std::partial_sort(
-            idx.begin(),
-            idx.begin() + opt_.beamSizeToken,
-            idx.end(),
-            [&amScores, &validHypo](const size_t& l, const size_t& r) {
-              return amScores[validHypo][l] > amScores[validHypo][r];
-            });
-      }
-
-      for (int r = 0;
-           r < std::min(amScores[validHypo].size(), (size_t)opt_.beamSizeToken);
-           r++) {
-        int n = idx[r];
-        double amScore = amScores[validHypo][n];
-
-        if (n == eos_) { /* (1) Try eos */
-          auto lmStateScorePair = lm_->finish(prevHyp.lmState);
-          auto lmScore = lmStateScorePair.second;
-
-          candidatesAdd(
-              candidates_,
-              candidatesBestScore_,
-              opt_.beamThreshold,
-              prevHyp.score + amScore + opt_.eosScore + opt_.lmWeight * lmScore,
-              lmStateScorePair.first,
-              &prevHyp,
-              n,
-              nullptr,
-              prevHyp.amScore + amScore,
-              prevHyp.lmScore + lmScore);
-        } else { /* (2) Try normal token */
-          auto lmStateScorePair = lm_->score(prevHyp.lmState, n);
-          auto lmScore = lmStateScorePair.second;
-          candidatesAdd(
-              candidates_,
-              candidatesBestScore_,
-              opt_.beamThreshold,
-              prevHyp.score + amScore + opt_.lmWeight * lmScore,
-              lmStateScorePair.first,
-              &prevHyp,
-              n,
-              outState,
-              prevHyp.amScore + amScore,
-              prevHyp.lmScore + lmScore);
-        }
+            prevHyp.amScore + amScore,
+            prevHyp.lmScore + lmScore);
+      } else { /* (2) Try normal token */
+        auto lmStateScorePair = lm_->score(prevHyp.lmState, n);
+        auto lmScore = lmStateScorePair.second;
+        candidatesAdd(
+            candidates_,
+            candidatesBestScore_,
+            opt_.beamThreshold,
+            prevHyp.score + amScore + opt_.lmWeight * lmScore,
+            lmStateScorePair.first,
+            &prevHyp,
+            n,
+            outState,
+            prevHyp.amScore + amScore,
+            prevHyp.lmScore + lmScore);
       }
-      validHypo++;
     }
-    candidatesStore(
-        candidates_,
-        candidatePtrs_,
-        hyp_[t + 1],
-        opt_.beamSize,
-        candidatesBestScore_ - opt_.beamThreshold,
-        opt_.logAdd,
-        true);
-    updateLMCache(lm_, hyp_[t + 1]);
-  } // End of decoding
+    validHypo++;
+  }
+  candidatesStore(
+      candidates_,
+      candidatePtrs_,
+      hyp_[t + 1],
+      opt_.beamSize,
+      candidatesBestScore_ - opt_.beamThreshold,
+      opt_.logAdd,
+      true);
+  for (const auto& hyp : hyp_[t + 1]) {
+    lmStates.push_back(hyp.lmState);
+  }
+}
 
+void LexiconFreeSeq2SeqDecoder::searchEnd(int t) {
   while (t > 0 && hyp_[t].empty()) {
     --t;
   }
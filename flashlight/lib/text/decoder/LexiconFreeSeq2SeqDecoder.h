@@ -10,23 +10,13 @@
 #include <memory>
 #include <unordered_map>
 
-#include "flashlight/lib/text/decoder/Decoder.h"
+#include "flashlight/lib/text/decoder/Seq2SeqDecoder.h"
 #include "flashlight/lib/text/decoder/lm/LM.h"
 
 namespace fl {
 namespace lib {
 namespace text {
 
-using AMStatePtr = std::shared_ptr<void>;
-using AMUpdateFunc = std::function<
-    std::pair<std::vector<std::vector<float>>, std::vector<AMStatePtr>>(
-        const float*,
-        const int,
-        const int,
-        const std::vector<int>&,
-        const std::vector<AMStatePtr>&,
-        int&)>;
-
 struct LexiconFreeSeq2SeqDecoderOptions {
   int beamSize; // Maximum number of hypothesis we hold after each step
   int beamSizeToken; // Maximum number of tokens we consider at each step
@@ -97,7 +87,7 @@ struct LexiconFreeSeq2SeqDecoderState {
  * TODO: Doesn't support online decoding now.
  *
  */
-class LexiconFreeSeq2SeqDecoder : public Decoder {
+class LexiconFreeSeq2SeqDecoder : public Seq2SeqDecoder {
  public:
   LexiconFreeSeq2SeqDecoder(
       LexiconFreeSeq2SeqDecoderOptions opt,
@@ -105,13 +95,8 @@ class LexiconFreeSeq2SeqDecoder : public Decoder {
       const int eos,
       AMUpdateFunc amUpdateFunc,
       const int maxOutputLength)
-      : opt_(std::move(opt)),
-        lm_(lm),
-        eos_(eos),
-        amUpdateFunc_(amUpdateFunc),
-        maxOutputLength_(maxOutputLength) {}
-
-  void decodeStep(const float* emissions, int T, int N) override;
+      : Seq2SeqDecoder(lm, eos, std::move(amUpdateFunc), maxOutputLength),
+        opt_(std::move(opt)) {}
 
   void prune(int lookBack = 0) override;
 
@@ -123,18 +108,25 @@ class LexiconFreeSeq2SeqDecoder : public Decoder {
 
  protected:
   LexiconFreeSeq2SeqDecoderOptions opt_;
-  LMPtr lm_;
-  int eos_;
-  AMUpdateFunc amUpdateFunc_;
-  std::vector<int> rawY_;
-  std::vector<AMStatePtr> rawPrevStates_;
-  int maxOutputLength_;
 
   std::vector<LexiconFreeSeq2SeqDecoderState> candidates_;
   std::vector<LexiconFreeSeq2SeqDecoderState*> candidatePtrs_;
   double candidatesBestScore_;
 
   std::unordered_map<int, std::vector<LexiconFreeSeq2SeqDecoderState>> hyp_;
+
+  void searchBegin() override;
+
+  bool gatherAmInputs(int t) override;
+
+  void expandHypothesis(
+      int t,
+      const std::vector<std::vector<float>>& amScores,
+      const std::vector<AMStatePtr>& outStates,
+      size_t offset,
+      std::vector<LMStatePtr>& lmStates) override;
+
+  void searchEnd(int t) override;
 };
 } // namespace text
 } // namespace lib
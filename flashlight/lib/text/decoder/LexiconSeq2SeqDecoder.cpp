@@ -19,7 +19,7 @@ namespace fl {
 namespace lib {
 namespace text {
 
-void LexiconSeq2SeqDecoder::decodeStep(const float* emissions, int T, int N) {
+void LexiconSeq2SeqDecoder::searchBegin() {
   // Extend hyp_ buffer
   if (hyp_.size() < maxOutputLength_ + 2) {
     for (int i = hyp_.size(); i < maxOutputLength_ + 2; i++) {
@@ -30,188 +30,186 @@ void LexiconSeq2SeqDecoder::decodeStep(const float* emissions, int T, int N) {
   // Start from here.
   hyp_[0].clear();
   hyp_[0].emplace_back(
-      0.0, lm_->start(0), lexicon_->getRoot(), nullptr, -1, -1, nullptr);
-
-  auto compare = [](const LexiconSeq2SeqDecoderState& n1,
-                    const LexiconSeq2SeqDecoderState& n2) {
-    return n1.score > n2.score;
-  };
-
-  // Decode frame by frame
-  int t = 0;
-  for (; t < maxOutputLength_; t++) {
-    candidatesReset(candidatesBestScore_, candidates_, candidatePtrs_);
-
-    // Batch forwarding
-    rawY_.clear();
-    rawPrevStates_.clear();
-    for (const LexiconSeq2SeqDecoderState& prevHyp : hyp_[t]) {
-      const AMStatePtr& prevState = prevHyp.amState;
-      if (prevHyp.token == eos_) {
-        continue;
-      }
-      rawY_.push_back(prevHyp.token);
-      rawPrevStates_.push_back(prevState);
-    }
-    if (rawY_.size() == 0) {
-      break;
+      0.0, startLm(*lm_), lexicon_->getRoot(), nullptr, -1, -1, nullptr);
+}
+
+bool LexiconSeq2SeqDecoder::gatherAmInputs(int t) {
+  candidatesReset(candidatesBestScore_, candidates_, candidatePtrs_);
+
+  // Batch forwarding
+  rawY_.clear();
+  rawPrevStates_.clear();
+  for (const LexiconSeq2SeqDecoderState& prevHyp : hyp_[t]) {
+    const AMStatePtr& prevState = prevHyp.amState;
+    if (prevHyp.token == eos_) {
+      continue;
     }
+    rawY_.push_back(prevHyp.token);
+    rawPrevStates_.push_back(prevState);
+  }
+  return !rawY_.empty();
+}
 
-    std::vector<std::vector<float>> amScores;
-    std::vector<AMStatePtr> outStates;
+void LexiconSeq2SeqDecoder::expandHypothesis(
+    int t,
+    const std::vector<std::vector<float>>& amScores,
+    const std::vector<AMStatePtr>& outStates,
+    size_t offset,
+    std::vector<LMStatePtr>& lmStates) {
+  std::vector<size_t> idx(amScores[offset].size());
+
+  // Generate new hypothesis
+  for (int hypo = 0, validHypo = 0; hypo < hyp_[t].size(); hypo++) {
+    const LexiconSeq2SeqDecoderState& prevHyp = hyp_[t][hypo];
+    // Change nothing for completed hypothesis
+    if (prevHyp.token == eos_) {
+      candidatesAdd(
+          candidates_,
+          candidatesBestScore_,
+          opt_.beamThreshold,
+          prevHyp.score,
+          prevHyp.lmState,
+          prevHyp.lex,
+          &prevHyp,
+          eos_,
+          -1,
+          nullptr,
+          prevHyp.amScore,
+          prevHyp.lmScore);
+      continue;
+    }
 
-    std::tie(amScores, outStates) =
-        amUpdateFunc_(emissions, N, T, rawY_, rawPrevStates_, t);
+    const AMStatePtr& outState = outStates[offset + validHypo];
+    if (!outState) {
+      validHypo++;
+      continue;
+    }
+    const std::vector<float>& hypAmScores = amScores[offset + validHypo];
+
+    const FlatTrieNode* prevLex = prevHyp.lex;
+    const float lexMaxScore =
+        prevLex == lexicon_->getRoot() ? 0 : prevLex->maxScore;
+
+    std::iota(idx.begin(), idx.end(), 0);
+    if (hypAmScores.size() > opt_.beamSizeToken) {
+      std::partial_sort(
+          idx.begin(),
+          idx.begin() + opt_.beamSizeToken,
+          idx.end(),
+          [&hypAmScores](const size_t& l, const size_t& r) {
+            return hypAmScores[l] > hypAmScores[r];
+          });
+    }
 
-    std::vector<size_t> idx(amScores.back().size());
+    for (int r = 0;
+         r < std::min(hypAmScores.size(), (size_t)opt_.beamSizeToken);
+         r++) {
+      int n = idx[r];
+      double amScore = hypAmScores[n];
+
+      /* (1) Try eos */
+      if (n == eos_ && (prevLex == lexicon_->getRoot())) {
+        auto lmStateScorePair = lm_->finish(prevHyp.lmState);
+        LMStatePtr lmState = lmStateScorePair.first;
+        double lmScore;
+        if (isLmToken_) {
+          lmScore = lmStateScorePair.second;
+        } else {
+          lmScore = lmStateScorePair.second - lexMaxScore;
+        }
 
-    // Generate new hypothesis
-    for (int hypo = 0, validHypo = 0; hypo < hyp_[t].size(); hypo++) {
-      const LexiconSeq2SeqDecoderState& prevHyp = hyp_[t][hypo];
-      // Change nothing for completed hypothesis
-      if (prevHyp.token == eos_) {
         candidatesAdd(
             candidates_,
             candidatesBestScore_,
             opt_.beamThreshold,
-            prevHyp.score,
-            prevHyp.lmState,
-            prevHyp.lex,
+            prevHyp.score + amScore + opt_.eosScore + opt_.lmWeight * lmScore,
+            lmState,
+            lexicon_->getRoot(),
             &prevHyp,
-            eos_,
+            n,
             -1,
             nullptr,
-            prevHyp.amScore,
-            prevHyp.lmScore);
-        continue;
+            prevHyp.amScore + amScore,
+            prevHyp.lmScore + lmScore);
       }
 
-      const AMStatePtr& outState = outStates[validHypo];
-      if (!outState) {
-        validHypo++;
-        continue;
-      }
-
-      const TrieNode* prevLex = prevHyp.lex;
-      const float lexMaxScore =
-          prevLex == lexicon_->getRoot() ? 0 : prevLex->maxScore;
-
-      std::iota(idx.begin(), idx.end(), 0);
-      if (amScores[validHypo].size() > opt_.beamSizeToken) {
-        std::partial_sort(
-            idx.begin(),
-            idx.begin() + opt_.beamSizeToken,
-            idx.end(),
-            [&amScores, &validHypo](const size_t& l, const size_t& r) {
-              return amScores[validHypo][l] > amScores[validHypo][r];
-            });
-      }
-
-      for (int r = 0;
-           r < std::min(amScores[validHypo].size(), (size_t)opt_.beamSizeToken);
-           r++) {
-        int n = idx[r];
-        double amScore = amScores[validHypo][n];
-
-        /* (1) Try eos */
-        if (n == eos_ && (prevLex == lexicon_->getRoot())) {
-          auto lmStateScorePair = lm_->finish(prevHyp.lmState);
-          LMStatePtr lmState = lmStateScorePair.first;
+      /* (2) Try normal token */
+      if (n != eos_) {
+        const FlatTrieNode* lex = lexicon_->child(prevLex, n);
+        if (lex) {
+          LMStatePtr lmState;
           double lmScore;
           if (isLmToken_) {
+            auto lmStateScorePair = lm_->score(prevHyp.lmState, n);
+            lmState = lmStateScorePair.first;
             lmScore = lmStateScorePair.second;
           } else {
-            lmScore = lmStateScorePair.second - lexMaxScore;
+            // smearing
+            lmState = prevHyp.lmState;
+            lmScore = lex->maxScore - lexMaxScore;
           }
-
           candidatesAdd(
               candidates_,
               candidatesBestScore_,
               opt_.beamThreshold,
-              prevHyp.score + amScore + opt_.eosScore + opt_.lmWeight * lmScore,
+              prevHyp.score + amScore + opt_.lmWeight * lmScore,
               lmState,
-              lexicon_->getRoot(),
+              lex,
               &prevHyp,
               n,
               -1,
-              nullptr,
+              outState,
               prevHyp.amScore + amScore,
               prevHyp.lmScore + lmScore);
-        }
 
-        /* (2) Try normal token */
-        if (n != eos_) {
-          auto searchLex = prevLex->children.find(n);
-          if (searchLex != prevLex->children.end()) {
-            auto lex = searchLex->second;
-            LMStatePtr lmState;
-            double lmScore;
-            if (isLmToken_) {
-              auto lmStateScorePair = lm_->score(prevHyp.lmState, n);
-              lmState = lmStateScorePair.first;
-              lmScore = lmStateScorePair.second;
-            } else {
-              // smearing
-              lmState = prevHyp.lmState;
-              lmScore = lex->maxScore - lexMaxScore;
-            }
-            candidatesAdd(
-                candidates_,
-                candidatesBestScore_,
-                opt_.beamThreshold,
-                prevHyp.score + amScore + opt_.lmWeight * lmScore,
-                lmState,
-                lex.get(),
-                &prevHyp,
-                n,
-                -1,
-                outState,
-                prevHyp.amScore + amScore,
-                prevHyp.lmScore + lmScore);
-
-            // If we got a true word
-            if (lex->labels.size() > 0) {
-              for (auto word : lex->labels) {
-                if (!isLmToken_) {
-                  auto lmStateScorePair = lm_->score(prevHyp.lmState, word);
-                  lmState = lmStateScorePair.first;
-                  lmScore = lmStateScorePair.second - lexMaxScore;
-                }
-                candidatesAdd(
-                    candidates_,
-                    candidatesBestScore_,
-                    opt_.beamThreshold,
-                    prevHyp.score + amScore + opt_.wordScore +
-                        opt_.lmWeight * lmScore,
-                    lmState,
-                    lexicon_->getRoot(),
-                    &prevHyp,
-                    n,
-                    word,
-                    outState,
-                    prevHyp.amScore + amScore,
-                    prevHyp.lmScore + lmScore);
-                if (isLmToken_) {
-                  break;
-                }
+          // If we got a true word
+          if (lex->nLabels > 0) {
+            const int32_t* labels = lexicon_->labels(lex);
+            for (uint32_t i = 0; i < lex->nLabels; i++) {
+              int word = labels[i];
+              if (!isLmToken_) {
+                auto lmStateScorePair = lm_->score(prevHyp.lmState, word);
+                lmState = lmStateScorePair.first;
+                lmScore = lmStateScorePair.second - lexMaxScore;
+              }
+              candidatesAdd(
+                  candidates_,
+                  candidatesBestScore_,
+                  opt_.beamThreshold,
+                  prevHyp.score + amScore + opt_.wordScore +
+                      opt_.lmWeight * lmScore,
+                  lmState,
+                  lexicon_->getRoot(),
+                  &prevHyp,
+                  n,
+                  word,
+                  outState,
+                  prevHyp.amScore + amScore,
+                  prevHyp.lmScore + lmScore);
+              if (isLmToken_) {
+                break;
               }
             }
           }
         }
       }
-      validHypo++;
     }
-    candidatesStore(
-        candidates_,
-        candidatePtrs_,
-        hyp_[t + 1],
-        opt_.beamSize,
-        candidatesBestScore_ - opt_.beamThreshold,
-        opt_.logAdd,
-        true);
-    updateLMCache(lm_, hyp_[t + 1]);
-  } // End of decoding
+    validHypo++;
+  }
+  candidatesStore(
+      candidates_,
+      candidatePtrs_,
+      hyp_[t + 1],
+      opt_.beamSize,
+      candidatesBestScore_ - opt_.beamThreshold,
+      opt_.logAdd,
+      true);
+  for (const auto& hyp : hyp_[t + 1]) {
+    lmStates.push_back(hyp.lmState);
+  }
+}
 
+void LexiconSeq2SeqDecoder::searchEnd(int t) {
   while (t > 0 && hyp_[t].empty()) {
     --t;
   }
@@ -10,24 +10,14 @@
 #include <memory>
 #include <unordered_map>
 
-#include "flashlight/lib/text/decoder/Decoder.h"
-#include "flashlight/lib/text/decoder/Trie.h"
+#include "flashlight/lib/text/decoder/FlatTrie.h"
+#include "flashlight/lib/text/decoder/Seq2SeqDecoder.h"
 #include "flashlight/lib/text/decoder/lm/LM.h"
 
 namespace fl {
 namespace lib {
 namespace text {
 
-using AMStatePtr = std::shared_ptr<void>;
-using AMUpdateFunc = std::function<
-    std::pair<std::vector<std::vector<float>>, std::vector<AMStatePtr>>(
-        const float*,
-        const int,
-        const int,
-        const std::vector<int>&,
-        const std::vector<AMStatePtr>&,
-        int&)>;
-
 struct LexiconSeq2SeqDecoderOptions {
   int beamSize; // Maximum number of hypothesis we hold after each step
   int beamSizeToken; // Maximum number of tokens we consider at each step
@@ -45,7 +35,7 @@ struct LexiconSeq2SeqDecoderOptions {
 struct LexiconSeq2SeqDecoderState {
   double score; // Accumulated total score so far
   LMStatePtr lmState; // Language model state
-  const TrieNode* lex;
+  const FlatTrieNode* lex;
   const LexiconSeq2SeqDecoderState* parent; // Parent hypothesis
   int token; // Label of token
   int word;
@@ -57,7 +47,7 @@ struct LexiconSeq2SeqDecoderState {
   LexiconSeq2SeqDecoderState(
       const double score,
       const LMStatePtr& lmState,
-      const TrieNode* lex,
+      const FlatTrieNode* lex,
       const LexiconSeq2SeqDecoderState* parent,
       const int token,
       const int word,
@@ -115,25 +105,38 @@ struct LexiconSeq2SeqDecoderState {
  * TODO: Doesn't support online decoding now.
  *
  */
-class LexiconSeq2SeqDecoder : public Decoder {
+class LexiconSeq2SeqDecoder : public Seq2SeqDecoder {
  public:
   LexiconSeq2SeqDecoder(
       LexiconSeq2SeqDecoderOptions opt,
-      const TriePtr& lexicon,
+      const FlatTriePtr& lexicon,
       const LMPtr& lm,
       const int eos,
       AMUpdateFunc amUpdateFunc,
       const int maxOutputLength,
       const bool isLmToken)
-      : opt_(std::move(opt)),
-        lm_(lm),
+      : Seq2SeqDecoder(lm, eos, std::move(amUpdateFunc), maxOutputLength),
+        opt_(std::move(opt)),
         lexicon_(lexicon),
-        eos_(eos),
-        amUpdateFunc_(amUpdateFunc),
-        maxOutputLength_(maxOutputLength),
         isLmToken_(isLmToken) {}
 
-  void decodeStep(const float* emissions, int T, int N) override;
+  /* Flattens `lexicon`, prefer sharing a FlatTrie between decoders */
+  LexiconSeq2SeqDecoder(
+      LexiconSeq2SeqDecoderOptions opt,
+      const TriePtr& lexicon,
+      const LMPtr& lm,
+      const int eos,
+      AMUpdateFunc amUpdateFunc,
+      const int maxOutputLength,
+      const bool isLmToken)
+      : LexiconSeq2SeqDecoder(
+            std::move(opt),
+            std::make_shared<FlatTrie>(*lexicon),
+            lm,
+            eos,
+            amUpdateFunc,
+            maxOutputLength,
+            isLmToken) {}
 
   void prune(int lookBack = 0) override;
 
@@ -145,13 +148,7 @@ class LexiconSeq2SeqDecoder : public Decoder {
 
  protected:
   LexiconSeq2SeqDecoderOptions opt_;
-  LMPtr lm_;
-  TriePtr lexicon_;
-  int eos_;
-  AMUpdateFunc amUpdateFunc_;
-  std::vector<int> rawY_;
-  std::vector<AMStatePtr> rawPrevStates_;
-  int maxOutputLength_;
+  FlatTriePtr lexicon_;
   bool isLmToken_;
 
   std::vector<LexiconSeq2SeqDecoderState> candidates_;
@@ -159,6 +156,19 @@ class LexiconSeq2SeqDecoder : public Decoder {
   double candidatesBestScore_;
 
   std::unordered_map<int, std::vector<LexiconSeq2SeqDecoderState>> hyp_;
+
+  void searchBegin() override;
+
+  bool gatherAmInputs(int t) override;
+
+  void expandHypothesis(
+      int t,
+      const std::vector<std::vector<float>>& amScores,
+      const std::vector<AMStatePtr>& outStates,
+      size_t offset,
+      std::vector<LMStatePtr>& lmStates) override;
+
+  void searchEnd(int t) override;
 };
 } // namespace text
 } // namespace lib
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "flashlight/lib/text/decoder/Seq2SeqDecoder.h"
+
+#include <tuple>
+
+namespace fl {
+namespace lib {
+namespace text {
+
+void Seq2SeqDecoder::decodeStep(const float* emissions, int T, int N) {
+  searchBegin();
+
+  std::vector<std::vector<float>> amScores;
+  std::vector<AMStatePtr> outStates;
+
+  // Decode frame by frame
+  int t = 0;
+  for (; t < maxOutputLength_; t++) {
+    if (!gatherAmInputs(t)) {
+      break;
+    }
+    // Batch forwarding
+    std::tie(amScores, outStates) =
+        amUpdateFunc_(emissions, N, T, rawY_, rawPrevStates_, t);
+
+    lmStates_.clear();
+    expandHypothesis(t, amScores, outStates, 0, lmStates_);
+    // For ConvLM update cache
+    lm_->updateCache(lmStates_);
+  }
+  lmStates_.clear();
+
+  searchEnd(t);
+}
+} // namespace text
+} // namespace lib
+} // namespace fl
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "flashlight/lib/text/decoder/Decoder.h"
+#include "flashlight/lib/text/decoder/lm/LM.h"
+
+namespace fl {
+namespace lib {
+namespace text {
+
+using AMStatePtr = std::shared_ptr<void>;
+using AMUpdateFunc = std::function<
+    std::pair<std::vector<std::vector<float>>, std::vector<AMStatePtr>>(
+        const float*,
+        const int,
+        const int,
+        const std::vector<int>&,
+        const std::vector<AMStatePtr>&,
+        int&)>;
+
+/**
+ * Seq2SeqDecoder is the base of the decoders for sequence-to-sequence
+ * acoustic models, which emit one token per step given the previous one and
+ * an AM state. At each step, the last token and AM state of every unfinished
+ * hypothesis are forwarded through the AM with a single `AMUpdateFunc` call
+ * and the beam is expanded with the resulting scores.
+ *
+ * The steps of the search are exposed to BatchSeq2SeqDecoder, which forwards
+ * the hypothesis of several utterances together.
+ */
+class Seq2SeqDecoder : public Decoder {
+ public:
+  Seq2SeqDecoder(
+      const LMPtr& lm,
+      const int eos,
+      AMUpdateFunc amUpdateFunc,
+      const int maxOutputLength)
+      : lm_(lm),
+        eos_(eos),
+        amUpdateFunc_(std::move(amUpdateFunc)),
+        maxOutputLength_(maxOutputLength) {}
+
+  void decodeStep(const float* emissions, int T, int N) override;
+
+ protected:
+  LMPtr lm_;
+  int eos_;
+  AMUpdateFunc amUpdateFunc_;
+  int maxOutputLength_;
+
+  // Last tokens and AM states of the unfinished hypothesis of a step
+  std::vector<int> rawY_;
+  std::vector<AMStatePtr> rawPrevStates_;
+  // LM states of the new hypothesis of a step
+  std::vector<LMStatePtr> lmStates_;
+
+  /* Reset the beam to the initial hypothesis */
+  virtual void searchBegin() = 0;
+
+  /**
+   * Fill `rawY_` and `rawPrevStates_` with the unfinished hypothesis of step
+   * `t`. Returns false if all of them are finished.
+   */
+  virtual bool gatherAmInputs(int t) = 0;
+
+  /**
+   * Expand the hypothesis of step `t` into step `t + 1`. The AM scores and
+   * states of `rawY_[i]` are `amScores[offset + i]` and
+   * `outStates[offset + i]`. The LM states of the new hypothesis are
+   * appended to `lmStates`, for the caller to update the LM cache.
+   */
+  virtual void expandHypothesis(
+      int t,
+      const std::vector<std::vector<float>>& amScores,
+      const std::vector<AMStatePtr>& outStates,
+      size_t offset,
+      std::vector<LMStatePtr>& lmStates) = 0;
+
+  /* Store the final hypothesis, `t` being the last step expanded */
+  virtual void searchEnd(int t) = 0;
+
+  friend class BatchSeq2SeqDecoder;
+};
+
+using Seq2SeqDecoderPtr = std::shared_ptr<Seq2SeqDecoder>;
+} // namespace text
+} // namespace lib
+} // namespace fl
@@ -5,11 +5,53 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include "flashlight/lib/text/decoder/Utils.h"
+
+#include <functional>
+#include <numeric>
+
 namespace fl {
 namespace lib {
 namespace text {
 
-// Place holder
+int selectTopTokens(
+    const float* emissions,
+    int N,
+    int k,
+    std::vector<int>& tokens,
+    std::vector<float>& buffer) {
+  tokens.resize(N);
+  if (N <= k) {
+    std::iota(tokens.begin(), tokens.end(), 0);
+    return N;
+  }
+  if (k <= 0) {
+    return 0;
+  }
+
+  // k-th largest value in linear time
+  buffer.assign(emissions, emissions + N);
+  std::nth_element(
+      buffer.begin(), buffer.begin() + k - 1, buffer.end(), std::greater<>());
+  const float kthValue = buffer[k - 1];
+
+  // Branchless compaction of the larger values, then ties up to k
+  int nTokens = 0;
+  for (int i = 0; i < N; i++) {
+    tokens[nTokens] = i;
+    nTokens += emissions[i] > kthValue;
+  }
+  for (int i = 0; i < N && nTokens < k; i++) {
+    if (emissions[i] == kthValue) {
+      tokens[nTokens++] = i;
+    }
+  }
+  std::sort(
+      tokens.begin(),
+      tokens.begin() + nTokens,
+      [emissions](int l, int r) { return emissions[l] > emissions[r]; });
+  return nTokens;
+}
 } // namespace text
 } // namespace lib
 } // namespace fl
@@ -61,6 +61,14 @@ void candidatesAdd(
   }
 }
 
+template <class DecoderState>
+void candidatesMergeAndStore(
+    std::vector<DecoderState*>& candidatePtrs,
+    std::vector<DecoderState>& outputs,
+    const int beamSize,
+    const bool logAdd,
+    const bool returnSorted);
+
 template <class DecoderState>
 void candidatesStore(
     std::vector<DecoderState>& candidates,
@@ -82,6 +90,55 @@ void candidatesStore(
     }
   }
 
+  candidatesMergeAndStore(
+      candidatePtrs, outputs, beamSize, logAdd, returnSorted);
+}
+
+/**
+ * Same as `candidatesStore()`, with the candidate scores also stored
+ * contiguously in `candidateScores`: valid candidates are selected with a
+ * branchless pass over the scores only.
+ */
+template <class DecoderState>
+void candidatesStore(
+    std::vector<DecoderState>& candidates,
+    const std::vector<double>& candidateScores,
+    std::vector<DecoderState*>& candidatePtrs,
+    std::vector<DecoderState>& outputs,
+    const int beamSize,
+    const double threshold,
+    const bool logAdd,
+    const bool returnSorted) {
+  outputs.clear();
+  if (candidates.empty()) {
+    return;
+  }
+
+  /* 1. Select valid candidates */
+  const int nCandidates = candidates.size();
+  candidatePtrs.resize(nCandidates);
+  int nValid = 0;
+  for (int i = 0; i < nCandidates; i++) {
+    candidatePtrs[nValid] = &candidates[i];
+    nValid += candidateScores[i] >= threshold;
+  }
+  candidatePtrs.resize(nValid);
+
+  candidatesMergeAndStore(
+      candidatePtrs, outputs, beamSize, logAdd, returnSorted);
+}
+
+template <class DecoderState>
+void candidatesMergeAndStore(
+    std::vector<DecoderState*>& candidatePtrs,
+    std::vector<DecoderState>& outputs,
+    const int beamSize,
+    const bool logAdd,
+    const bool returnSorted) {
+  if (candidatePtrs.empty()) {
+    return;
+  }
+
   /* 2. Merge candidates */
   std::sort(
       candidatePtrs.begin(),
@@ -142,6 +199,18 @@ void candidatesStore(
   }
 }
 
+/**
+ * Select the indices of the `k` largest values of `emissions` (of size `N`),
+ * sorted by decreasing value, or all the indices in order if `N <= k`.
+ * `buffer` is a scratch buffer. Returns the number of selected indices.
+ */
+int selectTopTokens(
+    const float* emissions,
+    int N,
+    int k,
+    std::vector<int>& tokens,
+    std::vector<float>& buffer);
+
 /* ===================== Result-related operations ===================== */
 
 template <class DecoderState>
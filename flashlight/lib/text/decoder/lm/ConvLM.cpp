@@ -31,6 +31,40 @@ ConvLM::ConvLM(
     throw std::invalid_argument("[ConvLM] History size is too small.");
   }
 
+  loadVocabulary(tokenVocabPath, usrTknDict);
+
+  /* Refresh cache */
+  cacheIndices_.reserve(beamSize_);
+  cache_.resize(beamSize_, std::vector<float>(vocabSize_));
+  slot_.reserve(beamSize_);
+  batchedTokens_.resize(beamSize_ * maxHistorySize_);
+}
+
+ConvLM::ConvLM(
+    const GetConvLmIncrementalScoreFunc& getConvLmIncrementalScoreFunc,
+    const std::string& tokenVocabPath,
+    const Dictionary& usrTknDict,
+    int lmMemory,
+    int beamSize)
+    : lmMemory_(lmMemory),
+      beamSize_(beamSize),
+      getConvLmIncrementalScoreFunc_(getConvLmIncrementalScoreFunc),
+      // the network state replaces the history, only the last token is kept
+      maxHistorySize_(1) {
+  if (lmMemory_ < 1) {
+    throw std::invalid_argument("[ConvLM] LM memory is too small.");
+  }
+  loadVocabulary(tokenVocabPath, usrTknDict);
+
+  /* Refresh cache */
+  cacheIndices_.reserve(beamSize_);
+  cache_.resize(beamSize_, std::vector<float>(vocabSize_));
+  slot_.reserve(beamSize_);
+}
+
+void ConvLM::loadVocabulary(
+    const std::string& tokenVocabPath,
+    const Dictionary& usrTknDict) {
   /* Load token vocabulary */
   // Note: fairseq vocab should start with:
   // <fairseq_style> - 0 <pad> - 1, </s> - 2, <unk> - 3
@@ -47,12 +81,6 @@ ConvLM::ConvLM(
     int lmIdx = vocab_.getIndex(token.c_str());
     usrToLmIdxMap_[i] = lmIdx;
   }
-
-  /* Refresh cache */
-  cacheIndices_.reserve(beamSize_);
-  cache_.resize(beamSize_, std::vector<float>(vocabSize_));
-  slot_.reserve(beamSize_);
-  batchedTokens_.resize(beamSize_ * maxHistorySize_);
 }
 
 LMStatePtr ConvLM::start(bool startWithNothing) {
@@ -77,14 +105,16 @@ std::pair<LMStatePtr, float> ConvLM::scoreWithLmIdx(
 
   // Prepare output state
   if (inStateLength == maxHistorySize_) {
-    outState = std::make_shared<ConvLMState>(maxHistorySize_);
+    outState =
+        LMState::create<ConvLMState>(rawInState->arena, maxHistorySize_);
     std::copy(
         rawInState->tokens.begin() + 1,
         rawInState->tokens.end(),
         outState->tokens.begin());
     outState->tokens[maxHistorySize_ - 1] = tokenIdx;
   } else {
-    outState = std::make_shared<ConvLMState>(inStateLength + 1);
+    outState =
+        LMState::create<ConvLMState>(rawInState->arena, inStateLength + 1);
     std::copy(
         rawInState->tokens.begin(),
         rawInState->tokens.end(),
@@ -115,11 +145,21 @@ std::pair<LMStatePtr, float> ConvLM::scoreWithLmIdx(
     int newIdx = cacheIndices_.size();
     cacheIndices_[rawInState] = newIdx;
 
-    std::vector<int> lastTokenPositions = {rawInState->length - 1};
-    cache_[newIdx] =
-        getConvLmScoreFunc_(rawInState->tokens, lastTokenPositions, -1, 1);
+    if (getConvLmIncrementalScoreFunc_) {
+      std::vector<ConvLMStreamingStatePtr> outStates;
+      cache_[newIdx] = getConvLmIncrementalScoreFunc_(
+          {rawInState->prevStreamingState},
+          {rawInState->tokens[rawInState->length - 1]},
+          outStates);
+      rawInState->streamingState = outStates.front();
+    } else {
+      std::vector<int> lastTokenPositions = {rawInState->length - 1};
+      cache_[newIdx] =
+          getConvLmScoreFunc_(rawInState->tokens, lastTokenPositions, -1, 1);
+    }
     score = cache_[newIdx][tokenIdx];
   }
+  outState->prevStreamingState = rawInState->streamingState;
   if (std::isnan(score) || !std::isfinite(score)) {
     throw std::runtime_error(
         "[ConvLM] Bad scoring from ConvLM: " + std::to_string(score));
@@ -171,6 +211,11 @@ void ConvLM::updateCache(std::vector<LMStatePtr> states) {
     ++cacheSize;
   }
 
+  if (getConvLmIncrementalScoreFunc_) {
+    updateCacheIncremental(states);
+    return;
+  }
+
   // Determine batchsize
   if (longestHistory <= 0) {
     return;
@@ -234,6 +279,55 @@ void ConvLM::updateCache(std::vector<LMStatePtr> states) {
     }
   }
 }
+
+void ConvLM::updateCacheIncremental(const std::vector<LMStatePtr>& states) {
+  // States that are cached already are packed at the beginning of the cache
+  int cacheSize = cacheIndices_.size();
+  int nStates = states.size();
+  int stateIdx = 0;
+  while (stateIdx < nStates) {
+    // Select batch: one frame per hypothesis
+    batchedStreamingStates_.clear();
+    batchedTokens_.clear();
+    slot_.clear();
+    for (; stateIdx < nStates && slot_.size() < lmMemory_; stateIdx++) {
+      auto rawState =
+          std::static_pointer_cast<ConvLMState>(states[stateIdx]).get();
+      if (cacheIndices_.find(rawState) != cacheIndices_.end()) {
+        continue;
+      }
+      cacheIndices_[rawState] = cacheSize + slot_.size();
+      slot_.push_back(rawState);
+      batchedStreamingStates_.push_back(rawState->prevStreamingState);
+      batchedTokens_.push_back(rawState->tokens[rawState->length - 1]);
+    }
+    int nBatchStates = slot_.size();
+    if (nBatchStates == 0) {
+      break;
+    }
+
+    // Feed forward
+    auto batchedProb = getConvLmIncrementalScoreFunc_(
+        batchedStreamingStates_, batchedTokens_, batchedOutStreamingStates_);
+
+    if (batchedProb.size() != vocabSize_ * nBatchStates ||
+        batchedOutStreamingStates_.size() != nBatchStates) {
+      throw std::logic_error(
+          "[ConvLM] Batch X Vocab size " + std::to_string(batchedProb.size()) +
+          " mismatch with " + std::to_string(vocabSize_ * nBatchStates));
+    }
+    // Place probabilities in cache and store the new network states
+    for (int i = 0; i < nBatchStates; i++, cacheSize++) {
+      std::memcpy(
+          cache_[cacheSize].data(),
+          batchedProb.data() + vocabSize_ * i,
+          vocabSize_ * sizeof(float));
+      slot_[i]->streamingState = std::move(batchedOutStreamingStates_[i]);
+    }
+  }
+  batchedStreamingStates_.clear();
+  batchedOutStreamingStates_.clear();
+}
 } // namespace text
 } // namespace lib
 } // namespace fl
@@ -20,10 +20,39 @@ namespace text {
 using GetConvLmScoreFunc = std::function<std::vector<
     float>(const std::vector<int>&, const std::vector<int>&, int, int)>;
 
+/**
+ * Opaque per-hypothesis state of a streaming ConvLM network, e.g. the
+ * receptive-field activations of every causal convolution. Its content is
+ * defined by the `GetConvLmIncrementalScoreFunc` which produces it.
+ */
+struct ConvLMStreamingState {
+  virtual ~ConvLMStreamingState() = default;
+};
+
+using ConvLMStreamingStatePtr = std::shared_ptr<ConvLMStreamingState>;
+
+/**
+ * Scores the next token for a batch of hypotheses in streaming mode.
+ * Arguments are the streaming states of the hypotheses (`nullptr` for an
+ * empty history), the last token to feed to each of them, and the output
+ * vector which is filled with the states after consuming those tokens.
+ * Returns batch x vocabulary scores.
+ */
+using GetConvLmIncrementalScoreFunc = std::function<std::vector<float>(
+    const std::vector<ConvLMStreamingStatePtr>&,
+    const std::vector<int>&,
+    std::vector<ConvLMStreamingStatePtr>&)>;
+
 struct ConvLMState : LMState {
   std::vector<int> tokens;
   int length;
 
+  // Streaming mode only: network state after consuming `tokens`, set once
+  // the state is scored, and the one of the parent hypothesis (excluding the
+  // last token) it is computed from.
+  ConvLMStreamingStatePtr streamingState;
+  ConvLMStreamingStatePtr prevStreamingState;
+
   ConvLMState() : length(0) {}
   explicit ConvLMState(int size)
       : tokens(std::vector<int>(size)), length(size) {}
@@ -39,6 +68,21 @@ class ConvLM : public LM {
       int beamSize = 2500,
       int historySize = 49);
 
+  /**
+   * Streaming ConvLM: instead of re-running the network over the whole
+   * (truncated) history, every hypothesis keeps the network state returned by
+   * `getConvLmIncrementalScoreFunc` so a new token costs a single frame of
+   * compute. The history is thus not truncated to `historySize` tokens but
+   * bounded by the receptive field of the network. `lmMemory` bounds the
+   * number of hypotheses forwarded in one batch.
+   */
+  ConvLM(
+      const GetConvLmIncrementalScoreFunc& getConvLmIncrementalScoreFunc,
+      const std::string& tokenVocabPath,
+      const Dictionary& usrTknDict,
+      int lmMemory = 10000,
+      int beamSize = 2500);
+
   LMStatePtr start(bool startWithNothing) override;
 
   std::pair<LMStatePtr, float> score(
@@ -60,10 +104,19 @@ class ConvLM : public LM {
 
   Dictionary vocab_;
   GetConvLmScoreFunc getConvLmScoreFunc_;
+  GetConvLmIncrementalScoreFunc getConvLmIncrementalScoreFunc_;
+  std::vector<ConvLMStreamingStatePtr> batchedStreamingStates_;
+  std::vector<ConvLMStreamingStatePtr> batchedOutStreamingStates_;
 
   int vocabSize_;
   int maxHistorySize_;
 
+  void loadVocabulary(
+      const std::string& tokenVocabPath,
+      const Dictionary& usrTknDict);
+
+  void updateCacheIncremental(const std::vector<LMStatePtr>& states);
+
   std::pair<LMStatePtr, float> scoreWithLmIdx(
       const LMStatePtr& state,
       const int tokenIdx);
@@ -7,7 +7,9 @@
 
 #include "flashlight/lib/text/decoder/lm/KenLM.h"
 
+#include <new>
 #include <stdexcept>
+#include <type_traits>
 
 #include <kenlm/lm/model.hh>
 
@@ -15,7 +17,17 @@ namespace fl {
 namespace lib {
 namespace text {
 
-KenLMState::KenLMState() : ken_(std::make_unique<lm::ngram::State>()) {}
+static_assert(
+    sizeof(lm::ngram::State) <= KenLMState::kKenStateSize &&
+        alignof(lm::ngram::State) <= alignof(uint32_t),
+    "KenLMState storage doesn't fit lm::ngram::State");
+static_assert(
+    std::is_trivially_destructible<lm::ngram::State>::value,
+    "lm::ngram::State is not destroyed by KenLMState");
+
+KenLMState::KenLMState() {
+  new (ken_) lm::ngram::State();
+}
 
 KenLM::KenLM(const std::string& path, const Dictionary& usrTknDict) {
   // Load LM
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 
 #include "flashlight/lib/text/decoder/lm/LM.h"
@@ -27,6 +29,11 @@ struct State;
 } // namespace ngram
 } // namespace lm
 
+// Same default as KenLM (lm/max_order.hh)
+#ifndef KENLM_MAX_ORDER
+#define KENLM_MAX_ORDER 6
+#endif
+
 namespace fl {
 namespace lib {
 namespace text {
@@ -38,10 +45,19 @@ namespace text {
  */
 struct KenLMState : LMState {
   KenLMState();
-  std::unique_ptr<lm::ngram::State> ken_;
   lm::ngram::State* ken() {
-    return ken_.get();
+    return reinterpret_cast<lm::ngram::State*>(ken_);
   }
+
+  // Size of lm::ngram::State: the words and backoffs of the context, and its
+  // length (checked in KenLM.cpp)
+  static constexpr size_t kKenStateSize =
+      (KENLM_MAX_ORDER - 1) * (sizeof(uint32_t) + sizeof(float)) +
+      sizeof(uint32_t);
+
+ private:
+  // Stored inline so a state is a single (arena) allocation
+  alignas(uint32_t) unsigned char ken_[kKenStateSize];
 };
 
 /**
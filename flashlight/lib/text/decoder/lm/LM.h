@@ -7,29 +7,179 @@
 
 #pragma once
 
+#include <cstdint>
 #include <cstring>
 #include <memory>
 #include <stdexcept>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "flashlight/lib/text/decoder/lm/LMStateArena.h"
+
 namespace fl {
 namespace lib {
 namespace text {
 
+struct LMState;
+
+/**
+ * LMStateChildren maps a token index to the child LM state reached from a
+ * state. It is an open-addressing hash table with linear probing, stored in
+ * a single block allocated from the arena of the state.
+ */
+class LMStateChildren {
+ public:
+  LMStateChildren() = default;
+  LMStateChildren(const LMStateChildren&) = delete;
+  LMStateChildren& operator=(const LMStateChildren&) = delete;
+
+  ~LMStateChildren() {
+    release();
+  }
+
+  /* Returns the child state for `usrIdx` or nullptr if there is none */
+  std::shared_ptr<LMState>* find(int usrIdx) {
+    if (size_ == 0) {
+      return nullptr;
+    }
+    for (uint32_t i = slotOf(usrIdx);; i = (i + 1) & (capacity_ - 1)) {
+      if (!entries_[i].state) {
+        return nullptr;
+      }
+      if (entries_[i].usrIdx == usrIdx) {
+        return &entries_[i].state;
+      }
+    }
+  }
+
+  /**
+   * Returns the child slot for `usrIdx`, inserting an empty one (which must be
+   * filled before any other insertion) if missing. The table storage is
+   * allocated from `arena` (if any).
+   */
+  std::shared_ptr<LMState>& insert(int usrIdx, LMStateArena* arena) {
+    if (auto state = find(usrIdx)) {
+      return *state;
+    }
+    if ((size_ + 1) * 4 > capacity_ * 3) {
+      grow(arena);
+    }
+    uint32_t i = slotOf(usrIdx);
+    while (entries_[i].state) {
+      i = (i + 1) & (capacity_ - 1);
+    }
+    entries_[i].usrIdx = usrIdx;
+    ++size_;
+    return entries_[i].state;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  /* Calls `fn(usrIdx, state)` for every child */
+  template <typename Fn>
+  void forEach(Fn&& fn) const {
+    for (uint32_t i = 0; i < capacity_; i++) {
+      if (entries_[i].state) {
+        fn(entries_[i].usrIdx, entries_[i].state);
+      }
+    }
+  }
+
+ private:
+  struct Entry {
+    int usrIdx;
+    std::shared_ptr<LMState> state;
+  };
+
+  Entry* entries_{nullptr};
+  uint32_t capacity_{0};
+  uint32_t size_{0};
+  int shift_{32};
+  LMStateArena* arena_{nullptr};
+
+  uint32_t slotOf(int usrIdx) const {
+    // Fibonacci hashing, capacity_ is 2^(32 - shift_)
+    return (static_cast<uint32_t>(usrIdx) * 2654435769u) >> shift_;
+  }
+
+  void grow(LMStateArena* arena) {
+    Entry* oldEntries = entries_;
+    uint32_t oldCapacity = capacity_;
+    LMStateArena* oldArena = arena_;
+
+    capacity_ = oldCapacity == 0 ? 4 : oldCapacity * 2;
+    shift_ = oldCapacity == 0 ? 30 : shift_ - 1;
+    arena_ = arena;
+    entries_ = LMStateArenaAllocator<Entry>(arena_).allocate(capacity_);
+    for (uint32_t i = 0; i < capacity_; i++) {
+      new (entries_ + i) Entry();
+    }
+    for (uint32_t i = 0; i < oldCapacity; i++) {
+      if (oldEntries[i].state) {
+        uint32_t j = slotOf(oldEntries[i].usrIdx);
+        while (entries_[j].state) {
+          j = (j + 1) & (capacity_ - 1);
+        }
+        entries_[j].usrIdx = oldEntries[i].usrIdx;
+        entries_[j].state = std::move(oldEntries[i].state);
+      }
+    }
+    destroy(oldEntries, oldCapacity, oldArena);
+  }
+
+  void release() {
+    destroy(entries_, capacity_, arena_);
+    entries_ = nullptr;
+    capacity_ = 0;
+    size_ = 0;
+    shift_ = 32;
+  }
+
+  static void destroy(Entry* entries, uint32_t capacity, LMStateArena* arena) {
+    if (!entries) {
+      return;
+    }
+    for (uint32_t i = 0; i < capacity; i++) {
+      entries[i].~Entry();
+    }
+    LMStateArenaAllocator<Entry>(arena).deallocate(entries, capacity);
+  }
+};
+
 struct LMState {
-  std::unordered_map<int, std::shared_ptr<LMState>> children;
+  LMStateChildren children;
+  /* Arena the children are allocated from; global allocator if unset */
+  LMStateArenaPtr arena;
+
+  /* Create an LM state allocated from `arena` (global allocator if unset) */
+  template <typename T, typename... Args>
+  static std::shared_ptr<T> create(const LMStateArenaPtr& arena, Args&&... args) {
+    std::shared_ptr<T> state;
+    if (arena) {
+      state = std::allocate_shared<T>(
+          LMStateArenaAllocator<T>(arena.get()), std::forward<Args>(args)...);
+      state->arena = arena;
+    } else {
+      state = std::make_shared<T>(std::forward<Args>(args)...);
+    }
+    return state;
+  }
 
   template <typename T>
   std::shared_ptr<T> child(int usrIdx) {
-    auto s = children.find(usrIdx);
-    if (s == children.end()) {
-      auto state = std::make_shared<T>();
-      children[usrIdx] = state;
+    auto& slot = children.insert(usrIdx, arena.get());
+    if (!slot) {
+      auto state = create<T>(arena);
+      slot = state;
       return state;
     } else {
-      return std::static_pointer_cast<T>(s->second);
+      return std::static_pointer_cast<T>(slot);
     }
   }
 
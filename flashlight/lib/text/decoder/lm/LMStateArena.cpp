@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "flashlight/lib/text/decoder/lm/LMStateArena.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace fl {
+namespace lib {
+namespace text {
+
+namespace {
+
+// Blocks are rounded up to a multiple of the alignment; each free block holds
+// the pointer to the next one
+size_t sizeClassOf(size_t bytes, size_t alignment) {
+  return bytes == 0 ? 1 : (bytes + alignment - 1) / alignment;
+}
+
+} // namespace
+
+LMStateArenaPtr::LMStateArenaPtr(LMStateArena* arena) : arena_(arena) {
+  if (arena_) {
+    arena_->acquire();
+  }
+}
+
+LMStateArenaPtr::LMStateArenaPtr(const LMStateArenaPtr& other)
+    : LMStateArenaPtr(other.arena_) {}
+
+LMStateArenaPtr::LMStateArenaPtr(LMStateArenaPtr&& other) noexcept
+    : arena_(other.arena_) {
+  other.arena_ = nullptr;
+}
+
+LMStateArenaPtr& LMStateArenaPtr::operator=(LMStateArenaPtr other) noexcept {
+  std::swap(arena_, other.arena_);
+  return *this;
+}
+
+LMStateArenaPtr::~LMStateArenaPtr() {
+  if (arena_) {
+    arena_->release();
+  }
+}
+
+LMStateArenaPtr LMStateArena::create(size_t chunkSize) {
+  if (chunkSize < kMaxBlockSize) {
+    throw std::invalid_argument(
+        "[LMStateArena] Chunk size should be at least " +
+        std::to_string(kMaxBlockSize));
+  }
+  return LMStateArenaPtr(new LMStateArena(chunkSize));
+}
+
+LMStateArena::LMStateArena(size_t chunkSize)
+    : chunkSize_(chunkSize / kAlignment * kAlignment),
+      freeLists_(kMaxBlockSize / kAlignment + 1, nullptr) {}
+
+void* LMStateArena::allocate(size_t bytes) {
+  size_t sizeClass = sizeClassOf(bytes, kAlignment);
+  // Large blocks are counted as well: they keep the arena alive
+  ++numLiveBlocks_;
+  if (sizeClass >= freeLists_.size()) {
+    return ::operator new(bytes);
+  }
+  // Recycle a released block of the same size class first
+  void* block = freeLists_[sizeClass];
+  if (block) {
+    freeLists_[sizeClass] = *static_cast<void**>(block);
+    return block;
+  }
+  size_t blockSize = sizeClass * kAlignment;
+  if (currentChunk_ == chunks_.size() ||
+      chunkOffset_ + blockSize > chunkSize_) {
+    if (currentChunk_ < chunks_.size()) {
+      ++currentChunk_;
+    }
+    if (currentChunk_ == chunks_.size()) {
+      chunks_.emplace_back(new char[chunkSize_]);
+    }
+    chunkOffset_ = 0;
+  }
+  block = chunks_[currentChunk_].get() + chunkOffset_;
+  chunkOffset_ += blockSize;
+  return block;
+}
+
+void LMStateArena::deallocate(void* ptr, size_t bytes) {
+  size_t sizeClass = sizeClassOf(bytes, kAlignment);
+  if (sizeClass >= freeLists_.size()) {
+    ::operator delete(ptr);
+  } else {
+    *static_cast<void**>(ptr) = freeLists_[sizeClass];
+    freeLists_[sizeClass] = ptr;
+  }
+  --numLiveBlocks_;
+  if (numLiveBlocks_ == 0 && numRefs_ == 0) {
+    delete this;
+  }
+}
+
+void LMStateArena::reset() {
+  if (numLiveBlocks_ > 0) {
+    return;
+  }
+  std::fill(freeLists_.begin(), freeLists_.end(), nullptr);
+  currentChunk_ = 0;
+  chunkOffset_ = 0;
+}
+
+void LMStateArena::release() {
+  --numRefs_;
+  if (numLiveBlocks_ == 0 && numRefs_ == 0) {
+    delete this;
+  }
+}
+} // namespace text
+} // namespace lib
+} // namespace fl
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace fl {
+namespace lib {
+namespace text {
+
+class LMStateArena;
+
+/**
+ * LMStateArenaPtr is a reference to an LMStateArena. An arena is released
+ * once its last reference is dropped and its last block is deallocated, so LM
+ * states can safely outlive the decoder which created the arena. Like the
+ * arena itself, references are not thread-safe.
+ */
+class LMStateArenaPtr {
+ public:
+  LMStateArenaPtr() = default;
+  explicit LMStateArenaPtr(LMStateArena* arena);
+  LMStateArenaPtr(const LMStateArenaPtr& other);
+  LMStateArenaPtr(LMStateArenaPtr&& other) noexcept;
+  LMStateArenaPtr& operator=(LMStateArenaPtr other) noexcept;
+  ~LMStateArenaPtr();
+
+  LMStateArena* get() const {
+    return arena_;
+  }
+
+  LMStateArena* operator->() const {
+    return arena_;
+  }
+
+  explicit operator bool() const {
+    return arena_ != nullptr;
+  }
+
+ private:
+  LMStateArena* arena_ = nullptr;
+};
+
+/**
+ * LMStateArena is a pool for the LM states (and their children tables)
+ * created while decoding one utterance. Memory is carved out of large chunks
+ * into a few size classes and recycled through free lists, so expanding a
+ * hypothesis never goes to the global allocator once the arena is warm.
+ * Each decoder owns one arena and rewinds it with `reset()` at the beginning
+ * of every utterance. Not thread-safe.
+ */
+class LMStateArena {
+ public:
+  static constexpr size_t kDefaultChunkSize = 1 << 16;
+
+  /* Create an arena allocating chunks of `chunkSize` bytes */
+  static LMStateArenaPtr create(size_t chunkSize = kDefaultChunkSize);
+
+  LMStateArena(const LMStateArena&) = delete;
+  LMStateArena& operator=(const LMStateArena&) = delete;
+
+  /**
+   * Allocate a block of `bytes` aligned on `alignof(std::max_align_t)`.
+   * Blocks which do not fit in a size class go to the global allocator.
+   */
+  void* allocate(size_t bytes);
+
+  /* Release a block returned by `allocate(bytes)` */
+  void deallocate(void* ptr, size_t bytes);
+
+  /**
+   * Rewind the arena, keeping the chunks allocated so far for reuse. No-op if
+   * blocks are still in use.
+   */
+  void reset();
+
+  /* Number of blocks currently allocated from the arena */
+  size_t numLiveBlocks() const {
+    return numLiveBlocks_;
+  }
+
+  /* Total size of the chunks owned by the arena */
+  size_t capacity() const {
+    return chunks_.size() * chunkSize_;
+  }
+
+ private:
+  friend class LMStateArenaPtr;
+
+  static constexpr size_t kAlignment = alignof(std::max_align_t);
+  static constexpr size_t kMaxBlockSize = 1024;
+
+  explicit LMStateArena(size_t chunkSize);
+  ~LMStateArena() = default;
+
+  void acquire() {
+    ++numRefs_;
+  }
+  void release();
+
+  size_t chunkSize_;
+  std::vector<std::unique_ptr<char[]>> chunks_;
+  size_t currentChunk_{0};
+  size_t chunkOffset_{0};
+  // Heads of the intrusive free lists, one per size class
+  std::vector<void*> freeLists_;
+  size_t numLiveBlocks_{0};
+  size_t numRefs_{0};
+};
+
+/**
+ * Standard allocator over an LMStateArena (global allocator if none), used to
+ * allocate LM states with `std::allocate_shared`.
+ */
+template <typename T>
+class LMStateArenaAllocator {
+ public:
+  using value_type = T;
+
+  explicit LMStateArenaAllocator(LMStateArena* arena = nullptr) noexcept
+      : arena_(arena) {}
+
+  template <typename U>
+  LMStateArenaAllocator(const LMStateArenaAllocator<U>& other) noexcept
+      : arena_(other.arena()) {}
+
+  T* allocate(size_t n) {
+    static_assert(
+        alignof(T) <= alignof(std::max_align_t),
+        "LMStateArenaAllocator: over-aligned types are not supported");
+    if (!arena_) {
+      return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    return static_cast<T*>(arena_->allocate(n * sizeof(T)));
+  }
+
+  void deallocate(T* ptr, size_t n) noexcept {
+    if (!arena_) {
+      ::operator delete(ptr);
+      return;
+    }
+    arena_->deallocate(ptr, n * sizeof(T));
+  }
+
+  LMStateArena* arena() const noexcept {
+    return arena_;
+  }
+
+ private:
+  LMStateArena* arena_;
+};
+
+template <typename T, typename U>
+bool operator==(
+    const LMStateArenaAllocator<T>& lhs,
+    const LMStateArenaAllocator<U>& rhs) {
+  return lhs.arena() == rhs.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(
+    const LMStateArenaAllocator<T>& lhs,
+    const LMStateArenaAllocator<U>& rhs) {
+  return !(lhs == rhs);
+}
+} // namespace text
+} // namespace lib
+} // namespace fl
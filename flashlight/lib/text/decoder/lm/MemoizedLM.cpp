@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "flashlight/lib/text/decoder/lm/MemoizedLM.h"
+
+#include <limits>
+#include <stdexcept>
+
+namespace fl {
+namespace lib {
+namespace text {
+
+namespace {
+// Children key of the state returned by `finish()`
+constexpr int kFinishKey = std::numeric_limits<int>::min();
+} // namespace
+
+MemoizedLM::MemoizedLM(const LMPtr& lm)
+    : lm_(lm), arena_(LMStateArena::create()) {
+  if (!lm_) {
+    throw std::invalid_argument("[MemoizedLM] LM is null");
+  }
+}
+
+void MemoizedLM::clear() {
+  roots_[0].reset();
+  roots_[1].reset();
+  numLmQueries_ = 0;
+  // No-op if states of the previous utterance are still referenced
+  arena_->reset();
+}
+
+LMStatePtr MemoizedLM::start(bool startWithNothing) {
+  ++pass_;
+  auto& root = roots_[startWithNothing ? 1 : 0];
+  if (!root) {
+    root = std::make_shared<MemoizedLMState>();
+    root->lmState = lm_->start(startWithNothing);
+    if (!root->lmState->arena) {
+      root->lmState->arena = arena_;
+    }
+  }
+  return root;
+}
+
+std::shared_ptr<MemoizedLMState> MemoizedLM::memoize(
+    MemoizedLMState* state,
+    int key) {
+  auto first = state->child<MemoizedLMState>(key);
+  if (first->pass != pass_) {
+    first->pass = pass_;
+    first->numQueries = 0;
+  }
+  size_t query = first->numQueries++;
+  if (first->canonical) {
+    return first;
+  }
+  std::shared_ptr<MemoizedLMState> outState;
+  if (query == 0) {
+    outState = first;
+  } else if (query <= first->repeats.size()) {
+    outState = first->repeats[query - 1];
+  }
+  if (outState && outState->lmState) {
+    return outState;
+  }
+
+  auto lmResult = key == kFinishKey ? lm_->finish(state->lmState)
+                                    : lm_->score(state->lmState, key);
+  ++numLmQueries_;
+  if (query > 0 && lmResult.first == first->lmState) {
+    // The LM returns the same state for the pair: so does the memo
+    first->canonical = true;
+    return first;
+  }
+  if (!outState) {
+    outState = LMState::create<MemoizedLMState>(state->arena);
+    first->repeats.push_back(outState);
+  }
+  outState->lmState = std::move(lmResult.first);
+  outState->score = lmResult.second;
+  return outState;
+}
+
+std::pair<LMStatePtr, float> MemoizedLM::score(
+    const LMStatePtr& state,
+    const int usrTokenIdx) {
+  auto outState =
+      memoize(static_cast<MemoizedLMState*>(state.get()), usrTokenIdx);
+  float score = outState->score;
+  return std::make_pair(std::move(outState), score);
+}
+
+std::pair<LMStatePtr, float> MemoizedLM::finish(const LMStatePtr& state) {
+  auto outState =
+      memoize(static_cast<MemoizedLMState*>(state.get()), kFinishKey);
+  float score = outState->score;
+  return std::make_pair(std::move(outState), score);
+}
+
+void MemoizedLM::updateCache(std::vector<LMStatePtr> states) {
+  // States already seen in a previous pass were cached then: their scores
+  // are memoized, and the LM falls back to scoring any new token directly
+  uncachedStates_.clear();
+  for (const auto& state : states) {
+    auto memoState = static_cast<MemoizedLMState*>(state.get());
+    if (!memoState->cached) {
+      memoState->cached = true;
+      uncachedStates_.push_back(memoState->lmState);
+    }
+  }
+  if (!uncachedStates_.empty()) {
+    lm_->updateCache(uncachedStates_);
+  }
+  uncachedStates_.clear();
+}
+} // namespace text
+} // namespace lib
+} // namespace fl
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "flashlight/lib/text/decoder/lm/LM.h"
+
+namespace fl {
+namespace lib {
+namespace text {
+
+/**
+ * MemoizedLMState wraps a state of the underlying language model together
+ * with the score which led to it, so that each (state, token) pair is scored
+ * only once.
+ */
+struct MemoizedLMState : LMState {
+  LMStatePtr lmState;
+  float score{0};
+  /* Whether `lmState` was passed to `LM::updateCache()` already */
+  bool cached{false};
+
+  /*
+   * Kept in the first state reached from a (state, token) pair. The decoders
+   * merge hypotheses with the same LM state, so the memo returns a new state
+   * for each query of the pair in a pass unless the underlying LM returned
+   * the same state twice. `repeats` are the states of the queries after the
+   * first one.
+   */
+  std::vector<std::shared_ptr<MemoizedLMState>> repeats;
+  bool canonical{false};
+  size_t pass{0};
+  size_t numQueries{0};
+};
+/**
+ * MemoizedLM keeps the scores returned by another language model so that
+ * decoding the same utterance several times (e.g. with different LM weights
+ * and word scores) queries the underlying LM only for new histories.
+ *
+ * Each call to `start()` begins a pass. Within a pass, states are shared
+ * exactly when the underlying LM shares them, so that hypotheses are merged
+ * as they would be without the memo. Telling whether the LM shares states
+ * costs one more query for the pairs scored twice in the first pass.
+ *
+ * The memo grows with the number of decoding passes and should be cleared
+ * with `clear()` before decoding a new utterance.
+ */
+class MemoizedLM : public LM {
+ public:
+  explicit MemoizedLM(const LMPtr& lm);
+
+  /* Drop the memoized states and scores */
+  void clear();
+
+  /* Number of queries forwarded to the underlying LM since `clear()` */
+  size_t numLmQueries() const {
+    return numLmQueries_;
+  }
+
+  LMStatePtr start(bool startWithNothing) override;
+
+  std::pair<LMStatePtr, float> score(
+      const LMStatePtr& state,
+      const int usrTokenIdx) override;
+
+  std::pair<LMStatePtr, float> finish(const LMStatePtr& state) override;
+
+  void updateCache(std::vector<LMStatePtr> states) override;
+
+ private:
+  LMPtr lm_;
+  LMStateArenaPtr arena_;
+  /* Root states, for `startWithNothing` false and true */
+  std::shared_ptr<MemoizedLMState> roots_[2];
+  size_t pass_{0};
+  size_t numLmQueries_{0};
+  std::vector<LMStatePtr> uncachedStates_;
+
+  /*
+   * Returns the state reached from `state` with token `key` (or
+   * `kFinishKey`), querying the underlying LM if it isn't memoized
+   */
+  std::shared_ptr<MemoizedLMState> memoize(
+      MemoizedLMState* state,
+      int key);
+};
+
+using MemoizedLMPtr = std::shared_ptr<MemoizedLM>;
+} // namespace text
+} // namespace lib
+} // namespace fl